@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "BackgroundJobs.h"
+#include "Gui.h"
+#include "ImGuiHelpers.h"
+
+namespace clk = std::chrono;
+
+/// The jobs are only accessed from the main thread
+static std::vector<std::unique_ptr<BackgroundJob>> &GetJobs() {
+    static std::vector<std::unique_ptr<BackgroundJob>> jobs;
+    return jobs;
+}
+
+BackgroundJob::BackgroundJob(const std::string &name) : _name(name), _startTime(clk::steady_clock::now()) {}
+
+std::string BackgroundJob::GetStatus() const {
+    std::lock_guard<std::mutex> lock(_statusMutex);
+    return _status;
+}
+
+void BackgroundJob::SetStatus(const std::string &status) {
+    std::lock_guard<std::mutex> lock(_statusMutex);
+    _status = status;
+}
+
+double BackgroundJob::GetElapsedSeconds() const {
+    const auto end = _finished ? _endTime : clk::steady_clock::now();
+    return clk::duration<double>(end - _startTime).count();
+}
+
+double BackgroundJob::GetRemainingSeconds() const {
+    const float progress = _progress;
+    if (_finished) {
+        return 0.0;
+    }
+    if (progress <= 0.f) {
+        return -1.0;
+    }
+    return GetElapsedSeconds() * (1.0 - progress) / progress;
+}
+
+void LaunchBackgroundJob(std::unique_ptr<BackgroundJob> job) {
+    if (job) {
+        GetJobs().emplace_back(std::move(job));
+    }
+}
+
+void UpdateBackgroundJobs() {
+    auto &jobs = GetJobs();
+    // Iterating with an index as a job can launch other jobs
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        BackgroundJob *job = jobs[i].get();
+        if (!job->_finished && !job->Step()) {
+            job->_finished = true;
+            job->_endTime = clk::steady_clock::now();
+        }
+    }
+}
+
+bool HasRunningBackgroundJobs() {
+    for (const auto &job : GetJobs()) {
+        if (!job->IsFinished()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void CancelBackgroundJobs() {
+    for (auto &job : GetJobs()) {
+        job->Cancel();
+    }
+    // The jobs are still stepped on the main thread as they release their GL resources in Step, the workers have time
+    // to finish between two steps
+    UpdateBackgroundJobs();
+    while (HasRunningBackgroundJobs()) {
+        std::this_thread::sleep_for(clk::milliseconds(5));
+        UpdateBackgroundJobs();
+    }
+}
+
+void ShutdownBackgroundJobs() {
+    CancelBackgroundJobs();
+    GetJobs().clear();
+}
+
+static std::string FormatDuration(double seconds) {
+    if (seconds < 0.0) {
+        return "--:--";
+    }
+    const int totalSeconds = static_cast<int>(seconds + 0.5);
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%02d:%02d", totalSeconds / 60, totalSeconds % 60);
+    return buffer;
+}
+
+void DrawBackgroundJobs() {
+    auto &jobs = GetJobs();
+    if (jobs.empty()) {
+        ImGui::Text("No background job");
+        return;
+    }
+    ImGui::BeginDisabled(!std::any_of(jobs.begin(), jobs.end(), [](const auto &job) { return job->IsFinished(); }));
+    if (ImGui::Button("Clear finished")) {
+        jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [](const auto &job) { return job->IsFinished(); }), jobs.end());
+    }
+    ImGui::EndDisabled();
+    for (auto &job : jobs) {
+        ImGui::PushID(job.get());
+        ImGui::Separator();
+        ImGui::Text("%s", job->GetName().c_str());
+        char overlay[64];
+        snprintf(overlay, sizeof(overlay), "%.0f%%", job->GetProgress() * 100.f);
+        ImGui::ProgressBar(job->GetProgress(), ImVec2(-FLT_MIN, 0), overlay);
+        ImGui::Text("Elapsed %s  Remaining %s", FormatDuration(job->GetElapsedSeconds()).c_str(),
+                    FormatDuration(job->GetRemainingSeconds()).c_str());
+        if (!job->IsFinished()) {
+            ImGui::SameLine();
+            ImGui::BeginDisabled(job->IsCancelled());
+            if (ImGui::SmallButton("Cancel")) {
+                job->Cancel();
+            }
+            ImGui::EndDisabled();
+        }
+        const std::string status = job->GetStatus();
+        if (!status.empty()) {
+            ImGui::TextWrapped("%s", status.c_str());
+        }
+        job->DrawDetails();
+        ImGui::PopID();
+    }
+}
+
+bool DrawBackgroundJobsStatus() {
+    int running = 0;
+    float progress = 0.f;
+    for (const auto &job : GetJobs()) {
+        if (!job->IsFinished()) {
+            running++;
+            progress += job->GetProgress();
+        }
+    }
+    if (running == 0) {
+        return false;
+    }
+    char label[64];
+    snprintf(label, sizeof(label), ICON_FA_COGS " %d job%s %.0f%%", running, running > 1 ? "s" : "",
+             100.f * progress / static_cast<float>(running));
+    return ImGui::Selectable(label, false, ImGuiSelectableFlags_None, ImGui::CalcTextSize(label));
+}
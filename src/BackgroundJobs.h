@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+
+///
+/// Long running tasks (playblasts, exports, saves ...) executed without blocking the UI.
+/// A job is stepped once per frame on the main thread, with the GL context current, and can offload its
+/// work to worker threads. The progress and status can be written by the workers and are read by the UI.
+///
+class BackgroundJob {
+  public:
+    BackgroundJob(const std::string &name);
+    virtual ~BackgroundJob() {}
+
+    BackgroundJob(const BackgroundJob &) = delete;
+    BackgroundJob &operator=(const BackgroundJob &) = delete;
+
+    /// Called on the main thread at every frame. Returns false when the job has finished, it is then
+    /// never called again.
+    virtual bool Step() = 0;
+
+    /// Additional information drawn under the progress bar in the jobs window
+    virtual void DrawDetails() {}
+
+    const std::string &GetName() const { return _name; }
+
+    /// Progress between 0 and 1
+    float GetProgress() const { return _progress; }
+    std::string GetStatus() const;
+
+    double GetElapsedSeconds() const;
+    /// Estimated remaining time computed from the progress, negative when unknown
+    double GetRemainingSeconds() const;
+
+    void Cancel() { _cancelled = true; }
+    bool IsCancelled() const { return _cancelled; }
+
+    /// Set when Step returned false
+    bool IsFinished() const { return _finished; }
+
+  protected:
+    void SetProgress(float progress) { _progress = progress; }
+    void SetStatus(const std::string &status);
+
+  private:
+    friend void UpdateBackgroundJobs();
+    std::string _name;
+    std::atomic<float> _progress{0.f};
+    std::atomic<bool> _cancelled{false};
+    bool _finished = false;
+    std::chrono::time_point<std::chrono::steady_clock> _startTime;
+    std::chrono::time_point<std::chrono::steady_clock> _endTime;
+    mutable std::mutex _statusMutex;
+    std::string _status;
+};
+
+/// Add a job to the list of running jobs, it will be stepped from the next frame
+void LaunchBackgroundJob(std::unique_ptr<BackgroundJob> job);
+
+/// Step all the running jobs, this is called once per frame in the main loop
+void UpdateBackgroundJobs();
+
+bool HasRunningBackgroundJobs();
+
+/// Cancel all the running jobs and wait for them to finish
+void CancelBackgroundJobs();
+
+/// Cancel and destroy all the jobs. Called when the editor is deleted, while the GL context is still alive
+void ShutdownBackgroundJobs();
+
+/// Draw the list of jobs with their progress, ETA and a cancel button
+void DrawBackgroundJobs();
+
+/// Compact summary of the running jobs for the status bar, returns true if it was clicked
+bool DrawBackgroundJobsStatus();
@@ -2,6 +2,11 @@
 
 CommandLineOptions::CommandLineOptions(int argc, char *const *argv) {
     for (int i = 1; i < argc; ++i) {
-        _stages.push_back(argv[i]);
+        const std::string argument(argv[i]);
+        if (argument == "--malloc-tags") {
+            _mallocTags = true;
+        } else {
+            _stages.push_back(argument);
+        }
     }
 }
@@ -7,6 +7,10 @@ class CommandLineOptions {
 
     const std::vector<std::string> &stages() { return _stages; }
 
+    /// --malloc-tags enables the TfMallocTag collection for the memory panel
+    bool mallocTags() const { return _mallocTags; }
+
   private:
     std::vector<std::string> _stages;
+    bool _mallocTags = false;
 };
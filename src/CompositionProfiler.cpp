@@ -0,0 +1,483 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include <pxr/base/arch/timing.h>
+#include <pxr/base/tf/enum.h>
+#include <pxr/base/trace/aggregateNode.h>
+#include <pxr/base/trace/collector.h>
+#include <pxr/base/trace/reporter.h>
+#include <pxr/base/trace/reporterDataSourceCollector.h>
+#include <pxr/base/work/loops.h>
+#include <pxr/usd/pcp/layerStack.h>
+#include <pxr/usd/pcp/node.h>
+#include <pxr/usd/pcp/primIndex.h>
+#include <pxr/usd/usd/primCompositionQuery.h>
+#include <pxr/usd/usd/primRange.h>
+
+#include "Commands.h"
+#include "CompositionProfiler.h"
+#include "Gui.h"
+#include "ImGuiHelpers.h"
+
+/// Arc types with their own column, the other types are only counted in the nodes
+static constexpr PcpArcType ProfiledArcTypes[] = {PcpArcTypeReference, PcpArcTypePayload, PcpArcTypeInherit,
+                                                  PcpArcTypeSpecialize, PcpArcTypeVariant};
+static constexpr const char *ProfiledArcNames[] = {"References", "Payloads", "Inherits", "Specializes", "Variants"};
+static constexpr size_t NbProfiledArcTypes = sizeof(ProfiledArcTypes) / sizeof(ProfiledArcTypes[0]);
+
+/// Strongest arc of a prim, with the layer and the prim spec authoring it
+struct StrongestArc {
+    SdfLayerHandle layer;
+    SdfPath path;
+    PcpArcType arcType = PcpArcTypeRoot;
+};
+
+struct PrimCompositionStats {
+    SdfPath path;
+    size_t nodes = 0;
+    size_t specs = 0;
+    /// Largest number of layers in the layer stacks of the nodes
+    size_t layerStackDepth = 0;
+    std::array<size_t, NbProfiledArcTypes> arcs{};
+    /// Found the first time the row is hovered, the composition query is too slow to run on every prim
+    StrongestArc strongestArc;
+    bool hasStrongestArc = false;
+};
+
+struct LayerCompositionStats {
+    SdfLayerHandle layer;
+    /// Number of specs of the layer contributing to the prim indices
+    size_t specs = 0;
+    /// Number of nodes of the prim indices whose layer stack is rooted at this layer
+    size_t nodes = 0;
+};
+
+struct TraceScopeStats {
+    TfToken key;
+    double inclusiveMs = 0.0;
+    double exclusiveMs = 0.0;
+    size_t count = 0;
+};
+
+struct CompositionProfile {
+    UsdStageWeakPtr stage;
+    double elapsedSeconds = 0.0;
+    size_t totalNodes = 0;
+    size_t maxNodes = 0;
+    std::vector<PrimCompositionStats> prims;
+    std::vector<LayerCompositionStats> layers;
+    std::vector<TraceScopeStats> scopes;
+    /// Position of the prims in the prims vector, for the outliner lookups
+    std::unordered_map<SdfPath, size_t, SdfPath::Hash> primPositions;
+    /// The tables are sorted again when new results are drawn the first time
+    bool primsSorted = false;
+    bool layersSorted = false;
+    bool scopesSorted = false;
+};
+
+// Replaced by each profiling run, also read by the outliner for its heat colors. Only accessed from the main thread
+static CompositionProfile profile;
+
+static void ComputePrimStats(const UsdPrim &prim, PrimCompositionStats &stats) {
+    stats.path = prim.GetPath();
+    const PcpPrimIndex &index = prim.GetPrimIndex();
+    if (!index.IsValid()) {
+        return;
+    }
+    const PcpPrimRange primRange = index.GetPrimRange();
+    stats.specs = std::distance(primRange.first, primRange.second);
+    // The nodes are iterated in strength order, so the first arc found is the strongest
+    TF_FOR_ALL(node, index.GetNodeRange()) {
+        stats.nodes++;
+        const PcpArcType arcType = node->GetArcType();
+        for (size_t i = 0; i < NbProfiledArcTypes; ++i) {
+            if (arcType == ProfiledArcTypes[i]) {
+                stats.arcs[i]++;
+            }
+        }
+        if (const PcpLayerStackRefPtr &layerStack = node->GetLayerStack()) {
+            stats.layerStackDepth = std::max(stats.layerStackDepth, layerStack->GetLayers().size());
+        }
+    }
+}
+
+static StrongestArc FindStrongestArc(const SdfPath &primPath) {
+    StrongestArc strongest;
+    const UsdPrim prim = profile.stage ? profile.stage->GetPrimAtPath(primPath) : UsdPrim();
+    if (!prim) {
+        return strongest;
+    }
+    // The arcs are in strength order, the implied arcs have no introducing layer
+    UsdPrimCompositionQuery query(prim);
+    for (const auto &arc : query.GetCompositionArcs()) {
+        if (arc.GetArcType() != PcpArcTypeRoot && arc.GetIntroducingLayer()) {
+            strongest.layer = arc.GetIntroducingLayer();
+            strongest.path = arc.GetIntroducingPrimPath();
+            strongest.arcType = arc.GetArcType();
+            return strongest;
+        }
+    }
+    // No arc, jump to the strongest spec instead
+    const SdfPrimSpecHandleVector primStack = prim.GetPrimStack();
+    if (!primStack.empty()) {
+        strongest.layer = primStack.front()->GetLayer();
+        strongest.path = primStack.front()->GetPath();
+    }
+    return strongest;
+}
+
+static const StrongestArc &GetStrongestArc(PrimCompositionStats &stats) {
+    if (!stats.hasStrongestArc) {
+        stats.strongestArc = FindStrongestArc(stats.path);
+        stats.hasStrongestArc = true;
+    }
+    return stats.strongestArc;
+}
+
+static void ComputeLayerStats(const UsdPrim &prim, std::map<SdfLayerHandle, LayerCompositionStats> &layers) {
+    const PcpPrimIndex &index = prim.GetPrimIndex();
+    if (!index.IsValid()) {
+        return;
+    }
+    TF_FOR_ALL(site, index.GetPrimRange()) { layers[site->layer].specs++; }
+    TF_FOR_ALL(node, index.GetNodeRange()) {
+        if (const PcpLayerStackRefPtr &layerStack = node->GetLayerStack()) {
+            layers[layerStack->GetIdentifier().rootLayer].nodes++;
+        }
+    }
+}
+
+static void CollectTraceScopes(const TraceAggregateNodePtr &node, std::map<TfToken, TraceScopeStats> &scopes) {
+    for (const auto &child : node->GetChildren()) {
+        // Recursive scopes are summed, so their inclusive time can be larger than the total
+        auto &scope = scopes[child->GetKey()];
+        scope.key = child->GetKey();
+        scope.inclusiveMs += ArchTicksToSeconds(child->GetInclusiveTime()) * 1000.0;
+        scope.exclusiveMs += ArchTicksToSeconds(child->GetExclusiveTime()) * 1000.0;
+        scope.count += child->GetCount();
+        CollectTraceScopes(child, scopes);
+    }
+}
+
+/// Returns true if the layers can be reloaded from disk without losing edits
+static bool CanReloadLayers(const UsdStageRefPtr &stage) {
+    for (const auto &layer : stage->GetUsedLayers()) {
+        if (layer->IsDirty() && !layer->IsAnonymous()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Recompose the stage, or reload its layers from disk and recompose it, under the TraceCollector, then compute
+/// the statistics of the prim indices of the recomposed stage.
+static void ProfileStageComposition(const UsdStageRefPtr &stage, bool reloadLayers) {
+    TraceCollector &collector = TraceCollector::GetInstance();
+    const bool collectorWasEnabled = collector.IsEnabled();
+    TraceReporterPtr reporter = TraceReporter::New("Composition profiler", TraceReporterDataSourceCollector::New());
+    collector.SetEnabled(true);
+    const auto start = std::chrono::steady_clock::now();
+    UsdStageRefPtr profiledStage;
+    if (reloadLayers) {
+        // The anonymous layers are never reloaded, they would lose their content
+        std::set<SdfLayerHandle> layers;
+        for (const auto &layer : stage->GetUsedLayers()) {
+            if (!layer->IsAnonymous()) {
+                layers.insert(layer);
+            }
+        }
+        SdfLayer::ReloadLayers(layers, true);
+        profiledStage = stage;
+    } else {
+        // A new stage on the same layers has its own PcpCache, so all the prim indices are recomputed
+        profiledStage = UsdStage::OpenMasked(stage->GetRootLayer(), stage->GetSessionLayer(),
+                                             stage->GetPathResolverContext(), stage->GetPopulationMask(), UsdStage::LoadNone);
+        if (profiledStage) {
+            profiledStage->SetLoadRules(stage->GetLoadRules());
+        }
+    }
+    const auto end = std::chrono::steady_clock::now();
+    collector.SetEnabled(collectorWasEnabled);
+
+    profile = CompositionProfile();
+    profile.stage = stage;
+    profile.elapsedSeconds = std::chrono::duration<double>(end - start).count();
+    if (!profiledStage) {
+        return;
+    }
+
+    // Trace scopes
+    reporter->UpdateTraceTrees();
+    std::map<TfToken, TraceScopeStats> scopes;
+    CollectTraceScopes(reporter->GetAggregateTreeRoot(), scopes);
+    for (const auto &scope : scopes) {
+        profile.scopes.push_back(scope.second);
+    }
+
+    // Prims, the prototypes are profiled once instead of once per instance
+    std::vector<UsdPrim> prims;
+    for (const auto &prim : profiledStage->Traverse(UsdPrimAllPrimsPredicate)) {
+        prims.push_back(prim);
+    }
+    for (const auto &prototype : profiledStage->GetPrototypes()) {
+        for (const auto &prim : UsdPrimRange(prototype, UsdPrimAllPrimsPredicate)) {
+            prims.push_back(prim);
+        }
+    }
+    profile.prims.resize(prims.size());
+    WorkParallelForN(prims.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            ComputePrimStats(prims[i], profile.prims[i]);
+        }
+    });
+
+    // Layers
+    std::map<SdfLayerHandle, LayerCompositionStats> layers;
+    for (const auto &prim : prims) {
+        ComputeLayerStats(prim, layers);
+    }
+    for (auto &layer : layers) {
+        layer.second.layer = layer.first;
+        profile.layers.push_back(layer.second);
+    }
+
+    for (size_t i = 0; i < profile.prims.size(); ++i) {
+        const PrimCompositionStats &stats = profile.prims[i];
+        profile.primPositions[stats.path] = i;
+        profile.totalNodes += stats.nodes;
+        profile.maxNodes = std::max(profile.maxNodes, stats.nodes);
+    }
+}
+
+static ImU32 GetHeatColor(float cost) { return ImGui::ColorConvertFloat4ToU32(ImVec4(cost, 1.f - cost, 0.f, 0.5f)); }
+
+static float GetNormalizedCost(const PrimCompositionStats &stats) {
+    return profile.maxNodes ? static_cast<float>(stats.nodes) / static_cast<float>(profile.maxNodes) : 0.f;
+}
+
+static size_t GetPrimColumnValue(const PrimCompositionStats &stats, int column) {
+    switch (column) {
+    case 1:
+    case 2:
+        return stats.nodes;
+    case 3:
+        return stats.specs;
+    case 4:
+        return stats.layerStackDepth;
+    default:
+        return stats.arcs[std::min<size_t>(column - 5, NbProfiledArcTypes - 1)];
+    }
+}
+
+static void DrawPrimsTable() {
+    constexpr ImGuiTableFlags tableFlags = ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY |
+                                           ImGuiTableFlags_Sortable | ImGuiTableFlags_Resizable;
+    if (ImGui::BeginTable("##CompositionProfilerPrims", 5 + NbProfiledArcTypes, tableFlags)) {
+        ImGui::TableSetupScrollFreeze(1, 1);
+        ImGui::TableSetupColumn("Prim", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Cost", ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableSetupColumn("Nodes", ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableSetupColumn("Specs", ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableSetupColumn("Stack depth", ImGuiTableColumnFlags_PreferSortDescending);
+        for (const char *arcName : ProfiledArcNames) {
+            ImGui::TableSetupColumn(arcName, ImGuiTableColumnFlags_PreferSortDescending);
+        }
+        ImGui::TableHeadersRow();
+        InvalidateTableSorting(profile.primsSorted);
+        if (SortTableRows(
+                profile.prims, [](const PrimCompositionStats &stats) { return stats.path; }, GetPrimColumnValue)) {
+            for (size_t i = 0; i < profile.prims.size(); ++i) {
+                profile.primPositions[profile.prims[i].path] = i;
+            }
+        }
+
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(profile.prims.size()));
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                PrimCompositionStats &stats = profile.prims[row];
+                ImGui::PushID(row);
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                if (ImGui::Selectable(stats.path.GetText(), false, ImGuiSelectableFlags_SpanAllColumns)) {
+                    const StrongestArc &arc = GetStrongestArc(stats);
+                    if (arc.layer) {
+                        ExecuteAfterDraw<EditorShowPrimCompositions>(arc.layer, arc.path, arc.arcType);
+                    }
+                }
+                if (ImGui::IsItemHovered()) {
+                    const StrongestArc &arc = GetStrongestArc(stats);
+                    if (arc.layer) {
+                        ImGui::SetTooltip("%s %s %s", TfEnum::GetDisplayName(arc.arcType).c_str(),
+                                          arc.layer->GetDisplayName().c_str(), arc.path.GetText());
+                    }
+                }
+                ImGui::TableSetColumnIndex(1);
+                const float cost = GetNormalizedCost(stats);
+                ImGui::TableSetBgColor(ImGuiTableBgTarget_CellBg, GetHeatColor(cost));
+                ImGui::Text("%.0f%%", cost * 100.f);
+                ImGui::TableSetColumnIndex(2);
+                ImGui::Text("%zu", stats.nodes);
+                ImGui::TableSetColumnIndex(3);
+                ImGui::Text("%zu", stats.specs);
+                ImGui::TableSetColumnIndex(4);
+                ImGui::Text("%zu", stats.layerStackDepth);
+                for (size_t i = 0; i < NbProfiledArcTypes; ++i) {
+                    ImGui::TableSetColumnIndex(static_cast<int>(5 + i));
+                    ImGui::Text("%zu", stats.arcs[i]);
+                }
+                ImGui::PopID();
+            }
+        }
+        ImGui::EndTable();
+    }
+}
+
+static void DrawLayersTable() {
+    constexpr ImGuiTableFlags tableFlags = ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY |
+                                           ImGuiTableFlags_Sortable | ImGuiTableFlags_Resizable;
+    if (ImGui::BeginTable("##CompositionProfilerLayers", 3, tableFlags)) {
+        ImGui::TableSetupScrollFreeze(1, 1);
+        ImGui::TableSetupColumn("Layer", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Specs", ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableSetupColumn("Nodes", ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableHeadersRow();
+        InvalidateTableSorting(profile.layersSorted);
+        SortTableRows(
+            profile.layers,
+            [](const LayerCompositionStats &stats) { return stats.layer ? stats.layer->GetIdentifier() : std::string(); },
+            [](const LayerCompositionStats &stats, int column) { return column == 1 ? stats.specs : stats.nodes; });
+        for (size_t row = 0; row < profile.layers.size(); ++row) {
+            const LayerCompositionStats &stats = profile.layers[row];
+            if (!stats.layer) {
+                continue;
+            }
+            ImGui::PushID(static_cast<int>(row));
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            if (ImGui::Selectable(stats.layer->GetDisplayName().c_str(), false, ImGuiSelectableFlags_SpanAllColumns)) {
+                ExecuteAfterDraw<EditorSetSelection>(stats.layer, SdfPath::AbsoluteRootPath());
+            }
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("%s", stats.layer->GetIdentifier().c_str());
+            }
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%zu", stats.specs);
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%zu", stats.nodes);
+            ImGui::PopID();
+        }
+        ImGui::EndTable();
+    }
+}
+
+static void DrawTraceScopesTable() {
+    constexpr ImGuiTableFlags tableFlags = ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY |
+                                           ImGuiTableFlags_Sortable | ImGuiTableFlags_Resizable;
+    if (ImGui::BeginTable("##CompositionProfilerScopes", 4, tableFlags)) {
+        ImGui::TableSetupScrollFreeze(1, 1);
+        ImGui::TableSetupColumn("Scope", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Inclusive ms", ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableSetupColumn("Exclusive ms", ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableSetupColumn("Count", ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableHeadersRow();
+        InvalidateTableSorting(profile.scopesSorted);
+        SortTableRows(
+            profile.scopes, [](const TraceScopeStats &stats) { return stats.key.GetString(); },
+            [](const TraceScopeStats &stats, int column) {
+                return column == 1 ? stats.inclusiveMs : (column == 2 ? stats.exclusiveMs : static_cast<double>(stats.count));
+            });
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(profile.scopes.size()));
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                const TraceScopeStats &stats = profile.scopes[row];
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::Text("%s", stats.key.GetText());
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Text("%.3f", stats.inclusiveMs);
+                ImGui::TableSetColumnIndex(2);
+                ImGui::Text("%.3f", stats.exclusiveMs);
+                ImGui::TableSetColumnIndex(3);
+                ImGui::Text("%zu", stats.count);
+            }
+        }
+        ImGui::EndTable();
+    }
+}
+
+void DrawCompositionProfiler(const UsdStageRefPtr &stage) {
+    if (!stage) {
+        return;
+    }
+    if (ImGui::Button("Recompose")) {
+        ProfileStageComposition(stage, false);
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Compose a new stage on the same layers, the layers are not read again");
+    }
+    ImGui::SameLine();
+    const bool canReload = CanReloadLayers(stage);
+    ImGui::BeginDisabled(!canReload);
+    if (ImGui::Button("Reload and recompose")) {
+        ProfileStageComposition(stage, true);
+    }
+    ImGui::EndDisabled();
+    if (ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled)) {
+        ImGui::SetTooltip(canReload ? "Read the layers from disk again and recompose the stage"
+                                    : "Some layers have unsaved modifications, they can't be reloaded");
+    }
+    if (!HasCompositionProfile(stage)) {
+        ImGui::Text("The stage has not been profiled");
+        return;
+    }
+    ImGui::SameLine();
+    ImGui::Text("%.3f s, %zu prims, %zu nodes, %zu layers", profile.elapsedSeconds, profile.prims.size(), profile.totalNodes,
+                profile.layers.size());
+    if (ImGui::BeginTabBar("##CompositionProfilerTabs")) {
+        if (ImGui::BeginTabItem("Prims")) {
+            DrawPrimsTable();
+            ImGui::EndTabItem();
+        }
+        if (ImGui::BeginTabItem("Layers")) {
+            DrawLayersTable();
+            ImGui::EndTabItem();
+        }
+        if (ImGui::BeginTabItem("Trace scopes")) {
+            DrawTraceScopesTable();
+            ImGui::EndTabItem();
+        }
+        ImGui::EndTabBar();
+    }
+}
+
+bool HasCompositionProfile(const UsdStageWeakPtr &stage) { return stage && profile.stage == stage; }
+
+void DrawCompositionCostCell(const UsdStageWeakPtr &stage, const SdfPath &path) {
+    if (!HasCompositionProfile(stage)) {
+        return;
+    }
+    const auto position = profile.primPositions.find(path);
+    if (position == profile.primPositions.end()) {
+        return;
+    }
+    const PrimCompositionStats &stats = profile.prims[position->second];
+    ImGui::TableSetBgColor(ImGuiTableBgTarget_CellBg, GetHeatColor(GetNormalizedCost(stats)));
+    ImGui::Text("%zu", stats.nodes);
+    if (ImGui::IsItemHovered()) {
+        ImGui::BeginTooltip();
+        ImGui::Text("%zu nodes, %zu specs, layer stack depth %zu", stats.nodes, stats.specs, stats.layerStackDepth);
+        for (size_t i = 0; i < NbProfiledArcTypes; ++i) {
+            if (stats.arcs[i]) {
+                ImGui::Text("%s: %zu", ProfiledArcNames[i], stats.arcs[i]);
+            }
+        }
+        ImGui::EndTooltip();
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <pxr/usd/sdf/path.h>
+#include <pxr/usd/usd/stage.h>
+
+PXR_NAMESPACE_USING_DIRECTIVE
+
+///
+/// Composition profiler.
+/// The stage is recomposed under the TraceCollector, then the prim indices are inspected to count the nodes, the arcs
+/// by type and the depth of the layer stacks of every prim. The results are attributed to the prims and to the source
+/// layers and kept until the next profile.
+///
+
+/// Draw the profiler window: the profiling buttons, the trace scopes, the prim and the layer tables
+void DrawCompositionProfiler(const UsdStageRefPtr &stage);
+
+/// Draw the composition cost of a prim in the current table cell: the number of nodes of its prim index on a
+/// background colored relatively to the most expensive prim. Nothing is drawn if the prim was not profiled
+void DrawCompositionCostCell(const UsdStageWeakPtr &stage, const SdfPath &path);
+
+/// Returns true if the stage has a profile, used to show the cost column in the outliner
+bool HasCompositionProfile(const UsdStageWeakPtr &stage);
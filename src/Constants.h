@@ -30,6 +30,7 @@ constexpr float TimeBeforeTooltip = 2.f; // 2 seconds
 #define ColorPrimPrototype {118.f/255.f, 136.f/255.f, 217.f/255.f, 1.0}
 #define ColorPrimUndefined {200.f/255.f, 100.f/255.f, 100.f/255.f, 1.0}
 #define ColorPrimHasComposition {222.f/255.f, 158.f/255.f, 46.f/255.f, 1.0}
+#define ColorTimelineKey {0.9, 0.75, 0.2, 1.0}
 #define ColorGreyish {0.5, 0.5, 0.5, 1.0}
 #define ColorButtonHighlight {0.5, 0.7, 0.5, 0.7}
 #define ColorEditableWidgetBg {0.260f, 0.300f, 0.360f, 1.000f}
@@ -1,46 +1,14 @@
 #include "Debug.h"
 #include "Gui.h"
-#include "pxr/base/trace/reporter.h"
-#include "pxr/base/trace/trace.h"
+#include "LayerLoadProfiler.h"
+#include "MemoryPanel.h"
+#include "TraceViewer.h"
 #include <pxr/base/plug/plugin.h>
 #include <pxr/base/plug/registry.h>
 #include <pxr/base/tf/debug.h>
-#include <sstream>
 
 PXR_NAMESPACE_USING_DIRECTIVE
 
-static void DrawTraceReporter() {
-
-    static std::string reportStr;
-
-    if (ImGui::Button("Start Tracing")) {
-        TraceCollector::GetInstance().SetEnabled(true);
-    }
-    ImGui::SameLine();
-    if (ImGui::Button("Stop Tracing")) {
-        TraceCollector::GetInstance().SetEnabled(false);
-    }
-    ImGui::SameLine();
-    if (ImGui::Button("Reset counters")) {
-        TraceReporter::GetGlobalReporter()->ClearTree();
-    }
-    ImGui::SameLine();
-
-    if (ImGui::Button("Update tree")) {
-        TraceReporter::GetGlobalReporter()->UpdateTraceTrees();
-    }
-    if (TraceCollector::IsEnabled()) {
-        std::ostringstream report;
-        TraceReporter::GetGlobalReporter()->Report(report);
-        reportStr = report.str();
-    }
-    ImGuiIO &io = ImGui::GetIO();
-    ImGui::PushFont(io.Fonts->Fonts[1]);
-    const ImVec2 size(-FLT_MIN, -10);
-    ImGui::InputTextMultiline("##TraceReport", &reportStr, size);
-    ImGui::PopFont();
-}
-
 static void DrawDebugCodes() {
     // TfDebug::IsCompileTimeEnabled()
     ImVec2 listBoxSize(-FLT_MIN, -10);
@@ -74,11 +42,11 @@ static void DrawPlugins() {
 }
 
 // Draw a preference like panel
-void DrawDebugUI() {
-    static const char *const panels[] = {"Timings", "Debug codes", "Trace reporter", "Plugins"};
+void DrawDebugUI(const UsdStageRefPtr &stage) {
+    static const char *const panels[] = {"Timings", "Debug codes", "Trace", "Plugins", "Layers", "Memory"};
     static int current_item = 0;
     ImGui::PushItemWidth(100);
-    ImGui::ListBox("##DebugPanels", &current_item, panels, 4);
+    ImGui::ListBox("##DebugPanels", &current_item, panels, IM_ARRAYSIZE(panels));
     ImGui::SameLine();
     if (current_item == 0) {
         ImGui::BeginChild("##Timing");
@@ -89,12 +57,20 @@ void DrawDebugUI() {
         DrawDebugCodes();
         ImGui::EndChild();
     } else if (current_item == 2) {
-        ImGui::BeginChild("##TraceReporter");
-        DrawTraceReporter();
+        ImGui::BeginChild("##Trace");
+        DrawTraceViewer();
         ImGui::EndChild();
     } else if (current_item == 3) {
         ImGui::BeginChild("##Plugins");
         DrawPlugins();
         ImGui::EndChild();
+    } else if (current_item == 4) {
+        ImGui::BeginChild("##Layers");
+        DrawLayerLoadProfiler(stage);
+        ImGui::EndChild();
+    } else if (current_item == 5) {
+        ImGui::BeginChild("##Memory");
+        DrawMemoryPanel();
+        ImGui::EndChild();
     }
 }
@@ -1,4 +1,8 @@
 #pragma once
 
-void DrawDebugUI();
+#include <pxr/usd/usd/stage.h>
+
+PXR_NAMESPACE_USING_DIRECTIVE
+
+void DrawDebugUI(const UsdStageRefPtr &stage);
 
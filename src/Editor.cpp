@@ -34,6 +34,12 @@
 #include "LauncherBar.h"
 #include "ConnectionEditor.h"
 #include "Playblast.h"
+#include "BackgroundJobs.h"
+#include "LayerSaveJob.h"
+#include "EditJournal.h"
+#include "CompositionProfiler.h"
+#include "StageStatistics.h"
+#include "InstancingAnalyzer.h"
 #include "Blueprints.h"
 #include "UsdHelpers.h"
 #include "Stamp.h"
@@ -61,6 +67,10 @@
 #define Viewport4WindowTitle "Viewport4"
 #define StatusBarWindowTitle "Status bar"
 #define LauncherBarWindowTitle "Launcher bar"
+#define BackgroundJobsWindowTitle "Background jobs"
+#define CompositionProfilerWindowTitle "Composition profiler"
+#define StageStatisticsWindowTitle "Stage statistics"
+#define InstancingAnalyzerWindowTitle "Instancing analyzer"
 
 // Used only in the editor, so no point adding them to ImGuiHelpers yet
 inline bool BelongToSameDockTab(ImGuiWindow *w1, ImGuiWindow *w2) {
@@ -296,6 +306,13 @@ struct ExportStageDialog : public ModalDialog {
         }
         auto filePath = GetFileBrowserFilePath();
         ImGui::Text("%s", filePath.c_str());
+        if (_exportType == ExportFlatten) {
+            ImGui::Checkbox("Split in chunks", &_writeChunks);
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Write the prims in a <name>_chunks directory sublayered by the exported file.\n"
+                                  "The memory used doesn't grow with the stage, but the directory must be kept with the file.");
+            }
+        }
         DrawOkCancelModal([&]() { // On Ok ->
             if (!filePath.empty()) {
                 switch (_exportType){
@@ -306,7 +323,7 @@ struct ExportStageDialog : public ModalDialog {
                         ExecuteAfterDraw<EditorExportUsdz>(filePath, true);
                         break;
                     case ExportFlatten:
-                        ExecuteAfterDraw<EditorExportFlattenedStage>(filePath);
+                        ExecuteAfterDraw<EditorExportFlattenedStage>(filePath, _writeChunks);
                         break;
                 }
             }
@@ -318,6 +335,7 @@ struct ExportStageDialog : public ModalDialog {
     ExportType _exportType;
     std::string _exportTypeStr;
     std::string _defaultExtension;
+    bool _writeChunks = false;
 };
 
 static void BeginBackgoundDock() {
@@ -384,6 +402,96 @@ void Editor::WindowSizeCallback(GLFWwindow *window, int width, int height) {
     }
 }
 
+/// Modal dialog listing the edit journals left by a crash, to replay them on their layers or discard them.
+/// The journals closed without a choice are proposed again at the next start
+struct RecoverEditJournalsModalDialog : public ModalDialog {
+    RecoverEditJournalsModalDialog(Editor &editor, std::vector<EditJournalFile> journals)
+        : editor(editor), journals(std::move(journals)) {}
+
+    void Draw() override {
+        ImGui::Text("Usdtweak did not exit normally, the unsaved edits of these layers can be recovered");
+        size_t recover = journals.size();
+        size_t discard = journals.size();
+        constexpr ImGuiTableFlags tableFlags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY;
+        if (ImGui::BeginTable("##RecoverEditJournals", 3, tableFlags, ImVec2(700, 200))) {
+            ImGui::TableSetupScrollFreeze(0, 1);
+            ImGui::TableSetupColumn("Layer", ImGuiTableColumnFlags_WidthStretch);
+            ImGui::TableSetupColumn("Edits", ImGuiTableColumnFlags_WidthFixed, 60);
+            ImGui::TableSetupColumn("", ImGuiTableColumnFlags_WidthFixed, 140);
+            ImGui::TableHeadersRow();
+            for (size_t i = 0; i < journals.size(); ++i) {
+                ImGui::PushID(static_cast<int>(i));
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                if (journals[i].layerFileChanged) {
+                    ImGui::TextColored(ImVec4(1.0f, 0.5f, 0.1f, 1.0f), "%s (file modified)", journals[i].layerIdentifier.c_str());
+                    if (ImGui::IsItemHovered()) {
+                        ImGui::SetTooltip("The layer file was modified after the crash, the edits can't be replayed on it");
+                    }
+                } else {
+                    ImGui::Text("%s", journals[i].layerIdentifier.c_str());
+                }
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Text("%zu", journals[i].records);
+                ImGui::TableSetColumnIndex(2);
+                ImGui::BeginDisabled(journals[i].layerFileChanged);
+                if (ImGui::SmallButton("Replay")) {
+                    recover = i;
+                }
+                ImGui::EndDisabled();
+                ImGui::SameLine();
+                if (ImGui::SmallButton("Discard")) {
+                    discard = i;
+                }
+                ImGui::PopID();
+            }
+            ImGui::EndTable();
+        }
+        if (recover < journals.size()) {
+            Recover(recover);
+        } else if (discard < journals.size()) {
+            DiscardEditJournal(journals[discard]);
+            journals.erase(journals.begin() + discard);
+        }
+        for (const auto &message : messages) {
+            ImGui::Text("%s", message.c_str());
+        }
+        if (ImGui::Button("Replay all")) {
+            for (size_t i = journals.size(); i > 0; --i) {
+                if (!journals[i - 1].layerFileChanged) {
+                    Recover(i - 1);
+                }
+            }
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Discard all")) {
+            for (const auto &journal : journals) {
+                DiscardEditJournal(journal);
+            }
+            journals.clear();
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Close")) {
+            CloseModal();
+        }
+    }
+
+    void Recover(size_t index) {
+        std::string message;
+        SdfLayerRefPtr layer = RecoverEditJournal(journals[index], message);
+        if (layer) {
+            editor.SetCurrentLayer(layer); // Keeps the recovered layer opened
+        }
+        messages.push_back(message);
+        journals.erase(journals.begin() + index);
+    }
+
+    const char *DialogId() const override { return "Recover unsaved edits"; }
+    Editor &editor;
+    std::vector<EditJournalFile> journals;
+    std::vector<std::string> messages;
+};
+
 Editor::Editor() : _viewport1(UsdStageRefPtr(), _selection),
 #if ENABLE_MULTIPLE_VIEWPORTS
 _viewport2(UsdStageRefPtr(), _selection),
@@ -395,9 +503,17 @@ _layerHistoryPointer(0) {
     LoadSettings();
     SetFileBrowserDirectory(_settings._lastFileBrowserDirectory);
     Blueprints::GetInstance().SetBlueprintsLocations(_settings._blueprintLocations);
+    InitializeLayerEditCounter();
+    // The journals of another running session are also found, they are only replayed if the user asks to
+    std::vector<EditJournalFile> journals = FindEditJournals();
+    if (!journals.empty()) {
+        DrawModalDialog<RecoverEditJournalsModalDialog>(*this, journals);
+    }
 }
 
 Editor::~Editor(){
+    // The jobs might hold GL resources and stage references, they are destroyed before the editor and the GL context
+    ShutdownBackgroundJobs();
     _settings._lastFileBrowserDirectory = GetFileBrowserDirectory();
     SaveSettings();
 }
@@ -495,7 +611,7 @@ void Editor::OpenStage(const std::string &path, bool openLoaded) {
         GetStageCache().Insert(newStage);
         SetCurrentStage(newStage);
         _settings._showContentBrowser = true;
-        _settings._showViewport1 = true;
+        // The viewport is not forced open, the hydra engine is only created when the viewport is visible
         _settings.UpdateRecentFiles(path);
     }
 }
@@ -552,7 +668,8 @@ void Editor::HydraRender() {
     }
 #endif
 #endif
-
+    // The jobs are stepped here as some of them need the GL context, like the playblast
+    UpdateBackgroundJobs();
 }
 
 void Editor::ShowDialogSaveLayerAs(SdfLayerHandle layerToSaveAs) { DrawModalDialog<SaveLayerAsDialog>(*this, layerToSaveAs); }
@@ -568,6 +685,11 @@ void Editor::SetLayerPathSelection(const SdfPath &primPath) {
     BringWindowToTabFront(SdfPrimPropertiesWindowTitle);
 }
 
+void Editor::ShowPrimSpecEditor() {
+    _settings._showPrimSpecEditor = true;
+    BringWindowToTabFront(SdfPrimPropertiesWindowTitle);
+}
+
 void Editor::AddStagePathSelection(const SdfPath &primPath) {
     _selection.AddSelected(GetCurrentStage(), primPath);
     BringWindowToTabFront(UsdPrimPropertiesWindowTitle);
@@ -638,7 +760,10 @@ void Editor::DrawMainMenuBar() {
             ImGui::Separator();
             const bool hasLayer = GetCurrentLayer() != SdfLayerRefPtr();
             if (ImGui::MenuItem(ICON_FA_SAVE " Save layer", "CTRL+S", false, hasLayer)) {
-                GetCurrentLayer()->Save(true);
+                ExecuteAfterDraw<EditorSaveLayer>(GetCurrentLayer());
+            }
+            if (ImGui::MenuItem(ICON_FA_SAVE " Save all layers", nullptr, false, HasUnsavedWork())) {
+                ShowSaveAllLayersDialog();
             }
             if (ImGui::MenuItem(ICON_FA_SAVE " Save current layer as", "CTRL+F", false, hasLayer)) {
                 ExecuteAfterDraw<EditorSaveLayerAs>(GetCurrentLayer());
@@ -720,6 +845,10 @@ void Editor::DrawMainMenuBar() {
 #endif
             ImGui::MenuItem(StatusBarWindowTitle, nullptr, &_settings._showStatusBar);
             ImGui::MenuItem(LauncherBarWindowTitle, nullptr, &_settings._showLauncherBar);
+            ImGui::MenuItem(BackgroundJobsWindowTitle, nullptr, &_settings._showBackgroundJobs);
+            ImGui::MenuItem(CompositionProfilerWindowTitle, nullptr, &_settings._showCompositionProfiler);
+            ImGui::MenuItem(StageStatisticsWindowTitle, nullptr, &_settings._showStageStatistics);
+            ImGui::MenuItem(InstancingAnalyzerWindowTitle, nullptr, &_settings._showInstancingAnalyzer);
             ImGui::EndMenu();
         }
         if (ImGui::BeginMenu("Help")) {
@@ -749,9 +878,11 @@ void Editor::Draw() {
         //
         TRACE_SCOPE(Viewport1WindowTitle);
         ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(0, 0));
-        ImGui::Begin(Viewport1WindowTitle, &_settings._showViewport1);
+        const bool isVisible = ImGui::Begin(Viewport1WindowTitle, &_settings._showViewport1);
         ImGui::PopStyleVar();
-        GetViewport().Draw();
+        if (isVisible) { // Not drawn when collapsed or in a hidden tab
+            GetViewport().Draw();
+        }
         ImGui::End();
     }
 #if ENABLE_MULTIPLE_VIEWPORTS
@@ -783,7 +914,7 @@ void Editor::Draw() {
     if (_settings._showDebugWindow) {
         TRACE_SCOPE(DebugWindowTitle);
         ImGui::Begin(DebugWindowTitle, &_settings._showDebugWindow);
-        DrawDebugUI();
+        DrawDebugUI(GetCurrentStage());
         ImGui::End();
     }
     if (_settings._showStatusBar) {
@@ -793,12 +924,23 @@ void Editor::Draw() {
                 ImGui::Text("\xee\x81\x99"
                             " %.3f ms/frame  (%.1f FPS)",
                             1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+                ImGui::SameLine();
+                if (DrawBackgroundJobsStatus()) {
+                    _settings._showBackgroundJobs = true;
+                }
                 ImGui::EndMenuBar();
             }
         }
         ImGui::End();
     }
 
+    if (_settings._showBackgroundJobs) {
+        TRACE_SCOPE(BackgroundJobsWindowTitle);
+        ImGui::Begin(BackgroundJobsWindowTitle, &_settings._showBackgroundJobs);
+        DrawBackgroundJobs();
+        ImGui::End();
+    }
+
     if (_settings._showLauncherBar) {
         ImGuiWindowFlags windowFlags = ImGuiWindowFlags_None;
         ImGui::Begin(LauncherBarWindowTitle, &_settings._showLauncherBar, windowFlags);
@@ -830,7 +972,7 @@ void Editor::Draw() {
         TRACE_SCOPE(TimelineWindowTitle);
         ImGui::Begin(TimelineWindowTitle, &_settings._showTimeline);
         UsdTimeCode tc = GetViewport().GetCurrentTimeCode();
-        DrawTimeline(GetCurrentStage(), tc);
+        DrawTimeline(GetCurrentStage(), tc, GetViewport().GetPlayback(), _selection);
         GetViewport().SetCurrentTimeCode(tc);
 #if ENABLE_MULTIPLE_VIEWPORTS
         _viewport2.SetCurrentTimeCode(tc);
@@ -918,6 +1060,27 @@ void Editor::Draw() {
         ImGui::End();
     }
 
+    if (_settings._showCompositionProfiler) {
+        TRACE_SCOPE(CompositionProfilerWindowTitle);
+        ImGui::Begin(CompositionProfilerWindowTitle, &_settings._showCompositionProfiler);
+        DrawCompositionProfiler(GetCurrentStage());
+        ImGui::End();
+    }
+
+    if (_settings._showStageStatistics) {
+        TRACE_SCOPE(StageStatisticsWindowTitle);
+        ImGui::Begin(StageStatisticsWindowTitle, &_settings._showStageStatistics);
+        DrawStageStatistics(GetCurrentStage());
+        ImGui::End();
+    }
+
+    if (_settings._showInstancingAnalyzer) {
+        TRACE_SCOPE(InstancingAnalyzerWindowTitle);
+        ImGui::Begin(InstancingAnalyzerWindowTitle, &_settings._showInstancingAnalyzer);
+        DrawInstancingAnalyzer(GetCurrentStage());
+        ImGui::End();
+    }
+
     DrawCurrentModal();
 
     ///////////////////////
@@ -60,6 +60,9 @@ public:
     void AddLayerPathSelection(const SdfPath &primPath);
     void SetStagePathSelection(const SdfPath &primPath);
     void AddStagePathSelection(const SdfPath &primPath);
+
+    /// Open the layer property editor and bring it to the front
+    void ShowPrimSpecEditor();
     
     /// Create a new layer in file path
     void CreateNewLayer(const std::string &path);
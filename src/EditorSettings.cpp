@@ -70,6 +70,14 @@ void EditorSettings::ParseLine(const char *line) {
         _showDebugWindow = static_cast<bool>(value);
     } else if (sscanf(line, "ShowArrayEditor=%i", &value) == 1) {
         _showSdfAttributeEditor = static_cast<bool>(value);
+    } else if (sscanf(line, "ShowBackgroundJobs=%i", &value) == 1) {
+        _showBackgroundJobs = static_cast<bool>(value);
+    } else if (sscanf(line, "ShowCompositionProfiler=%i", &value) == 1) {
+        _showCompositionProfiler = static_cast<bool>(value);
+    } else if (sscanf(line, "ShowStageStatistics=%i", &value) == 1) {
+        _showStageStatistics = static_cast<bool>(value);
+    } else if (sscanf(line, "ShowInstancingAnalyzer=%i", &value) == 1) {
+        _showInstancingAnalyzer = static_cast<bool>(value);
     } else if (sscanf(line, "LastFileBrowserDirectory=%s", strBuffer) == 1) {
         _lastFileBrowserDirectory = strBuffer;
     } else if (strlen(line) > 12 && std::equal(line, line + 12, "RecentFiles=")) {
@@ -117,6 +125,10 @@ void EditorSettings::Dump(ImGuiTextBuffer *buf) {
     buf->appendf("ShowLauncherBar=%d\n", _showLauncherBar);
     buf->appendf("ShowDebugWindow=%d\n", _showDebugWindow);
     buf->appendf("ShowArrayEditor=%d\n", _showSdfAttributeEditor);
+    buf->appendf("ShowBackgroundJobs=%d\n", _showBackgroundJobs);
+    buf->appendf("ShowCompositionProfiler=%d\n", _showCompositionProfiler);
+    buf->appendf("ShowStageStatistics=%d\n", _showStageStatistics);
+    buf->appendf("ShowInstancingAnalyzer=%d\n", _showInstancingAnalyzer);
     if (!_lastFileBrowserDirectory.empty()) {
         buf->appendf("LastFileBrowserDirectory=%s\n", _lastFileBrowserDirectory.c_str());
     }
@@ -28,6 +28,10 @@ struct EditorSettings {
     bool _showLauncherBar = false;
     bool _textEditor = false;
     bool _showSdfAttributeEditor = false;
+    bool _showBackgroundJobs = false;
+    bool _showCompositionProfiler = false;
+    bool _showStageStatistics = false;
+    bool _showInstancingAnalyzer = false;
     int _mainWindowWidth;
     int _mainWindowHeight;
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Gui.h"
+#include <algorithm>
 #include <vector>
 
 /// One liner for creating multiple calls to ImGui::TableSetupColumn
@@ -35,6 +36,38 @@ struct ScopedStyleColor {
     const size_t nbPop; // TODO: get rid of this constant and generate the correct number of pop at compile time
 };
 
+/// Mark the sort specs of the current table as dirty the first time it is drawn after its rows have changed, so the
+/// new rows are sorted with the current specs. isSorted is reset by the caller when the rows change.
+inline void InvalidateTableSorting(bool &isSorted) {
+    if (!isSorted) {
+        if (ImGuiTableSortSpecs *sortSpecs = ImGui::TableGetSortSpecs()) {
+            sortSpecs->SpecsDirty = true;
+        }
+        isSorted = true;
+    }
+}
+
+/// Sort the rows of the current table when its sort specs have changed. Only the first sort spec is used.
+/// The first column is sorted with the value returned by nameValue(row), the other columns with columnValue(row, column).
+/// Returns true if the rows were sorted
+template <typename RowT, typename NameFuncT, typename ValueFuncT>
+inline bool SortTableRows(std::vector<RowT> &rows, NameFuncT nameValue, ValueFuncT columnValue) {
+    ImGuiTableSortSpecs *sortSpecs = ImGui::TableGetSortSpecs();
+    if (!sortSpecs || !sortSpecs->SpecsDirty || sortSpecs->SpecsCount == 0) {
+        return false;
+    }
+    const bool ascending = sortSpecs->Specs[0].SortDirection == ImGuiSortDirection_Ascending;
+    const int column = sortSpecs->Specs[0].ColumnIndex;
+    std::stable_sort(rows.begin(), rows.end(), [&](const RowT &a, const RowT &b) {
+        if (column == 0) {
+            return ascending ? nameValue(a) < nameValue(b) : nameValue(b) < nameValue(a);
+        }
+        return ascending ? columnValue(a, column) < columnValue(b, column) : columnValue(b, column) < columnValue(a, column);
+    });
+    sortSpecs->SpecsDirty = false;
+    return true;
+}
+
 /// Creates a splitter
 /// This is coming right from the imgui github repo
 bool Splitter(bool splitVertically, float thickness, float *size1, float *size2, float minSize1, float minSize2,
@@ -0,0 +1,516 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <pxr/base/tf/notice.h>
+#include <pxr/base/tf/stringUtils.h>
+#include <pxr/base/tf/weakBase.h>
+#include <pxr/base/work/loops.h>
+#include <pxr/base/work/threadLimits.h>
+#include <pxr/usd/pcp/layerStack.h>
+#include <pxr/usd/pcp/node.h>
+#include <pxr/usd/pcp/primIndex.h>
+#include <pxr/usd/sdf/changeBlock.h>
+#include <pxr/usd/sdf/notice.h>
+#include <pxr/usd/usd/notice.h>
+#include <pxr/usd/usd/primRange.h>
+
+#include "BackgroundJobs.h"
+#include "Commands.h"
+#include "Gui.h"
+#include "ImGuiHelpers.h"
+#include "InstancingAnalyzer.h"
+#include "MemoryPanel.h"
+
+/// Estimated memory of a prim and a property in Usd and Hydra, without the values
+static constexpr size_t PrimBytes = 2048;
+static constexpr size_t PropertyBytes = 256;
+
+/// Budget of each step of the analysis, a large stage is traversed over many frames
+static constexpr std::chrono::milliseconds AnalysisTimeSlice(10);
+
+struct InstancingCandidate {
+    SdfPath path;
+    /// Arcs of the prim index, the prims with the same key would share a prototype
+    std::string key;
+    bool hasLocalOpinions = false;
+};
+
+struct InstancingGroup {
+    /// Strongest reference or payload of the prims, displayed in the table
+    std::string target;
+    std::string targetTooltip;
+    std::vector<SdfPath> prims;
+    /// Prims with the same arcs but with local opinions on their descendants
+    size_t primsWithLocalOpinions = 0;
+    /// Content of one copy of the subtree, without the instanced prim
+    size_t subtreePrims = 0;
+    size_t subtreeProperties = 0;
+    size_t estimatedBytesPerCopy = 0;
+    size_t estimatedSavedBytes = 0;
+    bool selected = true;
+};
+
+struct InstancingAnalysis {
+    UsdStageWeakPtr stage;
+    double elapsedSeconds = 0.0;
+    size_t candidates = 0;
+    std::vector<InstancingGroup> groups;
+    bool groupsSorted = false;
+};
+
+// Displayed until the next analysis replaces it. Only accessed from the main thread
+static InstancingAnalysis analysis;
+
+/// Returns true if the node was added by an arc of the prim, or is under such an arc. The nodes only brought by the
+/// arcs of the ancestors are the same for all the prims of an asset, they are not part of the key, as in PcpInstanceKey
+static bool IsUnderDirectArc(PcpNodeRef node) {
+    for (; node && !node.IsRootNode(); node = node.GetParentNode()) {
+        if (!node.IsDueToAncestor()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Nearest node holding the opinions of the prim in the layers of the stage or of the assets of its ancestors: the root
+/// node or a node only due to an ancestral arc. The arcs authored there are the arcs of the prim
+static PcpNodeRef GetOpinionSite(PcpNodeRef node) {
+    while (node && IsUnderDirectArc(node)) {
+        node = node.GetParentNode();
+    }
+    return node;
+}
+
+/// Strongest reference or payload authored on the prim, in the layers of the stage or of the asset of an ancestor,
+/// like a set referencing trees, directly or in one of their variants. Returns an invalid node if the prim doesn't
+/// bring any asset. The arcs inside the referenced assets are ignored
+static PcpNodeRef FindReferenceOrPayloadNode(const PcpPrimIndex &index) {
+    TF_FOR_ALL(node, index.GetNodeRange()) {
+        if ((node->GetArcType() != PcpArcTypeReference && node->GetArcType() != PcpArcTypePayload) ||
+            node->IsDueToAncestor()) {
+            continue;
+        }
+        PcpNodeRef parent = node->GetParentNode();
+        while (parent && IsUnderDirectArc(parent) && parent.GetArcType() == PcpArcTypeVariant) {
+            parent = parent.GetParentNode();
+        }
+        if (parent && !IsUnderDirectArc(parent)) {
+            return *node;
+        }
+    }
+    return PcpNodeRef();
+}
+
+/// The key is made of the arc type, the layer stack, the path and the time offset of every node added by the arcs of
+/// the prim. The paths under the opinion site of the arcs, like the variants, are made relative to the site so they
+/// compare between prims.
+/// The nodes of the root and of the ancestral arcs are not in the prototype: their opinions on the descendants, like a
+/// set overriding the children of one of its trees, would be lost once instanced.
+static void ComputeInstancingKey(const UsdPrim &prim, InstancingCandidate &candidate) {
+    candidate.path = prim.GetPath();
+    const PcpPrimIndex &index = prim.GetPrimIndex();
+    TF_FOR_ALL(node, index.GetNodeRange()) {
+        if (!IsUnderDirectArc(*node)) {
+            for (const auto &layer : node->GetLayerStack()->GetLayers()) {
+                const SdfPrimSpecHandle spec = layer->GetPrimAtPath(node->GetPath());
+                if (spec && !spec->GetNameChildren().empty()) {
+                    candidate.hasLocalOpinions = true;
+                }
+            }
+            continue;
+        }
+        const PcpNodeRef site = GetOpinionSite(*node);
+        const bool isUnderSite = node->GetLayerStack() == site.GetLayerStack() && node->GetPath().HasPrefix(site.GetPath());
+        const std::string &nodePath = node->GetPath().GetString();
+        const SdfLayerOffset offset = node->GetMapToRoot().GetTimeOffset();
+        candidate.key += std::to_string(static_cast<int>(node->GetArcType()));
+        candidate.key += node->GetLayerStack()->GetIdentifier().rootLayer->GetIdentifier();
+        candidate.key += isUnderSite ? nodePath.substr(site.GetPath().GetString().size()) : nodePath;
+        candidate.key += TfStringPrintf(" %g %g\n", offset.GetOffset(), offset.GetScale());
+    }
+}
+
+/// Count the content of one copy of the subtree, the instance prim itself stays when instanced.
+/// The geometry is not measured, its arrays would be read from the layers for every group
+static void ComputeCopyCost(const UsdStageRefPtr &stage, InstancingGroup &group) {
+    const UsdPrim prim = stage->GetPrimAtPath(group.prims.front());
+    UsdPrimRange range(prim, UsdPrimAllPrimsPredicate);
+    for (auto it = range.begin(); it != range.end(); ++it) {
+        if (*it == prim) {
+            continue;
+        }
+        group.subtreePrims++;
+        group.subtreeProperties += it->GetAuthoredProperties().size();
+    }
+    group.estimatedBytesPerCopy = group.subtreePrims * PrimBytes + group.subtreeProperties * PropertyBytes;
+    // N instances share one prototype
+    group.estimatedSavedBytes = (group.prims.size() - 1) * group.estimatedBytesPerCopy;
+}
+
+static void SetGroupTarget(const UsdStageRefPtr &stage, InstancingGroup &group) {
+    const UsdPrim prim = stage->GetPrimAtPath(group.prims.front());
+    if (const PcpNodeRef node = FindReferenceOrPayloadNode(prim.GetPrimIndex())) {
+        const SdfLayerHandle &layer = node.GetLayerStack()->GetIdentifier().rootLayer;
+        group.target = "@" + layer->GetDisplayName() + "@<" + node.GetPath().GetString() + ">";
+        group.targetTooltip = "@" + layer->GetIdentifier() + "@<" + node.GetPath().GetString() + ">";
+    }
+}
+
+/// Group the candidates by key. The candidates are in traversal order: a prim joining a group of two or more prims is
+/// instanced with its descendants, which are skipped, the descendants of the other prims can still be instanced
+static std::vector<InstancingGroup> GroupCandidates(const std::vector<InstancingCandidate> &candidates) {
+    std::unordered_map<std::string, size_t> keyCounts;
+    for (const auto &candidate : candidates) {
+        if (!candidate.hasLocalOpinions) {
+            keyCounts[candidate.key]++;
+        }
+    }
+    std::unordered_map<std::string, InstancingGroup> groups;
+    SdfPath instancedRoot;
+    for (const auto &candidate : candidates) {
+        if (!instancedRoot.IsEmpty() && candidate.path.HasPrefix(instancedRoot)) {
+            continue;
+        }
+        if (candidate.hasLocalOpinions) {
+            groups[candidate.key].primsWithLocalOpinions++;
+        } else if (keyCounts[candidate.key] > 1) {
+            groups[candidate.key].prims.push_back(candidate.path);
+            instancedRoot = candidate.path;
+        }
+    }
+    // The groups can lose prims nested in the prims of other groups, only the groups with more than one prim save memory
+    std::vector<InstancingGroup> instancingGroups;
+    for (auto &group : groups) {
+        if (group.second.prims.size() > 1) {
+            instancingGroups.push_back(std::move(group.second));
+        }
+    }
+    return instancingGroups;
+}
+
+/// Analysis of the stage spread over the frames. The stage is traversed and the groups are measured in time slices
+/// on the main thread, with the prims of each slice processed in parallel, so the stage is never read while it is
+/// edited. The traversal keeps the paths of the prims to visit rather than a range, which a resync would invalidate.
+/// The analysis stops if a layer of the stage, other than the session layers, is edited or the loaded payloads change.
+class InstancingAnalysisJob : public BackgroundJob, public TfWeakBase {
+  public:
+    InstancingAnalysisJob(const UsdStageRefPtr &stage);
+    ~InstancingAnalysisJob() override;
+
+    bool Step() override;
+
+  private:
+    void OnLayersChanged(const SdfNotice::LayersDidChange &notice);
+    void OnLayerMutingChanged(const UsdNotice::LayerMutingChanged &notice);
+    /// Returns true when the whole stage has been traversed
+    bool FindCandidates(const UsdStageRefPtr &stage, std::chrono::steady_clock::time_point deadline);
+    /// Returns true when all the groups are measured
+    bool MeasureGroups(const UsdStageRefPtr &stage, std::chrono::steady_clock::time_point deadline);
+
+    UsdStageWeakPtr _stage;
+    std::vector<SdfPath> _pathsToVisit; // The next prim visited is at the back, the traversal is in pre-order
+    bool _traversed = false;
+    std::vector<InstancingCandidate> _candidates;
+    InstancingAnalysis _analysis;
+    bool _grouped = false;
+    size_t _measuredGroups = 0;
+    // Layers of the stage without the session layers, whose edits (like the draw modes of the viewport) don't change
+    // the arcs. The layer change notices can come from worker threads, the set is not modified after construction
+    std::set<SdfLayerHandle> _analyzedLayers;
+    UsdStageLoadRules _loadRules;
+    std::atomic<bool> _stageEdited{false};
+    std::chrono::steady_clock::duration _analysisTime{0};
+    TfNotice::Key _layersChangedKey;
+    TfNotice::Key _layerMutingChangedKey;
+};
+
+// The running analysis, only accessed from the main thread
+static InstancingAnalysisJob *runningAnalysis = nullptr;
+
+InstancingAnalysisJob::InstancingAnalysisJob(const UsdStageRefPtr &stage)
+    : BackgroundJob("Instancing analysis"), _stage(stage) {
+    for (const auto &prim : stage->GetPseudoRoot().GetChildren()) {
+        _pathsToVisit.push_back(prim.GetPath());
+    }
+    std::reverse(_pathsToVisit.begin(), _pathsToVisit.end());
+    _analysis.stage = stage;
+    runningAnalysis = this;
+
+    for (const auto &layer : stage->GetUsedLayers()) {
+        _analyzedLayers.insert(layer);
+    }
+    // The session layer and its sublayers come first in the layer stack, before the root layer
+    for (const auto &layer : stage->GetLayerStack(true)) {
+        if (layer == stage->GetRootLayer()) {
+            break;
+        }
+        _analyzedLayers.erase(layer);
+    }
+    _loadRules = stage->GetLoadRules();
+    TfWeakPtr<InstancingAnalysisJob> me(this);
+    _layersChangedKey = TfNotice::Register(me, &InstancingAnalysisJob::OnLayersChanged);
+    _layerMutingChangedKey = TfNotice::Register(me, &InstancingAnalysisJob::OnLayerMutingChanged, _stage);
+}
+
+InstancingAnalysisJob::~InstancingAnalysisJob() {
+    TfNotice::Revoke(_layersChangedKey);
+    TfNotice::Revoke(_layerMutingChangedKey);
+    if (runningAnalysis == this) {
+        runningAnalysis = nullptr;
+    }
+}
+
+void InstancingAnalysisJob::OnLayersChanged(const SdfNotice::LayersDidChange &notice) {
+    for (const auto &layerChanges : notice.GetChangeListVec()) {
+        if (_analyzedLayers.count(layerChanges.first)) {
+            _stageEdited = true;
+            return;
+        }
+    }
+}
+
+void InstancingAnalysisJob::OnLayerMutingChanged(const UsdNotice::LayerMutingChanged &notice) { _stageEdited = true; }
+
+bool InstancingAnalysisJob::FindCandidates(const UsdStageRefPtr &stage, std::chrono::steady_clock::time_point deadline) {
+    // The prims of the slice are collected, then their keys are computed in parallel
+    std::vector<UsdPrim> prims;
+    while (!_pathsToVisit.empty() && std::chrono::steady_clock::now() < deadline) {
+        for (size_t i = 0; i < 256 && !_pathsToVisit.empty(); ++i) {
+            const UsdPrim prim = stage->GetPrimAtPath(_pathsToVisit.back());
+            _pathsToVisit.pop_back();
+            // The prims removed by a session layer edit are skipped, the instances are not traversed
+            if (!prim || prim.IsInstance() || prim.HasAuthoredInstanceable()) {
+                continue;
+            }
+            const size_t firstChild = _pathsToVisit.size();
+            for (const auto &child : prim.GetChildren()) {
+                _pathsToVisit.push_back(child.GetPath());
+            }
+            std::reverse(_pathsToVisit.begin() + firstChild, _pathsToVisit.end());
+            const PcpPrimIndex &index = prim.GetPrimIndex();
+            if (index.IsValid() && FindReferenceOrPayloadNode(index)) {
+                prims.push_back(prim);
+            }
+        }
+    }
+    const size_t first = _candidates.size();
+    _candidates.resize(first + prims.size());
+    WorkParallelForN(prims.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            ComputeInstancingKey(prims[i], _candidates[first + i]);
+        }
+    });
+    return _pathsToVisit.empty();
+}
+
+bool InstancingAnalysisJob::MeasureGroups(const UsdStageRefPtr &stage, std::chrono::steady_clock::time_point deadline) {
+    std::vector<InstancingGroup> &groups = _analysis.groups;
+    const size_t batchSize = std::max<unsigned>(1, WorkGetConcurrencyLimit());
+    while (_measuredGroups < groups.size() && std::chrono::steady_clock::now() < deadline) {
+        const size_t end = std::min(groups.size(), _measuredGroups + batchSize);
+        WorkParallelForN(end - _measuredGroups, [&](size_t begin, size_t last) {
+            for (size_t i = _measuredGroups + begin; i < _measuredGroups + last; ++i) {
+                SetGroupTarget(stage, groups[i]);
+                ComputeCopyCost(stage, groups[i]);
+            }
+        });
+        _measuredGroups = end;
+    }
+    return _measuredGroups == groups.size();
+}
+
+bool InstancingAnalysisJob::Step() {
+    UsdStageRefPtr stage = _stage;
+    if (IsCancelled() || !stage) {
+        SetStatus("Cancelled");
+        runningAnalysis = nullptr;
+        return false;
+    }
+    if (_stageEdited || !(stage->GetLoadRules() == _loadRules)) {
+        SetStatus("The stage was edited during the analysis, it must be analyzed again");
+        runningAnalysis = nullptr;
+        return false;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    const auto deadline = start + AnalysisTimeSlice;
+    if (!_traversed) {
+        _traversed = FindCandidates(stage, deadline);
+        SetStatus(TfStringPrintf("Traversing the stage, %zu prims bringing assets", _candidates.size()));
+    }
+    if (_traversed && !_grouped) {
+        _analysis.candidates = _candidates.size();
+        _analysis.groups = GroupCandidates(_candidates);
+        _candidates.clear();
+        _grouped = true;
+    }
+    bool measured = false;
+    if (_grouped) {
+        measured = MeasureGroups(stage, deadline);
+        const size_t groupCount = std::max<size_t>(1, _analysis.groups.size());
+        SetProgress(static_cast<float>(_measuredGroups) / static_cast<float>(groupCount));
+        SetStatus(TfStringPrintf("Measuring %zu/%zu groups", _measuredGroups, _analysis.groups.size()));
+    }
+    _analysisTime += std::chrono::steady_clock::now() - start;
+    if (!measured) {
+        return true;
+    }
+    _analysis.elapsedSeconds = std::chrono::duration<double>(_analysisTime).count();
+    SetProgress(1.f);
+    SetStatus(TfStringPrintf("%zu groups found", _analysis.groups.size()));
+    analysis = std::move(_analysis);
+    runningAnalysis = nullptr;
+    return false;
+}
+
+static bool HasInstancingAnalysis(const UsdStageRefPtr &stage) { return stage && analysis.stage == stage; }
+
+/// Set instanceable on the prims of the selected groups, all the prims are modified in one command
+static void MakeSelectedGroupsInstanceable(const UsdStageRefPtr &stage) {
+    SdfPathVector paths;
+    for (const auto &group : analysis.groups) {
+        if (group.selected) {
+            paths.insert(paths.end(), group.prims.begin(), group.prims.end());
+        }
+    }
+    if (paths.empty()) {
+        return;
+    }
+    UsdStageWeakPtr weakStage(stage);
+    std::function<void()> makeInstanceable = [=]() {
+        if (!weakStage) {
+            return;
+        }
+        SdfChangeBlock block;
+        for (const auto &path : paths) {
+            if (UsdPrim prim = weakStage->GetPrimAtPath(path)) {
+                prim.SetInstanceable(true);
+            }
+        }
+    };
+    ExecuteAfterDraw<UsdFunctionCall>(stage, makeInstanceable);
+    // The prims are now instances, the groups are not valid anymore
+    analysis = InstancingAnalysis();
+}
+
+static size_t GetGroupColumnValue(const InstancingGroup &group, int column) {
+    switch (column) {
+    case 1:
+        return group.selected;
+    case 2:
+        return group.prims.size();
+    case 3:
+        return group.subtreePrims;
+    case 4:
+        return group.primsWithLocalOpinions;
+    default:
+        return group.estimatedSavedBytes;
+    }
+}
+
+static void DrawGroupsTable(const UsdStageRefPtr &stage) {
+    constexpr ImGuiTableFlags tableFlags = ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY |
+                                           ImGuiTableFlags_Sortable | ImGuiTableFlags_Resizable;
+    if (ImGui::BeginTable("##InstancingGroups", 6, tableFlags)) {
+        ImGui::TableSetupScrollFreeze(1, 1);
+        ImGui::TableSetupColumn("Asset", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Instance", ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableSetupColumn("Prims", ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableSetupColumn("Prims per copy", ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableSetupColumn("With local opinions", ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableSetupColumn("Estimated saving", ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableHeadersRow();
+        InvalidateTableSorting(analysis.groupsSorted);
+        SortTableRows(
+            analysis.groups, [](const InstancingGroup &group) { return group.target; }, GetGroupColumnValue);
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(analysis.groups.size()));
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                InstancingGroup &group = analysis.groups[row];
+                ImGui::PushID(row);
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                // The check box overlaps the selectable spanning the row
+                if (ImGui::Selectable(group.target.c_str(), false,
+                                      ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowOverlap)) {
+                    ExecuteAfterDraw<EditorSetSelection>(stage, group.prims.front());
+                }
+                if (ImGui::IsItemHovered()) {
+                    ImGui::SetTooltip("%s\n%s ...", group.targetTooltip.c_str(), group.prims.front().GetText());
+                }
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Checkbox("##Selected", &group.selected);
+                ImGui::TableSetColumnIndex(2);
+                ImGui::Text("%zu", group.prims.size());
+                ImGui::TableSetColumnIndex(3);
+                ImGui::Text("%zu", group.subtreePrims);
+                ImGui::TableSetColumnIndex(4);
+                ImGui::Text("%zu", group.primsWithLocalOpinions);
+                ImGui::TableSetColumnIndex(5);
+                ImGui::Text("%s", FormatBytes(static_cast<double>(group.estimatedSavedBytes)).c_str());
+                ImGui::PopID();
+            }
+        }
+        ImGui::EndTable();
+    }
+}
+
+void DrawInstancingAnalyzer(const UsdStageRefPtr &stage) {
+    if (!stage) {
+        return;
+    }
+    ImGui::BeginDisabled(runningAnalysis != nullptr);
+    if (ImGui::Button("Analyze")) {
+        LaunchBackgroundJob(std::make_unique<InstancingAnalysisJob>(stage));
+    }
+    ImGui::EndDisabled();
+    if (runningAnalysis) {
+        ImGui::SameLine();
+        ImGui::Text("%s", runningAnalysis->GetStatus().c_str());
+    }
+    if (!HasInstancingAnalysis(stage)) {
+        ImGui::Text("The stage has not been analyzed");
+        return;
+    }
+    size_t selectedPrims = 0;
+    size_t selectedSavedBytes = 0;
+    size_t savedBytes = 0;
+    for (const auto &group : analysis.groups) {
+        savedBytes += group.estimatedSavedBytes;
+        if (group.selected) {
+            selectedPrims += group.prims.size();
+            selectedSavedBytes += group.estimatedSavedBytes;
+        }
+    }
+    ImGui::SameLine();
+    ImGui::Text("%.3f s, %zu prims bringing assets, %zu groups, about %s could be saved", analysis.elapsedSeconds,
+                analysis.candidates, analysis.groups.size(), FormatBytes(static_cast<double>(savedBytes)).c_str());
+    if (ImGui::Button("Select all")) {
+        for (auto &group : analysis.groups) {
+            group.selected = true;
+        }
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Select none")) {
+        for (auto &group : analysis.groups) {
+            group.selected = false;
+        }
+    }
+    ImGui::SameLine();
+    ImGui::BeginDisabled(selectedPrims == 0);
+    const bool makeInstanceable = ImGui::Button("Make instanceable");
+    ImGui::EndDisabled();
+    if (makeInstanceable) {
+        MakeSelectedGroupsInstanceable(stage);
+        return;
+    }
+    ImGui::SameLine();
+    ImGui::Text("%zu prims, about %s", selectedPrims, FormatBytes(static_cast<double>(selectedSavedBytes)).c_str());
+    DrawGroupsTable(stage);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <pxr/usd/usd/stage.h>
+
+PXR_NAMESPACE_USING_DIRECTIVE
+
+///
+/// Instancing analyzer.
+/// The prims bringing assets with references or payloads, and which are not instanced, are grouped by the arcs of
+/// their prim index: the prims of a group would share the same prototype if they were instanceable. The prims with
+/// local opinions on their descendants are not grouped as they would lose these opinions.
+/// A prim joining a group is instanced with its descendants, the descendants of the other prims can still be grouped.
+/// The saving is estimated from the prims and the properties of one copy of the subtree, multiplied by the number of
+/// copies that instancing removes. The stage is analyzed in a background job, over several frames.
+///
+
+/// Draw the analyzer window: the analyze button, the groups of prims which could be instanced and the button making
+/// the chosen groups instanceable in a single undoable command
+void DrawInstancingAnalyzer(const UsdStageRefPtr &stage);
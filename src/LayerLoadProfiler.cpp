@@ -0,0 +1,275 @@
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <pxr/base/tf/stringUtils.h>
+#include <pxr/usd/ar/asset.h>
+#include <pxr/usd/ar/resolver.h>
+#include <pxr/usd/ar/resolverContextBinder.h>
+#include <pxr/usd/sdf/fileFormat.h>
+#include <pxr/usd/sdf/layer.h>
+#include <pxr/usd/usd/usdFileFormat.h>
+
+#include "FileBrowser.h"
+#include "Gui.h"
+#include "ImGuiHelpers.h"
+#include "LayerLoadProfiler.h"
+#include "ModalDialogs.h"
+
+namespace clk = std::chrono;
+
+struct LayerLoadStats {
+    std::string identifier;
+    std::string displayName;
+    std::string fileFormat;
+    double resolveMs = 0.0;
+    double readMs = 0.0;
+    size_t fileSize = 0;
+    size_t specs = 0;
+    size_t timeSamples = 0;
+    std::string error;
+};
+
+/// Results of the last profile, the task runs on a worker thread and the results are only read once it is ready
+struct LayerLoadProfile {
+    ~LayerLoadProfile() { Cancel(); }
+
+    void Cancel() {
+        if (cancelled) {
+            *cancelled = true;
+        }
+        if (task.valid()) {
+            task.wait();
+        }
+    }
+
+    bool IsRunning() const { return task.valid(); }
+
+    std::shared_ptr<std::atomic<bool>> cancelled;
+    std::shared_ptr<std::atomic<size_t>> processed;
+    size_t total = 0;
+    std::future<std::vector<LayerLoadStats>> task;
+    std::vector<LayerLoadStats> layers;
+    bool isSorted = false;
+};
+
+static LayerLoadProfile profile; // Only accessed from the main thread
+
+static double MillisecondsSince(const clk::steady_clock::time_point &start) {
+    return clk::duration<double, std::milli>(clk::steady_clock::now() - start).count();
+}
+
+/// Resolve and read the layer again, in a new anonymous layer so the layer used by the stage is not modified
+static LayerLoadStats MeasureLayerLoad(const std::string &identifier) {
+    LayerLoadStats stats;
+    stats.identifier = identifier;
+    std::string layerPath;
+    SdfLayer::FileFormatArguments arguments;
+    SdfLayer::SplitIdentifier(identifier, &layerPath, &arguments);
+    stats.displayName = TfGetBaseName(layerPath);
+
+    ArResolver &resolver = ArGetResolver();
+    const auto resolveStart = clk::steady_clock::now();
+    const ArResolvedPath resolvedPath = resolver.Resolve(layerPath);
+    stats.resolveMs = MillisecondsSince(resolveStart);
+    if (resolvedPath.empty()) {
+        stats.error = "unable to resolve";
+        return stats;
+    }
+    if (std::shared_ptr<ArAsset> asset = resolver.OpenAsset(resolvedPath)) {
+        stats.fileSize = asset->GetSize();
+    }
+
+    const auto readStart = clk::steady_clock::now();
+    SdfLayerRefPtr layer = SdfLayer::OpenAsAnonymous(resolvedPath);
+    stats.readMs = MillisecondsSince(readStart);
+    if (!layer) {
+        stats.error = "unable to read";
+        return stats;
+    }
+
+    // The usd format is either usda or usdc
+    const TfToken formatId = layer->GetFileFormat()->GetFormatId();
+    stats.fileFormat = formatId == UsdUsdFileFormatTokens->Id ? UsdUsdFileFormat::GetUnderlyingFormatForLayer(*layer).GetString()
+                                                              : formatId.GetString();
+    layer->Traverse(SdfPath::AbsoluteRootPath(), [&](const SdfPath &path) {
+        stats.specs++;
+        if (path.IsPropertyPath()) {
+            stats.timeSamples += layer->GetNumTimeSamplesForPath(path);
+        }
+    });
+    return stats;
+}
+
+static void LaunchLayerLoadProfile(const UsdStageRefPtr &stage) {
+    profile.Cancel();
+    std::vector<std::string> identifiers;
+    for (const auto &layer : stage->GetUsedLayers()) {
+        if (!layer->IsAnonymous()) {
+            identifiers.push_back(layer->GetIdentifier());
+        }
+    }
+    profile.total = identifiers.size();
+    profile.cancelled = std::make_shared<std::atomic<bool>>(false);
+    profile.processed = std::make_shared<std::atomic<size_t>>(0);
+    std::shared_ptr<std::atomic<bool>> cancelled = profile.cancelled;
+    std::shared_ptr<std::atomic<size_t>> processed = profile.processed;
+    const ArResolverContext context = stage->GetPathResolverContext();
+    // The layers are read one after the other to avoid measuring the contention on the disk
+    profile.task = std::async(std::launch::async, [identifiers, context, cancelled, processed]() {
+        ArResolverContextBinder binder(context);
+        std::vector<LayerLoadStats> layers;
+        for (const auto &identifier : identifiers) {
+            if (*cancelled) {
+                break;
+            }
+            layers.push_back(MeasureLayerLoad(identifier));
+            (*processed)++;
+        }
+        return layers;
+    });
+}
+
+static std::string QuoteCsv(const std::string &value) {
+    std::string quoted("\"");
+    for (const char c : value) {
+        if (c == '"') {
+            quoted += '"';
+        }
+        quoted += c;
+    }
+    quoted += '"';
+    return quoted;
+}
+
+static void ExportLayerLoadStatsCsv(const std::string &filePath, const std::vector<LayerLoadStats> &layers) {
+    std::ofstream csv(filePath);
+    if (!csv) {
+        TF_WARN("unable to write %s", filePath.c_str());
+        return;
+    }
+    csv << "layer,format,size,resolve_ms,read_ms,specs,time_samples,error\n";
+    for (const auto &stats : layers) {
+        csv << QuoteCsv(stats.identifier) << "," << stats.fileFormat << "," << stats.fileSize << "," << stats.resolveMs << ","
+            << stats.readMs << "," << stats.specs << "," << stats.timeSamples << "," << QuoteCsv(stats.error) << "\n";
+    }
+}
+
+struct ExportLayerLoadStatsDialog : public ModalDialog {
+    ExportLayerLoadStatsDialog() {}
+    ~ExportLayerLoadStatsDialog() override {}
+    void Draw() override {
+        DrawFileBrowser();
+        EnsureFileBrowserDefaultExtension("csv");
+        if (FilePathExists()) {
+            ImGui::TextColored(ImVec4(1.0f, 0.1f, 0.1f, 1.0f), "Overwrite: ");
+        } else {
+            ImGui::Text("Export to: ");
+        }
+        auto filePath = GetFileBrowserFilePath();
+        ImGui::Text("%s", filePath.c_str());
+        DrawOkCancelModal([&]() {
+            if (!filePath.empty()) {
+                ExportLayerLoadStatsCsv(filePath, profile.layers);
+            }
+        });
+    }
+    const char *DialogId() const override { return "Export layer load statistics"; }
+};
+
+static double GetLayerColumnValue(const LayerLoadStats &stats, int column) {
+    switch (column) {
+    case 2:
+        return static_cast<double>(stats.fileSize);
+    case 3:
+        return stats.resolveMs;
+    case 4:
+        return stats.readMs;
+    case 5:
+        return static_cast<double>(stats.specs);
+    default:
+        return static_cast<double>(stats.timeSamples);
+    }
+}
+
+static void DrawLayerLoadTable() {
+    constexpr ImGuiTableFlags tableFlags = ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY |
+                                           ImGuiTableFlags_Sortable | ImGuiTableFlags_Resizable;
+    if (ImGui::BeginTable("##LayerLoadProfiler", 7, tableFlags, ImVec2(-FLT_MIN, -10))) {
+        ImGui::TableSetupScrollFreeze(1, 1);
+        ImGui::TableSetupColumn("Layer", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Format", ImGuiTableColumnFlags_NoSort);
+        ImGui::TableSetupColumn("Size (KB)", ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableSetupColumn("Resolve ms", ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableSetupColumn("Read ms", ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableSetupColumn("Specs", ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableSetupColumn("Time samples", ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableHeadersRow();
+        InvalidateTableSorting(profile.isSorted);
+        SortTableRows(
+            profile.layers, [](const LayerLoadStats &stats) { return stats.displayName; }, GetLayerColumnValue);
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(profile.layers.size()));
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                const LayerLoadStats &stats = profile.layers[row];
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                if (stats.error.empty()) {
+                    ImGui::Text("%s", stats.displayName.c_str());
+                } else {
+                    ImGui::TextColored(ImVec4(1.0f, 0.1f, 0.1f, 1.0f), "%s (%s)", stats.displayName.c_str(), stats.error.c_str());
+                }
+                if (ImGui::IsItemHovered()) {
+                    ImGui::SetTooltip("%s", stats.identifier.c_str());
+                }
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Text("%s", stats.fileFormat.c_str());
+                ImGui::TableSetColumnIndex(2);
+                ImGui::Text("%.1f", static_cast<double>(stats.fileSize) / 1024.0);
+                ImGui::TableSetColumnIndex(3);
+                ImGui::Text("%.3f", stats.resolveMs);
+                ImGui::TableSetColumnIndex(4);
+                ImGui::Text("%.3f", stats.readMs);
+                ImGui::TableSetColumnIndex(5);
+                ImGui::Text("%zu", stats.specs);
+                ImGui::TableSetColumnIndex(6);
+                ImGui::Text("%zu", stats.timeSamples);
+            }
+        }
+        ImGui::EndTable();
+    }
+}
+
+void DrawLayerLoadProfiler(const UsdStageRefPtr &stage) {
+    if (profile.IsRunning() && profile.task.wait_for(clk::seconds(0)) == std::future_status::ready) {
+        profile.layers = profile.task.get();
+        profile.isSorted = false;
+    }
+    ImGui::BeginDisabled(!stage || profile.IsRunning());
+    if (ImGui::Button("Profile layers")) {
+        LaunchLayerLoadProfile(stage);
+    }
+    ImGui::EndDisabled();
+    ImGui::SameLine();
+    if (profile.IsRunning()) {
+        ImGui::Text("Reading layer %zu/%zu", static_cast<size_t>(*profile.processed), profile.total);
+        ImGui::SameLine();
+        if (ImGui::Button("Cancel")) {
+            profile.Cancel();
+            profile.layers = profile.task.get();
+            profile.isSorted = false;
+        }
+    } else {
+        ImGui::BeginDisabled(profile.layers.empty());
+        if (ImGui::Button("Export csv")) {
+            DrawModalDialog<ExportLayerLoadStatsDialog>();
+        }
+        ImGui::EndDisabled();
+    }
+    DrawLayerLoadTable();
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <pxr/usd/usd/stage.h>
+
+PXR_NAMESPACE_USING_DIRECTIVE
+
+///
+/// Layer load profiler.
+/// The layers used by the stage are resolved and read again from disk, one after the other on a worker thread,
+/// to measure the resolve and the read/parse times of each layer. The file format, the size on disk, the number of
+/// specs and the number of time samples are recorded as well, so the layers dominating the loading time of a stage,
+/// or the usda layers which should be usdc, can be found.
+///
+
+/// Draw the layer load profiler panel of the debug window: the profiling button, the sortable table of the
+/// results and the csv export
+void DrawLayerLoadProfiler(const UsdStageRefPtr &stage);
@@ -0,0 +1,460 @@
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <pxr/base/tf/diagnostic.h>
+#include <pxr/base/tf/stringUtils.h>
+#include <pxr/usd/sdf/fileFormat.h>
+#include <pxr/usd/sdf/simpleLayerStateDelegate.h>
+#include <pxr/usd/usd/usdFileFormat.h>
+
+#if defined(__cplusplus) && __cplusplus >= 201703L && defined(__has_include) && __has_include(<filesystem>)
+#include <filesystem>
+namespace fs = std::filesystem;
+#else
+#define GHC_WITH_EXCEPTIONS 0
+#include <ghc/filesystem.hpp>
+namespace fs = ghc::filesystem;
+#endif
+
+#include "EditJournal.h"
+#include "Gui.h"
+#include "ImGuiHelpers.h"
+#include "LayerSaveJob.h"
+#include "ModalDialogs.h"
+
+/// The layers currently saved, only accessed from the main thread
+static std::map<SdfLayerHandle, LayerSaveJob *> savingLayers;
+
+/// Count the spec changes per layer, the counts are reset when the layer becomes clean
+class LayerEditCounter : public TfWeakBase {
+  public:
+    LayerEditCounter() {
+        TfWeakPtr<LayerEditCounter> me(this);
+        _layersChangedKey = TfNotice::Register(me, &LayerEditCounter::OnLayersChanged);
+        _dirtinessChangedKey = TfNotice::Register(me, &LayerEditCounter::OnDirtinessChanged);
+    }
+
+    ~LayerEditCounter() {
+        TfNotice::Revoke(_layersChangedKey);
+        TfNotice::Revoke(_dirtinessChangedKey);
+    }
+
+    size_t GetEditCount(const SdfLayerHandle &layer) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        const auto count = _editCounts.find(layer);
+        return count == _editCounts.end() ? 0 : count->second;
+    }
+
+    void Reset(const SdfLayerHandle &layer) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _editCounts.erase(layer);
+    }
+
+  private:
+    // The notices can be sent from the worker threads editing anonymous layers
+    void OnLayersChanged(const SdfNotice::LayersDidChange &notice) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (const auto &layerChanges : notice.GetChangeListVec()) {
+            _editCounts[layerChanges.first] += layerChanges.second.GetEntryList().size();
+        }
+    }
+
+    // The notice doesn't tell which layer changed, they are all checked
+    void OnDirtinessChanged(const SdfNotice::LayerDirtinessChanged &notice) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (auto count = _editCounts.begin(); count != _editCounts.end();) {
+            if (!count->first || !count->first->IsDirty()) {
+                count = _editCounts.erase(count);
+            } else {
+                ++count;
+            }
+        }
+    }
+
+    std::mutex _mutex;
+    std::map<SdfLayerHandle, size_t> _editCounts;
+    TfNotice::Key _layersChangedKey;
+    TfNotice::Key _dirtinessChangedKey;
+};
+
+static std::unique_ptr<LayerEditCounter> layerEditCounter;
+
+void InitializeLayerEditCounter() {
+    if (!layerEditCounter) {
+        layerEditCounter = std::make_unique<LayerEditCounter>();
+    }
+}
+
+size_t GetLayerEditCount(const SdfLayerHandle &layer) {
+    return layerEditCounter && layer && layer->IsDirty() ? layerEditCounter->GetEditCount(layer) : 0;
+}
+
+/// State delegate used to mark a layer clean after it was saved outside SdfLayer::Save. It is left installed on the
+/// layer and behaves like the default delegate, the undo delegates are only installed while a command is recorded
+class SavedLayerStateDelegate : public SdfSimpleLayerStateDelegate {
+  public:
+    static TfRefPtr<SavedLayerStateDelegate> New() { return TfCreateRefPtr(new SavedLayerStateDelegate()); }
+    void MarkClean() { _MarkCurrentStateAsClean(); }
+};
+
+static void MarkLayerClean(const SdfLayerHandle &layer) {
+    // The new delegate inherits the dirty state of the layer, so it is cleaned once installed
+    TfRefPtr<SavedLayerStateDelegate> delegate = SavedLayerStateDelegate::New();
+    layer->SetStateDelegate(delegate);
+    delegate->MarkClean();
+}
+
+#ifdef _WIN64
+/// Windows refuses to replace a file mapped in memory, as the usdc layers are while they are open. The mapped file can
+/// still be renamed, so it is moved aside and the snapshot takes its place. The files moved aside by the previous
+/// saves are deleted once the layers don't map them anymore.
+static void ReplaceMappedFile(const fs::path &temporaryPath, const fs::path &targetPath, std::error_code &errorCode) {
+    fs::path oldPath;
+    for (int index = 0; oldPath.empty(); ++index) {
+        const fs::path candidate = targetPath.string() + "." + std::to_string(index) + ".old";
+        std::error_code removeError;
+        fs::remove(candidate, removeError);
+        if (!fs::exists(candidate, removeError)) {
+            oldPath = candidate;
+        }
+    }
+    fs::rename(targetPath, oldPath, errorCode);
+    if (errorCode) {
+        return;
+    }
+    fs::rename(temporaryPath, targetPath, errorCode);
+    if (errorCode) {
+        std::error_code restoreError;
+        fs::rename(oldPath, targetPath, restoreError);
+        return;
+    }
+    std::error_code removeError;
+    fs::remove(oldPath, removeError);
+}
+#endif
+
+/// Write the snapshot next to the layer file and replace the layer file, returns an error message on failure.
+/// The file replaced is the target of the symlinks, with its permissions, so the links still point to the layer
+static std::string WriteSnapshot(const SdfLayerRefPtr &snapshot, const SdfLayer::FileFormatArguments &arguments,
+                                 const std::string &filePath) {
+    std::error_code errorCode;
+    fs::path targetPath = fs::canonical(fs::path(filePath), errorCode);
+    const bool targetExists = !errorCode;
+    if (!targetExists) {
+        targetPath = fs::path(filePath); // New layer file
+    }
+    const std::string temporaryPath = targetPath.string() + ".tmp";
+    if (!snapshot->GetFileFormat()->WriteToFile(*snapshot, temporaryPath, std::string(), arguments)) {
+        fs::remove(temporaryPath, errorCode);
+        return "unable to write " + temporaryPath;
+    }
+    if (targetExists) {
+        const fs::file_status targetStatus = fs::status(targetPath, errorCode);
+        if (!errorCode) {
+            fs::permissions(temporaryPath, targetStatus.permissions(), errorCode);
+        }
+        if (errorCode) {
+            fs::remove(temporaryPath, errorCode);
+            return "unable to copy the permissions of " + targetPath.string() + ": " + errorCode.message();
+        }
+    }
+    fs::rename(temporaryPath, targetPath, errorCode);
+#ifdef _WIN64
+    if (errorCode && targetExists) {
+        errorCode.clear();
+        ReplaceMappedFile(temporaryPath, targetPath, errorCode);
+    }
+#endif
+    if (errorCode) {
+        const std::string error = "unable to replace " + targetPath.string() + ": " + errorCode.message();
+        fs::remove(temporaryPath, errorCode);
+        return error;
+    }
+    return std::string();
+}
+
+LayerSaveJob::LayerSaveJob(const SdfLayerHandle &layer)
+    : BackgroundJob("Save " + layer->GetDisplayName()), _layer(layer), _filePath(layer->GetRealPath()) {
+    savingLayers[_layer] = this;
+
+    // The usd format writes binary files by default, the format of the layer is kept with the format argument
+    SdfFileFormatConstPtr fileFormat = layer->GetFileFormat();
+    SdfLayer::FileFormatArguments arguments = layer->GetFileFormatArguments();
+    if (fileFormat->GetFormatId() == UsdUsdFileFormatTokens->Id &&
+        arguments.find(UsdUsdFileFormatTokens->FormatArg.GetString()) == arguments.end()) {
+        arguments[UsdUsdFileFormatTokens->FormatArg.GetString()] = UsdUsdFileFormat::GetUnderlyingFormatForLayer(*layer).GetString();
+    }
+    SetStatus("Copying the layer");
+    SdfLayerRefPtr snapshot = SdfLayer::CreateAnonymous("save", fileFormat, arguments);
+    snapshot->TransferContent(layer);
+    _journalPosition = GetEditJournalPosition(layer);
+
+    // Edits after the snapshot are not written, the layer stays dirty if there are any
+    TfWeakPtr<LayerSaveJob> me(this);
+    _layerChangedKey = TfNotice::Register(me, &LayerSaveJob::OnLayerChanged, _layer);
+
+    SetStatus("Writing " + _filePath);
+    SetProgress(0.1f);
+    const std::string filePath = _filePath;
+    _task = std::async(std::launch::async, [this, snapshot, arguments, filePath]() {
+        // The save can only be cancelled before the writing starts, the file is then written completely
+        if (IsCancelled()) {
+            return std::string("cancelled");
+        }
+        return WriteSnapshot(snapshot, arguments, filePath);
+    });
+}
+
+LayerSaveJob::~LayerSaveJob() {
+    TfNotice::Revoke(_layerChangedKey);
+    if (_task.valid()) {
+        _task.wait();
+    }
+    const auto saving = savingLayers.find(_layer);
+    if (saving != savingLayers.end() && saving->second == this) {
+        savingLayers.erase(saving);
+    }
+}
+
+void LayerSaveJob::OnLayerChanged(const SdfNotice::LayersDidChangeSentPerLayer &notice) { _editedDuringSave = true; }
+
+bool LayerSaveJob::Step() {
+    if (_task.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return true;
+    }
+    _error = _task.get();
+    TfNotice::Revoke(_layerChangedKey);
+    savingLayers.erase(_layer);
+    if (!_error.empty()) {
+        SetStatus(_error);
+        TF_WARN("%s", _error.c_str());
+    } else {
+        SetProgress(1.f);
+        // The records up to the snapshot are in the file now, they are removed before any new edit is journaled, so a
+        // recovery never replays them on top of the saved file
+        if (_layer) {
+            TruncateEditJournal(_layer, _journalPosition);
+        }
+        if (_layer && !_editedDuringSave) {
+            MarkLayerClean(_layer);
+            if (layerEditCounter) {
+                layerEditCounter->Reset(_layer);
+            }
+            SetStatus("Saved " + _filePath);
+        } else {
+            SetStatus("Saved " + _filePath + ", the layer was edited during the save");
+        }
+    }
+    if (_saveAgain && _layer) {
+        SaveLayerInBackground(_layer);
+    }
+    return false;
+}
+
+void LayerSaveJob::DrawDetails() {
+    if (_layer && _editedDuringSave && !IsFinished()) {
+        ImGui::Text("The layer was edited after the snapshot, the edits will not be in this save");
+    }
+}
+
+SaveLayersJob::SaveLayersJob(const SdfLayerHandleVector &layers, size_t maxConcurrentSaves)
+    : BackgroundJob(TfStringPrintf("Save %zu layers", layers.size())), _maxConcurrentSaves(std::max<size_t>(1, maxConcurrentSaves)) {
+    for (const auto &layer : layers) {
+        if (layer) {
+            _saves.emplace_back();
+            _saves.back().layer = layer;
+            _saves.back().name = layer->GetDisplayName();
+            _saves.back().status = "Waiting";
+        }
+    }
+}
+
+// The running layer saves wait for their writes in their destructor
+SaveLayersJob::~SaveLayersJob() {}
+
+bool SaveLayersJob::StartLayerSave(LayerSave &save) {
+    if (!save.layer) {
+        save.status = "The layer was unloaded";
+        save.failed = true;
+        return false;
+    }
+    if (IsLayerBeingSaved(save.layer)) {
+        // The running save will save the layer again when it finishes
+        SaveLayerInBackground(save.layer);
+        save.status = "Saved by another job";
+        return false;
+    }
+    save.job = std::make_unique<LayerSaveJob>(save.layer);
+    save.status = "Writing";
+    return true;
+}
+
+bool SaveLayersJob::Step() {
+    for (auto &save : _saves) {
+        if (save.job && !save.job->Step()) {
+            save.failed = !save.job->GetError().empty();
+            save.status = save.job->GetStatus();
+            save.job.reset();
+            _runningSaves--;
+            _finishedSaves++;
+            _failedSaves += save.failed ? 1 : 0;
+        }
+    }
+    if (IsCancelled()) {
+        for (; _nextSave < _saves.size(); ++_nextSave) {
+            _saves[_nextSave].status = "Cancelled";
+        }
+    }
+    while (_runningSaves < _maxConcurrentSaves && _nextSave < _saves.size()) {
+        LayerSave &save = _saves[_nextSave++];
+        if (StartLayerSave(save)) {
+            _runningSaves++;
+        } else {
+            _finishedSaves++;
+            _failedSaves += save.failed ? 1 : 0;
+        }
+    }
+    SetProgress(_saves.empty() ? 1.f : static_cast<float>(_finishedSaves) / static_cast<float>(_saves.size()));
+    SetStatus(TfStringPrintf("%zu/%zu layers saved, %zu writing, %zu failed", _finishedSaves - _failedSaves, _saves.size(),
+                             _runningSaves, _failedSaves));
+    return _runningSaves > 0 || _nextSave < _saves.size();
+}
+
+void SaveLayersJob::DrawDetails() {
+    constexpr ImGuiTableFlags tableFlags = ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY;
+    const float height = std::min(10.f, static_cast<float>(_saves.size() + 1)) * ImGui::GetTextLineHeightWithSpacing();
+    if (ImGui::BeginTable("##SaveLayers", 2, tableFlags, ImVec2(-FLT_MIN, height))) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Layer");
+        ImGui::TableSetupColumn("Status", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableHeadersRow();
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(_saves.size()));
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                const LayerSave &save = _saves[row];
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::Text("%s", save.name.c_str());
+                ImGui::TableSetColumnIndex(1);
+                if (save.failed) {
+                    ImGui::TextColored(ImVec4(1.0f, 0.1f, 0.1f, 1.0f), "%s", save.status.c_str());
+                } else {
+                    ImGui::Text("%s", save.status.c_str());
+                }
+            }
+        }
+        ImGui::EndTable();
+    }
+}
+
+/// Dirty layer listed in the save all dialog
+struct DirtyLayer {
+    SdfLayerHandle layer;
+    std::string name;
+    std::string filePath;
+    double fileSize = -1.0; // Size of the file on disk before the save, negative if it doesn't exist
+    size_t edits = 0;
+    bool selected = true;
+};
+
+struct SaveAllLayersModalDialog : public ModalDialog {
+    SaveAllLayersModalDialog() {
+        for (const auto &layer : SdfLayer::GetLoadedLayers()) {
+            if (layer && layer->IsDirty() && !layer->IsAnonymous()) {
+                DirtyLayer dirtyLayer;
+                dirtyLayer.layer = layer;
+                dirtyLayer.name = layer->GetDisplayName();
+                dirtyLayer.filePath = layer->GetRealPath();
+                std::error_code errorCode;
+                const auto fileSize = fs::file_size(dirtyLayer.filePath, errorCode);
+                dirtyLayer.fileSize = errorCode ? -1.0 : static_cast<double>(fileSize);
+                dirtyLayer.edits = GetLayerEditCount(layer);
+                _layers.push_back(dirtyLayer);
+            }
+        }
+        std::sort(_layers.begin(), _layers.end(), [](const DirtyLayer &a, const DirtyLayer &b) { return a.name < b.name; });
+        // Writing too many files at the same time is slower on hard drives and network filesystems,
+        // the default is kept low and can be raised for fast local drives
+        _maxConcurrentSaves = static_cast<int>(std::min(4u, std::max(1u, std::thread::hardware_concurrency())));
+    }
+    ~SaveAllLayersModalDialog() override {}
+
+    void Draw() override {
+        ImGui::Text("%zu dirty layers", _layers.size());
+        constexpr ImGuiTableFlags tableFlags = ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY;
+        if (ImGui::BeginTable("##DirtyLayers", 4, tableFlags, ImVec2(600, 300))) {
+            ImGui::TableSetupScrollFreeze(0, 1);
+            ImGui::TableSetupColumn("##Selected");
+            ImGui::TableSetupColumn("Layer", ImGuiTableColumnFlags_WidthStretch);
+            ImGui::TableSetupColumn("Size on disk");
+            ImGui::TableSetupColumn("Edits");
+            ImGui::TableHeadersRow();
+            for (auto &dirtyLayer : _layers) {
+                ImGui::TableNextRow();
+                ImGui::PushID(&dirtyLayer);
+                ImGui::TableSetColumnIndex(0);
+                ImGui::Checkbox("##Selected", &dirtyLayer.selected);
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Text("%s", dirtyLayer.name.c_str());
+                if (ImGui::IsItemHovered()) {
+                    ImGui::SetTooltip("%s", dirtyLayer.filePath.c_str());
+                }
+                ImGui::TableSetColumnIndex(2);
+                if (dirtyLayer.fileSize >= 0.0) {
+                    ImGui::Text("%.1f KB", dirtyLayer.fileSize / 1024.0);
+                } else {
+                    ImGui::Text("new file");
+                }
+                ImGui::TableSetColumnIndex(3);
+                ImGui::Text("%zu", dirtyLayer.edits);
+                ImGui::PopID();
+            }
+            ImGui::EndTable();
+        }
+        ImGui::SliderInt("Concurrent writes", &_maxConcurrentSaves, 1, 32);
+        const bool hasSelection =
+            std::any_of(_layers.begin(), _layers.end(), [](const DirtyLayer &dirtyLayer) { return dirtyLayer.selected; });
+        DrawOkCancelModal(
+            [&]() {
+                SdfLayerHandleVector layers;
+                for (const auto &dirtyLayer : _layers) {
+                    if (dirtyLayer.selected && dirtyLayer.layer) {
+                        layers.push_back(dirtyLayer.layer);
+                    }
+                }
+                LaunchBackgroundJob(std::make_unique<SaveLayersJob>(layers, static_cast<size_t>(_maxConcurrentSaves)));
+            },
+            !hasSelection);
+    }
+    const char *DialogId() const override { return "Save all layers"; }
+
+    std::vector<DirtyLayer> _layers;
+    int _maxConcurrentSaves;
+};
+
+void ShowSaveAllLayersDialog() { DrawModalDialog<SaveAllLayersModalDialog>(); }
+
+void SaveLayerInBackground(const SdfLayerHandle &layer) {
+    if (!layer) {
+        return;
+    }
+    const auto saving = savingLayers.find(layer);
+    if (saving != savingLayers.end()) {
+        saving->second->SaveAgain();
+        return;
+    }
+    if (layer->IsAnonymous()) {
+        return;
+    }
+    if (layer->GetRealPath().empty()) {
+        layer->Save();
+        return;
+    }
+    LaunchBackgroundJob(std::make_unique<LayerSaveJob>(layer));
+}
+
+bool IsLayerBeingSaved(const SdfLayerHandle &layer) { return savingLayers.find(layer) != savingLayers.end(); }
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <pxr/base/tf/notice.h>
+#include <pxr/base/tf/weakBase.h>
+#include <pxr/usd/sdf/layer.h>
+#include <pxr/usd/sdf/notice.h>
+
+#include "BackgroundJobs.h"
+
+PXR_NAMESPACE_USING_DIRECTIVE
+
+/// Layer save job
+/// The layer data is copied in an anonymous snapshot layer on the main thread, which is fast compared to the
+/// serialization, then the snapshot is written on a worker thread to a temporary file which replaces the layer file
+/// when complete, so the file on disk is never partially written.
+/// The layer can be edited during the save, it is only marked clean when it wasn't modified after the snapshot.
+class LayerSaveJob : public BackgroundJob, public TfWeakBase {
+  public:
+    LayerSaveJob(const SdfLayerHandle &layer);
+    ~LayerSaveJob() override;
+
+    bool Step() override;
+    void DrawDetails() override;
+
+    /// Save the layer again when this save finishes, for the saves requested while the layer is written
+    void SaveAgain() { _saveAgain = true; }
+
+    const SdfLayerHandle &GetLayer() const { return _layer; }
+
+    /// Empty when the save succeeded, only valid when the job has finished
+    const std::string &GetError() const { return _error; }
+
+  private:
+    void OnLayerChanged(const SdfNotice::LayersDidChangeSentPerLayer &notice);
+
+    SdfLayerHandle _layer;
+    std::string _filePath;
+    std::future<std::string> _task;
+    std::string _error;
+    size_t _journalPosition = 0;
+    bool _editedDuringSave = false;
+    bool _saveAgain = false;
+    TfNotice::Key _layerChangedKey;
+};
+
+/// Save of multiple layers, with a bounded number of layers written at the same time. Each layer is saved with a
+/// LayerSaveJob owned and stepped by this job, the failures are reported per layer in the details.
+/// Cancelling stops the layers not yet started, the layers being written are completed
+class SaveLayersJob : public BackgroundJob {
+  public:
+    SaveLayersJob(const SdfLayerHandleVector &layers, size_t maxConcurrentSaves);
+    ~SaveLayersJob() override;
+
+    bool Step() override;
+    void DrawDetails() override;
+
+  private:
+    struct LayerSave {
+        SdfLayerHandle layer;
+        std::string name;
+        std::unique_ptr<LayerSaveJob> job;
+        std::string status;
+        bool failed = false;
+    };
+
+    /// Start the next layer save, returns false if the layer is saved by another job
+    bool StartLayerSave(LayerSave &save);
+
+    std::vector<LayerSave> _saves;
+    size_t _maxConcurrentSaves;
+    size_t _nextSave = 0;
+    size_t _runningSaves = 0;
+    size_t _finishedSaves = 0;
+    size_t _failedSaves = 0;
+};
+
+/// Start counting the edits of the layers, the counts are used by the save all dialog
+void InitializeLayerEditCounter();
+
+/// Number of spec changes since the layer was last clean
+size_t GetLayerEditCount(const SdfLayerHandle &layer);
+
+/// Open the dialog listing the dirty layers with their size and number of edits, to save them in a SaveLayersJob
+void ShowSaveAllLayersDialog();
+
+/// Save the layer with a LayerSaveJob. The anonymous layers and the layers without a file on disk can't be saved
+/// in the background and are saved immediately
+void SaveLayerInBackground(const SdfLayerHandle &layer);
+
+/// Returns true while a background save of the layer is running
+bool IsLayerBeingSaved(const SdfLayerHandle &layer);
@@ -0,0 +1,290 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <pxr/base/tf/mallocTag.h>
+#include <pxr/base/tf/stringUtils.h>
+#include <pxr/usd/sdf/layer.h>
+
+#include "Gui.h"
+#include "MemoryPanel.h"
+
+#ifdef _WIN64
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+PXR_NAMESPACE_USING_DIRECTIVE
+
+namespace clk = std::chrono;
+
+/// Number of samples of the memory graph, one per second
+static constexpr size_t MaxMemorySamples = 600;
+
+/// The call sites smaller than this fraction of the total are grouped in one line of the tree
+static constexpr double MinCallSiteFraction = 0.001;
+
+/// Memory attributed to a stage, a layer or a subsystem, with the growth since the previous snapshot
+struct MemoryTotal {
+    std::string name;
+    size_t bytes = 0;
+    int64_t growth = 0;
+};
+
+struct MemorySnapshot {
+    TfMallocTag::CallTree callTree;
+    std::vector<MemoryTotal> stages;
+    std::vector<MemoryTotal> layers;
+    std::vector<MemoryTotal> subsystems;
+    /// Bytes per path of the call tree, to compute the growth of the next snapshot
+    std::unordered_map<std::string, size_t> pathBytes;
+};
+
+// Only accessed from the main thread
+static std::vector<float> memorySamples;
+static clk::steady_clock::time_point lastSampleTime;
+static MemorySnapshot snapshot;
+
+bool InitializeMallocTags() {
+    std::string errorMessage;
+    if (!TfMallocTag::Initialize(&errorMessage)) {
+        std::cerr << "unable to initialize the malloc tags: " << errorMessage << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void UpdateMemoryPanel() {
+    if (!TfMallocTag::IsInitialized()) {
+        return;
+    }
+    const auto now = clk::steady_clock::now();
+    if (now - lastSampleTime < clk::seconds(1)) {
+        return;
+    }
+    lastSampleTime = now;
+    memorySamples.push_back(static_cast<float>(TfMallocTag::GetTotalBytes()) / (1024.f * 1024.f));
+    if (memorySamples.size() > MaxMemorySamples) {
+        memorySamples.erase(memorySamples.begin());
+    }
+}
+
+size_t GetPeakResidentMemory() {
+#ifdef _WIN64
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#if defined(__APPLE__)
+    return static_cast<size_t>(usage.ru_maxrss); // bytes on macOS
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024; // kilobytes on linux
+#endif
+#endif
+}
+
+std::string FormatBytes(double bytes) {
+    const char *units[] = {"B", "KB", "MB", "GB"};
+    int unit = 0;
+    while (std::abs(bytes) >= 1024.0 && unit < 3) {
+        bytes /= 1024.0;
+        unit++;
+    }
+    return TfStringPrintf("%.1f %s", bytes, units[unit]);
+}
+
+/// Sort the children by decreasing size and record the bytes of every path
+static void PrepareCallTree(TfMallocTag::CallTree::PathNode &node, const std::string &path,
+                            std::unordered_map<std::string, size_t> &pathBytes) {
+    pathBytes[path] = node.nBytes;
+    std::sort(node.children.begin(), node.children.end(),
+              [](const auto &a, const auto &b) { return a.nBytes > b.nBytes; });
+    for (auto &child : node.children) {
+        PrepareCallTree(child, path + "/" + child.siteName, pathBytes);
+    }
+}
+
+/// The categories of memory found in the call tree, the first matching node of each category on a path is
+/// accounted and its descendants are ignored, to avoid counting nested tags twice
+struct MemoryCategories {
+    std::unordered_set<std::string> layerIdentifiers;
+    std::unordered_set<std::string> subsystems;
+    std::map<std::string, size_t> stages;
+    std::map<std::string, size_t> layers;
+    std::map<std::string, size_t> subsystemBytes;
+};
+
+static const std::string *FindLayerIdentifier(const std::string &siteName, const MemoryCategories &categories) {
+    // The identifiers are usually delimited by spaces or @ in the tags
+    for (const auto &word : TfStringTokenize(siteName, " @")) {
+        const auto identifier = categories.layerIdentifiers.find(word);
+        if (identifier != categories.layerIdentifiers.end()) {
+            return &*identifier;
+        }
+    }
+    return nullptr;
+}
+
+static void AccumulateCategories(const TfMallocTag::CallTree::PathNode &node, MemoryCategories &categories, bool inStage,
+                                 bool inLayer, bool inSubsystem) {
+    if (!inStage && TfStringStartsWith(node.siteName, "UsdStage: ")) {
+        categories.stages[node.siteName.substr(10)] += node.nBytes;
+        inStage = true;
+    }
+    if (!inLayer) {
+        if (const std::string *identifier = FindLayerIdentifier(node.siteName, categories)) {
+            categories.layers[*identifier] += node.nBytes;
+            inLayer = true;
+        }
+    }
+    if (!inSubsystem && categories.subsystems.count(node.siteName)) {
+        categories.subsystemBytes[node.siteName] += node.nBytes;
+        inSubsystem = true;
+    }
+    for (const auto &child : node.children) {
+        AccumulateCategories(child, categories, inStage, inLayer, inSubsystem);
+    }
+}
+
+static std::vector<MemoryTotal> MakeTotals(const std::map<std::string, size_t> &bytes,
+                                           const std::vector<MemoryTotal> &previous) {
+    std::vector<MemoryTotal> totals;
+    for (const auto &category : bytes) {
+        MemoryTotal total{category.first, category.second, static_cast<int64_t>(category.second)};
+        for (const auto &previousTotal : previous) {
+            if (previousTotal.name == category.first) {
+                total.growth = static_cast<int64_t>(category.second) - static_cast<int64_t>(previousTotal.bytes);
+            }
+        }
+        totals.push_back(total);
+    }
+    std::sort(totals.begin(), totals.end(), [](const auto &a, const auto &b) { return a.bytes > b.bytes; });
+    return totals;
+}
+
+static void TakeSnapshot() {
+    MemorySnapshot newSnapshot;
+    TfMallocTag::GetCallTree(&newSnapshot.callTree);
+    PrepareCallTree(newSnapshot.callTree.root, newSnapshot.callTree.root.siteName, newSnapshot.pathBytes);
+
+    MemoryCategories categories;
+    for (const auto &layer : SdfLayer::GetLoadedLayers()) {
+        categories.layerIdentifiers.insert(layer->GetIdentifier());
+        categories.layerIdentifiers.insert(layer->GetRealPath());
+    }
+    categories.layerIdentifiers.erase(std::string());
+    categories.subsystems = {MallocTagUndoStack, MallocTagRenderer, MallocTagClipboard, MallocTagStageOutliner};
+    AccumulateCategories(newSnapshot.callTree.root, categories, false, false, false);
+
+    newSnapshot.stages = MakeTotals(categories.stages, snapshot.stages);
+    newSnapshot.layers = MakeTotals(categories.layers, snapshot.layers);
+    newSnapshot.subsystems = MakeTotals(categories.subsystemBytes, snapshot.subsystems);
+    snapshot = std::move(newSnapshot);
+}
+
+static void DrawMemoryTotals(const char *label, const std::vector<MemoryTotal> &totals) {
+    if (!ImGui::CollapsingHeader(label, ImGuiTreeNodeFlags_DefaultOpen)) {
+        return;
+    }
+    constexpr ImGuiTableFlags tableFlags = ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_RowBg;
+    if (ImGui::BeginTable(label, 3, tableFlags)) {
+        ImGui::TableSetupColumn("Name", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Size");
+        ImGui::TableSetupColumn("Growth");
+        ImGui::TableHeadersRow();
+        for (const auto &total : totals) {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::Text("%s", total.name.c_str());
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%s", FormatBytes(static_cast<double>(total.bytes)).c_str());
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%s%s", total.growth > 0 ? "+" : "", FormatBytes(static_cast<double>(total.growth)).c_str());
+        }
+        ImGui::EndTable();
+    }
+}
+
+static void DrawCallTreeNode(const TfMallocTag::CallTree::PathNode &node, const std::string &path, size_t minBytes,
+                             const std::unordered_map<std::string, size_t> &previousBytes) {
+    const auto previous = previousBytes.find(path);
+    const int64_t growth =
+        static_cast<int64_t>(node.nBytes) - static_cast<int64_t>(previous == previousBytes.end() ? 0 : previous->second);
+    const ImGuiTreeNodeFlags flags = node.children.empty() ? ImGuiTreeNodeFlags_Leaf : ImGuiTreeNodeFlags_None;
+    const bool isOpen = ImGui::TreeNodeEx(path.c_str(), flags, "%s  %s  (%s%s)", node.siteName.c_str(),
+                                          FormatBytes(static_cast<double>(node.nBytes)).c_str(), growth > 0 ? "+" : "",
+                                          FormatBytes(static_cast<double>(growth)).c_str());
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("%zu bytes, %zu direct, %zu allocations", node.nBytes, node.nBytesDirect, node.nAllocations);
+    }
+    if (!isOpen) {
+        return;
+    }
+    size_t hiddenBytes = 0;
+    size_t hiddenSites = 0;
+    for (const auto &child : node.children) {
+        if (child.nBytes >= minBytes) {
+            DrawCallTreeNode(child, path + "/" + child.siteName, minBytes, previousBytes);
+        } else {
+            hiddenBytes += child.nBytes;
+            hiddenSites++;
+        }
+    }
+    if (hiddenSites) {
+        ImGui::TreeNodeEx("##hidden", ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen, "%zu smaller sites  %s",
+                          hiddenSites, FormatBytes(static_cast<double>(hiddenBytes)).c_str());
+    }
+    ImGui::TreePop();
+}
+
+void DrawMemoryPanel() {
+    if (!TfMallocTag::IsInitialized()) {
+        ImGui::Text("The malloc tags are disabled, start usdtweak with --malloc-tags to enable them");
+        return;
+    }
+    ImGui::Text("Total: %s, max: %s", FormatBytes(static_cast<double>(TfMallocTag::GetTotalBytes())).c_str(),
+                FormatBytes(static_cast<double>(TfMallocTag::GetMaxTotalBytes())).c_str());
+    if (!memorySamples.empty()) {
+        ImGui::PlotLines("##MemorySamples", memorySamples.data(), static_cast<int>(memorySamples.size()), 0, "MB over time",
+                         FLT_MAX, FLT_MAX, ImVec2(-FLT_MIN, 60));
+    }
+
+    static std::unordered_map<std::string, size_t> previousPathBytes;
+    static bool autoRefresh = false;
+    static clk::steady_clock::time_point lastSnapshotTime;
+    const auto now = clk::steady_clock::now();
+    // The snapshots are expensive, they are taken on demand or every 5 seconds
+    if (ImGui::Button("Take snapshot") || (autoRefresh && now - lastSnapshotTime > clk::seconds(5))) {
+        previousPathBytes = std::move(snapshot.pathBytes);
+        TakeSnapshot();
+        lastSnapshotTime = now;
+    }
+    ImGui::SameLine();
+    ImGui::Checkbox("Auto refresh", &autoRefresh);
+    if (snapshot.pathBytes.empty()) {
+        return;
+    }
+    DrawMemoryTotals("Subsystems", snapshot.subsystems);
+    DrawMemoryTotals("Stages", snapshot.stages);
+    DrawMemoryTotals("Layers", snapshot.layers);
+    if (ImGui::CollapsingHeader("Call sites", ImGuiTreeNodeFlags_DefaultOpen)) {
+        const TfMallocTag::CallTree::PathNode &root = snapshot.callTree.root;
+        const size_t minBytes = static_cast<size_t>(static_cast<double>(root.nBytes) * MinCallSiteFraction);
+        DrawCallTreeNode(root, root.siteName, minBytes, previousPathBytes);
+    }
+}
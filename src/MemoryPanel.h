@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+///
+/// Memory breakdown using TfMallocTag.
+/// The malloc tags are only collected when they are initialized at startup with --malloc-tags, as they slow down
+/// every allocation. The editor subsystems tag their allocations with the tags below, the stages and the layers
+/// are tagged by USD.
+///
+
+// Using define instead of constexpr for the tags, like the window titles, so they can be used as literals
+#define MallocTagEditor "usdtweak"
+#define MallocTagUndoStack "Undo stack"
+#define MallocTagRenderer "Renderer"
+#define MallocTagClipboard "Clipboard"
+#define MallocTagStageOutliner "Stage outliner"
+
+/// Peak resident memory of the process in bytes, available without the malloc tags
+size_t GetPeakResidentMemory();
+
+/// Memory size with a unit, like "12.5 MB"
+std::string FormatBytes(double bytes);
+
+/// Initialize the malloc tags, this must be called as early as possible in main. Returns false on failure
+bool InitializeMallocTags();
+
+/// Record the total allocated memory, called once per frame in the main loop. The memory is sampled once per second
+void UpdateMemoryPanel();
+
+/// Draw the memory panel of the debug window: the memory over time, the totals per stage, per layer and per subsystem
+/// and the call site tree
+void DrawMemoryPanel();
@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <memory>
+#include <mutex>
+
+#include <pxr/base/work/dispatcher.h>
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usd/schemaBase.h>
+
+#include "SchemaTypeIndex.h"
+
+/// The prims above this depth are dispatched as separate tasks, the subtrees below are traversed sequentially
+static constexpr int ParallelDepth = 4;
+
+using PrimsByType = std::map<TfType, std::vector<SdfPath>>;
+
+/// Results shared by the indexing tasks, each task merges its results once
+struct IndexingResults {
+    std::mutex mutex;
+    PrimsByType primsByType;
+
+    void Merge(PrimsByType &found) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto &typeAndPaths : found) {
+            auto &paths = primsByType[typeAndPaths.first];
+            paths.insert(paths.end(), typeAndPaths.second.begin(), typeAndPaths.second.end());
+        }
+    }
+};
+
+static void AddPrim(const UsdPrim &prim, PrimsByType &found) {
+    const TfToken &typeName = prim.GetTypeName();
+    if (typeName.IsEmpty()) {
+        return;
+    }
+    static const TfType schemaBaseType = TfType::Find<UsdSchemaBase>();
+    const TfType schemaType = schemaBaseType.FindDerivedByName(typeName);
+    if (!schemaType.IsUnknown()) {
+        found[schemaType].push_back(prim.GetPath());
+    }
+}
+
+static void IndexPrim(const UsdPrim &prim, int depth, WorkDispatcher &dispatcher, IndexingResults &results) {
+    PrimsByType found;
+    if (depth < ParallelDepth) {
+        AddPrim(prim, found);
+        for (const auto &child : prim.GetFilteredChildren(UsdPrimDefaultPredicate)) {
+            dispatcher.Run([child, depth, &dispatcher, &results]() { IndexPrim(child, depth + 1, dispatcher, results); });
+        }
+    } else {
+        for (const auto &descendant : UsdPrimRange(prim, UsdPrimDefaultPredicate)) {
+            AddPrim(descendant, found);
+        }
+    }
+    if (!found.empty()) {
+        results.Merge(found);
+    }
+}
+
+SchemaTypeIndex::SchemaTypeIndex(const UsdStageWeakPtr &stage) : _stage(stage) {
+    if (_stage) {
+        TfWeakPtr<SchemaTypeIndex> me(this);
+        _objectsChangedKey = TfNotice::Register(me, &SchemaTypeIndex::OnObjectsChanged, _stage);
+    }
+}
+
+SchemaTypeIndex::~SchemaTypeIndex() { TfNotice::Revoke(_objectsChangedKey); }
+
+void SchemaTypeIndex::OnObjectsChanged(const UsdNotice::ObjectsChanged &notice, const UsdStageWeakPtr &sender) {
+    if (!_isBuilt) {
+        return;
+    }
+    // Only the prim resyncs can change the types, the property resyncs are ignored
+    for (const auto &path : notice.GetResyncedPaths()) {
+        if (path.IsAbsoluteRootOrPrimPath()) {
+            _resyncedPaths.push_back(path);
+        }
+    }
+}
+
+void SchemaTypeIndex::IndexSubtree(const SdfPath &path) {
+    const UsdPrim prim = _stage->GetPrimAtPath(path);
+    if (!prim || !UsdPrimDefaultPredicate(prim)) {
+        return;
+    }
+    IndexingResults results;
+    {
+        WorkDispatcher dispatcher;
+        IndexPrim(prim, path.GetPathElementCount(), dispatcher, results);
+        dispatcher.Wait();
+    }
+    for (auto &typeAndPaths : results.primsByType) {
+        _primsByType[typeAndPaths.first].insert(typeAndPaths.second.begin(), typeAndPaths.second.end());
+    }
+}
+
+void SchemaTypeIndex::Update() {
+    if (!_stage) {
+        _primsByType.clear();
+        _queries.clear();
+        return;
+    }
+    if (!_isBuilt) {
+        _primsByType.clear();
+        _queries.clear();
+        _resyncedPaths.clear();
+        IndexSubtree(SdfPath::AbsoluteRootPath());
+        _isBuilt = true;
+        return;
+    }
+    if (_resyncedPaths.empty()) {
+        return;
+    }
+    // Remove the resynced subtrees and index them again
+    SdfPath::RemoveDescendentPaths(&_resyncedPaths);
+    for (const auto &resyncedPath : _resyncedPaths) {
+        for (auto &typeAndPaths : _primsByType) {
+            // The descendants of a path are sorted right after it
+            auto &paths = typeAndPaths.second;
+            auto it = paths.lower_bound(resyncedPath);
+            while (it != paths.end() && it->HasPrefix(resyncedPath)) {
+                it = paths.erase(it);
+            }
+        }
+        IndexSubtree(resyncedPath);
+    }
+    _resyncedPaths.clear();
+    _queries.clear();
+}
+
+const SdfPathVector &SchemaTypeIndex::GetPrimPaths(const TfType &schemaType) {
+    Update();
+    auto query = _queries.find(schemaType);
+    if (query == _queries.end()) {
+        SdfPathVector &paths = _queries[schemaType];
+        for (const auto &typeAndPaths : _primsByType) {
+            if (typeAndPaths.first.IsA(schemaType)) {
+                paths.insert(paths.end(), typeAndPaths.second.begin(), typeAndPaths.second.end());
+            }
+        }
+        std::sort(paths.begin(), paths.end());
+        return paths;
+    }
+    return query->second;
+}
+
+SchemaTypeIndex &GetSchemaTypeIndex(const UsdStageWeakPtr &stage) {
+    // The indices are only accessed from the main thread
+    static std::vector<std::unique_ptr<SchemaTypeIndex>> indices;
+    // Release the indices of the destroyed stages
+    indices.erase(std::remove_if(indices.begin(), indices.end(), [](const auto &index) { return !index->GetStage(); }),
+                  indices.end());
+    for (auto &index : indices) {
+        if (index->GetStage() == stage) {
+            return *index;
+        }
+    }
+    indices.emplace_back(std::make_unique<SchemaTypeIndex>(stage));
+    return *indices.back();
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include <pxr/base/tf/type.h>
+#include <pxr/base/tf/weakBase.h>
+#include <pxr/usd/sdf/path.h>
+#include <pxr/usd/usd/notice.h>
+#include <pxr/usd/usd/stage.h>
+
+PXR_NAMESPACE_USING_DIRECTIVE
+
+///
+/// Index of the prims of a stage by schema type, used by the pickers listing the cameras, materials, ...
+/// The stage is traversed in parallel the first time the index is queried, then the index is updated only on the
+/// subtrees resynced by the ObjectsChanged notices.
+/// The traversal uses the default predicate, like UsdStage::Traverse.
+///
+class SchemaTypeIndex : public TfWeakBase {
+  public:
+    SchemaTypeIndex(const UsdStageWeakPtr &stage);
+    ~SchemaTypeIndex();
+
+    SchemaTypeIndex(const SchemaTypeIndex &) = delete;
+    SchemaTypeIndex &operator=(const SchemaTypeIndex &) = delete;
+
+    /// Sorted paths of the prims which are of the schema type or a derived type, like UsdPrim::IsA.
+    /// The reference is valid until the next call or the next modification of the stage.
+    const SdfPathVector &GetPrimPaths(const TfType &schemaType);
+
+    template <typename SchemaT> const SdfPathVector &GetPrimPaths() { return GetPrimPaths(TfType::Find<SchemaT>()); }
+
+    const UsdStageWeakPtr &GetStage() const { return _stage; }
+
+  private:
+    void OnObjectsChanged(const UsdNotice::ObjectsChanged &notice, const UsdStageWeakPtr &sender);
+
+    /// Apply the pending resyncs, or build the whole index the first time
+    void Update();
+
+    /// Index the prims of the subtree rooted at path, in parallel
+    void IndexSubtree(const SdfPath &path);
+
+    UsdStageWeakPtr _stage;
+    TfNotice::Key _objectsChangedKey;
+
+    bool _isBuilt = false;
+    SdfPathVector _resyncedPaths;
+
+    /// Prim paths by concrete schema type
+    std::map<TfType, std::set<SdfPath>> _primsByType;
+
+    /// Results of GetPrimPaths, they are cleared when the index changes
+    std::map<TfType, SdfPathVector> _queries;
+};
+
+/// Returns the index of the stage, it is created on the first call and released when the stage is destroyed
+SchemaTypeIndex &GetSchemaTypeIndex(const UsdStageWeakPtr &stage);
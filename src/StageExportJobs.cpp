@@ -0,0 +1,614 @@
+#include <algorithm>
+#include <fstream>
+#include <thread>
+
+#include <pxr/base/arch/fileSystem.h>
+#include <pxr/base/tf/errorMark.h>
+#include <pxr/base/tf/fileUtils.h>
+#include <pxr/base/tf/pathUtils.h>
+#include <pxr/base/tf/stringUtils.h>
+#include <pxr/usd/ar/asset.h>
+#include <pxr/usd/ar/packageUtils.h>
+#include <pxr/usd/ar/resolver.h>
+#include <pxr/usd/ar/resolverContextBinder.h>
+#include <pxr/usd/sdf/fileFormat.h>
+#include <pxr/usd/sdf/zipFile.h>
+#include <pxr/usd/sdf/attributeSpec.h>
+#include <pxr/usd/sdf/primSpec.h>
+#include <pxr/usd/sdf/relationshipSpec.h>
+#include <pxr/usd/usd/attribute.h>
+#include <pxr/usd/usd/relationship.h>
+#include <pxr/usd/usd/resolveInfo.h>
+#include <pxr/usd/usdUtils/dependencies.h>
+#include <pxr/usd/usdUtils/usdzPackage.h>
+
+#include "Gui.h"
+#include "MemoryPanel.h"
+#include "StageExportJobs.h"
+
+/// The walk of the stage yields after this long and resumes at the next frame
+static constexpr std::chrono::milliseconds FlattenTimeSlice(10);
+
+/// Number of prims written in each chunk of the flattened export, when it is split in chunks
+static constexpr size_t FlattenChunkPrims = 20000;
+
+static std::string ExportLayer(const SdfLayerRefPtr &layer, const std::string &filePath) {
+    TfErrorMark errorMark;
+    if (!layer->Export(filePath)) {
+        return std::string("Unable to write ") + filePath;
+    }
+    return std::string();
+}
+
+/// The composition arcs are resolved by the flattening, they are not copied with the prim metadata
+static bool IsFlattenedPrimField(const TfToken &field) {
+    return field == SdfFieldKeys->References || field == SdfFieldKeys->Payload || field == SdfFieldKeys->InheritPaths ||
+           field == SdfFieldKeys->Specializes || field == SdfFieldKeys->VariantSetNames ||
+           field == SdfFieldKeys->VariantSelection || field == SdfFieldKeys->Specifier || field == SdfFieldKeys->TypeName;
+}
+
+/// The asset paths are written resolved, the flattened layer is not next to the layers they were relative to
+static VtValue ResolveAssetPaths(const VtValue &value) {
+    if (value.IsHolding<SdfAssetPath>()) {
+        const SdfAssetPath &assetPath = value.UncheckedGet<SdfAssetPath>();
+        return assetPath.GetResolvedPath().empty() ? value : VtValue(SdfAssetPath(assetPath.GetResolvedPath()));
+    }
+    if (value.IsHolding<SdfAssetPathArray>()) {
+        SdfAssetPathArray assetPaths = value.UncheckedGet<SdfAssetPathArray>();
+        for (auto &assetPath : assetPaths) {
+            if (!assetPath.GetResolvedPath().empty()) {
+                assetPath = SdfAssetPath(assetPath.GetResolvedPath());
+            }
+        }
+        return VtValue::Take(assetPaths);
+    }
+    return value;
+}
+
+FlattenExportJob::FlattenExportJob(const UsdStageRefPtr &stage, const std::string &filePath, bool writeChunks)
+    : BackgroundJob("Export flattened " + TfGetBaseName(filePath)), _stage(stage), _filePath(filePath),
+      _writeChunks(writeChunks), _peakMemoryAtStart(GetPeakResidentMemory()) {
+    _flattened = SdfLayer::CreateAnonymous("flattened.usdc");
+    if (_writeChunks) {
+        // The chunks are in a directory next to the root layer, they are sublayered with relative paths
+        _chunkDirectoryName = TfGetBaseName(TfStringGetBeforeSuffix(filePath)) + "_chunks";
+        const std::string directory = TfGetPathName(filePath);
+        _chunkDirectory = directory.empty() ? _chunkDirectoryName : TfStringCatPaths(directory, _chunkDirectoryName);
+        if (!TfIsDir(_chunkDirectory)) {
+            TfMakeDirs(_chunkDirectory, -1, true);
+        }
+        _chunk = CreateChunk();
+    } else {
+        _chunk = _flattened;
+    }
+
+    const auto prototypes = _stage->GetPrototypes();
+    for (size_t i = 0; i < prototypes.size(); ++i) {
+        _prototypes[prototypes[i].GetPath()] = SdfPath(TfStringPrintf("/Flattened_Prototype_%zu", i + 1));
+    }
+    for (const auto &prim : _stage->GetPseudoRoot().GetAllChildren()) {
+        _subtrees.emplace_back(prim, prim.GetPath());
+    }
+    for (const auto &prototype : prototypes) {
+        _subtrees.emplace_back(prototype, MapPath(prototype.GetPath()));
+    }
+    // The root prims keep their order when they are in different chunks
+    if (_writeChunks) {
+        TfTokenVector rootPrimOrder;
+        for (const auto &subtree : _subtrees) {
+            rootPrimOrder.push_back(subtree.second.GetNameToken());
+        }
+        _flattened->SetRootPrimOrder(rootPrimOrder);
+    }
+    FlattenStageMetadata();
+
+    for (const auto &layer : _stage->GetUsedLayers()) {
+        _exportedLayers.insert(layer);
+    }
+    // The session layer and its sublayers come first in the layer stack, before the root layer
+    for (const auto &layer : _stage->GetLayerStack(true)) {
+        if (layer == _stage->GetRootLayer()) {
+            break;
+        }
+        _exportedLayers.erase(layer);
+    }
+    _loadRules = _stage->GetLoadRules();
+
+    TfWeakPtr<FlattenExportJob> me(this);
+    _layersChangedKey = TfNotice::Register(me, &FlattenExportJob::OnLayersChanged);
+    _layerMutingChangedKey = TfNotice::Register(me, &FlattenExportJob::OnLayerMutingChanged, _stage);
+    _objectsChangedKey = TfNotice::Register(me, &FlattenExportJob::OnObjectsChanged, _stage);
+}
+
+FlattenExportJob::~FlattenExportJob() {
+    TfNotice::Revoke(_layersChangedKey);
+    TfNotice::Revoke(_layerMutingChangedKey);
+    TfNotice::Revoke(_objectsChangedKey);
+    if (_chunkTask.valid()) {
+        _chunkTask.wait();
+    }
+    if (_task.valid()) {
+        _task.wait();
+    }
+}
+
+void FlattenExportJob::OnLayersChanged(const SdfNotice::LayersDidChange &notice) {
+    for (const auto &layerChanges : notice.GetChangeListVec()) {
+        if (_exportedLayers.count(layerChanges.first)) {
+            _stageEdited = true;
+            return;
+        }
+    }
+}
+
+void FlattenExportJob::OnLayerMutingChanged(const UsdNotice::LayerMutingChanged &notice) { _stageEdited = true; }
+
+// A resync, even authored in the session layer, releases the prims of the range walked. The value changes of the
+// session layer, like the draw modes set by the viewport, are left to the layer notices
+void FlattenExportJob::OnObjectsChanged(const UsdNotice::ObjectsChanged &notice) {
+    if (!notice.GetResyncedPaths().empty()) {
+        _stageEdited = true;
+    }
+}
+
+SdfLayerRefPtr FlattenExportJob::CreateChunk() const {
+    // The usdc format is kept in memory as crate data and written without conversion. The time codes of the chunks
+    // must match the root layer, otherwise the sublayer offsets would rescale the time samples
+    SdfLayerRefPtr chunk = SdfLayer::CreateAnonymous("flattened_chunk.usdc");
+    chunk->SetTimeCodesPerSecond(_stage->GetTimeCodesPerSecond());
+    chunk->SetFramesPerSecond(_stage->GetFramesPerSecond());
+    return chunk;
+}
+
+bool FlattenExportJob::IsChunkFull() const { return _writeChunks && _chunkPrims >= FlattenChunkPrims; }
+
+void FlattenExportJob::WriteChunk() {
+    const std::string chunkName = TfStringPrintf("chunk_%04zu.usdc", _chunkPaths.size() + 1);
+    _chunkPaths.push_back("./" + _chunkDirectoryName + "/" + chunkName);
+    const std::string chunkPath = TfStringCatPaths(_chunkDirectory, chunkName);
+    SdfLayerRefPtr chunk = _chunk;
+    // The chunk is released by the worker as soon as it is written
+    _chunkTask = std::async(std::launch::async, [chunk, chunkPath]() mutable {
+        const std::string error = ExportLayer(chunk, chunkPath);
+        chunk = SdfLayerRefPtr();
+        return error;
+    });
+    _chunk = CreateChunk();
+    _chunkPrims = 0;
+}
+
+SdfPath FlattenExportJob::MapPath(const SdfPath &path) const {
+    if (_prototypes.empty() || !path.IsAbsolutePath()) {
+        return path;
+    }
+    SdfPath root = path;
+    while (root.GetPathElementCount() > 1) {
+        root = root.GetParentPath();
+    }
+    const auto prototype = _prototypes.find(root);
+    return prototype == _prototypes.end() ? path : path.ReplacePrefix(prototype->first, prototype->second);
+}
+
+void FlattenExportJob::FlattenStageMetadata() {
+    for (const auto &metadata : _stage->GetPseudoRoot().GetAllAuthoredMetadata()) {
+        if (metadata.first != SdfFieldKeys->SubLayers && metadata.first != SdfFieldKeys->SubLayerOffsets) {
+            _flattened->SetField(SdfPath::AbsoluteRootPath(), metadata.first, metadata.second);
+        }
+    }
+}
+
+void FlattenExportJob::FlattenPrim(const UsdPrim &prim, const SdfPath &path) {
+    SdfPrimSpecHandle primSpec = SdfCreatePrimInLayer(_chunk, path);
+    if (!primSpec) {
+        return;
+    }
+    _chunk->SetField(path, SdfFieldKeys->Specifier, prim.GetSpecifier());
+    if (!prim.GetTypeName().IsEmpty()) {
+        _chunk->SetField(path, SdfFieldKeys->TypeName, prim.GetTypeName());
+    }
+    for (const auto &metadata : prim.GetAllAuthoredMetadata()) {
+        if (!IsFlattenedPrimField(metadata.first)) {
+            _chunk->SetField(path, metadata.first, metadata.second);
+        }
+    }
+    // The children flattened in the next chunks are sorted by the prim order when the chunks are composed
+    if (_writeChunks && !prim.IsInstance()) {
+        const TfTokenVector childrenNames = prim.GetAllChildrenNames();
+        if (childrenNames.size() > 1) {
+            _chunk->SetField(path, SdfFieldKeys->PrimOrder, childrenNames);
+        }
+    }
+    // The instances reference their flattened prototype, their children are not traversed
+    if (prim.IsInstance()) {
+        const auto prototype = _prototypes.find(prim.GetPrototype().GetPath());
+        if (prototype != _prototypes.end()) {
+            SdfReferenceListOp references;
+            references.SetPrependedItems({SdfReference(std::string(), prototype->second)});
+            _chunk->SetField(path, SdfFieldKeys->References, references);
+        }
+    }
+    for (const auto &attribute : prim.GetAuthoredAttributes()) {
+        FlattenAttribute(attribute, primSpec);
+    }
+    for (const auto &relationship : prim.GetAuthoredRelationships()) {
+        FlattenRelationship(relationship, primSpec);
+    }
+}
+
+void FlattenExportJob::FlattenAttribute(const UsdAttribute &attribute, const SdfPrimSpecHandle &primSpec) {
+    SdfAttributeSpecHandle attributeSpec = SdfAttributeSpec::New(primSpec, attribute.GetName(), attribute.GetTypeName(),
+                                                                 attribute.GetVariability(), attribute.IsCustom());
+    if (!attributeSpec) {
+        return;
+    }
+    const SdfPath path = attributeSpec->GetPath();
+    for (const auto &metadata : attribute.GetAllAuthoredMetadata()) {
+        if (metadata.first != SdfFieldKeys->TypeName && metadata.first != SdfFieldKeys->Variability &&
+            metadata.first != SdfFieldKeys->Custom && metadata.first != SdfFieldKeys->Default &&
+            metadata.first != SdfFieldKeys->TimeSamples && metadata.first != SdfFieldKeys->ConnectionPaths) {
+            _chunk->SetField(path, metadata.first, metadata.second);
+        }
+    }
+    // The values are resolved with the layer offsets, they share their arrays with the source layers
+    const UsdResolveInfo resolveInfo = attribute.GetResolveInfo(UsdTimeCode::Default());
+    if (resolveInfo.ValueIsBlocked()) {
+        _chunk->SetField(path, SdfFieldKeys->Default, SdfValueBlock());
+    } else if (resolveInfo.GetSource() == UsdResolveInfoSourceDefault) {
+        VtValue value;
+        if (attribute.Get(&value, UsdTimeCode::Default())) {
+            _chunk->SetField(path, SdfFieldKeys->Default, ResolveAssetPaths(value));
+        }
+    }
+    std::vector<double> times;
+    if (attribute.GetTimeSamples(&times)) {
+        for (const double time : times) {
+            VtValue value;
+            if (attribute.Get(&value, time)) {
+                _chunk->SetTimeSample(path, time, ResolveAssetPaths(value));
+            }
+        }
+    }
+    SdfPathVector connections;
+    if (attribute.HasAuthoredConnections() && attribute.GetConnections(&connections)) {
+        std::transform(connections.begin(), connections.end(), connections.begin(),
+                       [this](const SdfPath &connection) { return MapPath(connection); });
+        _chunk->SetField(path, SdfFieldKeys->ConnectionPaths, SdfPathListOp::CreateExplicit(connections));
+    }
+}
+
+void FlattenExportJob::FlattenRelationship(const UsdRelationship &relationship, const SdfPrimSpecHandle &primSpec) {
+    SdfRelationshipSpecHandle relationshipSpec =
+        SdfRelationshipSpec::New(primSpec, relationship.GetName(), relationship.IsCustom());
+    if (!relationshipSpec) {
+        return;
+    }
+    const SdfPath path = relationshipSpec->GetPath();
+    for (const auto &metadata : relationship.GetAllAuthoredMetadata()) {
+        if (metadata.first != SdfFieldKeys->Custom && metadata.first != SdfFieldKeys->TargetPaths) {
+            _chunk->SetField(path, metadata.first, metadata.second);
+        }
+    }
+    SdfPathVector targets;
+    if (relationship.HasAuthoredTargets() && relationship.GetTargets(&targets)) {
+        std::transform(targets.begin(), targets.end(), targets.begin(), [this](const SdfPath &target) { return MapPath(target); });
+        _chunk->SetField(path, SdfFieldKeys->TargetPaths, SdfPathListOp::CreateExplicit(targets));
+    }
+}
+
+bool FlattenExportJob::Step() {
+    // Writing the flattened layer
+    if (_task.valid()) {
+        if (_task.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return true;
+        }
+        const std::string error = _task.get();
+        _flattened = SdfLayerRefPtr();
+        if (error.empty()) {
+            SetProgress(1.f);
+            SetStatus(_writeChunks ? TfStringPrintf("Exported %zu prims in %zu chunks to %s", _flattenedPrims,
+                                                    _chunkPaths.size(), _filePath.c_str())
+                                   : TfStringPrintf("Exported %zu prims to %s", _flattenedPrims, _filePath.c_str()));
+        } else {
+            SetStatus(error);
+            TF_WARN("%s", error.c_str());
+        }
+        return false;
+    }
+
+    if (IsCancelled()) {
+        SetStatus("Cancelled");
+        return false;
+    }
+    if (_stageEdited || !(_stage->GetLoadRules() == _loadRules)) {
+        SetStatus("The stage was edited during the export, the export was stopped");
+        TF_WARN("The stage was edited during the export of %s, the export was stopped", _filePath.c_str());
+        return false;
+    }
+
+    // The previous chunk is written while the current one is flattened, the walk waits when the current one is full
+    if (_chunkTask.valid()) {
+        if (_chunkTask.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            const std::string error = _chunkTask.get();
+            if (!error.empty()) {
+                SetStatus(error);
+                TF_WARN("%s", error.c_str());
+                return false;
+            }
+        } else if (IsChunkFull()) {
+            return true;
+        }
+    }
+
+    // Walk the stage until the end of the time slice or until the chunk is full
+    const auto start = std::chrono::steady_clock::now();
+    const auto deadline = start + FlattenTimeSlice;
+    while (!IsChunkFull() && std::chrono::steady_clock::now() < deadline) {
+        if (!_inSubtree) {
+            if (_currentSubtree == _subtrees.size()) {
+                break;
+            }
+            _range = UsdPrimRange(_subtrees[_currentSubtree].first, UsdPrimAllPrimsPredicate);
+            _current = _range.begin();
+            _inSubtree = true;
+        }
+        if (_current == _range.end()) {
+            _inSubtree = false;
+            _currentSubtree++;
+            continue;
+        }
+        const auto &subtree = _subtrees[_currentSubtree];
+        FlattenPrim(*_current, _current->GetPath().ReplacePrefix(subtree.first.GetPath(), subtree.second));
+        _flattenedPrims++;
+        _chunkPrims++;
+        ++_current;
+    }
+    _flattenTime += std::chrono::steady_clock::now() - start;
+
+    const bool walked = _currentSubtree == _subtrees.size();
+    if (_writeChunks && _chunkPrims > 0 && (walked || IsChunkFull()) && !_chunkTask.valid()) {
+        WriteChunk();
+    }
+    if (!walked || (_writeChunks && _chunkPrims > 0) || _chunkTask.valid()) {
+        SetProgress(0.9f * static_cast<float>(_currentSubtree) / static_cast<float>(_subtrees.size()));
+        SetStatus(walked ? TfStringPrintf("Writing chunk %zu", _chunkPaths.size())
+                         : TfStringPrintf("Flattening %s, %zu prims", _subtrees[_currentSubtree].second.GetText(), _flattenedPrims));
+        return true;
+    }
+
+    // All the prims are flattened, the root layer is only accessed by the worker from now on
+    TfNotice::Revoke(_layersChangedKey);
+    TfNotice::Revoke(_layerMutingChangedKey);
+    TfNotice::Revoke(_objectsChangedKey);
+    _chunk = SdfLayerRefPtr();
+    if (_writeChunks) {
+        _flattened->SetSubLayerPaths(_chunkPaths);
+    }
+    SetProgress(0.9f);
+    SetStatus("Writing " + _filePath);
+    SdfLayerRefPtr flattened = _flattened;
+    const std::string filePath = _filePath;
+    _task = std::async(std::launch::async, [flattened, filePath]() { return ExportLayer(flattened, filePath); });
+    return true;
+}
+
+void FlattenExportJob::DrawDetails() {
+    ImGui::Text("%zu prims flattened in %.1fs", _flattenedPrims,
+                std::chrono::duration<double>(_flattenTime).count());
+    if (_writeChunks) {
+        ImGui::Text("%zu chunks of %zu prims in %s", _chunkPaths.size(), FlattenChunkPrims, _chunkDirectory.c_str());
+    }
+    const size_t peakMemory = GetPeakResidentMemory();
+    ImGui::Text("Peak memory: %s", FormatBytes(static_cast<double>(peakMemory)).c_str());
+    if (peakMemory > _peakMemoryAtStart) {
+        ImGui::SameLine();
+        ImGui::Text("(+%s during the export)", FormatBytes(static_cast<double>(peakMemory - _peakMemoryAtStart)).c_str());
+    }
+}
+
+/// Maximum number of files written at the same time in the package directory
+static constexpr size_t MaxConcurrentPackageWrites = 8;
+
+UsdzExportJob::UsdzExportJob(const UsdStageRefPtr &stage, const std::string &filePath, bool useArKit)
+    : BackgroundJob("Export " + TfGetBaseName(filePath)), _filePath(filePath), _useArKit(useArKit) {
+    const SdfLayerHandle rootLayer = stage->GetRootLayer();
+    if (rootLayer->IsAnonymous()) {
+        return; // Reported by Step
+    }
+    _rootLayerPath = rootLayer->GetRealPath();
+    _resolverContext = stage->GetPathResolverContext();
+    // The unsaved edits are packaged, the dirty layers are copied as they are now
+    SetStatus("Copying the modified layers");
+    for (const auto &layer : stage->GetUsedLayers()) {
+        if (layer && layer->IsDirty() && !layer->IsAnonymous()) {
+            SdfLayerRefPtr copy = SdfLayer::CreateAnonymous("usdz", layer->GetFileFormat(), layer->GetFileFormatArguments());
+            copy->TransferContent(layer);
+            _dirtyLayers[layer->GetRealPath()] = copy;
+        }
+    }
+    _task = std::async(std::launch::async, [this]() {
+        ArResolverContextBinder binder(_resolverContext);
+        const std::string directory = ArchMakeTmpSubdir(ArchGetTmpDir(), "usdtweak_usdz");
+        if (directory.empty()) {
+            return std::string("Unable to create a temporary directory");
+        }
+        const std::string error = Package(directory);
+        TfRmTree(directory);
+        return error;
+    });
+}
+
+UsdzExportJob::~UsdzExportJob() {
+    Cancel();
+    if (_task.valid()) {
+        _task.wait();
+    }
+}
+
+const std::string &UsdzExportJob::AddFile(const std::string &resolvedPath) {
+    const auto found = _fileIndices.find(resolvedPath);
+    if (found != _fileIndices.end()) {
+        return _files[found->second].name;
+    }
+    // All the files are at the root of the package, the names are made unique
+    const std::string filePath =
+        ArIsPackageRelativePath(resolvedPath) ? ArSplitPackageRelativePathInner(resolvedPath).second : resolvedPath;
+    std::string name = TfGetBaseName(filePath);
+    const size_t nameCount = _nameCounts[name]++;
+    if (nameCount) {
+        const std::string extension = TfGetExtension(name);
+        name = TfStringPrintf("%s_%zu.%s", TfStringGetBeforeSuffix(name).c_str(), nameCount, extension.c_str());
+    }
+    PackageFile file;
+    file.name = name;
+    file.sourcePath = resolvedPath;
+    // The packages are copied as assets, their layers are already anchored in the package
+    const std::string extension = ArGetResolver().GetExtension(resolvedPath);
+    file.isLayer = extension != "usdz" && SdfFileFormat::FindByExtension(extension);
+    file.isLayer ? _layerCount++ : _assetCount++;
+    _fileIndices[resolvedPath] = _files.size();
+    _files.push_back(std::move(file));
+    return _files.back().name;
+}
+
+std::string UsdzExportJob::CollectFiles() {
+    ArResolver &resolver = ArGetResolver();
+    AddFile(_rootLayerPath);
+    // The files are added while the layers are processed, breadth first
+    for (size_t i = 0; i < _files.size(); ++i) {
+        if (IsCancelled()) {
+            return "Cancelled";
+        }
+        if (!_files[i].isLayer) {
+            continue;
+        }
+        const std::string layerPath = _files[i].sourcePath;
+        SetStatus("Collecting the dependencies of " + TfGetBaseName(layerPath));
+        const auto dirtyLayer = _dirtyLayers.find(layerPath);
+        SdfLayerRefPtr layer = dirtyLayer != _dirtyLayers.end() ? dirtyLayer->second : SdfLayer::OpenAsAnonymous(layerPath);
+        if (!layer) {
+            return "Unable to open " + layerPath;
+        }
+        UsdUtilsModifyAssetPaths(layer, [&](const std::string &assetPath) {
+            if (assetPath.empty()) {
+                return assetPath;
+            }
+            const ArResolvedPath resolvedPath = resolver.Resolve(resolver.CreateIdentifier(assetPath, ArResolvedPath(layerPath)));
+            if (!resolvedPath) {
+                std::lock_guard<std::mutex> lock(_unresolvedMutex);
+                _unresolvedPaths.push_back(assetPath + " in " + TfGetBaseName(layerPath));
+                return assetPath;
+            }
+            return "./" + AddFile(resolvedPath.GetPathString());
+        });
+        _files[i].layer = layer;
+    }
+    return std::string();
+}
+
+std::string UsdzExportJob::WriteFile(const PackageFile &file, const std::string &directory) {
+    const std::string filePath = TfStringCatPaths(directory, file.name);
+    if (file.isLayer) {
+        return file.layer->Export(filePath) ? std::string() : "Unable to write " + file.name;
+    }
+    std::shared_ptr<ArAsset> asset = ArGetResolver().OpenAsset(ArResolvedPath(file.sourcePath));
+    std::shared_ptr<const char> buffer = asset ? asset->GetBuffer() : nullptr;
+    if (!buffer) {
+        return "Unable to read " + file.sourcePath;
+    }
+    std::ofstream output(filePath, std::ios::binary);
+    output.write(buffer.get(), static_cast<std::streamsize>(asset->GetSize()));
+    return output ? std::string() : "Unable to copy " + file.sourcePath;
+}
+
+std::string UsdzExportJob::Package(const std::string &directory) {
+    TfErrorMark errorMark;
+    const std::string error = CollectFiles();
+    if (!error.empty()) {
+        return error;
+    }
+    SetProgress(0.2f);
+
+    // The layers are written and the assets are copied by a few threads
+    SetStatus(TfStringPrintf("Writing %zu layers and %zu assets", _layerCount.load(), _assetCount.load()));
+    std::atomic<size_t> nextFile{0};
+    std::mutex writeErrorMutex;
+    std::string writeError;
+    const auto writeFiles = [&]() {
+        ArResolverContextBinder binder(_resolverContext);
+        for (size_t i = nextFile++; i < _files.size() && !IsCancelled(); i = nextFile++) {
+            const std::string fileError = WriteFile(_files[i], directory);
+            if (!fileError.empty()) {
+                std::lock_guard<std::mutex> lock(writeErrorMutex);
+                writeError = fileError;
+            }
+            SetProgress(0.2f + 0.6f * static_cast<float>(++_writtenFiles) / static_cast<float>(_files.size()));
+        }
+    };
+    const size_t threadCount = std::min<size_t>({MaxConcurrentPackageWrites, std::max(1u, std::thread::hardware_concurrency()), _files.size()});
+    std::vector<std::future<void>> writers;
+    for (size_t i = 0; i < threadCount; ++i) {
+        writers.push_back(std::async(std::launch::async, writeFiles));
+    }
+    for (auto &writer : writers) {
+        writer.wait();
+    }
+    if (IsCancelled()) {
+        return "Cancelled";
+    }
+    if (!writeError.empty()) {
+        return writeError;
+    }
+
+    // The root layer is the first file of the package
+    SetStatus("Writing " + _filePath);
+    SetProgress(0.8f);
+    if (_useArKit) {
+        // The ARKit packager flattens the layers when needed, it opens the copies written in the temporary directory
+        if (!UsdUtilsCreateNewARKitUsdzPackage(SdfAssetPath(TfStringCatPaths(directory, _files.front().name)), _filePath)) {
+            return "Unable to create the package " + _filePath;
+        }
+        return std::string();
+    }
+    SdfZipFileWriter zipFile = SdfZipFileWriter::CreateNew(_filePath);
+    if (!zipFile) {
+        return "Unable to create the package " + _filePath;
+    }
+    for (const auto &file : _files) {
+        if (zipFile.AddFile(TfStringCatPaths(directory, file.name), file.name).empty()) {
+            return "Unable to add " + file.name + " to the package";
+        }
+    }
+    return zipFile.Save() ? std::string() : "Unable to write the package " + _filePath;
+}
+
+bool UsdzExportJob::Step() {
+    if (_rootLayerPath.empty()) {
+        SetStatus("The stage must be saved before being packaged");
+        return false;
+    }
+    if (_task.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return true;
+    }
+    const std::string error = _task.get();
+    _dirtyLayers.clear();
+    if (error.empty()) {
+        SetProgress(1.f);
+        SetStatus(TfStringPrintf("Packaged %zu layers and %zu assets in %s", _layerCount.load(), _assetCount.load(),
+                                 _filePath.c_str()));
+    } else {
+        SetStatus(error);
+        TF_WARN("%s", error.c_str());
+    }
+    return false;
+}
+
+void UsdzExportJob::DrawDetails() {
+    ImGui::Text("%zu layers, %zu assets, %zu files written", _layerCount.load(), _assetCount.load(), _writtenFiles.load());
+    std::lock_guard<std::mutex> lock(_unresolvedMutex);
+    if (!_unresolvedPaths.empty() && ImGui::TreeNode("Unresolved", "%zu unresolved asset paths", _unresolvedPaths.size())) {
+        for (const auto &unresolvedPath : _unresolvedPaths) {
+            ImGui::Text("%s", unresolvedPath.c_str());
+        }
+        ImGui::TreePop();
+    }
+}
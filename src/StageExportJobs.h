@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <pxr/base/tf/hash.h>
+#include <pxr/base/tf/notice.h>
+#include <pxr/base/tf/weakBase.h>
+#include <pxr/usd/ar/resolverContext.h>
+#include <pxr/usd/sdf/layer.h>
+#include <pxr/usd/sdf/notice.h>
+#include <pxr/usd/sdf/primSpec.h>
+#include <pxr/usd/usd/notice.h>
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usd/stage.h>
+
+#include "BackgroundJobs.h"
+
+PXR_NAMESPACE_USING_DIRECTIVE
+
+/// Export of the flattened stage.
+/// The composed stage is walked subtree by subtree in time slices on the main thread, the resolved prims are copied in
+/// a single layer written on a worker thread at the end of the walk.
+/// When the export is split in chunks, the prims are written in usdc layers holding a bounded number of prims, each
+/// chunk is serialized on a worker thread while the next one is flattened, so the memory used doesn't grow with the
+/// size of the stage. The exported file is then a root layer with the stage metadata which has the chunks as
+/// sublayers, the chunks are written in the <name>_chunks directory next to it and must be moved with it. The prim
+/// order is authored so the children spread over multiple chunks keep their order.
+/// The instances are kept, their prototypes are written under /Flattened_Prototype_N as UsdStage::Flatten does.
+/// The export stops if a layer of the stage, other than the session layers, is edited during the walk, if a prim is
+/// resynced or if the loaded payloads change, as the prims already flattened would be inconsistent.
+class FlattenExportJob : public BackgroundJob, public TfWeakBase {
+  public:
+    FlattenExportJob(const UsdStageRefPtr &stage, const std::string &filePath, bool writeChunks);
+    ~FlattenExportJob() override;
+
+    bool Step() override;
+    void DrawDetails() override;
+
+  private:
+    void OnLayersChanged(const SdfNotice::LayersDidChange &notice);
+    void OnLayerMutingChanged(const UsdNotice::LayerMutingChanged &notice);
+    void OnObjectsChanged(const UsdNotice::ObjectsChanged &notice);
+    SdfLayerRefPtr CreateChunk() const;
+    bool IsChunkFull() const;
+    /// Write the current chunk on a worker thread and start a new one
+    void WriteChunk();
+    void FlattenStageMetadata();
+    void FlattenPrim(const UsdPrim &prim, const SdfPath &path);
+    void FlattenAttribute(const UsdAttribute &attribute, const SdfPrimSpecHandle &primSpec);
+    void FlattenRelationship(const UsdRelationship &relationship, const SdfPrimSpecHandle &primSpec);
+    /// Path in the flattened layer, the paths in the prototypes are moved to the flattened prototypes
+    SdfPath MapPath(const SdfPath &path) const;
+
+    UsdStageRefPtr _stage;
+    std::string _filePath;
+    SdfLayerRefPtr _flattened; // Root layer of the export, with the stage metadata and the chunks as sublayers
+
+    bool _writeChunks = false;
+    SdfLayerRefPtr _chunk; // Layer receiving the flattened prims, the root layer when the export is not split
+    size_t _chunkPrims = 0;
+    std::string _chunkDirectory;
+    std::string _chunkDirectoryName;
+    std::vector<std::string> _chunkPaths; // Sublayer paths of the chunks, relative to the root layer
+    std::future<std::string> _chunkTask;
+
+    // Subtrees to flatten, the root prims followed by the prototypes, with their path in the flattened layer
+    std::vector<std::pair<UsdPrim, SdfPath>> _subtrees;
+    std::unordered_map<SdfPath, SdfPath, SdfPath::Hash> _prototypes;
+    size_t _currentSubtree = 0;
+    UsdPrimRange _range;
+    UsdPrimRange::iterator _current;
+    bool _inSubtree = false;
+
+    size_t _flattenedPrims = 0;
+    size_t _peakMemoryAtStart = 0;
+    // Layers of the stage, without the session layers whose edits (like the draw modes of the viewport) don't change
+    // the export. The layer change notices can come from worker threads, the set is not modified after construction
+    std::set<SdfLayerHandle> _exportedLayers;
+    UsdStageLoadRules _loadRules;
+    std::atomic<bool> _stageEdited{false};
+    std::chrono::steady_clock::duration _flattenTime{0};
+    std::future<std::string> _task;
+    TfNotice::Key _layersChangedKey;
+    TfNotice::Key _layerMutingChangedKey;
+    TfNotice::Key _objectsChangedKey;
+};
+
+/// Export of the stage as a usdz package.
+/// The package is made from copies of the layers: the dirty layers are copied on the main thread, the others are
+/// opened again as anonymous layers by the worker, so the loaded layers are never edited or reloaded. The asset paths
+/// of the copies are remapped to the files of the package, then the layers are written and the assets copied
+/// concurrently in a temporary directory which is archived.
+/// The asset paths which can't be resolved, like the UDIM textures, are kept unchanged and listed in the details.
+class UsdzExportJob : public BackgroundJob {
+  public:
+    UsdzExportJob(const UsdStageRefPtr &stage, const std::string &filePath, bool useArKit);
+    ~UsdzExportJob() override;
+
+    bool Step() override;
+    void DrawDetails() override;
+
+  private:
+    struct PackageFile {
+        std::string name;       // Name in the package
+        std::string sourcePath; // Resolved path of the layer or asset
+        bool isLayer = false;
+        SdfLayerRefPtr layer;   // Copy of the layer with the remapped asset paths
+    };
+
+    // Executed on the worker thread
+    std::string Package(const std::string &directory);
+    std::string CollectFiles();
+    std::string WriteFile(const PackageFile &file, const std::string &directory);
+    /// Name in the package of the layer or asset, it is added to the package files if needed
+    const std::string &AddFile(const std::string &resolvedPath);
+
+    std::string _filePath;
+    bool _useArKit;
+    std::string _rootLayerPath;
+    ArResolverContext _resolverContext; // Bound by the worker threads, they resolve the asset paths as the stage does
+    std::map<std::string, SdfLayerRefPtr> _dirtyLayers; // Copies of the dirty layers by real path
+
+    // Only accessed by the worker until it has finished
+    std::vector<PackageFile> _files;
+    std::map<std::string, size_t> _fileIndices;
+    std::map<std::string, size_t> _nameCounts;
+
+    std::atomic<size_t> _layerCount{0};
+    std::atomic<size_t> _assetCount{0};
+    std::atomic<size_t> _writtenFiles{0};
+    std::mutex _unresolvedMutex;
+    std::vector<std::string> _unresolvedPaths;
+    std::future<std::string> _task;
+};
@@ -0,0 +1,714 @@
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include <pxr/base/tf/notice.h>
+#include <pxr/base/tf/weakBase.h>
+#include <pxr/base/work/loops.h>
+#include <pxr/base/work/threadLimits.h>
+#include <pxr/usd/sdf/changeList.h>
+#include <pxr/usd/sdf/notice.h>
+#include <pxr/usd/sdf/schema.h>
+#include <pxr/usd/usd/notice.h>
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usdGeom/mesh.h>
+#include <pxr/usd/usdGeom/pointBased.h>
+
+#include "Commands.h"
+#include "Gui.h"
+#include "ImGuiHelpers.h"
+#include "MemoryPanel.h"
+#include "StageStatistics.h"
+
+/// The prims at this depth and below are counted with their subtree in one block
+static constexpr size_t BlockDepth = 2;
+
+/// Time spent computing the statistics at each frame, at least one batch of blocks is computed
+static constexpr std::chrono::milliseconds UpdateTimeSlice(8);
+
+/// Estimated memory of a spec and a field, without their values
+static constexpr size_t SpecBytes = 64;
+static constexpr size_t FieldBytes = 32;
+
+struct PrimStatistics {
+    size_t prims = 0;
+    size_t inactivePrims = 0;
+    size_t overs = 0;
+    size_t instances = 0;
+    size_t points = 0;
+    size_t faces = 0;
+    size_t attributes = 0;
+    size_t timeSampledAttributes = 0;
+    size_t timeSamples = 0;
+    std::unordered_map<TfToken, size_t, TfToken::HashFunctor> primsByType;
+
+    void Add(const PrimStatistics &other) {
+        prims += other.prims;
+        inactivePrims += other.inactivePrims;
+        overs += other.overs;
+        instances += other.instances;
+        points += other.points;
+        faces += other.faces;
+        attributes += other.attributes;
+        timeSampledAttributes += other.timeSampledAttributes;
+        timeSamples += other.timeSamples;
+        for (const auto &type : other.primsByType) {
+            primsByType[type.first] += type.second;
+        }
+    }
+};
+
+struct SpecStatistics {
+    size_t specs = 0;
+    size_t fields = 0;
+    size_t timeSamples = 0;
+    size_t approximateBytes = 0;
+
+    void Add(const SpecStatistics &other) {
+        specs += other.specs;
+        fields += other.fields;
+        timeSamples += other.timeSamples;
+        approximateBytes += other.approximateBytes;
+    }
+    void Subtract(const SpecStatistics &other) {
+        specs -= other.specs;
+        fields -= other.fields;
+        timeSamples -= other.timeSamples;
+        approximateBytes -= other.approximateBytes;
+    }
+};
+
+/// The specs of a layer are counted per prim, with their properties, so the prims modified by an edit are counted
+/// again without traversing the layer
+struct LayerStatistics {
+    SdfLayerHandle layer;
+    SpecStatistics totals;
+    std::map<SdfPath, SpecStatistics> prims; // Sorted so the descendants of a prim follow it
+};
+
+/// Specs of a layer modified since its statistics were computed
+struct LayerChanges {
+    bool all = false;
+    std::set<SdfPath> subtrees; // The prims added, removed or renamed, with their descendants
+    std::set<SdfPath> prims;    // The prims whose fields or properties have changed
+};
+
+// Rows of the tables, rebuilt when the statistics change
+struct BlockRow {
+    SdfPath path;
+    const PrimStatistics *statistics;
+};
+
+struct TypeRow {
+    TfToken type;
+    size_t count;
+};
+
+/// Estimated memory of a field value, the arrays are counted with the size of their elements
+static size_t GetValueBytes(const VtValue &value) {
+    if (value.IsHolding<SdfTimeSampleMap>()) {
+        size_t bytes = 0;
+        for (const auto &sample : value.UncheckedGet<SdfTimeSampleMap>()) {
+            bytes += sizeof(double) + GetValueBytes(sample.second);
+        }
+        return bytes;
+    }
+    if (value.IsArrayValued()) {
+        const size_t elementSize = SdfSchema::GetInstance().FindType(value).GetScalarType().GetType().GetSizeof();
+        return sizeof(VtValue) + value.GetArraySize() * (elementSize ? elementSize : sizeof(void *));
+    }
+    return sizeof(VtValue);
+}
+
+static void AddSpecStatistics(const SdfLayerHandle &layer, const SdfPath &path, SpecStatistics &statistics) {
+    statistics.specs++;
+    statistics.approximateBytes += SpecBytes;
+    for (const auto &field : layer->ListFields(path)) {
+        statistics.fields++;
+        const VtValue value = layer->GetField(path, field);
+        statistics.approximateBytes += FieldBytes + GetValueBytes(value);
+        if (field == SdfFieldKeys->TimeSamples && value.IsHolding<SdfTimeSampleMap>()) {
+            statistics.timeSamples += value.UncheckedGet<SdfTimeSampleMap>().size();
+        }
+    }
+}
+
+/// Prim counting the spec: the properties, targets and connections are counted with their prim, the variants are
+/// counted as prims
+static SdfPath GetSpecPrimPath(const SdfPath &path) {
+    const SdfPath primPath = path.GetPrimOrPrimVariantSelectionPath();
+    return primPath.IsEmpty() ? SdfPath::AbsoluteRootPath() : primPath;
+}
+
+/// Count the spec of the prim and the specs of its properties, the child prims are not counted
+static SpecStatistics ComputePrimSpecStatistics(const SdfLayerHandle &layer, const SdfPath &primPath) {
+    SpecStatistics statistics;
+    AddSpecStatistics(layer, primPath, statistics);
+    for (const auto &property : layer->GetFieldAs<TfTokenVector>(primPath, SdfChildrenKeys->PropertyChildren)) {
+        const SdfPath propertyPath = primPath.AppendProperty(property);
+        AddSpecStatistics(layer, propertyPath, statistics);
+        for (const TfToken &childrenKey : {SdfChildrenKeys->RelationshipTargetChildren, SdfChildrenKeys->ConnectionChildren}) {
+            for (const auto &target : layer->GetFieldAs<SdfPathVector>(propertyPath, childrenKey)) {
+                AddSpecStatistics(layer, propertyPath.AppendTarget(target), statistics);
+            }
+        }
+    }
+    return statistics;
+}
+
+static void RemovePrimStatistics(LayerStatistics &statistics, std::map<SdfPath, SpecStatistics>::iterator prim) {
+    statistics.totals.Subtract(prim->second);
+    statistics.prims.erase(prim);
+}
+
+static void UpdatePrimStatistics(LayerStatistics &statistics, const SdfPath &primPath) {
+    const auto prim = statistics.prims.find(primPath);
+    if (prim != statistics.prims.end()) {
+        RemovePrimStatistics(statistics, prim);
+    }
+    if (statistics.layer->HasSpec(primPath)) {
+        const SpecStatistics primStatistics = ComputePrimSpecStatistics(statistics.layer, primPath);
+        statistics.totals.Add(primStatistics);
+        statistics.prims[primPath] = primStatistics;
+    }
+}
+
+static void UpdateSubtreeStatistics(LayerStatistics &statistics, const SdfPath &rootPath) {
+    for (auto prim = statistics.prims.lower_bound(rootPath); prim != statistics.prims.end() && prim->first.HasPrefix(rootPath);) {
+        RemovePrimStatistics(statistics, prim++);
+    }
+    if (!statistics.layer->HasSpec(rootPath)) {
+        return;
+    }
+    std::map<SdfPath, SpecStatistics> prims;
+    statistics.layer->Traverse(rootPath, [&](const SdfPath &path) {
+        AddSpecStatistics(statistics.layer, path, prims[GetSpecPrimPath(path)]);
+    });
+    for (const auto &prim : prims) {
+        statistics.totals.Add(prim.second);
+    }
+    statistics.prims.insert(prims.begin(), prims.end());
+}
+
+/// Count the specs modified in the layer again
+static void UpdateLayerStatistics(LayerStatistics &statistics, const LayerChanges &changes) {
+    if (!statistics.layer) {
+        statistics.totals = SpecStatistics();
+        statistics.prims.clear();
+        return;
+    }
+    if (changes.all) {
+        statistics.totals = SpecStatistics();
+        statistics.prims.clear();
+        UpdateSubtreeStatistics(statistics, SdfPath::AbsoluteRootPath());
+        return;
+    }
+    for (const auto &subtree : changes.subtrees) {
+        UpdateSubtreeStatistics(statistics, subtree);
+    }
+    for (const auto &prim : changes.prims) {
+        UpdatePrimStatistics(statistics, prim);
+    }
+}
+
+/// The prims added, removed or renamed are counted with their descendants, the other changes only modify the specs of
+/// their prim
+static bool IsSubtreeChange(const SdfChangeList::Entry &entry) {
+    return entry.flags.didRename || entry.flags.didAddInertPrim || entry.flags.didAddNonInertPrim ||
+           entry.flags.didRemoveInertPrim || entry.flags.didRemoveNonInertPrim || entry.flags.didChangePrimVariantSets;
+}
+
+static void AddLayerChanges(const SdfChangeList &changeList, LayerChanges &changes) {
+    for (const auto &pathEntry : changeList.GetEntryList()) {
+        const SdfPath &path = pathEntry.first;
+        const SdfChangeList::Entry &entry = pathEntry.second;
+        if (entry.flags.didReplaceContent || entry.flags.didReloadContent) {
+            changes.all = true;
+            return;
+        }
+        const SdfPath primPath = GetSpecPrimPath(path);
+        if (path == primPath && IsSubtreeChange(entry)) {
+            changes.subtrees.insert(path);
+            if (!entry.oldPath.IsEmpty()) {
+                changes.subtrees.insert(entry.oldPath);
+            }
+            // The children field of the parent is counted with the parent
+            changes.prims.insert(GetSpecPrimPath(path.GetParentPath()));
+        } else {
+            changes.prims.insert(primPath);
+        }
+    }
+}
+
+static void AddPrimStatistics(const UsdPrim &prim, PrimStatistics &statistics) {
+    statistics.prims++;
+    statistics.inactivePrims += !prim.IsActive();
+    statistics.overs += !prim.HasDefiningSpecifier();
+    statistics.instances += prim.IsInstance();
+    statistics.primsByType[prim.GetTypeName()]++;
+    // The geometry is counted at the first sample
+    if (prim.IsA<UsdGeomPointBased>()) {
+        VtVec3fArray points;
+        if (UsdGeomPointBased(prim).GetPointsAttr().Get(&points, UsdTimeCode::EarliestTime())) {
+            statistics.points += points.size();
+        }
+    }
+    if (prim.IsA<UsdGeomMesh>()) {
+        VtIntArray faceVertexCounts;
+        if (UsdGeomMesh(prim).GetFaceVertexCountsAttr().Get(&faceVertexCounts, UsdTimeCode::EarliestTime())) {
+            statistics.faces += faceVertexCounts.size();
+        }
+    }
+    for (const auto &attribute : prim.GetAuthoredAttributes()) {
+        statistics.attributes++;
+        if (const size_t timeSamples = attribute.GetNumTimeSamples()) {
+            statistics.timeSampledAttributes++;
+            statistics.timeSamples += timeSamples;
+        }
+    }
+}
+
+/// Returns false if the prim of the block doesn't exist anymore
+static bool ComputeBlockStatistics(const UsdStageRefPtr &stage, const SdfPath &path, PrimStatistics &statistics) {
+    const UsdPrim prim = stage->GetPrimAtPath(path);
+    if (!prim) {
+        return false;
+    }
+    // The prims above the block depth are counted alone, their children are other blocks
+    if (path.GetPathElementCount() < BlockDepth && !prim.IsPrototype()) {
+        AddPrimStatistics(prim, statistics);
+        return true;
+    }
+    for (const auto &descendant : UsdPrimRange(prim, UsdPrimAllPrimsPredicate)) {
+        AddPrimStatistics(descendant, statistics);
+    }
+    return true;
+}
+
+/// Block of a prim of the stage, the ancestor at the block depth or the prototype containing the prim
+static SdfPath GetBlockPath(const SdfPath &primPath) {
+    SdfPath path = primPath;
+    while (path.GetPathElementCount() > BlockDepth) {
+        path = path.GetParentPath();
+    }
+    if (path.GetPathElementCount() == BlockDepth && UsdPrim::IsPrototypePath(path.GetParentPath())) {
+        return path.GetParentPath();
+    }
+    return path;
+}
+
+class StageStatistics : public TfWeakBase {
+  public:
+    StageStatistics(const UsdStageRefPtr &stage) : _stage(stage) {
+        // All the blocks and layers are computed the first time
+        _resyncedRoots.insert(SdfPath::AbsoluteRootPath());
+        TfWeakPtr<StageStatistics> me(this);
+        _objectsChangedKey = TfNotice::Register(me, &StageStatistics::OnObjectsChanged, UsdStageWeakPtr(stage));
+        _layersChangedKey = TfNotice::Register(me, &StageStatistics::OnLayersChanged);
+    }
+
+    ~StageStatistics() {
+        TfNotice::Revoke(_objectsChangedKey);
+        TfNotice::Revoke(_layersChangedKey);
+    }
+
+    const UsdStageWeakPtr &GetStage() const { return _stage; }
+
+    void Update();
+    void Draw();
+
+  private:
+    void OnObjectsChanged(const UsdNotice::ObjectsChanged &notice);
+    // The layer notices can be sent from the worker threads editing other layers, the changes are stored with a lock
+    // and only for the layers used by the stage
+    void OnLayersChanged(const SdfNotice::LayersDidChange &notice);
+    size_t GetDirtyLayerCount();
+
+    /// Find the blocks under the resynced root prims, or all the blocks if the pseudo root was resynced
+    void UpdateResyncedRoots(const UsdStageRefPtr &stage);
+    /// Add and remove the layers when the stage uses other layers, only the added layers are counted
+    void UpdateUsedLayers(const UsdStageRefPtr &stage);
+    /// Add and remove the prototype blocks, the prototypes change when the instances are resynced
+    void UpdatePrototypes(const UsdStageRefPtr &stage);
+    void UpdateTotals();
+
+    void DrawTypesTable();
+    void DrawBlocksTable();
+    void DrawLayersTable();
+
+    UsdStageWeakPtr _stage;
+    std::map<SdfPath, PrimStatistics> _blocks;
+    std::set<SdfPath> _dirtyBlocks;
+    std::vector<LayerStatistics> _layers;
+    std::mutex _dirtyLayersMutex;
+    std::set<SdfLayerHandle> _usedLayers;
+    std::map<SdfLayerHandle, LayerChanges> _dirtyLayers;
+    std::set<SdfPath> _resyncedRoots; // Resynced prims above the block depth
+    bool _usedLayersChanged = true;
+    bool _prototypesChanged = true;
+
+    PrimStatistics _totals;
+    size_t _prototypes = 0;
+    size_t _layersBytes = 0;
+    std::vector<TypeRow> _typeRows;
+    std::vector<BlockRow> _blockRows;
+    bool _typesSorted = false;
+    bool _blocksSorted = false;
+    bool _layersSorted = false;
+
+    TfNotice::Key _objectsChangedKey;
+    TfNotice::Key _layersChangedKey;
+};
+
+void StageStatistics::OnObjectsChanged(const UsdNotice::ObjectsChanged &notice) {
+    // The resyncs can change the layers used by the stage, like the references added or the payloads loaded
+    for (const auto &path : notice.GetResyncedPaths()) {
+        if (path.GetPathElementCount() < BlockDepth) {
+            _resyncedRoots.insert(path);
+        } else {
+            _dirtyBlocks.insert(GetBlockPath(path.GetPrimPath()));
+        }
+        _prototypesChanged = true;
+        _usedLayersChanged = true;
+    }
+    // The values changes can modify the geometry and the time samples counts
+    for (const auto &path : notice.GetChangedInfoOnlyPaths()) {
+        if (path != SdfPath::AbsoluteRootPath()) {
+            _dirtyBlocks.insert(GetBlockPath(path.GetPrimPath()));
+        }
+    }
+}
+
+void StageStatistics::OnLayersChanged(const SdfNotice::LayersDidChange &notice) {
+    std::lock_guard<std::mutex> lock(_dirtyLayersMutex);
+    for (const auto &change : notice.GetChangeListVec()) {
+        if (_usedLayers.count(change.first)) {
+            AddLayerChanges(change.second, _dirtyLayers[change.first]);
+        }
+    }
+}
+
+size_t StageStatistics::GetDirtyLayerCount() {
+    std::lock_guard<std::mutex> lock(_dirtyLayersMutex);
+    return _dirtyLayers.size();
+}
+
+void StageStatistics::UpdateResyncedRoots(const UsdStageRefPtr &stage) {
+    for (const auto &rootPath : _resyncedRoots) {
+        // The blocks computed again are found from the stage, the blocks of the removed prims are dropped
+        for (auto block = _blocks.lower_bound(rootPath); block != _blocks.end() && block->first.HasPrefix(rootPath);) {
+            block = _blocks.erase(block);
+        }
+        std::vector<UsdPrim> rootPrims;
+        if (rootPath == SdfPath::AbsoluteRootPath()) {
+            for (const auto &prim : stage->GetPseudoRoot().GetAllChildren()) {
+                rootPrims.push_back(prim);
+            }
+        } else if (const UsdPrim prim = stage->GetPrimAtPath(rootPath)) {
+            rootPrims.push_back(prim);
+        }
+        for (const auto &prim : rootPrims) {
+            _dirtyBlocks.insert(prim.GetPath());
+            for (const auto &child : prim.GetAllChildren()) {
+                _dirtyBlocks.insert(child.GetPath());
+            }
+        }
+    }
+    _resyncedRoots.clear();
+}
+
+void StageStatistics::UpdateUsedLayers(const UsdStageRefPtr &stage) {
+    const SdfLayerHandleVector usedLayers = stage->GetUsedLayers();
+    const std::set<SdfLayerHandle> layers(usedLayers.begin(), usedLayers.end());
+    std::lock_guard<std::mutex> lock(_dirtyLayersMutex);
+    _layers.erase(std::remove_if(_layers.begin(), _layers.end(),
+                                 [&](const LayerStatistics &statistics) { return !layers.count(statistics.layer); }),
+                  _layers.end());
+    for (auto layer = _usedLayers.begin(); layer != _usedLayers.end();) {
+        if (!layers.count(*layer)) {
+            _dirtyLayers.erase(*layer);
+            layer = _usedLayers.erase(layer);
+        } else {
+            ++layer;
+        }
+    }
+    for (const auto &layer : layers) {
+        if (_usedLayers.insert(layer).second) {
+            _layers.push_back(LayerStatistics{layer});
+            _dirtyLayers[layer].all = true;
+        }
+    }
+    _usedLayersChanged = false;
+}
+
+void StageStatistics::UpdatePrototypes(const UsdStageRefPtr &stage) {
+    std::set<SdfPath> prototypes;
+    for (const auto &prototype : stage->GetPrototypes()) {
+        prototypes.insert(prototype.GetPath());
+    }
+    for (auto block = _blocks.begin(); block != _blocks.end();) {
+        block = UsdPrim::IsPrototypePath(block->first) && !prototypes.count(block->first) ? _blocks.erase(block) : std::next(block);
+    }
+    // The prototype paths are not stable, their content is computed again
+    _dirtyBlocks.insert(prototypes.begin(), prototypes.end());
+    _prototypes = prototypes.size();
+    _prototypesChanged = false;
+}
+
+void StageStatistics::Update() {
+    UsdStageRefPtr stage = _stage;
+    if (!stage) {
+        return;
+    }
+    // The rows point to the blocks and layers, they are rebuilt when any of them is removed
+    const bool removesRows = !_resyncedRoots.empty() || _usedLayersChanged || _prototypesChanged;
+    if (!_resyncedRoots.empty()) {
+        UpdateResyncedRoots(stage);
+    }
+    if (_usedLayersChanged) {
+        UpdateUsedLayers(stage);
+    }
+    if (_prototypesChanged) {
+        UpdatePrototypes(stage);
+    }
+    if (_dirtyBlocks.empty() && GetDirtyLayerCount() == 0) {
+        if (removesRows) {
+            UpdateTotals();
+        }
+        return;
+    }
+    // Batches of blocks and layers are computed in parallel until the time slice is spent.
+    // The stage is only read by the workers, it is not modified while the main thread waits for them
+    const size_t batchSize = std::max<unsigned>(1, WorkGetConcurrencyLimit()) * 4;
+    const auto deadline = std::chrono::steady_clock::now() + UpdateTimeSlice;
+    do {
+        std::vector<std::pair<SdfPath, PrimStatistics>> blocks;
+        std::vector<char> blockExists;
+        while (!_dirtyBlocks.empty() && blocks.size() < batchSize) {
+            blocks.emplace_back(*_dirtyBlocks.begin(), PrimStatistics());
+            _dirtyBlocks.erase(_dirtyBlocks.begin());
+        }
+        blockExists.resize(blocks.size());
+        WorkParallelForN(blocks.size(), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                blockExists[i] = ComputeBlockStatistics(stage, blocks[i].first, blocks[i].second);
+            }
+        });
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            if (blockExists[i]) {
+                _blocks[blocks[i].first] = std::move(blocks[i].second);
+            } else {
+                _blocks.erase(blocks[i].first);
+            }
+        }
+
+        std::vector<std::pair<LayerStatistics *, LayerChanges>> layers;
+        {
+            std::lock_guard<std::mutex> lock(_dirtyLayersMutex);
+            for (auto &layer : _layers) {
+                const auto dirtyLayer = _dirtyLayers.find(layer.layer);
+                if (dirtyLayer != _dirtyLayers.end() && layers.size() < batchSize) {
+                    layers.emplace_back(&layer, std::move(dirtyLayer->second));
+                    _dirtyLayers.erase(dirtyLayer);
+                }
+            }
+        }
+        WorkParallelForN(layers.size(), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                UpdateLayerStatistics(*layers[i].first, layers[i].second);
+            }
+        });
+    } while ((!_dirtyBlocks.empty() || GetDirtyLayerCount() != 0) && std::chrono::steady_clock::now() < deadline);
+    UpdateTotals();
+}
+
+void StageStatistics::UpdateTotals() {
+    _totals = PrimStatistics();
+    _blockRows.clear();
+    for (const auto &block : _blocks) {
+        _totals.Add(block.second);
+        _blockRows.push_back({block.first, &block.second});
+    }
+    _typeRows.clear();
+    for (const auto &type : _totals.primsByType) {
+        _typeRows.push_back({type.first, type.second});
+    }
+    _layersBytes = 0;
+    for (const auto &layer : _layers) {
+        _layersBytes += layer.totals.approximateBytes;
+    }
+    _typesSorted = _blocksSorted = _layersSorted = false;
+}
+
+void StageStatistics::DrawTypesTable() {
+    constexpr ImGuiTableFlags tableFlags = ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY |
+                                           ImGuiTableFlags_Sortable | ImGuiTableFlags_Resizable;
+    if (ImGui::BeginTable("##StageStatisticsTypes", 2, tableFlags)) {
+        ImGui::TableSetupScrollFreeze(1, 1);
+        ImGui::TableSetupColumn("Type", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Prims", ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableHeadersRow();
+        InvalidateTableSorting(_typesSorted);
+        SortTableRows(
+            _typeRows, [](const TypeRow &row) { return row.type.GetString(); }, [](const TypeRow &row, int) { return row.count; });
+        for (const auto &row : _typeRows) {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::Text("%s", row.type.IsEmpty() ? "(untyped)" : row.type.GetText());
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%zu", row.count);
+        }
+        ImGui::EndTable();
+    }
+}
+
+static size_t GetBlockColumnValue(const BlockRow &row, int column) {
+    switch (column) {
+    case 1:
+        return row.statistics->prims;
+    case 2:
+        return row.statistics->instances;
+    case 3:
+        return row.statistics->points;
+    case 4:
+        return row.statistics->faces;
+    case 5:
+        return row.statistics->timeSampledAttributes;
+    default:
+        return row.statistics->timeSamples;
+    }
+}
+
+void StageStatistics::DrawBlocksTable() {
+    constexpr ImGuiTableFlags tableFlags = ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY |
+                                           ImGuiTableFlags_Sortable | ImGuiTableFlags_Resizable;
+    if (ImGui::BeginTable("##StageStatisticsBlocks", 7, tableFlags)) {
+        ImGui::TableSetupScrollFreeze(1, 1);
+        ImGui::TableSetupColumn("Subtree", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Prims", ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableSetupColumn("Instances", ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableSetupColumn("Points", ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableSetupColumn("Faces", ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableSetupColumn("Animated attributes", ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableSetupColumn("Time samples", ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableHeadersRow();
+        InvalidateTableSorting(_blocksSorted);
+        SortTableRows(
+            _blockRows, [](const BlockRow &row) { return row.path; }, GetBlockColumnValue);
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(_blockRows.size()));
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                const BlockRow &blockRow = _blockRows[row];
+                ImGui::PushID(row);
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                // The prototypes can't be selected
+                if (ImGui::Selectable(blockRow.path.GetText(), false, ImGuiSelectableFlags_SpanAllColumns) &&
+                    !UsdPrim::IsPrototypePath(blockRow.path)) {
+                    ExecuteAfterDraw<EditorSetSelection>(UsdStageRefPtr(_stage), blockRow.path);
+                }
+                for (int column = 1; column < 7; ++column) {
+                    ImGui::TableSetColumnIndex(column);
+                    ImGui::Text("%zu", GetBlockColumnValue(blockRow, column));
+                }
+                ImGui::PopID();
+            }
+        }
+        ImGui::EndTable();
+    }
+}
+
+void StageStatistics::DrawLayersTable() {
+    constexpr ImGuiTableFlags tableFlags = ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY |
+                                           ImGuiTableFlags_Sortable | ImGuiTableFlags_Resizable;
+    if (ImGui::BeginTable("##StageStatisticsLayers", 5, tableFlags)) {
+        ImGui::TableSetupScrollFreeze(1, 1);
+        ImGui::TableSetupColumn("Layer", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Approximate size", ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableSetupColumn("Specs", ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableSetupColumn("Fields", ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableSetupColumn("Time samples", ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableHeadersRow();
+        InvalidateTableSorting(_layersSorted);
+        SortTableRows(
+            _layers, [](const LayerStatistics &row) { return row.layer ? row.layer->GetIdentifier() : std::string(); },
+            [](const LayerStatistics &row, int column) {
+                const SpecStatistics &totals = row.totals;
+                return column == 1 ? totals.approximateBytes
+                                   : (column == 2 ? totals.specs : (column == 3 ? totals.fields : totals.timeSamples));
+            });
+        for (size_t row = 0; row < _layers.size(); ++row) {
+            const LayerStatistics &statistics = _layers[row];
+            if (!statistics.layer) {
+                continue;
+            }
+            ImGui::PushID(static_cast<int>(row));
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            if (ImGui::Selectable(statistics.layer->GetDisplayName().c_str(), false, ImGuiSelectableFlags_SpanAllColumns)) {
+                ExecuteAfterDraw<EditorSetSelection>(statistics.layer, SdfPath::AbsoluteRootPath());
+            }
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("%s", statistics.layer->GetIdentifier().c_str());
+            }
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%s", FormatBytes(static_cast<double>(statistics.totals.approximateBytes)).c_str());
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%zu", statistics.totals.specs);
+            ImGui::TableSetColumnIndex(3);
+            ImGui::Text("%zu", statistics.totals.fields);
+            ImGui::TableSetColumnIndex(4);
+            ImGui::Text("%zu", statistics.totals.timeSamples);
+            ImGui::PopID();
+        }
+        ImGui::EndTable();
+    }
+}
+
+void StageStatistics::Draw() {
+    ImGui::Text("%zu prims, %zu inactive, %zu overs, %zu instances, %zu prototypes", _totals.prims, _totals.inactivePrims,
+                _totals.overs, _totals.instances, _prototypes);
+    ImGui::Text("%zu points, %zu faces, %zu attributes, %zu animated with %zu time samples", _totals.points, _totals.faces,
+                _totals.attributes, _totals.timeSampledAttributes, _totals.timeSamples);
+    ImGui::Text("%zu layers, approximately %s", _layers.size(), FormatBytes(static_cast<double>(_layersBytes)).c_str());
+    const size_t dirtyLayers = GetDirtyLayerCount();
+    if (!_dirtyBlocks.empty() || dirtyLayers) {
+        ImGui::SameLine();
+        ImGui::Text("- updating %zu subtrees and %zu layers", _dirtyBlocks.size(), dirtyLayers);
+    }
+    if (ImGui::BeginTabBar("##StageStatisticsTabs")) {
+        if (ImGui::BeginTabItem("Types")) {
+            DrawTypesTable();
+            ImGui::EndTabItem();
+        }
+        if (ImGui::BeginTabItem("Subtrees")) {
+            DrawBlocksTable();
+            ImGui::EndTabItem();
+        }
+        if (ImGui::BeginTabItem("Layers")) {
+            DrawLayersTable();
+            ImGui::EndTabItem();
+        }
+        ImGui::EndTabBar();
+    }
+}
+
+// Dropped when another stage is displayed. Only accessed from the main thread
+static std::unique_ptr<StageStatistics> statistics;
+
+void DrawStageStatistics(const UsdStageRefPtr &stage) {
+    if (!stage) {
+        return;
+    }
+    if (!statistics || statistics->GetStage() != stage) {
+        statistics = std::make_unique<StageStatistics>(stage);
+    }
+    statistics->Update();
+    statistics->Draw();
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <pxr/usd/usd/stage.h>
+
+PXR_NAMESPACE_USING_DIRECTIVE
+
+///
+/// Stage statistics.
+/// The stage is divided in blocks: the prims under the root prims are counted per subtree, and each prototype is a
+/// block. The specs of the used layers are counted per prim. The blocks and the layers are computed in parallel and
+/// cached, the notices of the stage and the layers only mark the blocks and the prim specs they modify to be computed
+/// again. A resynced root prim only finds its blocks again, and only the layers added to the stage are traversed.
+/// The computation is spread over the frames while the statistics window is opened.
+/// The prim counts are the same as the ones of UsdUtilsComputeUsdStageStats, which can't be updated incrementally.
+///
+
+/// Draw the statistics window of the stage: the totals, the prims by type, the heaviest subtrees and the layers
+void DrawStageStatistics(const UsdStageRefPtr &stage);
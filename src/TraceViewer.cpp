@@ -0,0 +1,459 @@
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include <pxr/base/arch/timing.h>
+#include <pxr/base/tf/notice.h>
+#include <pxr/base/tf/weakBase.h>
+#include <pxr/base/trace/collection.h>
+#include <pxr/base/trace/collectionNotice.h>
+#include <pxr/base/trace/collector.h>
+#include <pxr/base/trace/event.h>
+
+#include "FileBrowser.h"
+#include "Gui.h"
+#include "ImGuiHelpers.h"
+#include "ModalDialogs.h"
+#include "TraceViewer.h"
+
+PXR_NAMESPACE_USING_DIRECTIVE
+
+using TimeStamp = TraceEvent::TimeStamp;
+
+/// Number of frames kept for the timeline, the flame view and the export
+static constexpr size_t MaxRetainedFrames = 300;
+
+struct TraceRegion {
+    TfToken key;
+    TimeStamp start = 0;
+    TimeStamp end = 0;
+    int thread = 0;
+    int depth = 0;
+};
+
+struct TraceFrame {
+    size_t id = 0;
+    TimeStamp start = 0;
+    TimeStamp end = 0;
+    /// Sorted by thread then by start time, the parents are before their children
+    std::vector<TraceRegion> regions;
+    int maxDepth = 0;
+};
+
+struct TraceScopeTotals {
+    TfToken key;
+    size_t count = 0;
+    TimeStamp total = 0;
+    TimeStamp max = 0;
+};
+
+static double TicksToMilliseconds(TimeStamp ticks) { return ArchTicksToSeconds(ticks) * 1000.0; }
+
+///
+/// Receives the collections of the TraceCollector and turns the events into regions. The begin and end events can
+/// be split across collections, so the scopes still open are kept per thread.
+///
+class TraceViewer : public TfWeakBase, private TraceCollection::Visitor {
+  public:
+    TraceViewer() {
+        TfWeakPtr<TraceViewer> me(this);
+        _collectionKey = TfNotice::Register(me, &TraceViewer::OnCollectionAvailable);
+    }
+    ~TraceViewer() { TfNotice::Revoke(_collectionKey); }
+
+    void EndFrame() {
+        if (!TraceCollector::IsEnabled()) {
+            _frameStart = 0;
+            return;
+        }
+        // The collection is sent synchronously to OnCollectionAvailable
+        TraceCollector::GetInstance().CreateCollection();
+        const TimeStamp now = ArchGetTickTime();
+        TraceFrame frame;
+        frame.id = _nextFrameId++;
+        frame.start = _frameStart ? _frameStart : now;
+        frame.end = now;
+        frame.regions = std::move(_pendingRegions);
+        _pendingRegions.clear();
+        _frameStart = now;
+        for (const auto &region : frame.regions) {
+            frame.start = std::min(frame.start, region.start);
+        }
+        ComputeDepths(frame);
+        AccumulateTotals(frame);
+        if (!_paused) {
+            _frames.emplace_back(std::move(frame));
+            if (_frames.size() > MaxRetainedFrames) {
+                _frames.pop_front();
+            }
+        }
+    }
+
+    void Clear() {
+        _frames.clear();
+        _scopes.clear();
+        _scopeIndices.clear();
+        _selectedFrameId = 0;
+    }
+
+    void Draw();
+
+    bool ExportChromeTrace(const std::string &filePath) const;
+
+  private:
+    void OnCollectionAvailable(const TraceCollectionAvailable &notice) {
+        if (notice.GetCollection()) {
+            notice.GetCollection()->Iterate(*this);
+        }
+    }
+
+    // TraceCollection::Visitor
+    bool AcceptsCategory(TraceCategoryId) override { return true; }
+    void OnBeginCollection() override {}
+    void OnEndCollection() override {}
+    void OnBeginThread(const TraceThreadId &) override {}
+    void OnEndThread(const TraceThreadId &) override {}
+    void OnEvent(const TraceThreadId &threadId, const TfToken &key, const TraceEvent &event) override {
+        const int thread = GetThreadLane(threadId.ToString());
+        switch (event.GetType()) {
+        case TraceEvent::EventType::Begin:
+            _openScopes[thread].emplace_back(key, event.GetTimeStamp());
+            break;
+        case TraceEvent::EventType::End: {
+            auto &openScopes = _openScopes[thread];
+            // Close the innermost scope with the same key, the unmatched end events are ignored
+            for (auto it = openScopes.rbegin(); it != openScopes.rend(); ++it) {
+                if (it->first == key) {
+                    _pendingRegions.push_back({key, it->second, event.GetTimeStamp(), thread, 0});
+                    openScopes.erase(std::next(it).base());
+                    break;
+                }
+            }
+            break;
+        }
+        case TraceEvent::EventType::Timespan:
+            _pendingRegions.push_back({key, event.GetStartTimeStamp(), event.GetEndTimeStamp(), thread, 0});
+            break;
+        default:
+            break;
+        }
+    }
+
+    int GetThreadLane(const std::string &threadName) {
+        const auto lane = _threadLanes.find(threadName);
+        if (lane != _threadLanes.end()) {
+            return lane->second;
+        }
+        _threadNames.push_back(threadName);
+        return _threadLanes[threadName] = static_cast<int>(_threadNames.size() - 1);
+    }
+
+    static void ComputeDepths(TraceFrame &frame) {
+        std::sort(frame.regions.begin(), frame.regions.end(), [](const TraceRegion &a, const TraceRegion &b) {
+            if (a.thread != b.thread) {
+                return a.thread < b.thread;
+            }
+            return a.start != b.start ? a.start < b.start : a.end > b.end;
+        });
+        std::vector<TimeStamp> parentEnds;
+        int thread = -1;
+        for (auto &region : frame.regions) {
+            if (region.thread != thread) {
+                parentEnds.clear();
+                thread = region.thread;
+            }
+            while (!parentEnds.empty() && parentEnds.back() <= region.start) {
+                parentEnds.pop_back();
+            }
+            region.depth = static_cast<int>(parentEnds.size());
+            frame.maxDepth = std::max(frame.maxDepth, region.depth);
+            parentEnds.push_back(region.end);
+        }
+    }
+
+    void AccumulateTotals(const TraceFrame &frame) {
+        for (const auto &region : frame.regions) {
+            auto index = _scopeIndices.find(region.key);
+            if (index == _scopeIndices.end()) {
+                index = _scopeIndices.emplace(region.key, _scopes.size()).first;
+                _scopes.push_back({region.key});
+            }
+            TraceScopeTotals &totals = _scopes[index->second];
+            const TimeStamp duration = region.end - region.start;
+            totals.count++;
+            totals.total += duration;
+            totals.max = std::max(totals.max, duration);
+        }
+        if (!frame.regions.empty()) {
+            _scopesSorted = false;
+        }
+    }
+
+    void DrawTimeline();
+    void DrawFlameView(const TraceFrame &frame);
+    void DrawScopesTable();
+
+    TfNotice::Key _collectionKey;
+    std::vector<TraceRegion> _pendingRegions;
+    std::map<int, std::vector<std::pair<TfToken, TimeStamp>>> _openScopes;
+    std::map<std::string, int> _threadLanes;
+    std::vector<std::string> _threadNames;
+
+    TimeStamp _frameStart = 0;
+    size_t _nextFrameId = 1;
+    std::deque<TraceFrame> _frames;
+
+    std::vector<TraceScopeTotals> _scopes;
+    std::unordered_map<TfToken, size_t, TfToken::HashFunctor> _scopeIndices;
+    bool _scopesSorted = false;
+
+    bool _paused = false;
+    size_t _selectedFrameId = 0;
+    float _zoom = 1.f;
+};
+
+static TraceViewer &GetTraceViewer() {
+    static TraceViewer traceViewer;
+    return traceViewer;
+}
+
+void TraceViewer::DrawTimeline() {
+    constexpr float timelineHeight = 60.f;
+    const float barWidth = std::max(2.f, ImGui::GetContentRegionAvail().x / static_cast<float>(MaxRetainedFrames));
+    TimeStamp longestFrame = 1;
+    for (const auto &frame : _frames) {
+        longestFrame = std::max(longestFrame, frame.end - frame.start);
+    }
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImGui::InvisibleButton("##TraceTimeline", ImVec2(barWidth * MaxRetainedFrames, timelineHeight));
+    const bool clicked = ImGui::IsItemClicked();
+    ImDrawList *drawList = ImGui::GetWindowDrawList();
+    for (size_t i = 0; i < _frames.size(); ++i) {
+        const TraceFrame &frame = _frames[i];
+        const float height = timelineHeight * static_cast<float>(frame.end - frame.start) / static_cast<float>(longestFrame);
+        const ImVec2 barMin(origin.x + barWidth * i, origin.y + timelineHeight - height);
+        const ImVec2 barMax(barMin.x + barWidth - 1.f, origin.y + timelineHeight);
+        const bool isSelected = frame.id == _selectedFrameId;
+        drawList->AddRectFilled(barMin, barMax, isSelected ? IM_COL32(230, 160, 60, 255) : IM_COL32(100, 150, 200, 255));
+        if (ImGui::IsMouseHoveringRect(ImVec2(barMin.x, origin.y), barMax)) {
+            ImGui::SetTooltip("Frame %zu: %.3f ms", frame.id, TicksToMilliseconds(frame.end - frame.start));
+            if (clicked) {
+                _selectedFrameId = frame.id;
+            }
+        }
+    }
+}
+
+void TraceViewer::DrawFlameView(const TraceFrame &frame) {
+    const float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+    ImGui::SetNextItemWidth(150);
+    ImGui::SliderFloat("Zoom", &_zoom, 1.f, 100.f, "%.1f", ImGuiSliderFlags_Logarithmic);
+    ImGui::SameLine();
+    ImGui::Text("Frame %zu: %.3f ms, %zu scopes", frame.id, TicksToMilliseconds(frame.end - frame.start), frame.regions.size());
+
+    if (!ImGui::BeginChild("##FlameView", ImVec2(0, ImGui::GetContentRegionAvail().y * 0.5f), true,
+                           ImGuiWindowFlags_HorizontalScrollbar)) {
+        ImGui::EndChild();
+        return;
+    }
+    const float width = ImGui::GetContentRegionAvail().x * _zoom;
+    const double frameTicks = static_cast<double>(std::max<TimeStamp>(1, frame.end - frame.start));
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImDrawList *drawList = ImGui::GetWindowDrawList();
+    const ImVec2 clipMin = drawList->GetClipRectMin();
+    const ImVec2 clipMax = drawList->GetClipRectMax();
+
+    // One lane per thread, the lanes are as tall as the deepest scope of the thread
+    std::map<int, int> laneDepths;
+    for (const auto &region : frame.regions) {
+        laneDepths[region.thread] = std::max(laneDepths[region.thread], region.depth + 1);
+    }
+    std::map<int, float> laneOffsets;
+    float laneOffset = 0.f;
+    for (const auto &lane : laneDepths) {
+        laneOffsets[lane.first] = laneOffset;
+        drawList->AddText(ImVec2(clipMin.x, origin.y + laneOffset), IM_COL32(200, 200, 200, 255),
+                          _threadNames[lane.first].c_str());
+        laneOffset += rowHeight * (lane.second + 1);
+    }
+
+    for (const auto &region : frame.regions) {
+        const double start = static_cast<double>(std::max(region.start, frame.start) - frame.start);
+        const double end = static_cast<double>(std::min(region.end, frame.end) - frame.start);
+        const ImVec2 regionMin(origin.x + static_cast<float>(start / frameTicks) * width,
+                               origin.y + laneOffsets[region.thread] + rowHeight * (region.depth + 1));
+        const ImVec2 regionMax(std::max(regionMin.x + 1.f, origin.x + static_cast<float>(end / frameTicks) * width),
+                               regionMin.y + rowHeight - 1.f);
+        // Skip the regions outside of the visible part of the view
+        if (regionMax.x < clipMin.x || regionMin.x > clipMax.x || regionMax.y < clipMin.y || regionMin.y > clipMax.y) {
+            continue;
+        }
+        const float hue = static_cast<float>(ImHashStr(region.key.GetText()) % 360) / 360.f;
+        ImVec4 color(0.f, 0.f, 0.f, 1.f);
+        ImGui::ColorConvertHSVtoRGB(hue, 0.5f, 0.7f, color.x, color.y, color.z);
+        drawList->AddRectFilled(regionMin, regionMax, ImGui::ColorConvertFloat4ToU32(color));
+        const ImVec4 textClip(std::max(regionMin.x, clipMin.x), regionMin.y, std::min(regionMax.x, clipMax.x), regionMax.y);
+        drawList->AddText(nullptr, 0.f, ImVec2(textClip.x + 2.f, regionMin.y), IM_COL32(255, 255, 255, 255),
+                          region.key.GetText(), nullptr, 0.f, &textClip);
+        if (ImGui::IsMouseHoveringRect(regionMin, regionMax)) {
+            ImGui::SetTooltip("%s\n%.3f ms", region.key.GetText(), TicksToMilliseconds(region.end - region.start));
+        }
+    }
+    ImGui::Dummy(ImVec2(width, laneOffset));
+    ImGui::EndChild();
+}
+
+static double GetScopeColumnValue(const TraceScopeTotals &scope, int column) {
+    switch (column) {
+    case 1:
+        return static_cast<double>(scope.count);
+    case 2:
+        return TicksToMilliseconds(scope.total);
+    case 3:
+        return scope.count ? TicksToMilliseconds(scope.total) / scope.count : 0.0;
+    default:
+        return TicksToMilliseconds(scope.max);
+    }
+}
+
+void TraceViewer::DrawScopesTable() {
+    constexpr ImGuiTableFlags tableFlags = ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY |
+                                           ImGuiTableFlags_Sortable | ImGuiTableFlags_Resizable;
+    if (ImGui::BeginTable("##TraceScopes", 5, tableFlags, ImVec2(-FLT_MIN, -10))) {
+        ImGui::TableSetupScrollFreeze(1, 1);
+        ImGui::TableSetupColumn("Scope", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Count", ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableSetupColumn("Total ms", ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableSetupColumn("Mean ms", ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableSetupColumn("Max ms", ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableHeadersRow();
+        InvalidateTableSorting(_scopesSorted);
+        if (SortTableRows(
+                _scopes, [](const TraceScopeTotals &scope) { return scope.key.GetString(); }, GetScopeColumnValue)) {
+            for (size_t i = 0; i < _scopes.size(); ++i) {
+                _scopeIndices[_scopes[i].key] = i;
+            }
+        }
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(_scopes.size()));
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                const TraceScopeTotals &scope = _scopes[row];
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::Text("%s", scope.key.GetText());
+                for (int column = 1; column < 5; ++column) {
+                    ImGui::TableSetColumnIndex(column);
+                    ImGui::Text(column == 1 ? "%.0f" : "%.3f", GetScopeColumnValue(scope, column));
+                }
+            }
+        }
+        ImGui::EndTable();
+    }
+}
+
+struct ExportChromeTraceDialog : public ModalDialog {
+    ExportChromeTraceDialog() {}
+    ~ExportChromeTraceDialog() override {}
+    void Draw() override {
+        DrawFileBrowser();
+        EnsureFileBrowserDefaultExtension("json");
+        if (FilePathExists()) {
+            ImGui::TextColored(ImVec4(1.0f, 0.1f, 0.1f, 1.0f), "Overwrite: ");
+        } else {
+            ImGui::Text("Export to: ");
+        }
+        auto filePath = GetFileBrowserFilePath();
+        ImGui::Text("%s", filePath.c_str());
+        DrawOkCancelModal([&]() {
+            if (!filePath.empty()) {
+                ExportChromeTrace(filePath);
+            }
+        });
+    }
+    const char *DialogId() const override { return "Export chrome trace"; }
+};
+
+void TraceViewer::Draw() {
+    const bool isEnabled = TraceCollector::IsEnabled();
+    if (ImGui::Button(isEnabled ? "Stop tracing" : "Start tracing")) {
+        TraceCollector::GetInstance().SetEnabled(!isEnabled);
+    }
+    ImGui::SameLine();
+    ImGui::Checkbox("Pause", &_paused);
+    ImGui::SameLine();
+    if (ImGui::Button("Clear")) {
+        Clear();
+    }
+    ImGui::SameLine();
+    ImGui::BeginDisabled(_frames.empty());
+    if (ImGui::Button("Export chrome trace")) {
+        DrawModalDialog<ExportChromeTraceDialog>();
+    }
+    ImGui::EndDisabled();
+
+    DrawTimeline();
+    // Show the last frame until a frame is selected
+    const TraceFrame *selectedFrame = _frames.empty() ? nullptr : &_frames.back();
+    for (const auto &frame : _frames) {
+        if (frame.id == _selectedFrameId) {
+            selectedFrame = &frame;
+        }
+    }
+    if (selectedFrame) {
+        DrawFlameView(*selectedFrame);
+    }
+    DrawScopesTable();
+}
+
+static std::string EscapeJson(const char *text) {
+    std::string escaped;
+    for (const char *c = text; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            escaped += '\\';
+            escaped += *c;
+        } else if (static_cast<unsigned char>(*c) < 0x20) {
+            escaped += ' ';
+        } else {
+            escaped += *c;
+        }
+    }
+    return escaped;
+}
+
+bool TraceViewer::ExportChromeTrace(const std::string &filePath) const {
+    std::ofstream json(filePath);
+    if (!json) {
+        TF_WARN("unable to write %s", filePath.c_str());
+        return false;
+    }
+    // The timestamps are in microseconds relative to the first retained frame
+    const TimeStamp origin = _frames.empty() ? 0 : _frames.front().start;
+    const auto toMicroseconds = [](TimeStamp ticks) { return static_cast<double>(ArchTicksToNanoseconds(ticks)) / 1000.0; };
+    json << "{\"traceEvents\":[\n";
+    bool first = true;
+    for (size_t thread = 0; thread < _threadNames.size(); ++thread) {
+        json << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread
+             << ",\"args\":{\"name\":\"" << EscapeJson(_threadNames[thread].c_str()) << "\"}}";
+        first = false;
+    }
+    for (const auto &frame : _frames) {
+        for (const auto &region : frame.regions) {
+            json << (first ? "" : ",\n") << "{\"name\":\"" << EscapeJson(region.key.GetText()) << "\",\"ph\":\"X\",\"ts\":"
+                 << toMicroseconds(region.start - std::min(origin, region.start))
+                 << ",\"dur\":" << toMicroseconds(region.end - region.start) << ",\"pid\":1,\"tid\":" << region.thread << "}";
+            first = false;
+        }
+    }
+    json << "\n]}\n";
+    return true;
+}
+
+void EndTraceViewerFrame() { GetTraceViewer().EndFrame(); }
+
+void DrawTraceViewer() { GetTraceViewer().Draw(); }
+
+bool ExportChromeTrace(const std::string &filePath) { return GetTraceViewer().ExportChromeTrace(filePath); }
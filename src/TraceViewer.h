@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+
+///
+/// Structured viewer of the TraceCollector events.
+/// The events are collected once per frame and aggregated incrementally: the scopes of the last frames are kept
+/// for the timeline and the flame view, and the totals per scope are updated with the new events only.
+///
+
+/// Collect the events recorded since the last call and close the current frame. Called once per frame in the main
+/// loop, it does nothing when the TraceCollector is disabled
+void EndTraceViewerFrame();
+
+/// Draw the trace panel of the debug window: the tracing buttons, the frame timeline, the flame view of the selected
+/// frame and the table of the scopes
+void DrawTraceViewer();
+
+/// Write the retained frames in the chrome trace event format, readable by chrome://tracing or perfetto
+bool ExportChromeTrace(const std::string &filePath);
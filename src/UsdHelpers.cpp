@@ -3,6 +3,7 @@
 #include <iomanip>
 
 #include <pxr/usd/sdf/fileFormat.h>
+#include <pxr/usd/usd/primRange.h>
 
 std::string FindNextAvailableTokenString(std::string prefix) {
     // Find number in the prefix
@@ -32,3 +33,29 @@ const std::vector<std::string> GetUsdValidExtensions() {
     std::transform(usdExtensions.cbegin(), usdExtensions.cend(), std::back_inserter(validExtensions), addDot);
     return validExtensions;
 }
+
+SdfPath FindNextPrimMatching(const UsdStageRefPtr &stage, const SdfPath &anchor,
+                             const std::function<bool(const std::string &)> &matches) {
+    SdfPath found;
+    bool anchorFound = false;
+    auto range = UsdPrimRange::Stage(stage, UsdTraverseInstanceProxies(UsdPrimAllPrimsPredicate));
+    for (auto iter = range.begin(); iter != range.end(); ++iter) {
+        if (iter->GetPath() == anchor) {
+            anchorFound = true;
+        } else if (matches(iter->GetName())) {
+            // Store the first matching path in case we don't find the one
+            // after the anchor
+            if (found == SdfPath()) {
+                found = iter->GetPath();
+                // We don't have an anchor, so the first match is the correct one
+                if (anchor == SdfPath())
+                    break;
+            }
+            if (anchorFound) {
+                found = iter->GetPath();
+                break;
+            }
+        }
+    }
+    return found;
+}
@@ -1,8 +1,10 @@
 #pragma once
 #include <cassert>
+#include <functional>
 #include <pxr/usd/sdf/listEditorProxy.h>
 #include <pxr/usd/sdf/reference.h>
 #include <pxr/usd/sdf/listOp.h>
+#include <pxr/usd/usd/stage.h>
 
 PXR_NAMESPACE_USING_DIRECTIVE
 
@@ -111,3 +113,8 @@ std::string FindNextAvailableTokenString(std::string prefix);
 
 // Find usd file format extensions and returns them prefixed with a dot
 const std::vector<std::string> GetUsdValidExtensions();
+
+// Returns the first prim after anchor, in traversal order, whose name matches. The search wraps around to the
+// first matching prim of the stage. Returns an empty path if no prim matches
+SdfPath FindNextPrimMatching(const UsdStageRefPtr &stage, const SdfPath &anchor,
+                             const std::function<bool(const std::string &)> &matches);
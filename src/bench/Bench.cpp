@@ -0,0 +1,313 @@
+///
+/// usdtweak_bench: headless benchmark of the widgets and the commands.
+/// The widgets are drawn in an ImGui context without window and without renderer, the draw data is generated and
+/// discarded. The stages are synthetic and generated from the command line parameters, so the results of different
+/// builds are comparable.
+///
+/// usdtweak_bench --prims 100000 --depth 4 --instancing 0.2 --attributes 4 --iterations 20 --output bench.json
+///
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <pxr/base/tf/stringUtils.h>
+#include <pxr/usd/sdf/attributeSpec.h>
+#include <pxr/usd/sdf/changeBlock.h>
+#include <pxr/usd/sdf/layer.h>
+#include <pxr/usd/sdf/primSpec.h>
+#include <pxr/usd/sdf/reference.h>
+#include <pxr/usd/sdf/types.h>
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usd/stage.h>
+
+#include "Commands.h"
+#include "Gui.h"
+#include "SdfCommandGroup.h"
+#include "SdfCommandGroupRecorder.h"
+#include "SdfLayerSceneGraphEditor.h"
+#include "Selection.h"
+#include "StageOutliner.h"
+#include "UsdHelpers.h"
+#include "WildcardsCompare.h"
+
+PXR_NAMESPACE_USING_DIRECTIVE
+
+namespace clk = std::chrono;
+
+struct BenchConfig {
+    size_t prims = 10000;
+    size_t depth = 4;
+    double instancing = 0.1;
+    size_t attributes = 4;
+    size_t iterations = 10;
+    std::string output;
+};
+
+struct BenchResult {
+    std::string name;
+    size_t iterations = 0;
+    double meanMs = 0.0;
+    double minMs = 0.0;
+    double maxMs = 0.0;
+    size_t items = 0; // Mean number of items processed per iteration, to compute the throughput
+};
+
+static void PrintUsage() {
+    std::cout << "usage: usdtweak_bench [--prims N] [--depth D] [--instancing RATIO] [--attributes A] [--iterations I] "
+                 "[--output FILE.json]"
+              << std::endl;
+}
+
+static bool ParseArguments(int argc, char *const *argv, BenchConfig &config) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        if (arg == "--help" || arg == "-h") {
+            return false;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "missing value for " << arg << std::endl;
+            return false;
+        }
+        const char *value = argv[++i];
+        if (arg == "--prims") {
+            config.prims = std::max<size_t>(1, std::strtoul(value, nullptr, 10));
+        } else if (arg == "--depth") {
+            config.depth = std::max<size_t>(1, std::strtoul(value, nullptr, 10));
+        } else if (arg == "--instancing") {
+            config.instancing = std::min(1.0, std::max(0.0, std::strtod(value, nullptr)));
+        } else if (arg == "--attributes") {
+            config.attributes = std::strtoul(value, nullptr, 10);
+        } else if (arg == "--iterations") {
+            config.iterations = std::max<size_t>(1, std::strtoul(value, nullptr, 10));
+        } else if (arg == "--output") {
+            config.output = value;
+        } else {
+            std::cerr << "unknown argument " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Generate a stage with config.prims prims spread on config.depth levels. A fraction of the leaves reference a
+/// prototype and are instanceable, all the prims hold config.attributes float attributes.
+/// The generation is deterministic, the same config always gives the same stage
+static UsdStageRefPtr CreateSyntheticStage(const BenchConfig &config, std::vector<SdfPath> &leaves,
+                                           std::vector<SdfPath> &attributes) {
+    SdfLayerRefPtr layer = SdfLayer::CreateAnonymous("bench.usda");
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<double> distribution(0.0, 1.0);
+    const size_t fanout =
+        std::max<size_t>(2, static_cast<size_t>(std::ceil(std::pow(static_cast<double>(config.prims), 1.0 / config.depth))));
+    const SdfPath prototypePath("/Prototype");
+    {
+        SdfChangeBlock block;
+        SdfPrimSpecHandle prototype = SdfPrimSpec::New(layer, "Prototype", SdfSpecifierClass, "Xform");
+        SdfPrimSpec::New(prototype, "Geometry", SdfSpecifierDef, "Sphere");
+
+        // Breadth first creation, so the levels are filled before going deeper
+        std::vector<SdfPrimSpecHandle> parents = {layer->GetPseudoRoot()};
+        size_t created = 0;
+        for (size_t level = 0; level < config.depth && created < config.prims; ++level) {
+            std::vector<SdfPrimSpecHandle> children;
+            const bool isLastLevel = level + 1 == config.depth;
+            for (const auto &parent : parents) {
+                for (size_t i = 0; i < fanout && created < config.prims; ++i, ++created) {
+                    SdfPrimSpecHandle prim =
+                        SdfPrimSpec::New(parent, TfStringPrintf("Prim_%zu", created), SdfSpecifierDef, "Xform");
+                    for (size_t a = 0; a < config.attributes; ++a) {
+                        SdfAttributeSpecHandle attribute = SdfAttributeSpec::New(prim, TfStringPrintf("value_%zu", a),
+                                                                                 SdfValueTypeNames->Float);
+                        attribute->SetDefaultValue(VtValue(static_cast<float>(distribution(generator))));
+                        attributes.push_back(attribute->GetPath());
+                    }
+                    if (isLastLevel && distribution(generator) < config.instancing) {
+                        prim->GetReferenceList().Prepend(SdfReference(std::string(), prototypePath));
+                        prim->SetInstanceable(true);
+                    }
+                    children.push_back(prim);
+                }
+            }
+            parents.swap(children);
+        }
+        for (const auto &leaf : parents) {
+            leaves.push_back(leaf->GetPath());
+        }
+    }
+    return UsdStage::Open(layer);
+}
+
+static void InitializeHeadlessImGui() {
+    ImGui::CreateContext();
+    ImGuiIO &io = ImGui::GetIO();
+    io.IniFilename = nullptr;
+    io.DisplaySize = ImVec2(1920, 1080);
+    io.DeltaTime = 1.f / 60.f;
+    // Building the font atlas is required by NewFrame, the texture is never uploaded
+    unsigned char *pixels = nullptr;
+    int width = 0, height = 0;
+    io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+}
+
+/// Draw a full frame with one window containing the widget, the draw data is generated and ignored
+static void DrawHeadlessFrame(const char *windowName, const std::function<void()> &drawWidget) {
+    ImGui::NewFrame();
+    ImGui::SetNextWindowPos(ImVec2(0, 0));
+    ImGui::SetNextWindowSize(ImGui::GetIO().DisplaySize);
+    ImGui::Begin(windowName, nullptr, ImGuiWindowFlags_MenuBar);
+    drawWidget();
+    ImGui::End();
+    ImGui::Render();
+}
+
+/// Run the iteration function and time it. The iteration returns the number of items it has processed.
+static BenchResult RunBenchmark(const std::string &name, size_t iterations, const std::function<size_t(size_t)> &iteration) {
+    BenchResult result;
+    result.name = name;
+    result.iterations = iterations;
+    result.minMs = std::numeric_limits<double>::max();
+    double totalMs = 0.0;
+    size_t totalItems = 0;
+    for (size_t i = 0; i < iterations; ++i) {
+        const auto start = clk::steady_clock::now();
+        totalItems += iteration(i);
+        const double elapsedMs = clk::duration<double, std::milli>(clk::steady_clock::now() - start).count();
+        totalMs += elapsedMs;
+        result.minMs = std::min(result.minMs, elapsedMs);
+        result.maxMs = std::max(result.maxMs, elapsedMs);
+    }
+    result.meanMs = totalMs / static_cast<double>(iterations);
+    result.items = totalItems / iterations;
+    std::cout << TfStringPrintf("%-32s mean %10.3f ms  min %10.3f ms  max %10.3f ms", name.c_str(), result.meanMs,
+                                result.minMs, result.maxMs)
+              << std::endl;
+    return result;
+}
+
+static std::string ToJson(const BenchConfig &config, const std::vector<BenchResult> &results) {
+    std::ostringstream json;
+    json << "{\n  \"config\": {\"prims\": " << config.prims << ", \"depth\": " << config.depth
+         << ", \"instancing\": " << config.instancing << ", \"attributes\": " << config.attributes
+         << ", \"iterations\": " << config.iterations << "},\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult &result = results[i];
+        const double itemsPerSecond = result.meanMs > 0.0 ? static_cast<double>(result.items) * 1000.0 / result.meanMs : 0.0;
+        json << "    {\"name\": \"" << result.name << "\", \"iterations\": " << result.iterations
+             << ", \"mean_ms\": " << result.meanMs << ", \"min_ms\": " << result.minMs << ", \"max_ms\": " << result.maxMs
+             << ", \"items\": " << result.items << ", \"items_per_second\": " << itemsPerSecond << "}"
+             << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    json << "  ]\n}\n";
+    return json.str();
+}
+
+int main(int argc, char *const *argv) {
+    BenchConfig config;
+    if (!ParseArguments(argc, argv, config)) {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+
+    std::vector<SdfPath> leaves;
+    std::vector<SdfPath> attributes;
+    const auto generationStart = clk::steady_clock::now();
+    UsdStageRefPtr stage = CreateSyntheticStage(config, leaves, attributes);
+    std::cout << "generated " << config.prims << " prims in "
+              << clk::duration<double, std::milli>(clk::steady_clock::now() - generationStart).count() << " ms" << std::endl;
+    SdfLayerRefPtr layer = stage->GetRootLayer();
+
+    InitializeHeadlessImGui();
+    Selection selection;
+    std::vector<BenchResult> results;
+
+    // Selecting a different leaf each frame forces the outliner to open the path and traverse the new rows.
+    // The items are the rows of the opened prims visited by the traversal, they grow as more paths are opened
+    results.push_back(RunBenchmark("outliner_traversal", config.iterations, [&](size_t i) {
+        selection.SetSelected(stage, leaves[i % leaves.size()]);
+        DrawHeadlessFrame("Stage outliner", [&]() { DrawStageOutliner(stage, selection); });
+        return GetStageOutlinerRowCount();
+    }));
+
+    results.push_back(RunBenchmark("layer_hierarchy_traversal", config.iterations, [&](size_t i) {
+        selection.SetSelected(layer, leaves[i % leaves.size()]);
+        DrawHeadlessFrame("Layer hierarchy", [&]() { DrawLayerPrimHierarchy(layer, selection); });
+        return GetLayerPrimHierarchyRowCount();
+    }));
+
+    results.push_back(RunBenchmark("selection_update", config.iterations, [&](size_t) {
+        SelectionHash hash = 0;
+        for (const auto &leaf : leaves) {
+            selection.SetSelected(stage, leaf);
+            selection.UpdateSelectionHash(stage, hash);
+        }
+        return leaves.size();
+    }));
+
+    // Searching the last leaf from the root visits the whole stage, with the same wildcard matching as the find bar
+    const std::string pattern = leaves.back().GetName();
+    results.push_back(RunBenchmark("find_prim", config.iterations, [&](size_t) {
+        FindNextPrimMatching(stage, SdfPath(),
+                             [&](const std::string &name) { return FastWildComparePortable(pattern.c_str(), name.c_str()); });
+        return config.prims;
+    }));
+
+    // Throughput of the undo delegate: record a change on every attribute, the recorded instructions are then
+    // replayed as undo and redo
+    SdfCommandGroup undoCommands;
+    results.push_back(RunBenchmark("undo_recorder", config.iterations, [&](size_t i) {
+        undoCommands.Clear();
+        SdfCommandGroupRecorder recorder(undoCommands, layer);
+        for (const auto &attributePath : attributes) {
+            if (SdfAttributeSpecHandle attribute = layer->GetAttributeAtPath(attributePath)) {
+                attribute->SetDefaultValue(VtValue(static_cast<float>(i)));
+            }
+        }
+        return attributes.size();
+    }));
+    results.push_back(RunBenchmark("undo_replay", config.iterations, [&](size_t) {
+        undoCommands.UndoIt();
+        undoCommands.DoIt();
+        return attributes.size() * 2;
+    }));
+    undoCommands.UndoIt();
+    undoCommands.Clear();
+
+    // Full command path: creation through the command stack, then undo of all the commands
+    constexpr size_t commandsPerIteration = 100;
+    results.push_back(RunBenchmark("command_execution", config.iterations, [&](size_t i) {
+        for (size_t c = 0; c < commandsPerIteration; ++c) {
+            ExecuteAfterDraw<PrimNew>(layer, TfStringPrintf("Bench_%zu_%zu", i, c));
+            ExecuteCommands();
+        }
+        for (size_t c = 0; c < commandsPerIteration; ++c) {
+            ExecuteAfterDraw<UndoCommand>();
+            ExecuteCommands();
+        }
+        return commandsPerIteration;
+    }));
+
+    ImGui::DestroyContext();
+
+    const std::string json = ToJson(config, results);
+    if (config.output.empty()) {
+        std::cout << json;
+    } else {
+        std::ofstream output(config.output);
+        if (!output) {
+            std::cerr << "unable to write " << config.output << std::endl;
+            return EXIT_FAILURE;
+        }
+        output << json;
+    }
+    return EXIT_SUCCESS;
+}
@@ -4,9 +4,12 @@
 #include <pxr/usd/usdGeom/gprim.h>
 #include <pxr/usd/sdf/propertySpec.h>
 #include <pxr/base/vt/value.h>
+#include <pxr/base/tf/mallocTag.h>
 #include "CommandsImpl.h"
 #include "CommandStack.h"
 #include "SdfCommandGroupRecorder.h"
+#include "SdfLayerInstructions.h"
+#include "MemoryPanel.h"
 
 PXR_NAMESPACE_USING_DIRECTIVE
 
@@ -74,4 +77,30 @@ struct AttributeCreateDefaultValue : public SdfLayerCommand {
 };
 template void ExecuteAfterDraw<AttributeCreateDefaultValue>(UsdAttribute attribute);
 
+/// Edit a few elements of an array value in a layer, default value or time sample.
+/// The instruction is stored directly instead of being recorded, so the undo keeps only the patch and not
+/// the full previous and new arrays.
+struct AttributePatchArray : public SdfLayerCommand {
+
+    AttributePatchArray(SdfLayerHandle layer, SdfPath path, UsdTimeCode timeCode, VtArrayPatch patch) {
+        if (layer && !patch.IsEmpty()) {
+            TfAutoMallocTag2 tag(MallocTagEditor, MallocTagUndoStack);
+            _undoCommands.StoreInstruction(UndoRedoPatchArray(layer, path, timeCode, std::move(patch)));
+        }
+    }
+
+    ~AttributePatchArray() override {}
+
+    // Redo calls DoIt again, it replays the same instruction
+    bool DoIt() override {
+        if (_undoCommands.IsEmpty()) {
+            return false;
+        }
+        _undoCommands.DoIt();
+        return true;
+    }
+};
+template void ExecuteAfterDraw<AttributePatchArray>(SdfLayerHandle layer, SdfPath path, UsdTimeCode timeCode,
+                                                    VtArrayPatch patch);
+
 
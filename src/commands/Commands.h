@@ -41,6 +41,7 @@ struct EditorFindOrOpenLayer;
 struct EditorRunLauncher;
 struct EditorAddLauncher;
 struct EditorRemoveLauncher;
+struct EditorSaveLayer;
 struct EditorSaveLayerAs;
 struct EditorSetCurrentLayer;
 struct EditorSetCurrentStage;
@@ -49,6 +50,7 @@ struct EditorSetPreviousLayer;
 struct EditorSetNextLayer;
 struct EditorSetSelection;
 struct EditorSelectAttributePath;
+struct EditorShowPrimCompositions;
 struct EditorShutdown;
 struct EditorStartPlayback;
 struct EditorStopPlayback;
@@ -70,6 +72,7 @@ struct ClearUndoRedoCommand;
 
 struct AttributeSet;
 struct AttributeCreateDefaultValue;
+struct AttributePatchArray;
 
 struct UsdFunctionCall; // This should be name a SdfLayerFunctionCall to be precise
 
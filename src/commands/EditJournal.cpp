@@ -0,0 +1,1121 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <set>
+
+#include <pxr/base/arch/fileSystem.h>
+#include <pxr/base/tf/fileUtils.h>
+#include <pxr/base/tf/pathUtils.h>
+#include <pxr/base/tf/stringUtils.h>
+#include <pxr/base/vt/dictionary.h>
+#include <pxr/usd/sdf/changeBlock.h>
+#include <pxr/usd/sdf/layerOffset.h>
+#include <pxr/usd/sdf/listOp.h>
+#include <pxr/usd/sdf/payload.h>
+#include <pxr/usd/sdf/reference.h>
+#include <pxr/usd/sdf/timeCode.h>
+#include <pxr/usd/sdf/types.h>
+
+#include "EditJournal.h"
+#include "VtArrayPatch.h"
+
+// Each session holds a lock on its lock file until it exits, the lock is released by the system when the session
+// crashes. The journals of a session whose lock file is still locked belong to a running instance
+#ifdef _WIN64
+#include <io.h>
+#include <windows.h>
+static void SyncFile(FILE *file) { _commit(_fileno(file)); }
+using SessionLock = HANDLE;
+static const SessionLock InvalidSessionLock = INVALID_HANDLE_VALUE;
+// The file is opened without sharing, it can't be opened by another process while the session is running
+static SessionLock LockSessionFile(const std::string &filePath, bool create) {
+    return CreateFileA(filePath.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, create ? CREATE_ALWAYS : OPEN_EXISTING,
+                       FILE_ATTRIBUTE_NORMAL, nullptr);
+}
+static void UnlockSessionFile(SessionLock lock) { CloseHandle(lock); }
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+static void SyncFile(FILE *file) { fsync(fileno(file)); }
+using SessionLock = int;
+static const SessionLock InvalidSessionLock = -1;
+static SessionLock LockSessionFile(const std::string &filePath, bool create) {
+    const int fd = open(filePath.c_str(), create ? O_RDWR | O_CREAT : O_RDWR, 0644);
+    if (fd >= 0 && flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        close(fd);
+        return InvalidSessionLock;
+    }
+    return fd;
+}
+static void UnlockSessionFile(SessionLock lock) { close(lock); }
+#endif
+
+/// File header, followed by the layer identifier, real path and the fingerprint of the layer file
+static constexpr char JournalMagic[8] = {'U', 'T', 'J', 'O', 'U', 'R', 'N', 'L'};
+static constexpr uint32_t JournalVersion = 2;
+static constexpr const char *JournalExtension = ".journal";
+static constexpr const char *SessionLockExtension = ".lock";
+
+/// Minimum time between two syncs of the journal files
+static constexpr std::chrono::seconds JournalSyncPeriod(2);
+
+// A record is [uint32 size][uint8 operation][payload], size counts the operation and the payload.
+// A record cut by a crash is detected by its size and ignored.
+enum class JournalOperation : uint8_t {
+    SetField,
+    SetFieldDictValueByKey,
+    SetTimeSample,
+    EraseTimeSample,
+    CreateSpec,
+    DeleteSpec,
+    MoveSpec,
+    PushChild,
+    PopChild,
+    PatchArray,
+};
+
+// Type tags of the values. The plain data types and their arrays are indexed from TagPlainData and TagPlainDataArray
+enum JournalValueTag : uint8_t {
+    TagEmpty,
+    TagUnsupported,
+    TagValueBlock,
+    TagString,
+    TagToken,
+    TagAssetPath,
+    TagPath,
+    TagStringArray,
+    TagTokenArray,
+    TagAssetPathArray,
+    TagStringVector,
+    TagTokenVector,
+    TagPathVector,
+    TagDictionary,
+    TagTimeSamples,
+    TagVariantSelections,
+    TagLayerOffset,
+    TagLayerOffsetVector,
+    TagStringListOp,
+    TagTokenListOp,
+    TagPathListOp,
+    TagReferenceListOp,
+    TagPayloadListOp,
+    TagPlainData = 32,
+    TagPlainDataArray = 96,
+};
+
+class JournalWriter {
+  public:
+    explicit JournalWriter(std::string &buffer) : _buffer(buffer) {}
+
+    void Bytes(const void *data, size_t size) { _buffer.append(static_cast<const char *>(data), size); }
+    template <typename T> void Pod(const T &value) { Bytes(&value, sizeof(T)); }
+    void U8(uint8_t value) { Pod(value); }
+    void U64(uint64_t value) { Pod(value); }
+    void String(const std::string &value) {
+        U64(value.size());
+        Bytes(value.data(), value.size());
+    }
+
+  private:
+    std::string &_buffer;
+};
+
+class JournalReader {
+  public:
+    JournalReader(const char *data, size_t size) : _data(data), _size(size) {}
+
+    bool IsValid() const { return _valid; }
+    bool IsAtEnd() const { return _offset == _size; }
+    size_t GetOffset() const { return _offset; }
+
+    /// Check there are at least size bytes left, invalidates the reader otherwise
+    bool CanRead(uint64_t size) {
+        if (!_valid || size > _size - _offset) {
+            _valid = false;
+        }
+        return _valid;
+    }
+    bool Bytes(void *data, size_t size) {
+        if (!CanRead(size)) {
+            return false;
+        }
+        memcpy(data, _data + _offset, size);
+        _offset += size;
+        return true;
+    }
+    template <typename T> T Pod() {
+        T value{};
+        Bytes(&value, sizeof(T));
+        return value;
+    }
+    std::string String() {
+        const uint64_t size = Pod<uint64_t>();
+        if (!CanRead(size)) {
+            return {};
+        }
+        std::string value(_data + _offset, size);
+        _offset += size;
+        return value;
+    }
+
+  private:
+    const char *_data;
+    size_t _size;
+    size_t _offset = 0;
+    bool _valid = true;
+};
+
+//
+// Value encoding
+//
+static void WriteValue(JournalWriter &writer, const VtValue &value);
+static bool ReadValue(JournalReader &reader, VtValue &value);
+
+static void WriteItem(JournalWriter &writer, const std::string &item) { writer.String(item); }
+static void ReadItem(JournalReader &reader, std::string &item) { item = reader.String(); }
+
+static void WriteItem(JournalWriter &writer, const TfToken &item) { writer.String(item.GetString()); }
+static void ReadItem(JournalReader &reader, TfToken &item) { item = TfToken(reader.String()); }
+
+static void WriteItem(JournalWriter &writer, const SdfPath &item) { writer.String(item.GetAsString()); }
+static void ReadItem(JournalReader &reader, SdfPath &item) { item = SdfPath(reader.String()); }
+
+static void WriteItem(JournalWriter &writer, const SdfAssetPath &item) { writer.String(item.GetAssetPath()); }
+static void ReadItem(JournalReader &reader, SdfAssetPath &item) { item = SdfAssetPath(reader.String()); }
+
+static void WriteItem(JournalWriter &writer, const SdfLayerOffset &item) {
+    writer.Pod(item.GetOffset());
+    writer.Pod(item.GetScale());
+}
+static void ReadItem(JournalReader &reader, SdfLayerOffset &item) {
+    const double offset = reader.Pod<double>();
+    const double scale = reader.Pod<double>();
+    item = SdfLayerOffset(offset, scale);
+}
+
+static void WriteItem(JournalWriter &writer, const VtDictionary &item) {
+    writer.U64(item.size());
+    for (const auto &entry : item) {
+        writer.String(entry.first);
+        WriteValue(writer, entry.second);
+    }
+}
+static void ReadItem(JournalReader &reader, VtDictionary &item) {
+    const uint64_t size = reader.Pod<uint64_t>();
+    for (uint64_t i = 0; i < size && reader.IsValid(); ++i) {
+        const std::string key = reader.String();
+        VtValue value;
+        if (ReadValue(reader, value)) {
+            item[key] = value;
+        }
+    }
+}
+
+static void WriteItem(JournalWriter &writer, const SdfTimeSampleMap &item) {
+    writer.U64(item.size());
+    for (const auto &sample : item) {
+        writer.Pod(sample.first);
+        WriteValue(writer, sample.second);
+    }
+}
+static void ReadItem(JournalReader &reader, SdfTimeSampleMap &item) {
+    const uint64_t size = reader.Pod<uint64_t>();
+    for (uint64_t i = 0; i < size && reader.IsValid(); ++i) {
+        const double time = reader.Pod<double>();
+        VtValue value;
+        if (ReadValue(reader, value)) {
+            item[time] = value;
+        }
+    }
+}
+
+static void WriteItem(JournalWriter &writer, const SdfVariantSelectionMap &item) {
+    writer.U64(item.size());
+    for (const auto &selection : item) {
+        writer.String(selection.first);
+        writer.String(selection.second);
+    }
+}
+static void ReadItem(JournalReader &reader, SdfVariantSelectionMap &item) {
+    const uint64_t size = reader.Pod<uint64_t>();
+    for (uint64_t i = 0; i < size && reader.IsValid(); ++i) {
+        const std::string variantSet = reader.String();
+        item[variantSet] = reader.String();
+    }
+}
+
+static void WriteItem(JournalWriter &writer, const SdfReference &item) {
+    writer.String(item.GetAssetPath());
+    WriteItem(writer, item.GetPrimPath());
+    WriteItem(writer, item.GetLayerOffset());
+    WriteItem(writer, item.GetCustomData());
+}
+static void ReadItem(JournalReader &reader, SdfReference &item) {
+    const std::string assetPath = reader.String();
+    SdfPath primPath;
+    SdfLayerOffset layerOffset;
+    VtDictionary customData;
+    ReadItem(reader, primPath);
+    ReadItem(reader, layerOffset);
+    ReadItem(reader, customData);
+    item = SdfReference(assetPath, primPath, layerOffset, customData);
+}
+
+static void WriteItem(JournalWriter &writer, const SdfPayload &item) {
+    writer.String(item.GetAssetPath());
+    WriteItem(writer, item.GetPrimPath());
+    WriteItem(writer, item.GetLayerOffset());
+}
+static void ReadItem(JournalReader &reader, SdfPayload &item) {
+    const std::string assetPath = reader.String();
+    SdfPath primPath;
+    SdfLayerOffset layerOffset;
+    ReadItem(reader, primPath);
+    ReadItem(reader, layerOffset);
+    item = SdfPayload(assetPath, primPath, layerOffset);
+}
+
+template <typename ContainerT> static void WriteItems(JournalWriter &writer, const ContainerT &items) {
+    writer.U64(items.size());
+    for (const auto &item : items) {
+        WriteItem(writer, item);
+    }
+}
+template <typename ContainerT> static void ReadItems(JournalReader &reader, ContainerT &items) {
+    const uint64_t size = reader.Pod<uint64_t>();
+    // Each item takes at least one byte, this prevents allocating a corrupted size
+    if (!reader.CanRead(size)) {
+        return;
+    }
+    items.resize(size);
+    for (auto &item : items) {
+        ReadItem(reader, item);
+    }
+}
+
+template <typename T> static void WriteItem(JournalWriter &writer, const std::vector<T> &items) { WriteItems(writer, items); }
+template <typename T> static void ReadItem(JournalReader &reader, std::vector<T> &items) { ReadItems(reader, items); }
+
+template <typename T> static void WriteItem(JournalWriter &writer, const VtArray<T> &items) { WriteItems(writer, items); }
+template <typename T> static void ReadItem(JournalReader &reader, VtArray<T> &items) { ReadItems(reader, items); }
+
+// The deprecated added items are not kept
+template <typename T> static void WriteItem(JournalWriter &writer, const SdfListOp<T> &item) {
+    writer.U8(item.IsExplicit());
+    WriteItems(writer, item.GetExplicitItems());
+    WriteItems(writer, item.GetPrependedItems());
+    WriteItems(writer, item.GetAppendedItems());
+    WriteItems(writer, item.GetDeletedItems());
+    WriteItems(writer, item.GetOrderedItems());
+}
+template <typename T> static void ReadItem(JournalReader &reader, SdfListOp<T> &item) {
+    const bool isExplicit = reader.Pod<uint8_t>();
+    typename SdfListOp<T>::ItemVector explicitItems, prependedItems, appendedItems, deletedItems, orderedItems;
+    ReadItems(reader, explicitItems);
+    ReadItems(reader, prependedItems);
+    ReadItems(reader, appendedItems);
+    ReadItems(reader, deletedItems);
+    ReadItems(reader, orderedItems);
+    if (isExplicit) {
+        item.SetExplicitItems(explicitItems);
+    } else {
+        item.SetPrependedItems(prependedItems);
+        item.SetAppendedItems(appendedItems);
+        item.SetDeletedItems(deletedItems);
+        item.SetOrderedItems(orderedItems);
+    }
+}
+
+template <typename T> static bool WriteIfHolding(JournalWriter &writer, const VtValue &value, JournalValueTag tag) {
+    if (!value.IsHolding<T>()) {
+        return false;
+    }
+    writer.U8(tag);
+    WriteItem(writer, value.UncheckedGet<T>());
+    return true;
+}
+
+template <typename T> static bool ReadAs(JournalReader &reader, VtValue &value) {
+    T item;
+    ReadItem(reader, item);
+    if (!reader.IsValid()) {
+        return false;
+    }
+    value = VtValue::Take(item);
+    return true;
+}
+
+// Types copied as raw bytes, with their arrays. The order defines their tag and must not change
+template <size_t Index, typename... Types> struct PlainDataValues {
+    static bool Write(JournalWriter &, const VtValue &) { return false; }
+    static bool Read(JournalReader &, uint8_t, VtValue &) { return false; }
+};
+
+template <size_t Index, typename T, typename... Others> struct PlainDataValues<Index, T, Others...> {
+    static bool Write(JournalWriter &writer, const VtValue &value) {
+        if (value.IsHolding<T>()) {
+            writer.U8(TagPlainData + Index);
+            writer.Pod(value.UncheckedGet<T>());
+            return true;
+        }
+        if (value.IsHolding<VtArray<T>>()) {
+            const VtArray<T> &array = value.UncheckedGet<VtArray<T>>();
+            writer.U8(TagPlainDataArray + Index);
+            writer.U64(array.size());
+            writer.Bytes(array.cdata(), array.size() * sizeof(T));
+            return true;
+        }
+        return PlainDataValues<Index + 1, Others...>::Write(writer, value);
+    }
+
+    static bool Read(JournalReader &reader, uint8_t tag, VtValue &value) {
+        if (tag == TagPlainData + Index) {
+            value = VtValue(reader.Pod<T>());
+            return reader.IsValid();
+        }
+        if (tag == TagPlainDataArray + Index) {
+            const uint64_t size = reader.Pod<uint64_t>();
+            if (!reader.CanRead(size) || !reader.CanRead(size * sizeof(T))) {
+                return false;
+            }
+            VtArray<T> array(size);
+            reader.Bytes(array.data(), size * sizeof(T));
+            value = VtValue::Take(array);
+            return true;
+        }
+        return PlainDataValues<Index + 1, Others...>::Read(reader, tag, value);
+    }
+};
+
+using JournalPlainDataValues =
+    PlainDataValues<0, bool, unsigned char, int, unsigned int, int64_t, uint64_t, GfHalf, float, double, SdfTimeCode, GfVec2i,
+                    GfVec2h, GfVec2f, GfVec2d, GfVec3i, GfVec3h, GfVec3f, GfVec3d, GfVec4i, GfVec4h, GfVec4f, GfVec4d, GfQuath,
+                    GfQuatf, GfQuatd, GfMatrix2d, GfMatrix3d, GfMatrix4d, SdfSpecifier, SdfVariability, SdfPermission>;
+
+static void WriteValue(JournalWriter &writer, const VtValue &value) {
+    if (value.IsEmpty()) {
+        writer.U8(TagEmpty);
+        return;
+    }
+    if (value.IsHolding<SdfValueBlock>()) {
+        writer.U8(TagValueBlock);
+        return;
+    }
+    const bool written = JournalPlainDataValues::Write(writer, value) || WriteIfHolding<std::string>(writer, value, TagString) ||
+                         WriteIfHolding<TfToken>(writer, value, TagToken) ||
+                         WriteIfHolding<SdfAssetPath>(writer, value, TagAssetPath) ||
+                         WriteIfHolding<SdfPath>(writer, value, TagPath) ||
+                         WriteIfHolding<VtStringArray>(writer, value, TagStringArray) ||
+                         WriteIfHolding<VtTokenArray>(writer, value, TagTokenArray) ||
+                         WriteIfHolding<SdfAssetPathArray>(writer, value, TagAssetPathArray) ||
+                         WriteIfHolding<std::vector<std::string>>(writer, value, TagStringVector) ||
+                         WriteIfHolding<TfTokenVector>(writer, value, TagTokenVector) ||
+                         WriteIfHolding<SdfPathVector>(writer, value, TagPathVector) ||
+                         WriteIfHolding<VtDictionary>(writer, value, TagDictionary) ||
+                         WriteIfHolding<SdfTimeSampleMap>(writer, value, TagTimeSamples) ||
+                         WriteIfHolding<SdfVariantSelectionMap>(writer, value, TagVariantSelections) ||
+                         WriteIfHolding<SdfLayerOffset>(writer, value, TagLayerOffset) ||
+                         WriteIfHolding<SdfLayerOffsetVector>(writer, value, TagLayerOffsetVector) ||
+                         WriteIfHolding<SdfStringListOp>(writer, value, TagStringListOp) ||
+                         WriteIfHolding<SdfTokenListOp>(writer, value, TagTokenListOp) ||
+                         WriteIfHolding<SdfPathListOp>(writer, value, TagPathListOp) ||
+                         WriteIfHolding<SdfReferenceListOp>(writer, value, TagReferenceListOp) ||
+                         WriteIfHolding<SdfPayloadListOp>(writer, value, TagPayloadListOp);
+    if (!written) {
+        // The type name is kept for diagnostic, the value is skipped when replaying
+        writer.U8(TagUnsupported);
+        writer.String(value.GetTypeName());
+    }
+}
+
+// Returns false when the value can't be decoded, the reader stays valid for the unsupported values
+static bool ReadValue(JournalReader &reader, VtValue &value) {
+    const uint8_t tag = reader.Pod<uint8_t>();
+    if (!reader.IsValid()) {
+        return false;
+    }
+    switch (tag) {
+    case TagEmpty:
+        value = VtValue();
+        return true;
+    case TagUnsupported:
+        reader.String();
+        return false;
+    case TagValueBlock:
+        value = VtValue(SdfValueBlock());
+        return true;
+    case TagString:
+        return ReadAs<std::string>(reader, value);
+    case TagToken:
+        return ReadAs<TfToken>(reader, value);
+    case TagAssetPath:
+        return ReadAs<SdfAssetPath>(reader, value);
+    case TagPath:
+        return ReadAs<SdfPath>(reader, value);
+    case TagStringArray:
+        return ReadAs<VtStringArray>(reader, value);
+    case TagTokenArray:
+        return ReadAs<VtTokenArray>(reader, value);
+    case TagAssetPathArray:
+        return ReadAs<SdfAssetPathArray>(reader, value);
+    case TagStringVector:
+        return ReadAs<std::vector<std::string>>(reader, value);
+    case TagTokenVector:
+        return ReadAs<TfTokenVector>(reader, value);
+    case TagPathVector:
+        return ReadAs<SdfPathVector>(reader, value);
+    case TagDictionary:
+        return ReadAs<VtDictionary>(reader, value);
+    case TagTimeSamples:
+        return ReadAs<SdfTimeSampleMap>(reader, value);
+    case TagVariantSelections:
+        return ReadAs<SdfVariantSelectionMap>(reader, value);
+    case TagLayerOffset:
+        return ReadAs<SdfLayerOffset>(reader, value);
+    case TagLayerOffsetVector:
+        return ReadAs<SdfLayerOffsetVector>(reader, value);
+    case TagStringListOp:
+        return ReadAs<SdfStringListOp>(reader, value);
+    case TagTokenListOp:
+        return ReadAs<SdfTokenListOp>(reader, value);
+    case TagPathListOp:
+        return ReadAs<SdfPathListOp>(reader, value);
+    case TagReferenceListOp:
+        return ReadAs<SdfReferenceListOp>(reader, value);
+    case TagPayloadListOp:
+        return ReadAs<SdfPayloadListOp>(reader, value);
+    default:
+        return JournalPlainDataValues::Read(reader, tag, value);
+    }
+}
+
+// Element types of the array patches, they are read back as the arrays of the journal
+template <typename... Types> struct ArrayPatchTypes {
+    static VtArrayPatch Make(size_t, const VtValue &, const VtValue &) { return VtArrayPatch(); }
+};
+
+template <typename T, typename... Others> struct ArrayPatchTypes<T, Others...> {
+    static VtArrayPatch Make(size_t index, const VtValue &removedElements, const VtValue &addedElements) {
+        if (removedElements.IsHolding<VtArray<T>>() && addedElements.IsHolding<VtArray<T>>()) {
+            return VtArrayPatch(index, removedElements.UncheckedGet<VtArray<T>>(), addedElements.UncheckedGet<VtArray<T>>());
+        }
+        return ArrayPatchTypes<Others...>::Make(index, removedElements, addedElements);
+    }
+};
+
+using JournalArrayPatchTypes =
+    ArrayPatchTypes<bool, unsigned char, int, unsigned int, int64_t, uint64_t, GfHalf, float, double, SdfTimeCode, GfVec2i,
+                    GfVec2h, GfVec2f, GfVec2d, GfVec3i, GfVec3h, GfVec3f, GfVec3d, GfVec4i, GfVec4h, GfVec4f, GfVec4d, GfQuath,
+                    GfQuatf, GfQuatd, GfMatrix2d, GfMatrix3d, GfMatrix4d, std::string, TfToken, SdfAssetPath>;
+
+//
+// Journal files
+//
+struct LayerJournal {
+    SdfLayerHandle layer;
+    std::string filePath;
+    FILE *file = nullptr;
+    std::string header;
+    std::string pending;    // Records not yet written to the file
+    size_t position = 0;    // Bytes recorded since the journal was created
+    size_t filePosition = 0; // Position of the first record in the file
+};
+
+static struct {
+    bool enabled = false;
+    std::string directory;
+    std::string sessionId;
+    SessionLock sessionLock = InvalidSessionLock;
+    std::mutex mutex;
+    std::map<SdfLayerHandle, LayerJournal> journals;
+    std::chrono::steady_clock::time_point lastSync;
+    std::future<void> syncTask;
+} editJournal;
+
+// The records are relative to the content of the layer file, like the children pushed or the specs moved. The size
+// and modification time of the file tell if it was modified after the journal was started
+struct LayerFileFingerprint {
+    int64_t size = -1; // -1 when the file doesn't exist
+    double modificationTime = 0.0;
+};
+
+static LayerFileFingerprint GetLayerFileFingerprint(const std::string &realPath) {
+    LayerFileFingerprint fingerprint;
+    if (!realPath.empty() && ArchGetModificationTime(realPath.c_str(), &fingerprint.modificationTime)) {
+        fingerprint.size = ArchGetFileLength(realPath.c_str());
+    }
+    return fingerprint;
+}
+
+static std::string MakeJournalHeader(const SdfLayer *layer) {
+    std::string header;
+    JournalWriter writer(header);
+    writer.Bytes(JournalMagic, sizeof(JournalMagic));
+    writer.Pod(JournalVersion);
+    writer.String(layer->GetIdentifier());
+    writer.String(layer->GetRealPath());
+    const LayerFileFingerprint fingerprint = GetLayerFileFingerprint(layer->GetRealPath());
+    writer.Pod(fingerprint.size);
+    writer.Pod(fingerprint.modificationTime);
+    return header;
+}
+
+// The file names are unique per session and layer, two sessions editing the same layer don't share a journal
+static std::string MakeJournalFilePath(const std::string &identifier) {
+    return TfStringCatPaths(editJournal.directory, TfStringPrintf("%s_%016zx%s", editJournal.sessionId.c_str(),
+                                                                  std::hash<std::string>()(identifier), JournalExtension));
+}
+
+static std::string MakeSessionLockFilePath(const std::string &sessionId) {
+    return TfStringCatPaths(editJournal.directory, sessionId + SessionLockExtension);
+}
+
+// The session id is the prefix of the journal file name
+static std::string GetJournalSessionId(const std::string &journalFilePath) {
+    const std::string fileName = TfGetBaseName(journalFilePath);
+    return fileName.substr(0, fileName.find('_'));
+}
+
+// Returns true if the session holds its lock. The journals without lock file were left by a crashed session
+static bool IsSessionRunning(const std::string &sessionId) {
+    const std::string lockFilePath = MakeSessionLockFilePath(sessionId);
+    if (!TfIsFile(lockFilePath)) {
+        return false;
+    }
+    const SessionLock lock = LockSessionFile(lockFilePath, false);
+    if (lock == InvalidSessionLock) {
+        return true;
+    }
+    UnlockSessionFile(lock);
+    return false;
+}
+
+// Remove the lock file of a crashed session when its last journal was recovered or discarded
+static void RemoveSessionLockIfUnused(const std::string &sessionId) {
+    for (const auto &fileName : TfListDir(editJournal.directory)) {
+        if (TfStringEndsWith(fileName, JournalExtension) && GetJournalSessionId(fileName) == sessionId) {
+            return;
+        }
+    }
+    const std::string lockFilePath = MakeSessionLockFilePath(sessionId);
+    if (TfIsFile(lockFilePath)) {
+        TfDeleteFile(lockFilePath);
+    }
+}
+
+static void WaitForSync() {
+    if (editJournal.syncTask.valid()) {
+        editJournal.syncTask.wait();
+    }
+}
+
+static void CloseJournal(LayerJournal &journal, bool removeFile) {
+    if (journal.file) {
+        fclose(journal.file);
+        journal.file = nullptr;
+    }
+    if (removeFile && TfIsFile(journal.filePath)) {
+        TfDeleteFile(journal.filePath);
+    }
+}
+
+bool IsEditJournaled(const SdfLayer *layer) { return editJournal.enabled && layer && !layer->IsAnonymous(); }
+
+// Journal of the layer, created with its header on the first record
+static LayerJournal &GetLayerJournal(const SdfLayer *layer) {
+    const SdfLayerHandle handle(const_cast<SdfLayer *>(layer));
+    auto found = editJournal.journals.find(handle);
+    if (found == editJournal.journals.end()) {
+        LayerJournal journal;
+        journal.layer = handle;
+        journal.filePath = MakeJournalFilePath(layer->GetIdentifier());
+        journal.header = MakeJournalHeader(layer);
+        journal.pending = journal.header;
+        found = editJournal.journals.emplace(handle, std::move(journal)).first;
+    }
+    return found->second;
+}
+
+// Append a record to the journal of the layer, the payload is written by the function.
+// The anonymous layers can't be reopened after a crash, they are not journaled
+template <typename FunctionT> static void Record(const SdfLayer *layer, JournalOperation operation, FunctionT &&writePayload) {
+    if (!IsEditJournaled(layer)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(editJournal.mutex);
+    LayerJournal &journal = GetLayerJournal(layer);
+    const size_t recordStart = journal.pending.size();
+    JournalWriter writer(journal.pending);
+    writer.Pod(uint32_t(0)); // Patched with the size of the record
+    writer.U8(static_cast<uint8_t>(operation));
+    writePayload(writer);
+    const uint32_t size = static_cast<uint32_t>(journal.pending.size() - recordStart - sizeof(uint32_t));
+    memcpy(&journal.pending[recordStart], &size, sizeof(size));
+    journal.position += journal.pending.size() - recordStart;
+}
+
+void JournalSetField(const SdfLayer *layer, const SdfPath &path, const TfToken &fieldName, const VtValue &value) {
+    Record(layer, JournalOperation::SetField, [&](JournalWriter &writer) {
+        WriteItem(writer, path);
+        WriteItem(writer, fieldName);
+        WriteValue(writer, value);
+    });
+}
+
+void JournalSetFieldDictValueByKey(const SdfLayer *layer, const SdfPath &path, const TfToken &fieldName, const TfToken &keyPath,
+                                   const VtValue &value) {
+    Record(layer, JournalOperation::SetFieldDictValueByKey, [&](JournalWriter &writer) {
+        WriteItem(writer, path);
+        WriteItem(writer, fieldName);
+        WriteItem(writer, keyPath);
+        WriteValue(writer, value);
+    });
+}
+
+void JournalSetTimeSample(const SdfLayer *layer, const SdfPath &path, double time, const VtValue &value) {
+    Record(layer, JournalOperation::SetTimeSample, [&](JournalWriter &writer) {
+        WriteItem(writer, path);
+        writer.Pod(time);
+        WriteValue(writer, value);
+    });
+}
+
+void JournalEraseTimeSample(const SdfLayer *layer, const SdfPath &path, double time) {
+    Record(layer, JournalOperation::EraseTimeSample, [&](JournalWriter &writer) {
+        WriteItem(writer, path);
+        writer.Pod(time);
+    });
+}
+
+void JournalCreateSpec(const SdfLayer *layer, const SdfPath &path, SdfSpecType specType, bool inert) {
+    Record(layer, JournalOperation::CreateSpec, [&](JournalWriter &writer) {
+        WriteItem(writer, path);
+        writer.U8(static_cast<uint8_t>(specType));
+        writer.U8(inert);
+    });
+}
+
+void JournalDeleteSpec(const SdfLayer *layer, const SdfPath &path, bool inert) {
+    Record(layer, JournalOperation::DeleteSpec, [&](JournalWriter &writer) {
+        WriteItem(writer, path);
+        writer.U8(inert);
+    });
+}
+
+void JournalMoveSpec(const SdfLayer *layer, const SdfPath &oldPath, const SdfPath &newPath) {
+    Record(layer, JournalOperation::MoveSpec, [&](JournalWriter &writer) {
+        WriteItem(writer, oldPath);
+        WriteItem(writer, newPath);
+    });
+}
+
+void JournalPushChild(const SdfLayer *layer, const SdfPath &parentPath, const TfToken &fieldName, const VtValue &value) {
+    Record(layer, JournalOperation::PushChild, [&](JournalWriter &writer) {
+        WriteItem(writer, parentPath);
+        WriteItem(writer, fieldName);
+        WriteValue(writer, value);
+    });
+}
+
+void JournalPopChild(const SdfLayer *layer, const SdfPath &parentPath, const TfToken &fieldName, const VtValue &value) {
+    Record(layer, JournalOperation::PopChild, [&](JournalWriter &writer) {
+        WriteItem(writer, parentPath);
+        WriteItem(writer, fieldName);
+        WriteValue(writer, value);
+    });
+}
+
+void JournalPatchArray(const SdfLayer *layer, const SdfPath &path, UsdTimeCode timeCode, size_t index,
+                       const VtValue &removedElements, const VtValue &addedElements) {
+    Record(layer, JournalOperation::PatchArray, [&](JournalWriter &writer) {
+        WriteItem(writer, path);
+        writer.U8(timeCode.IsDefault());
+        writer.Pod(timeCode.IsDefault() ? 0.0 : timeCode.GetValue());
+        writer.U64(index);
+        WriteValue(writer, removedElements);
+        WriteValue(writer, addedElements);
+    });
+}
+
+void InitializeEditJournal(const std::string &directory) {
+    std::lock_guard<std::mutex> lock(editJournal.mutex);
+    if (!TfIsDir(directory) && !TfMakeDirs(directory, -1, true)) {
+        TF_WARN("Unable to create the edit journal directory %s, the edits won't be journaled", directory.c_str());
+        return;
+    }
+    editJournal.directory = directory;
+    editJournal.sessionId = TfStringPrintf(
+        "%llx", static_cast<unsigned long long>(std::chrono::system_clock::now().time_since_epoch().count()));
+    editJournal.sessionLock = LockSessionFile(MakeSessionLockFilePath(editJournal.sessionId), true);
+    if (editJournal.sessionLock == InvalidSessionLock) {
+        TF_WARN("Unable to lock the edit journal session in %s, the edits won't be journaled", directory.c_str());
+        return;
+    }
+    editJournal.lastSync = std::chrono::steady_clock::now();
+    editJournal.enabled = true;
+}
+
+void UpdateEditJournal() {
+    std::lock_guard<std::mutex> lock(editJournal.mutex);
+    if (!editJournal.enabled) {
+        return;
+    }
+    bool written = false;
+    for (auto it = editJournal.journals.begin(); it != editJournal.journals.end();) {
+        LayerJournal &journal = it->second;
+        // The edits of a clean layer are in its file, or were discarded by a reload
+        if (!journal.layer || !journal.layer->IsDirty()) {
+            WaitForSync();
+            CloseJournal(journal, true);
+            it = editJournal.journals.erase(it);
+            continue;
+        }
+        if (!journal.pending.empty()) {
+            if (!journal.file) {
+                journal.file = fopen(journal.filePath.c_str(), "wb");
+            }
+            if (journal.file) {
+                fwrite(journal.pending.data(), 1, journal.pending.size(), journal.file);
+                fflush(journal.file);
+                written = true;
+            }
+            journal.pending.clear();
+        }
+        ++it;
+    }
+
+    // The sync can take a few milliseconds per file, it runs on a worker thread. The files are only closed by the main
+    // thread after waiting for the sync
+    const auto now = std::chrono::steady_clock::now();
+    if (written && now - editJournal.lastSync > JournalSyncPeriod &&
+        (!editJournal.syncTask.valid() ||
+         editJournal.syncTask.wait_for(std::chrono::seconds(0)) == std::future_status::ready)) {
+        std::vector<FILE *> files;
+        for (auto &journal : editJournal.journals) {
+            if (journal.second.file) {
+                files.push_back(journal.second.file);
+            }
+        }
+        editJournal.syncTask = std::async(std::launch::async, [files]() {
+            for (FILE *file : files) {
+                SyncFile(file);
+            }
+        });
+        editJournal.lastSync = now;
+    }
+}
+
+void ShutdownEditJournal() {
+    std::lock_guard<std::mutex> lock(editJournal.mutex);
+    WaitForSync();
+    for (auto &journal : editJournal.journals) {
+        CloseJournal(journal.second, true);
+    }
+    editJournal.journals.clear();
+    if (editJournal.sessionLock != InvalidSessionLock) {
+        UnlockSessionFile(editJournal.sessionLock);
+        editJournal.sessionLock = InvalidSessionLock;
+        TfDeleteFile(MakeSessionLockFilePath(editJournal.sessionId));
+    }
+    editJournal.enabled = false;
+}
+
+size_t GetEditJournalPosition(const SdfLayerHandle &layer) {
+    std::lock_guard<std::mutex> lock(editJournal.mutex);
+    const auto found = editJournal.journals.find(layer);
+    return found == editJournal.journals.end() ? 0 : found->second.position;
+}
+
+void TruncateEditJournal(const SdfLayerHandle &layer, size_t position) {
+    std::lock_guard<std::mutex> lock(editJournal.mutex);
+    auto found = editJournal.journals.find(layer);
+    if (found == editJournal.journals.end() || position < found->second.filePosition) {
+        return;
+    }
+    LayerJournal &journal = found->second;
+    // Gather the records after position, from the file and the pending buffer. The pending buffer starts with the
+    // header when the file is not opened yet
+    std::string records;
+    if (journal.file) {
+        fflush(journal.file);
+        std::ifstream file(journal.filePath, std::ios::binary);
+        records.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        records.erase(0, std::min(records.size(), journal.header.size()));
+        records += journal.pending;
+    } else {
+        records = journal.pending.substr(std::min(journal.pending.size(), journal.header.size()));
+    }
+    records.erase(0, std::min(records.size(), position - journal.filePosition));
+
+    WaitForSync();
+    CloseJournal(journal, false);
+    journal.filePosition = position;
+    // The records left apply to the file just saved, the header gets its fingerprint. The file is rewritten
+    // immediately, a crash after the save must not find the saved records
+    journal.header = MakeJournalHeader(get_pointer(layer));
+    journal.pending = journal.header + records;
+    journal.file = fopen(journal.filePath.c_str(), "wb");
+    if (journal.file) {
+        fwrite(journal.pending.data(), 1, journal.pending.size(), journal.file);
+        fflush(journal.file);
+        journal.pending.clear();
+    }
+}
+
+//
+// Recovery
+//
+struct JournalContent {
+    std::string identifier;
+    std::string realPath;
+    LayerFileFingerprint fingerprint;
+    std::string records;
+};
+
+static bool HasLayerFileChanged(const JournalContent &content) {
+    const LayerFileFingerprint fingerprint = GetLayerFileFingerprint(content.realPath);
+    return fingerprint.size != content.fingerprint.size ||
+           fingerprint.modificationTime != content.fingerprint.modificationTime;
+}
+
+static bool ReadJournalFile(const std::string &filePath, JournalContent &content) {
+    std::ifstream file(filePath, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    JournalReader reader(data.data(), data.size());
+    char magic[sizeof(JournalMagic)];
+    reader.Bytes(magic, sizeof(magic));
+    const uint32_t version = reader.Pod<uint32_t>();
+    content.identifier = reader.String();
+    content.realPath = reader.String();
+    content.fingerprint.size = reader.Pod<int64_t>();
+    content.fingerprint.modificationTime = reader.Pod<double>();
+    if (!reader.IsValid() || memcmp(magic, JournalMagic, sizeof(magic)) != 0 || version != JournalVersion) {
+        return false;
+    }
+    content.records = data.substr(reader.GetOffset());
+    return true;
+}
+
+// Call function with the reader of each complete record, returns the size of the complete records
+template <typename FunctionT> static size_t ForEachRecord(const std::string &records, FunctionT &&function) {
+    size_t offset = 0;
+    while (records.size() - offset >= sizeof(uint32_t)) {
+        uint32_t size = 0;
+        memcpy(&size, records.data() + offset, sizeof(size));
+        if (size == 0 || size > records.size() - offset - sizeof(size)) {
+            break; // Record cut by the crash
+        }
+        JournalReader record(records.data() + offset + sizeof(size), size);
+        function(record);
+        offset += sizeof(size) + size;
+    }
+    return offset;
+}
+
+std::vector<EditJournalFile> FindEditJournals() {
+    std::vector<EditJournalFile> journals;
+    if (!editJournal.enabled) {
+        return journals;
+    }
+    std::set<std::string> runningSessions;
+    std::set<std::string> crashedSessions;
+    for (const auto &fileName : TfListDir(editJournal.directory)) {
+        const std::string filePath = TfStringCatPaths(editJournal.directory, TfGetBaseName(fileName));
+        if (!TfStringEndsWith(filePath, JournalExtension) ||
+            TfStringStartsWith(TfGetBaseName(filePath), editJournal.sessionId + "_")) {
+            continue;
+        }
+        // The journals of the other running instances are still written
+        const std::string sessionId = GetJournalSessionId(filePath);
+        if (runningSessions.count(sessionId) || (!crashedSessions.count(sessionId) && IsSessionRunning(sessionId))) {
+            runningSessions.insert(sessionId);
+            continue;
+        }
+        crashedSessions.insert(sessionId);
+        JournalContent content;
+        if (!ReadJournalFile(filePath, content)) {
+            continue;
+        }
+        EditJournalFile journal;
+        journal.filePath = filePath;
+        journal.layerIdentifier = content.identifier;
+        journal.layerFileChanged = HasLayerFileChanged(content);
+        ForEachRecord(content.records, [&](JournalReader &) { journal.records++; });
+        journals.push_back(journal);
+    }
+    return journals;
+}
+
+// Apply a record with the state delegate of the layer, as the instructions do
+static bool ReplayRecord(const SdfLayerRefPtr &layer, JournalReader &record) {
+    const auto operation = static_cast<JournalOperation>(record.Pod<uint8_t>());
+    auto delegate = layer->GetStateDelegate();
+    if (!delegate || !record.IsValid()) {
+        return false;
+    }
+    SdfPath path;
+    TfToken fieldName;
+    VtValue value;
+    ReadItem(record, path);
+    switch (operation) {
+    case JournalOperation::SetField:
+        ReadItem(record, fieldName);
+        if (!ReadValue(record, value)) {
+            return false;
+        }
+        delegate->SetField(path, fieldName, value);
+        return true;
+    case JournalOperation::SetFieldDictValueByKey: {
+        TfToken keyPath;
+        ReadItem(record, fieldName);
+        ReadItem(record, keyPath);
+        if (!ReadValue(record, value)) {
+            return false;
+        }
+        delegate->SetFieldDictValueByKey(path, fieldName, keyPath, value);
+        return true;
+    }
+    case JournalOperation::SetTimeSample: {
+        const double time = record.Pod<double>();
+        if (!ReadValue(record, value)) {
+            return false;
+        }
+        delegate->SetTimeSample(path, time, value);
+        return true;
+    }
+    case JournalOperation::EraseTimeSample: {
+        const double time = record.Pod<double>();
+        if (!record.IsValid()) {
+            return false;
+        }
+        layer->EraseTimeSample(path, time);
+        return true;
+    }
+    case JournalOperation::CreateSpec: {
+        const auto specType = static_cast<SdfSpecType>(record.Pod<uint8_t>());
+        const bool inert = record.Pod<uint8_t>();
+        if (!record.IsValid()) {
+            return false;
+        }
+        delegate->CreateSpec(path, specType, inert);
+        return true;
+    }
+    case JournalOperation::DeleteSpec: {
+        const bool inert = record.Pod<uint8_t>();
+        if (!record.IsValid()) {
+            return false;
+        }
+        delegate->DeleteSpec(path, inert);
+        return true;
+    }
+    case JournalOperation::MoveSpec: {
+        SdfPath newPath;
+        ReadItem(record, newPath);
+        if (!record.IsValid()) {
+            return false;
+        }
+        delegate->MoveSpec(path, newPath);
+        return true;
+    }
+    case JournalOperation::PushChild:
+    case JournalOperation::PopChild:
+        ReadItem(record, fieldName);
+        if (!ReadValue(record, value)) {
+            return false;
+        }
+        if (value.IsHolding<TfToken>()) {
+            operation == JournalOperation::PushChild ? delegate->PushChild(path, fieldName, value.UncheckedGet<TfToken>())
+                                                     : delegate->PopChild(path, fieldName, value.UncheckedGet<TfToken>());
+        } else if (value.IsHolding<SdfPath>()) {
+            operation == JournalOperation::PushChild ? delegate->PushChild(path, fieldName, value.UncheckedGet<SdfPath>())
+                                                     : delegate->PopChild(path, fieldName, value.UncheckedGet<SdfPath>());
+        } else {
+            return false;
+        }
+        return true;
+    case JournalOperation::PatchArray: {
+        const bool isDefault = record.Pod<uint8_t>();
+        const double time = record.Pod<double>();
+        const uint64_t index = record.Pod<uint64_t>();
+        VtValue removedElements;
+        VtValue addedElements;
+        if (!ReadValue(record, removedElements) || !ReadValue(record, addedElements)) {
+            return false;
+        }
+        const VtArrayPatch patch = JournalArrayPatchTypes::Make(index, removedElements, addedElements);
+        VtValue array;
+        if (isDefault) {
+            array = layer->GetField(path, SdfFieldKeys->Default);
+        } else {
+            layer->QueryTimeSample(path, time, &array);
+        }
+        const VtValue patched = patch.Apply(array);
+        if (patched.IsEmpty()) {
+            return false;
+        }
+        isDefault ? delegate->SetField(path, SdfFieldKeys->Default, patched) : delegate->SetTimeSample(path, time, patched);
+        return true;
+    }
+    }
+    return false;
+}
+
+SdfLayerRefPtr RecoverEditJournal(const EditJournalFile &journalFile, std::string &message) {
+    JournalContent content;
+    if (!ReadJournalFile(journalFile.filePath, content)) {
+        message = "Unable to read the journal " + journalFile.filePath;
+        return {};
+    }
+    // Replaying the records on another content of the file could silently corrupt the layer
+    if (HasLayerFileChanged(content)) {
+        message = "The file of " + content.identifier + " was modified after the crash, its journal is not replayed";
+        return {};
+    }
+    SdfLayerRefPtr layer = SdfLayer::FindOrOpen(content.identifier);
+    if (!layer) {
+        message = "Unable to open the layer " + content.identifier;
+        return {};
+    }
+    size_t replayed = 0;
+    size_t skipped = 0;
+    size_t recordsSize = 0;
+    {
+        SdfChangeBlock block;
+        recordsSize = ForEachRecord(content.records, [&](JournalReader &record) {
+            ReplayRecord(layer, record) ? replayed++ : skipped++;
+        });
+    }
+
+    // The journal continues in a file of this session with the replayed records, a crash before the next save
+    // recovers them again
+    if (editJournal.enabled) {
+        std::lock_guard<std::mutex> lock(editJournal.mutex);
+        LayerJournal &journal = GetLayerJournal(get_pointer(layer));
+        journal.pending.append(content.records, 0, recordsSize);
+        journal.position += recordsSize;
+    }
+    TfDeleteFile(journalFile.filePath);
+    RemoveSessionLockIfUnused(GetJournalSessionId(journalFile.filePath));
+
+    message = TfStringPrintf("Replayed %zu edits on %s", replayed, layer->GetDisplayName().c_str());
+    if (skipped) {
+        message += TfStringPrintf(", %zu edits with unsupported values were skipped", skipped);
+    }
+    return layer;
+}
+
+void DiscardEditJournal(const EditJournalFile &journal) {
+    TfDeleteFile(journal.filePath);
+    RemoveSessionLockIfUnused(GetJournalSessionId(journal.filePath));
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <pxr/usd/sdf/layer.h>
+#include <pxr/usd/usd/timeCode.h>
+
+PXR_NAMESPACE_USING_DIRECTIVE
+
+///
+/// Append only journal of the edits, to recover the work after a crash without saving the layers.
+/// The instructions executed by the SdfCommandGroups are encoded in a compact binary form and appended to one journal
+/// per dirty layer. The records are written to the files every frame and the files are synced periodically.
+/// The journal of a layer is removed when the layer becomes clean, after a save or a reload.
+/// Each session holds a lock file while it runs, to tell the journals of the running instances from the crashed ones.
+/// The values are encoded for the types found in the layers, the records holding a value of another type are
+/// skipped when the journal is replayed. The sparse array edits are journaled as their patch, not as the whole array.
+/// The header keeps the size and modification time of the layer file, a journal is not replayed on a file modified
+/// after the crash.
+///
+
+/// Enable the journal, the files are written in directory. Called once at startup
+void InitializeEditJournal(const std::string &directory);
+
+/// Write the pending records, remove the journals of the clean layers and sync the files periodically.
+/// Called once per frame in the main loop
+void UpdateEditJournal();
+
+/// Remove all the journals of the session, called when the application exits normally
+void ShutdownEditJournal();
+
+/// Returns true if the edits of the layer are recorded. The anonymous layers can't be reopened after a crash, they
+/// are not journaled
+bool IsEditJournaled(const SdfLayer *layer);
+
+// Records of the edits, called when the instructions are executed
+void JournalSetField(const SdfLayer *layer, const SdfPath &path, const TfToken &fieldName, const VtValue &value);
+void JournalSetFieldDictValueByKey(const SdfLayer *layer, const SdfPath &path, const TfToken &fieldName, const TfToken &keyPath,
+                                   const VtValue &value);
+void JournalSetTimeSample(const SdfLayer *layer, const SdfPath &path, double time, const VtValue &value);
+void JournalEraseTimeSample(const SdfLayer *layer, const SdfPath &path, double time);
+void JournalCreateSpec(const SdfLayer *layer, const SdfPath &path, SdfSpecType specType, bool inert);
+void JournalDeleteSpec(const SdfLayer *layer, const SdfPath &path, bool inert);
+void JournalMoveSpec(const SdfLayer *layer, const SdfPath &oldPath, const SdfPath &newPath);
+void JournalPushChild(const SdfLayer *layer, const SdfPath &parentPath, const TfToken &fieldName, const VtValue &value);
+void JournalPopChild(const SdfLayer *layer, const SdfPath &parentPath, const TfToken &fieldName, const VtValue &value);
+/// Replace the elements [index, index + removedElements.size()) of the default value or time sample with addedElements
+void JournalPatchArray(const SdfLayer *layer, const SdfPath &path, UsdTimeCode timeCode, size_t index,
+                       const VtValue &removedElements, const VtValue &addedElements);
+
+/// Number of bytes recorded for the layer since the journal was created
+size_t GetEditJournalPosition(const SdfLayerHandle &layer);
+
+/// Remove the records before position, when they were written to the layer file by a save. The journal then refers
+/// to the saved file
+void TruncateEditJournal(const SdfLayerHandle &layer, size_t position);
+
+/// Journal left by a session which didn't exit normally
+struct EditJournalFile {
+    std::string filePath;
+    std::string layerIdentifier;
+    size_t records = 0;
+    bool layerFileChanged = false; // The layer file was modified after the crash, the journal can't be replayed
+};
+
+/// Find the journals left by the sessions which crashed, the journals of the other running instances are skipped
+std::vector<EditJournalFile> FindEditJournals();
+
+/// Replay the journal on its layer, opening the layer if needed. The layer is left dirty and the journal is kept for
+/// the new edits. Returns the layer, or an invalid layer if it can't be opened, the journal is not readable or the
+/// layer file was modified after the crash.
+/// message describes the result
+SdfLayerRefPtr RecoverEditJournal(const EditJournalFile &journal, std::string &message);
+
+/// Remove the journal file
+void DiscardEditJournal(const EditJournalFile &journal);
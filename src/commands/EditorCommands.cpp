@@ -12,6 +12,10 @@
 #include <pxr/usd/usdUtils/dependencies.h>
 #include <string>
 #include "WildcardsCompare.h"
+#include "UsdHelpers.h"
+#include "LayerSaveJob.h"
+#include "StageExportJobs.h"
+#include "CompositionEditor.h"
 
 #include "SdfUndoRedoRecorder.h"
 ///
@@ -92,6 +96,29 @@ struct EditorSelectAttributePath : public EditorCommand {
 };
 template void ExecuteAfterDraw<EditorSelectAttributePath>(SdfPath attributePath);
 
+/// Select a prim spec and show its compositions in the layer property editor, with the tab of the arc type selected
+struct EditorShowPrimCompositions : public EditorCommand {
+
+    EditorShowPrimCompositions(SdfLayerHandle layer, SdfPath primPath, PcpArcType arcType)
+        : _layer(layer), _primPath(primPath), _arcType(arcType) {}
+
+    ~EditorShowPrimCompositions() override {}
+
+    bool DoIt() override {
+        if (_editor && _layer) {
+            _editor->SetCurrentLayer(_layer);
+            _editor->SetLayerPathSelection(_primPath);
+            _editor->ShowPrimSpecEditor();
+            FocusPrimCompositions(_primPath, _arcType);
+        }
+        return false;
+    }
+    SdfLayerRefPtr _layer;
+    SdfPath _primPath;
+    PcpArcType _arcType;
+};
+template void ExecuteAfterDraw<EditorShowPrimCompositions>(SdfLayerHandle layer, SdfPath primPath, PcpArcType arcType);
+
 struct EditorOpenStage : public EditorCommand {
 
     EditorOpenStage(std::string stagePath) : _stagePath(std::move(stagePath)) {}
@@ -203,6 +230,22 @@ struct EditorFindOrOpenLayer : public EditorCommand {
 };
 template void ExecuteAfterDraw<EditorFindOrOpenLayer>(std::string layerPath);
 
+/// Save the layer in a background job, the editor stays responsive during the write
+struct EditorSaveLayer : public EditorCommand {
+
+    EditorSaveLayer(SdfLayerHandle layer) : _layer(layer) {}
+    EditorSaveLayer(SdfLayerRefPtr layer) : _layer(layer) {}
+    ~EditorSaveLayer() override {}
+
+    bool DoIt() override {
+        SaveLayerInBackground(_layer);
+        return false;
+    }
+    SdfLayerRefPtr _layer;
+};
+template void ExecuteAfterDraw<EditorSaveLayer>(SdfLayerHandle layer);
+template void ExecuteAfterDraw<EditorSaveLayer>(SdfLayerRefPtr layer);
+
 struct EditorSaveLayerAs : public EditorCommand {
 
     EditorSaveLayerAs(SdfLayerHandle layer) : _layer(layer) {}
@@ -331,28 +374,8 @@ struct EditorFindPrim : public EditorCommand {
             const auto &stage = _editor->GetCurrentStage();
             auto &selection = _editor->GetSelection();
             auto anchor = selection.GetAnchorPrimPath(stage);
-            SdfPath found;
-            bool selectedFound = false;
             // Traverse the stage and set the new selection
-            auto range = UsdPrimRange::Stage(stage, UsdTraverseInstanceProxies(UsdPrimAllPrimsPredicate));
-            for (auto iter = range.begin(); iter != range.end(); ++iter) {
-                if (iter->GetPath() == anchor) {
-                    selectedFound = true;
-                } else if (_matches(iter->GetName())) {
-                    // Store the first matching path in case we don't find the one
-                    // after the anchor
-                    if (found == SdfPath()) {
-                        found = iter->GetPath();
-                        // We don't have an anchor, so the first match is the correct one
-                        if (anchor == SdfPath())
-                            break;
-                    }
-                    if (selectedFound) {
-                        found = iter->GetPath();
-                        break;
-                    }
-                }
-            }
+            const SdfPath found = FindNextPrimMatching(stage, anchor, _matches);
             if (found != SdfPath()) {
                 selection.SetSelected(stage, found);
             }
@@ -367,18 +390,10 @@ template void ExecuteAfterDraw<EditorFindPrim>(const std::string, bool useRegex)
 struct EditorExportUsdz : public EditorCommand {
     EditorExportUsdz(const std::string destination, bool useArKit) : _destination(destination), _useArKit(useArKit) {}
     bool DoIt() override {
-        // UsdUtilsCreateNewUsdzPackage is making changes to the scene, we just undo them when it has finished.
-        SdfCommandGroup _undoCommands;
-        {
-            SdfAssetPath stageAssetPath(_editor->GetCurrentStage()->GetRootLayer()->GetRealPath());
-            SdfCommandGroupRecorder recorder(_undoCommands, _editor->GetCurrentStage()->GetUsedLayers());
-            if (_useArKit) {
-                UsdUtilsCreateNewARKitUsdzPackage(stageAssetPath, _destination);
-            } else {
-                UsdUtilsCreateNewUsdzPackage(stageAssetPath, _destination);
-            }
+        // The package is made from copies of the layers, the stage is not modified
+        if (_editor->GetCurrentStage()) {
+            LaunchBackgroundJob(std::make_unique<UsdzExportJob>(_editor->GetCurrentStage(), _destination, _useArKit));
         }
-        _undoCommands.UndoIt();
         return false; // Don't push this command on the undo/redo stack
     }
     
@@ -389,11 +404,15 @@ template void ExecuteAfterDraw<EditorExportUsdz>(const std::string, bool);
 
 
 struct EditorExportFlattenedStage : public EditorCommand {
-    EditorExportFlattenedStage(const std::string destination) : _destination(destination) {}
+    EditorExportFlattenedStage(const std::string destination, bool writeChunks)
+        : _destination(destination), _writeChunks(writeChunks) {}
     bool DoIt() override {
-        _editor->GetCurrentStage()->Flatten()->Export(_destination);
+        if (_editor->GetCurrentStage()) {
+            LaunchBackgroundJob(std::make_unique<FlattenExportJob>(_editor->GetCurrentStage(), _destination, _writeChunks));
+        }
         return false;
     }
     std::string _destination;
+    bool _writeChunks;
 };
-template void ExecuteAfterDraw<EditorExportFlattenedStage>(const std::string);
+template void ExecuteAfterDraw<EditorExportFlattenedStage>(const std::string, bool);
@@ -1,5 +1,6 @@
 
 
+#include <pxr/base/tf/mallocTag.h>
 #include <pxr/usd/sdf/attributeSpec.h>
 #include <pxr/usd/sdf/copyUtils.h>
 #include <pxr/usd/sdf/layer.h>
@@ -12,6 +13,7 @@
 #include <pxr/usd/sdf/variantSetSpec.h>
 #include <pxr/usd/sdf/variantSpec.h>
 #include "CommandsImpl.h"
+#include "MemoryPanel.h"
 #include "SdfUndoRedoRecorder.h"
 #include "UsdHelpers.h"
 
@@ -333,6 +335,7 @@ struct PrimCopy : public CopyPasteCommand {
     ~PrimCopy() override {}
     bool DoIt() override {
         if (_prim && _copyPasteLayer) {
+            TfAutoMallocTag2 tag(MallocTagEditor, MallocTagClipboard);
             SdfCommandGroupRecorder recorder(_undoCommands, _copyPasteLayer);
             // Ditch root prim
             const SdfPath CopiedPrimRoot = SdfPath::AbsoluteRootPath().AppendChild(GetCopyRoot());
@@ -401,6 +404,7 @@ struct PropertyCopy : public CopyPasteCommand {
     ~PropertyCopy() override {}
     bool DoIt() override {
         if (_prop && _copyPasteLayer) {
+            TfAutoMallocTag2 tag(MallocTagEditor, MallocTagClipboard);
             SdfCommandGroupRecorder recorder(_undoCommands, _copyPasteLayer);
             const SdfPath copiedPropertiesRoot = SdfPath::AbsoluteRootPath().AppendChild(GetCopyRoot());
             auto copiedPropertiesPrim = _copyPasteLayer->GetPrimAtPath(copiedPropertiesRoot);
@@ -1,47 +1,255 @@
+#include <algorithm>
 #include <memory>
-#include <iostream>
+#include <new>
+#include <type_traits>
+#include "EditJournal.h"
 #include "SdfCommandGroup.h"
 #include "SdfLayerInstructions.h"
 
+/// Size of the arena blocks, a block holds a few hundred instructions
+static constexpr size_t ArenaBlockSize = 64 * 1024;
 
+// Map the instruction types to their tag
+template <typename InstructionT> struct InstructionTypeOf;
+
+#define DeclareInstructionType(InstructionT, Tag)                                                                                \
+    template <> struct InstructionTypeOf<InstructionT> {                                                                         \
+        static constexpr SdfInstructionType type = SdfInstructionType::Tag;                                                      \
+    };
+
+DeclareInstructionType(UndoRedoSetField, SetField);
+DeclareInstructionType(UndoRedoSetFieldDictValueByKey, SetFieldDictValueByKey);
+DeclareInstructionType(UndoRedoSetTimeSample, SetTimeSample);
+DeclareInstructionType(UndoRedoPatchArray, PatchArray);
+DeclareInstructionType(UndoRedoCreateSpec, CreateSpec);
+DeclareInstructionType(UndoRedoDeleteSpec, DeleteSpec);
+DeclareInstructionType(UndoRedoMoveSpec, MoveSpec);
+DeclareInstructionType(UndoRedoPushChild<TfToken>, PushTokenChild);
+DeclareInstructionType(UndoRedoPushChild<SdfPath>, PushPathChild);
+DeclareInstructionType(UndoRedoPopChild<TfToken>, PopTokenChild);
+DeclareInstructionType(UndoRedoPopChild<SdfPath>, PopPathChild);
+
+/// Call function with the instruction cast to its concrete type. The calls are resolved at compile time,
+/// which lets the compiler inline DoIt and UndoIt in the replay loops
+template <typename FunctionT> static void VisitInstruction(SdfInstructionType type, void *instruction, FunctionT &&function) {
+    switch (type) {
+    case SdfInstructionType::SetField:
+        function(*static_cast<UndoRedoSetField *>(instruction));
+        break;
+    case SdfInstructionType::SetFieldDictValueByKey:
+        function(*static_cast<UndoRedoSetFieldDictValueByKey *>(instruction));
+        break;
+    case SdfInstructionType::SetTimeSample:
+        function(*static_cast<UndoRedoSetTimeSample *>(instruction));
+        break;
+    case SdfInstructionType::PatchArray:
+        function(*static_cast<UndoRedoPatchArray *>(instruction));
+        break;
+    case SdfInstructionType::CreateSpec:
+        function(*static_cast<UndoRedoCreateSpec *>(instruction));
+        break;
+    case SdfInstructionType::DeleteSpec:
+        function(*static_cast<UndoRedoDeleteSpec *>(instruction));
+        break;
+    case SdfInstructionType::MoveSpec:
+        function(*static_cast<UndoRedoMoveSpec *>(instruction));
+        break;
+    case SdfInstructionType::PushTokenChild:
+        function(*static_cast<UndoRedoPushChild<TfToken> *>(instruction));
+        break;
+    case SdfInstructionType::PushPathChild:
+        function(*static_cast<UndoRedoPushChild<SdfPath> *>(instruction));
+        break;
+    case SdfInstructionType::PopTokenChild:
+        function(*static_cast<UndoRedoPopChild<TfToken> *>(instruction));
+        break;
+    case SdfInstructionType::PopPathChild:
+        function(*static_cast<UndoRedoPopChild<SdfPath> *>(instruction));
+        break;
+    }
+}
+
+// Record the instructions in the edit journal, with the operation actually applied on the layer when
+// executed as a redo or as an undo
+static void JournalInstruction(const UndoRedoSetField &instruction, bool undo) {
+    JournalSetField(instruction._layer, instruction._path, instruction._fieldName,
+                    undo ? instruction._previousValue : instruction._newValue);
+}
+
+static void JournalInstruction(const UndoRedoSetFieldDictValueByKey &instruction, bool undo) {
+    JournalSetFieldDictValueByKey(instruction._layer, instruction._path, instruction._fieldName, instruction._keyPath,
+                                  undo ? instruction._previousValue : instruction._newValue);
+}
+
+static void JournalInstruction(const UndoRedoSetTimeSample &instruction, bool undo) {
+    if (!undo) {
+        JournalSetTimeSample(instruction._layer, instruction._path, instruction._timeCode, instruction._newValue);
+    } else if (instruction._hasTimeSamples && instruction._isKeyFrame) {
+        JournalSetTimeSample(instruction._layer, instruction._path, instruction._timeCode, instruction._previousValue);
+    } else if (instruction._hasTimeSamples) {
+        JournalEraseTimeSample(instruction._layer, instruction._path, instruction._timeCode);
+    } else {
+        JournalSetField(instruction._layer, instruction._path, SdfFieldKeys->TimeSamples, instruction._previousValue);
+    }
+}
+
+// Only the modified elements are journaled, an undo replaces the new elements with the old ones
+static void JournalInstruction(const UndoRedoPatchArray &instruction, bool undo) {
+    const VtArrayPatch &patch = instruction._patch;
+    if (patch.IsEmpty()) {
+        return;
+    }
+    JournalPatchArray(instruction._layer, instruction._path, instruction._timeCode, patch.GetIndex(),
+                      undo ? patch.GetNewElements() : patch.GetOldElements(),
+                      undo ? patch.GetOldElements() : patch.GetNewElements());
+}
+
+static void JournalInstruction(const UndoRedoCreateSpec &instruction, bool undo) {
+    if (undo) {
+        JournalDeleteSpec(instruction._layer, instruction._path, instruction._inert);
+    } else {
+        JournalCreateSpec(instruction._layer, instruction._path, instruction._specType, instruction._inert);
+    }
+}
+
+static void JournalInstruction(const UndoRedoDeleteSpec &instruction, bool undo) {
+    if (!undo) {
+        JournalDeleteSpec(instruction._layer, instruction._path, instruction._inert);
+        return;
+    }
+    if (!instruction._deletedSpecs || !IsEditJournaled(instruction._layer)) {
+        return;
+    }
+    // The snapshot is in post order, it is journaled in reverse to create the parents before their children
+    const auto &deletedSpecs = *instruction._deletedSpecs;
+    for (auto spec = deletedSpecs.rbegin(); spec != deletedSpecs.rend(); ++spec) {
+        JournalCreateSpec(instruction._layer, spec->path, spec->specType, spec->path == instruction._path && instruction._inert);
+        for (const auto &field : spec->fields) {
+            JournalSetField(instruction._layer, spec->path, field.first, field.second);
+        }
+    }
+}
+
+static void JournalInstruction(const UndoRedoMoveSpec &instruction, bool undo) {
+    if (undo) {
+        JournalMoveSpec(instruction._layer, instruction._newPath, instruction._oldPath);
+    } else {
+        JournalMoveSpec(instruction._layer, instruction._oldPath, instruction._newPath);
+    }
+}
+
+template <typename ValueT> static void JournalInstruction(const UndoRedoPushChild<ValueT> &instruction, bool undo) {
+    if (undo) {
+        JournalPopChild(instruction._layer, instruction._parentPath, instruction._fieldName, VtValue(instruction._value));
+    } else {
+        JournalPushChild(instruction._layer, instruction._parentPath, instruction._fieldName, VtValue(instruction._value));
+    }
+}
+
+template <typename ValueT> static void JournalInstruction(const UndoRedoPopChild<ValueT> &instruction, bool undo) {
+    if (undo) {
+        JournalPushChild(instruction._layer, instruction._parentPath, instruction._fieldName, VtValue(instruction._value));
+    } else {
+        JournalPopChild(instruction._layer, instruction._parentPath, instruction._fieldName, VtValue(instruction._value));
+    }
+}
+
+// The instructions are stored when the edit is made, except the array patches which are applied after being stored
+template <typename InstructionT> static void JournalStoredInstruction(const InstructionT &instruction) {
+    JournalInstruction(instruction, false);
+}
+
+static void JournalStoredInstruction(const UndoRedoPatchArray &) {}
+
+SdfCommandGroup::~SdfCommandGroup() { Clear(); }
 
 bool SdfCommandGroup::IsEmpty() const { return _instructions.empty(); }
 
-void SdfCommandGroup::Clear() { _instructions.clear(); }
+void SdfCommandGroup::Clear() {
+    for (auto &record : _instructions) {
+        VisitInstruction(record.type, record.instruction, [](auto &instruction) {
+            using InstructionT = std::decay_t<decltype(instruction)>;
+            instruction.~InstructionT();
+        });
+    }
+    _instructions.clear();
+    _blocks.clear();
+    _blockOffset = 0;
+    _blockSize = 0;
+    _layers.clear();
+}
+
+void *SdfCommandGroup::Allocate(size_t size, size_t alignment) {
+    size_t offset = (_blockOffset + alignment - 1) & ~(alignment - 1);
+    if (_blocks.empty() || offset + size > _blockSize) {
+        // Instructions bigger than a block get their own block
+        _blockSize = std::max(ArenaBlockSize, size + alignment);
+        _blocks.emplace_back(new char[_blockSize]);
+        const size_t misalignment = reinterpret_cast<uintptr_t>(_blocks.back().get()) & (alignment - 1);
+        offset = misalignment ? alignment - misalignment : 0;
+    }
+    _blockOffset = offset + size;
+    return _blocks.back().get() + offset;
+}
+
+void SdfCommandGroup::RetainLayer(SdfLayer *layer) {
+    // The instructions of a group are usually on one or two layers, the last one is checked first
+    if (!layer || (!_layers.empty() && get_pointer(_layers.back()) == layer)) {
+        return;
+    }
+    const auto found =
+        std::find_if(_layers.begin(), _layers.end(), [&](const SdfLayerRefPtr &retained) { return get_pointer(retained) == layer; });
+    if (found == _layers.end()) {
+        _layers.emplace_back(SdfLayerHandle(layer));
+    }
+}
 
 template <typename InstructionT>
-void SdfCommandGroup::StoreInstruction(InstructionT inst) {
+void SdfCommandGroup::StoreInstruction(InstructionT &&inst) {
     // TODO: specialize by InstructionT type to compact the instructions in the command,
     // typically we don't want to store thousand of setField instruction where only the last one matters
     // One optim would be to look for the previous instruction, check if it is a setfield on the same path, same layer ?
     // Update the latest instruction instead of inserting a new instruction
     // As StoreInstruction is templatized, it is possible to specialize it.
-    _instructions.emplace_back(std::move(inst));
+    // The allocations are tagged by the callers, the recorder callbacks and the commands storing their own instructions
+    using StoredT = std::decay_t<InstructionT>;
+    RetainLayer(inst._layer);
+    JournalStoredInstruction(inst);
+    void *instruction = Allocate(sizeof(StoredT), alignof(StoredT));
+    new (instruction) StoredT(std::move(inst));
+    _instructions.push_back({InstructionTypeOf<StoredT>::type, instruction});
 }
 
 
-template void SdfCommandGroup::StoreInstruction<UndoRedoSetField>(UndoRedoSetField inst);
-template void SdfCommandGroup::StoreInstruction<UndoRedoSetFieldDictValueByKey>(UndoRedoSetFieldDictValueByKey inst);
-template void SdfCommandGroup::StoreInstruction<UndoRedoSetTimeSample>(UndoRedoSetTimeSample inst);
-template void SdfCommandGroup::StoreInstruction<UndoRedoCreateSpec>(UndoRedoCreateSpec inst);
-template void SdfCommandGroup::StoreInstruction<UndoRedoDeleteSpec>(UndoRedoDeleteSpec inst);
-template void SdfCommandGroup::StoreInstruction<UndoRedoMoveSpec>(UndoRedoMoveSpec inst);
-template void SdfCommandGroup::StoreInstruction<UndoRedoPushChild<TfToken>>(UndoRedoPushChild<TfToken> inst);
-template void SdfCommandGroup::StoreInstruction<UndoRedoPushChild<SdfPath>>(UndoRedoPushChild<SdfPath> inst);
-template void SdfCommandGroup::StoreInstruction<UndoRedoPopChild<TfToken>>(UndoRedoPopChild<TfToken> inst);
-template void SdfCommandGroup::StoreInstruction<UndoRedoPopChild<SdfPath>>(UndoRedoPopChild<SdfPath> inst);
+template void SdfCommandGroup::StoreInstruction<UndoRedoSetField>(UndoRedoSetField &&inst);
+template void SdfCommandGroup::StoreInstruction<UndoRedoSetFieldDictValueByKey>(UndoRedoSetFieldDictValueByKey &&inst);
+template void SdfCommandGroup::StoreInstruction<UndoRedoSetTimeSample>(UndoRedoSetTimeSample &&inst);
+template void SdfCommandGroup::StoreInstruction<UndoRedoPatchArray>(UndoRedoPatchArray &&inst);
+template void SdfCommandGroup::StoreInstruction<UndoRedoCreateSpec>(UndoRedoCreateSpec &&inst);
+template void SdfCommandGroup::StoreInstruction<UndoRedoDeleteSpec>(UndoRedoDeleteSpec &&inst);
+template void SdfCommandGroup::StoreInstruction<UndoRedoMoveSpec>(UndoRedoMoveSpec &&inst);
+template void SdfCommandGroup::StoreInstruction<UndoRedoPushChild<TfToken>>(UndoRedoPushChild<TfToken> &&inst);
+template void SdfCommandGroup::StoreInstruction<UndoRedoPushChild<SdfPath>>(UndoRedoPushChild<SdfPath> &&inst);
+template void SdfCommandGroup::StoreInstruction<UndoRedoPopChild<TfToken>>(UndoRedoPopChild<TfToken> &&inst);
+template void SdfCommandGroup::StoreInstruction<UndoRedoPopChild<SdfPath>>(UndoRedoPopChild<SdfPath> &&inst);
 
 // Call all the functions stored in _commands in reverse order
 void SdfCommandGroup::UndoIt() {
     SdfChangeBlock block;
     for (auto cmd = _instructions.rbegin(); cmd != _instructions.rend(); ++cmd) {
-        cmd->UndoIt();
+        VisitInstruction(cmd->type, cmd->instruction, [](auto &instruction) {
+            instruction.UndoIt();
+            JournalInstruction(instruction, true);
+        });
     }
 }
 
 void SdfCommandGroup::DoIt() {
     SdfChangeBlock block;
     for (auto &cmd : _instructions) {
-        cmd.DoIt();
+        VisitInstruction(cmd.type, cmd.instruction, [](auto &instruction) {
+            instruction.DoIt();
+            JournalInstruction(instruction, false);
+        });
     }
 }
@@ -1,63 +1,44 @@
 #pragma once
-#include <vector>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
-#include <memory>
 #include <iostream>
-
-
-class InstructionWrapper {
-public:
-
-    template <typename InstructionT>
-    InstructionWrapper(InstructionT &&instruction) :
-        _ref(std::make_unique<Storage<InstructionT>>(std::move(instruction))) {
-        _ref->ShowIt();
-    }
-
-    void DoIt() {
-        _ref->DoIt();
-    }
-
-    void UndoIt() {
-        _ref->UndoIt();
-    }
-
-    void ShowIt() {
-        _ref->ShowIt();
-    }
-
-    struct Interface {
-        virtual ~Interface() = default;
-        virtual void DoIt() = 0;
-        virtual void UndoIt() = 0;
-        virtual void ShowIt() = 0;
-    };
-
-    template <typename InstructionT>
-    struct Storage : Interface {
-        Storage(InstructionT &&inst) : _data(std::move(inst)) {
-        }
-        virtual ~Storage(){}
-        void DoIt () override {
-            _data.DoIt();
-        }
-        void UndoIt () override {
-            _data.UndoIt();
-        }
-
-        void ShowIt() override { }
-
-        InstructionT _data;
-    };
-
-    std::unique_ptr<Interface> _ref;
+#include <memory>
+#include <vector>
+#include <pxr/usd/sdf/layer.h>
+
+PXR_NAMESPACE_USING_DIRECTIVE
+
+/// Type tag of the instructions stored in a SdfCommandGroup, the list of types is closed and defined
+/// with the instructions in SdfLayerInstructions.h
+enum class SdfInstructionType : uint8_t {
+    SetField,
+    SetFieldDictValueByKey,
+    SetTimeSample,
+    PatchArray,
+    CreateSpec,
+    DeleteSpec,
+    MoveSpec,
+    PushTokenChild,
+    PushPathChild,
+    PopTokenChild,
+    PopPathChild,
 };
 
+///
+/// Recorded Sdf instructions, replayed in order with DoIt and in reverse order with UndoIt.
+/// The instructions are constructed contiguously in an arena of fixed size blocks, and are replayed with a switch on
+/// their type tag instead of a virtual call. They only keep a raw pointer to their layer, the group holds one
+/// reference per layer for all its instructions.
+///
 class SdfCommandGroup {
 
 public:
     SdfCommandGroup() = default;
-    ~SdfCommandGroup() = default;
+    ~SdfCommandGroup();
+
+    SdfCommandGroup(const SdfCommandGroup &) = delete;
+    SdfCommandGroup &operator=(const SdfCommandGroup &) = delete;
 
     /// Was it recorded
     bool IsEmpty() const;
@@ -68,10 +49,20 @@ public:
     void UndoIt();
 
     template <typename InstructionT>
-    void StoreInstruction(InstructionT);
+    void StoreInstruction(InstructionT &&);
 
 private:
-    std::vector<InstructionWrapper> _instructions;
-};
+    struct InstructionRecord {
+        SdfInstructionType type;
+        void *instruction;
+    };
 
+    void *Allocate(size_t size, size_t alignment);
+    void RetainLayer(SdfLayer *layer);
 
+    std::vector<InstructionRecord> _instructions;
+    std::vector<std::unique_ptr<char[]>> _blocks;
+    size_t _blockOffset = 0;
+    size_t _blockSize = 0;
+    std::vector<SdfLayerRefPtr> _layers;
+};
@@ -3,34 +3,24 @@
 #include <pxr/usd/sdf/abstractData.h>
 #include "SdfLayerInstructions.h"
 
-static void _CopySpec(const SdfAbstractData &src, SdfAbstractData *dst, const SdfPath &path) {
-    if (!dst) {
-        std::cerr << "ERROR: when copying the destination prim is null at path " << path.GetString() << std::endl;
-        return;
-    }
-    dst->CreateSpec(path, src.GetSpecType(path));
-    const TfTokenVector &fields = src.List(path);
-    TF_FOR_ALL(i, fields) { dst->Set(path, *i, src.Get(path, *i)); }
-}
-
-UndoRedoDeleteSpec::_SpecCopier::_SpecCopier(SdfAbstractData *dst_) : dst(dst_) {}
-
-bool UndoRedoDeleteSpec::_SpecCopier::VisitSpec(const SdfAbstractData &src, const SdfPath &path) {
-    _CopySpec(src, dst, path);
-    return true;
-}
-
-void UndoRedoDeleteSpec::_SpecCopier::Done(const SdfAbstractData &) {}
-
 UndoRedoDeleteSpec::UndoRedoDeleteSpec(SdfLayerHandle layer, const SdfPath &path, bool inert, SdfAbstractDataPtr layerData)
-    : _layer(layer), _path(path), _inert(inert), _deletedSpecType(_layer->GetSpecType(path)), _layerData(layerData) {
-    // TODO: is there a faster way of copying and restoring the data ?
-    // This can be really slow on big scenes
-    SdfChangeBlock changeBlock;
-    _deletedData = TfCreateRefPtr(new SdfData());
-    SdfLayer::TraversalFunction copyFunc = std::bind(&_CopySpec, std::cref(*get_pointer(_layerData)),
-                                                     get_pointer(_deletedData), std::placeholders::_1);
-    _layer->Traverse(path, copyFunc);
+    : _layer(get_pointer(layer)), _path(path), _inert(inert), _deletedSpecType(_layer->GetSpecType(path)), _layerData(layerData) {
+    // This is a copy of all the fields of the subtree, there is no way to detach the specs from the layer data without
+    // copying them
+    const SdfAbstractData &layerData = *get_pointer(_layerData);
+    auto deletedSpecs = std::make_shared<DeletedSpecs>();
+    _layer->Traverse(path, [&](const SdfPath &specPath) {
+        deletedSpecs->emplace_back();
+        DeletedSpec &deletedSpec = deletedSpecs->back();
+        deletedSpec.path = specPath;
+        deletedSpec.specType = layerData.GetSpecType(specPath);
+        const TfTokenVector fields = layerData.List(specPath);
+        deletedSpec.fields.reserve(fields.size());
+        for (const auto &field : fields) {
+            deletedSpec.fields.emplace_back(field, layerData.Get(specPath, field));
+        }
+    });
+    _deletedSpecs = std::move(deletedSpecs);
 }
 
 
@@ -43,8 +33,16 @@ void UndoRedoDeleteSpec::DoIt() {
 void UndoRedoDeleteSpec::UndoIt() {
     if (_layer && _layer->GetStateDelegate()) {
         SdfChangeBlock changeBlock;
-        _SpecCopier copier(get_pointer(_layerData));
         _layer->GetStateDelegate()->CreateSpec(_path, _deletedSpecType, _inert);
-        _deletedData->VisitSpecs(&copier);
+        // The descendants are restored directly in the layer data, the change notification is sent for the root spec
+        SdfAbstractData *layerData = get_pointer(_layerData);
+        for (const auto &deletedSpec : *_deletedSpecs) {
+            if (!layerData->HasSpec(deletedSpec.path)) {
+                layerData->CreateSpec(deletedSpec.path, deletedSpec.specType);
+            }
+            for (const auto &field : deletedSpec.fields) {
+                layerData->Set(deletedSpec.path, field.first, field.second);
+            }
+        }
     }
 }
@@ -1,15 +1,20 @@
 #pragma once
 #include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
 #include <pxr/usd/sdf/abstractData.h>
 #include <pxr/usd/sdf/layer.h>
 #include <pxr/usd/sdf/path.h>
 #include <pxr/usd/sdf/layerStateDelegate.h>
+#include <pxr/usd/usd/timeCode.h>
+#include "VtArrayPatch.h"
 
 PXR_NAMESPACE_USING_DIRECTIVE
 
 struct UndoRedoSetField {
     UndoRedoSetField(SdfLayerHandle layer, const SdfPath& path, const TfToken& fieldName, VtValue newValue, VtValue previousValue )
-        : _layer(layer), _path(path), _fieldName(fieldName), _newValue(std::move(newValue)), _previousValue(std::move(previousValue)) {}
+        : _layer(get_pointer(layer)), _path(path), _fieldName(fieldName), _newValue(std::move(newValue)), _previousValue(std::move(previousValue)) {}
 
     UndoRedoSetField(UndoRedoSetField &&) = default;
     ~UndoRedoSetField() = default;
@@ -26,7 +31,7 @@ struct UndoRedoSetField {
         }
     }
 
-    SdfLayerRefPtr _layer;
+    SdfLayer *_layer; // Kept alive by the SdfCommandGroup
     const SdfPath _path;
     const TfToken _fieldName;
     VtValue _newValue;
@@ -36,7 +41,7 @@ struct UndoRedoSetField {
 
 struct UndoRedoSetFieldDictValueByKey {
     UndoRedoSetFieldDictValueByKey(SdfLayerHandle layer, const SdfPath &path, const TfToken& fieldName, const TfToken& keyPath, VtValue value, VtValue previousValue)
-        :_layer(layer), _path(path), _fieldName(fieldName), _keyPath(keyPath), _newValue(std::move(value)), _previousValue(previousValue) {}
+        :_layer(get_pointer(layer)), _path(path), _fieldName(fieldName), _keyPath(keyPath), _newValue(std::move(value)), _previousValue(previousValue) {}
 
     UndoRedoSetFieldDictValueByKey(UndoRedoSetFieldDictValueByKey &&) = default;
     ~UndoRedoSetFieldDictValueByKey() = default;
@@ -53,7 +58,7 @@ struct UndoRedoSetFieldDictValueByKey {
         }
     }
 
-    SdfLayerRefPtr _layer;
+    SdfLayer *_layer; // Kept alive by the SdfCommandGroup
     const SdfPath _path;
     const TfToken _fieldName;
     const TfToken _keyPath;
@@ -64,7 +69,7 @@ struct UndoRedoSetFieldDictValueByKey {
 
 struct UndoRedoSetTimeSample {
     UndoRedoSetTimeSample(SdfLayerHandle layer, const SdfPath &path, double timeCode, VtValue newValue)
-        : _layer(layer), _path(path), _timeCode(timeCode), _newValue(std::move(newValue)), _isKeyFrame(false),
+        : _layer(get_pointer(layer)), _path(path), _timeCode(timeCode), _newValue(std::move(newValue)), _isKeyFrame(false),
           _hasTimeSamples(false) {
 
         if (_layer && _layer->HasField(path, SdfFieldKeys->TimeSamples)) {
@@ -96,7 +101,7 @@ struct UndoRedoSetTimeSample {
     }
 
     // TODO: look for reducing the size of this struct
-    SdfLayerRefPtr _layer;
+    SdfLayer *_layer; // Kept alive by the SdfCommandGroup
     const SdfPath _path;
     double _timeCode;
     VtValue _newValue;
@@ -106,9 +111,49 @@ struct UndoRedoSetTimeSample {
 };
 
 
+/// Sparse edit of an array default value or time sample. Only the modified elements are kept for undo/redo,
+/// instead of the previous and new arrays stored by UndoRedoSetField
+struct UndoRedoPatchArray {
+    UndoRedoPatchArray(SdfLayerHandle layer, const SdfPath &path, UsdTimeCode timeCode, VtArrayPatch patch)
+        : _layer(get_pointer(layer)), _path(path), _timeCode(timeCode), _patch(std::move(patch)) {}
+    ~UndoRedoPatchArray() = default;
+    UndoRedoPatchArray(UndoRedoPatchArray &&) = default;
+
+    void DoIt() { Apply(false); }
+
+    void UndoIt() { Apply(true); }
+
+    void Apply(bool revert) {
+        if (!_layer || !_layer->GetStateDelegate()) {
+            return;
+        }
+        VtValue value;
+        if (_timeCode.IsDefault()) {
+            value = _layer->GetField(_path, SdfFieldKeys->Default);
+        } else {
+            _layer->QueryTimeSample(_path, _timeCode.GetValue(), &value);
+        }
+        const VtValue patched = _patch.Apply(value, revert);
+        if (patched.IsEmpty()) {
+            return;
+        }
+        if (_timeCode.IsDefault()) {
+            _layer->GetStateDelegate()->SetField(_path, SdfFieldKeys->Default, patched);
+        } else {
+            _layer->GetStateDelegate()->SetTimeSample(_path, _timeCode.GetValue(), patched);
+        }
+    }
+
+    SdfLayer *_layer; // Kept alive by the SdfCommandGroup
+    const SdfPath _path;
+    const UsdTimeCode _timeCode;
+    VtArrayPatch _patch;
+};
+
+
 struct UndoRedoCreateSpec {
     UndoRedoCreateSpec(SdfLayerHandle layer, const SdfPath& path, SdfSpecType specType, bool inert)
-        : _layer(layer), _path(path), _specType(specType), _inert(inert) {}
+        : _layer(get_pointer(layer)), _path(path), _specType(specType), _inert(inert) {}
 
     void DoIt() {
         if (_layer && _layer->GetStateDelegate()) {
@@ -122,44 +167,46 @@ struct UndoRedoCreateSpec {
         }
     }
 
-    SdfLayerRefPtr _layer;
+    SdfLayer *_layer; // Kept alive by the SdfCommandGroup
     const SdfPath _path;
     const SdfSpecType _specType;
     const bool _inert;
 };
 
 
+/// Deletion of a spec and its descendants. The constructor copies every field of the subtree in a flat snapshot, so
+/// the cost of the deletion is proportional to the number of fields, and undo writes the fields back one by one.
+/// The arrays of an in memory layer share their buffer with the snapshot (VtArray is copy on write), the arrays of a
+/// layer read from a crate file are unpacked when copied.
+/// The snapshot is immutable once taken and shared by the copies of the instruction, it is not copied again on redo
 struct UndoRedoDeleteSpec {
 
-    // Need a structure to copy the old data
-    struct _SpecCopier : public SdfAbstractDataSpecVisitor {
-        explicit _SpecCopier(SdfAbstractData* dst_);
-        bool VisitSpec(const SdfAbstractData& src, const SdfPath& path) override;
-        void Done(const SdfAbstractData&) override;
-
-        SdfAbstractData* const dst;
+    struct DeletedSpec {
+        SdfPath path;
+        SdfSpecType specType;
+        std::vector<std::pair<TfToken, VtValue>> fields;
     };
-
+    using DeletedSpecs = std::vector<DeletedSpec>;
 
     UndoRedoDeleteSpec(SdfLayerHandle layer, const SdfPath &path, bool inert, SdfAbstractDataPtr layerData);
 
     void DoIt();
     void UndoIt();
 
-    SdfLayerRefPtr _layer;
+    SdfLayer *_layer; // Kept alive by the SdfCommandGroup
     const SdfPath _path;
     const bool _inert;
 
     SdfAbstractDataPtr _layerData; // TODO: this might change ? isn't it ? normally it's retrieved from the delegate
     const SdfSpecType _deletedSpecType;
-    SdfDataRefPtr _deletedData;
+    std::shared_ptr<const DeletedSpecs> _deletedSpecs;
 };
 
 
 struct UndoRedoMoveSpec {
 
     UndoRedoMoveSpec(SdfLayerHandle layer, const SdfPath &oldPath, const SdfPath &newPath)
-    : _layer(layer), _oldPath(oldPath), _newPath(newPath) {}
+    : _layer(get_pointer(layer)), _oldPath(oldPath), _newPath(newPath) {}
 
 
     void DoIt() {
@@ -174,7 +221,7 @@ struct UndoRedoMoveSpec {
         }
     };
 
-    SdfLayerRefPtr _layer;
+    SdfLayer *_layer; // Kept alive by the SdfCommandGroup
     const SdfPath _oldPath;
     const SdfPath _newPath;
 };
@@ -182,7 +229,7 @@ struct UndoRedoMoveSpec {
 template <typename ValueT>
 struct UndoRedoPushChild {
     UndoRedoPushChild(SdfLayerHandle layer, const SdfPath& parentPath, const TfToken& fieldName, const ValueT& value)
-        : _layer(layer), _parentPath(parentPath), _fieldName(fieldName), _value(value) {}
+        : _layer(get_pointer(layer)), _parentPath(parentPath), _fieldName(fieldName), _value(value) {}
 
 
     void UndoIt() {
@@ -197,7 +244,7 @@ struct UndoRedoPushChild {
         }
     }
 
-    SdfLayerRefPtr _layer;
+    SdfLayer *_layer; // Kept alive by the SdfCommandGroup
     const SdfPath _parentPath;
     const TfToken _fieldName;
     const ValueT _value;
@@ -206,7 +253,7 @@ struct UndoRedoPushChild {
 template <typename ValueT>
 struct UndoRedoPopChild {
     UndoRedoPopChild(SdfLayerHandle layer, const SdfPath& parentPath, const TfToken& fieldName, const ValueT& value)
-        : _layer(layer), _parentPath(parentPath), _fieldName(fieldName), _value(value) {}
+        : _layer(get_pointer(layer)), _parentPath(parentPath), _fieldName(fieldName), _value(value) {}
 
 
     void UndoIt() {
@@ -221,7 +268,7 @@ struct UndoRedoPopChild {
         }
     }
 
-    SdfLayerRefPtr _layer;
+    SdfLayer *_layer; // Kept alive by the SdfCommandGroup
     const SdfPath _parentPath;
     const TfToken _fieldName;
     const ValueT _value;
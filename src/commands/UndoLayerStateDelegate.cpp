@@ -1,9 +1,11 @@
 #include <iostream>
 #include <pxr/usd/sdf/path.h>
 #include <pxr/usd/sdf/abstractData.h>
+#include <pxr/base/tf/mallocTag.h>
 #include "UndoLayerStateDelegate.h"
 #include "SdfCommandGroupRecorder.h"
 #include "SdfLayerInstructions.h"
+#include "MemoryPanel.h"
 
 ///
 /// UndoRedoLayerStateDelegate is a delegate used to record Undo functions.
@@ -88,6 +90,8 @@ UndoRedoLayerStateDelegate::_OnSetField(
     const TfToken& fieldName,
     const VtValue& value)
 {
+    // The previous values and the instructions are the allocations of the undo stack
+    TfAutoMallocTag2 tag(MallocTagEditor, MallocTagUndoStack);
     SetDirty();
     const VtValue previousValue = _layer->GetField(path, fieldName);
     const VtValue newValue = value;
@@ -100,6 +104,7 @@ UndoRedoLayerStateDelegate::_OnSetField(
     const TfToken& fieldName,
     const SdfAbstractDataConstValue& value)
 {
+    TfAutoMallocTag2 tag(MallocTagEditor, MallocTagUndoStack);
     SetDirty();
     const VtValue previousValue = _layer->GetField(path, fieldName);
     VtValue newValue;
@@ -114,6 +119,7 @@ UndoRedoLayerStateDelegate::_OnSetFieldDictValueByKey(
     const TfToken& keyPath,
     const VtValue& value)
 {
+    TfAutoMallocTag2 tag(MallocTagEditor, MallocTagUndoStack);
     SetDirty();
     const VtValue previousValue = _layer->GetFieldDictValueByKey(path, fieldName, keyPath); // TODO should the instruction retrieve the value instead ?
     const VtValue newValue = value;
@@ -127,6 +133,7 @@ UndoRedoLayerStateDelegate::_OnSetFieldDictValueByKey(
     const TfToken& keyPath,
     const SdfAbstractDataConstValue& value)
 {
+    TfAutoMallocTag2 tag(MallocTagEditor, MallocTagUndoStack);
     SetDirty();
     const VtValue previousValue = _layer->GetFieldDictValueByKey(path, fieldName, keyPath);
 
@@ -141,6 +148,7 @@ UndoRedoLayerStateDelegate::_OnSetTimeSample(
     double timeCode,
     const VtValue& value)
 {
+    TfAutoMallocTag2 tag(MallocTagEditor, MallocTagUndoStack);
     SetDirty();
     _undoCommands.StoreInstruction<UndoRedoSetTimeSample>({_layer, path, timeCode, value});
 }
@@ -151,6 +159,7 @@ UndoRedoLayerStateDelegate::_OnSetTimeSample(
     double timeCode,
     const SdfAbstractDataConstValue& value)
 {
+    TfAutoMallocTag2 tag(MallocTagEditor, MallocTagUndoStack);
     SetDirty();
     VtValue newValue;
     value.GetValue(&newValue);
@@ -164,6 +173,7 @@ UndoRedoLayerStateDelegate::_OnCreateSpec(
     SdfSpecType specType,
     bool inert)
 {
+    TfAutoMallocTag2 tag(MallocTagEditor, MallocTagUndoStack);
     SetDirty();
     _undoCommands.StoreInstruction<UndoRedoCreateSpec>({_layer, path, specType, inert});
 }
@@ -173,6 +183,7 @@ UndoRedoLayerStateDelegate::_OnDeleteSpec(
     const SdfPath& path,
     bool inert)
 {
+    TfAutoMallocTag2 tag(MallocTagEditor, MallocTagUndoStack);
     SetDirty();
 
     _undoCommands.StoreInstruction<UndoRedoDeleteSpec>({_layer, path,  inert, _GetLayerData()});
@@ -184,6 +195,7 @@ UndoRedoLayerStateDelegate::_OnMoveSpec(
     const SdfPath& oldPath,
     const SdfPath& newPath)
 {
+    TfAutoMallocTag2 tag(MallocTagEditor, MallocTagUndoStack);
     SetDirty();
     _undoCommands.StoreInstruction<UndoRedoMoveSpec>({_layer, oldPath, newPath});
 }
@@ -194,6 +206,7 @@ UndoRedoLayerStateDelegate::_OnPushChild(
     const TfToken& fieldName,
     const TfToken& value)
 {
+    TfAutoMallocTag2 tag(MallocTagEditor, MallocTagUndoStack);
     SetDirty();
     _undoCommands.StoreInstruction<UndoRedoPushChild<TfToken>>({_layer, parentPath, fieldName, value});
 }
@@ -204,6 +217,7 @@ UndoRedoLayerStateDelegate::_OnPushChild(
     const TfToken& fieldName,
     const SdfPath& value)
 {
+    TfAutoMallocTag2 tag(MallocTagEditor, MallocTagUndoStack);
     SetDirty();
     _undoCommands.StoreInstruction<UndoRedoPushChild<SdfPath>>({_layer, parentPath, fieldName, value});
 }
@@ -214,6 +228,7 @@ UndoRedoLayerStateDelegate::_OnPopChild(
     const TfToken& fieldName,
     const TfToken& oldValue)
 {
+    TfAutoMallocTag2 tag(MallocTagEditor, MallocTagUndoStack);
     SetDirty();
     _undoCommands.StoreInstruction<UndoRedoPopChild<TfToken>>({_layer, parentPath, fieldName, oldValue});
 }
@@ -224,6 +239,7 @@ UndoRedoLayerStateDelegate::_OnPopChild(
     const TfToken& fieldName,
     const SdfPath& oldValue)
 {
+    TfAutoMallocTag2 tag(MallocTagEditor, MallocTagUndoStack);
     SetDirty();
     _undoCommands.StoreInstruction<UndoRedoPopChild<SdfPath>>({_layer, parentPath, fieldName, oldValue});
 }
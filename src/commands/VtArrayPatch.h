@@ -0,0 +1,67 @@
+#pragma once
+
+#include <algorithm>
+#include <pxr/base/vt/array.h>
+#include <pxr/base/vt/value.h>
+
+PXR_NAMESPACE_USING_DIRECTIVE
+
+///
+/// Sparse modification of a VtArray.
+/// A patch replaces the elements [index, index + oldElements.size()) with newElements, this covers editing
+/// a range of elements, inserting (no old elements) and erasing (no new elements). Only the modified elements are
+/// stored, so the patch can be applied and reverted without keeping copies of the full array.
+///
+struct VtArrayPatch {
+
+    VtArrayPatch() = default;
+
+    template <typename ValueT>
+    VtArrayPatch(size_t index, VtArray<ValueT> oldElements, VtArray<ValueT> newElements)
+        : _index(index), _oldElements(VtValue::Take(oldElements)), _newElements(VtValue::Take(newElements)),
+          _apply(&ApplyTyped<ValueT>) {}
+
+    bool IsEmpty() const { return _apply == nullptr; }
+
+    size_t GetIndex() const { return _index; }
+
+    /// Elements replaced by the patch and elements replacing them, as VtArrays held in VtValues
+    const VtValue &GetOldElements() const { return _oldElements; }
+    const VtValue &GetNewElements() const { return _newElements; }
+
+    /// Returns a copy of the array with the patch applied, or reverted when revert is true.
+    /// The copy shares the buffer of the original array until the first modified element, so the array is copied
+    /// at most once. Returns an empty VtValue if the patch doesn't apply to the array.
+    VtValue Apply(const VtValue &array, bool revert = false) const {
+        return _apply ? _apply(*this, array, revert) : VtValue();
+    }
+
+  private:
+    template <typename ValueT> static VtValue ApplyTyped(const VtArrayPatch &patch, const VtValue &value, bool revert) {
+        if (!value.IsHolding<VtArray<ValueT>>()) {
+            return VtValue();
+        }
+        VtArray<ValueT> array = value.UncheckedGet<VtArray<ValueT>>();
+        const VtArray<ValueT> &removed = (revert ? patch._newElements : patch._oldElements).UncheckedGet<VtArray<ValueT>>();
+        const VtArray<ValueT> &added = (revert ? patch._oldElements : patch._newElements).UncheckedGet<VtArray<ValueT>>();
+        const size_t index = patch._index;
+        const size_t arraySize = array.size();
+        if (index + removed.size() > arraySize) {
+            return VtValue();
+        }
+        // Resize only when the number of elements changes, then copy the new elements in place
+        if (added.size() > removed.size()) {
+            array.resize(arraySize + added.size() - removed.size());
+            std::move_backward(array.begin() + index + removed.size(), array.begin() + arraySize, array.end());
+        } else if (added.size() < removed.size()) {
+            array.erase(array.begin() + index + added.size(), array.begin() + index + removed.size());
+        }
+        std::copy(added.cbegin(), added.cend(), array.begin() + index);
+        return VtValue::Take(array);
+    }
+
+    size_t _index = 0;
+    VtValue _oldElements;
+    VtValue _newElements;
+    VtValue (*_apply)(const VtArrayPatch &, const VtValue &, bool) = nullptr;
+};
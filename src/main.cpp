@@ -8,6 +8,8 @@
 #include <pxr/base/plug/registry.h>
 #include <pxr/base/arch/env.h>
 #include <pxr/base/arch/systemInfo.h>
+#include <pxr/base/tf/pathUtils.h>
+#include <pxr/base/tf/stringUtils.h>
 #include <pxr/imaging/glf/contextCaps.h>
 #include <pxr/imaging/glf/simpleLight.h>
 #include <pxr/imaging/glf/diagnostic.h>
@@ -15,9 +17,13 @@
 #include "Viewport.h"
 #include "Commands.h"
 #include "Constants.h"
+#include "EditJournal.h"
 #include "ResourcesLoader.h"
 #include "CommandLineOptions.h"
 #include "Gui.h"
+#include "TraceViewer.h"
+#include "MemoryPanel.h"
+#include "Timeline.h"
 
 #ifdef _WIN64
 #include<process.h>
@@ -58,6 +64,11 @@ int main(int argc, char *const *argv) {
 
     CommandLineOptions options(argc, argv);
 
+    // The malloc tags must be initialized before the allocations we want to track
+    if (options.mallocTags()) {
+        InitializeMallocTags();
+    }
+
     // ResourceLoader will load the settings/fonts/textures and create an imgui context
     ResourcesLoader loader;
 
@@ -138,6 +149,9 @@ int main(int argc, char *const *argv) {
     ImGui::SetCurrentContext(hydraUIContext);
     ImGui_ImplOpenGL3_Init();
 
+    // Journal of the edits for the crash recovery, stored next to the settings file
+    InitializeEditJournal(TfStringCatPaths(TfGetPathName(GetConfigFilePath()), ".usdtweak_journal"));
+
     { // we use a scope as the editor should be deleted before imgui and glfw, to release correctly the memory
         ImGui::SetCurrentContext(mainUIContext);
         Editor editor;
@@ -172,6 +186,8 @@ int main(int argc, char *const *argv) {
             ImGui_ImplGlfw_NewFrame();
             ImGui::NewFrame();
             editor.Draw();
+            // The stage is not edited until the commands are executed, the timeline reads its keys meanwhile
+            StartTimelineTasks();
             ImGui::Render();
             ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
@@ -186,10 +202,18 @@ int main(int argc, char *const *argv) {
             glFinish();
 
             // Process edition commands
+            StopTimelineTasks();
             ExecuteCommands();
+            UpdateEditJournal();
+
+            // Collect the trace events of the frame when tracing is enabled
+            EndTraceViewerFrame();
+            UpdateMemoryPanel();
         }
         editor.RemoveCallbacks(window);
     }
+    // The editor exited normally, the unsaved edits were discarded by the user
+    ShutdownEditJournal();
     ImGui::DestroyContext(hydraUIContext);
 
     // Shutdown imgui
@@ -1,6 +1,9 @@
 #pragma once
 #include "EditorSettings.h"
 
+// Path of the ini file storing the settings
+std::string GetConfigFilePath();
+
 // Load fonts, ini settings, texture and initialise an imgui context.
  class ResourcesLoader {
   public:
@@ -0,0 +1,159 @@
+///
+/// usdtweak_playblast_test: renders a playblast of a small stage in a hidden window and checks the images are written.
+/// It is meant to run headless with a software GL driver, for example:
+///
+/// LIBGL_ALWAYS_SOFTWARE=1 xvfb-run -a usdtweak_playblast_test
+///
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pxr/base/tf/stringUtils.h>
+#include <pxr/imaging/garch/glApi.h>
+#include <pxr/imaging/glf/contextCaps.h>
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usd/usdGeom/camera.h>
+#include <pxr/usd/usdGeom/cube.h>
+#include <pxr/usd/usdGeom/xformCommonAPI.h>
+
+#include "BackgroundJobs.h"
+#include "Gui.h"
+#include "Playblast.h"
+
+#if defined(__cplusplus) && __cplusplus >= 201703L && defined(__has_include) && __has_include(<filesystem>)
+#include <filesystem>
+namespace fs = std::filesystem;
+#else
+#define GHC_WITH_EXCEPTIONS 0
+#include <ghc/filesystem.hpp>
+namespace fs = ghc::filesystem;
+#endif
+
+PXR_NAMESPACE_USING_DIRECTIVE
+
+namespace clk = std::chrono;
+
+static UsdStageRefPtr CreateTestStage() {
+    UsdStageRefPtr stage = UsdStage::CreateInMemory();
+    stage->SetStartTimeCode(1);
+    stage->SetEndTimeCode(4);
+    UsdGeomCube cube = UsdGeomCube::Define(stage, SdfPath("/World/Cube"));
+    for (int frame = 1; frame <= 4; ++frame) {
+        UsdGeomXformCommonAPI(cube).SetRotate(GfVec3f(0.f, 20.f * frame, 0.f), UsdGeomXformCommonAPI::RotationOrderXYZ,
+                                              UsdTimeCode(frame));
+    }
+    UsdGeomCamera camera = UsdGeomCamera::Define(stage, SdfPath("/World/Camera"));
+    UsdGeomXformCommonAPI(camera).SetTranslate(GfVec3d(0.0, 0.0, 10.0));
+    return stage;
+}
+
+/// Step the jobs like the editor does, once per frame, until they have all finished or the timeout is reached
+static bool WaitForBackgroundJobs(double timeoutSeconds) {
+    const auto start = clk::steady_clock::now();
+    while (HasRunningBackgroundJobs()) {
+        if (clk::duration<double>(clk::steady_clock::now() - start).count() > timeoutSeconds) {
+            return false;
+        }
+        UpdateBackgroundJobs();
+        std::this_thread::sleep_for(clk::milliseconds(1));
+    }
+    return true;
+}
+
+static bool TestPlayblastWritesFrames(UsdStageRefPtr stage, const fs::path &directory) {
+    std::vector<UsdTimeCode> frames;
+    std::vector<std::string> outputFiles;
+    for (int frame = 1; frame <= 4; ++frame) {
+        frames.emplace_back(frame);
+        outputFiles.push_back((directory / TfStringPrintf("playblast.%d.png", frame)).string());
+    }
+    auto job = std::make_unique<PlayblastJob>(stage, SdfPath("/World/Camera"), frames, outputFiles, 64);
+    BackgroundJob *playblast = job.get();
+    LaunchBackgroundJob(std::move(job));
+    if (!WaitForBackgroundJobs(120.0)) {
+        std::cerr << "playblast did not finish: " << playblast->GetStatus() << std::endl;
+        return false;
+    }
+    bool success = playblast->GetProgress() == 1.f;
+    for (const auto &outputFile : outputFiles) {
+        if (!fs::exists(fs::path(outputFile)) || fs::file_size(fs::path(outputFile)) == 0) {
+            std::cerr << "missing image " << outputFile << std::endl;
+            success = false;
+        }
+    }
+    if (!success) {
+        std::cerr << "playblast failed: " << playblast->GetStatus() << std::endl;
+    }
+    return success;
+}
+
+static bool TestPlayblastCancel(UsdStageRefPtr stage, const fs::path &directory) {
+    std::vector<UsdTimeCode> frames;
+    std::vector<std::string> outputFiles;
+    for (int frame = 1; frame <= 100; ++frame) {
+        frames.emplace_back(frame);
+        outputFiles.push_back((directory / TfStringPrintf("cancelled.%d.png", frame)).string());
+    }
+    LaunchBackgroundJob(std::make_unique<PlayblastJob>(stage, SdfPath("/World/Camera"), frames, outputFiles, 64));
+    UpdateBackgroundJobs();
+    UpdateBackgroundJobs();
+    // Same path as the editor exiting with a running playblast: the job is cancelled and destroyed with the context alive
+    ShutdownBackgroundJobs();
+    if (HasRunningBackgroundJobs()) {
+        std::cerr << "the jobs are still running after shutdown" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    if (!glfwInit()) {
+        std::cerr << "unable to initialize glfw" << std::endl;
+        return 1;
+    }
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#else
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_COMPAT_PROFILE);
+#endif
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow *window = glfwCreateWindow(64, 64, "usdtweak_playblast_test", nullptr, nullptr);
+    if (!window) {
+        std::cerr << "unable to create a GL context" << std::endl;
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    GarchGLApiLoad();
+    GlfContextCaps::InitInstance();
+    std::cout << glGetString(GL_RENDERER) << std::endl;
+
+    const fs::path directory = fs::temp_directory_path() / "usdtweak_playblast_test";
+    fs::remove_all(directory);
+    fs::create_directories(directory);
+
+    bool success = true;
+    {
+        UsdStageRefPtr stage = CreateTestStage();
+        if (!TestPlayblastWritesFrames(stage, directory)) {
+            success = false;
+        }
+        if (!TestPlayblastCancel(stage, directory)) {
+            success = false;
+        }
+        ShutdownBackgroundJobs();
+    }
+    fs::remove_all(directory);
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+
+    std::cout << (success ? "playblast test passed" : "playblast test failed") << std::endl;
+    return success ? 0 : 1;
+}
@@ -0,0 +1,327 @@
+#include <algorithm>
+#include <array>
+#include <pxr/base/gf/bbox3d.h>
+#include <pxr/base/gf/vec4d.h>
+#include <pxr/usd/kind/registry.h>
+#include <pxr/usd/sdf/attributeSpec.h>
+#include <pxr/usd/sdf/changeBlock.h>
+#include <pxr/usd/sdf/layer.h>
+#include <pxr/usd/sdf/listOp.h>
+#include <pxr/usd/sdf/primSpec.h>
+#include <pxr/usd/usd/modelAPI.h>
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usd/tokens.h>
+#include <pxr/usd/usdGeom/bboxCache.h>
+#include <pxr/usd/usdGeom/imageable.h>
+#include <pxr/usd/usdGeom/modelAPI.h>
+#include <pxr/usd/usdGeom/tokens.h>
+
+#include "DrawModeLod.h"
+#include "Gui.h"
+#include "ImGuiHelpers.h"
+#include "Constants.h"
+
+static const std::array<TfToken, 2> LodDrawModes = {UsdGeomTokens->bounds, UsdGeomTokens->cards};
+static const std::array<TfToken, 3> LodKinds = {KindTokens->component, KindTokens->group, KindTokens->assembly};
+
+// Models are switched back to their own draw mode when they are this much bigger than the threshold,
+// it avoids flickering between the two modes when a model size is close to the threshold
+static constexpr double LodHysteresis = 1.5;
+
+// Schema name of UsdGeomModelAPI, it has to be applied for the draw mode to be taken into account
+static const TfToken GeomModelAPIName("GeomModelAPI");
+
+DrawModeLod::DrawModeLod() : _bboxCache(UsdTimeCode::Default(), UsdGeomImageable::GetOrderedPurposeTokens(), true) {}
+
+DrawModeLod::~DrawModeLod() {
+    // The overrides would stay in the session layer otherwise
+    Clear();
+    TfNotice::Revoke(_objectsChangedKey);
+}
+
+void DrawModeLod::OnObjectsChanged(const UsdNotice::ObjectsChanged &notice, const UsdStageWeakPtr &sender) {
+    // The resynced prims are recomposed, even by our own changes, the cached bounds refer to the previous ones
+    if (!notice.GetResyncedPaths().empty()) {
+        _bboxCache.Clear();
+    }
+    if (_authoring) {
+        return; // We are the source of the change
+    }
+    for (const auto &path : notice.GetResyncedPaths()) {
+        if (path.IsPrimPath() || path.IsAbsoluteRootPath()) {
+            _modelsAreDirty = true;
+            return;
+        }
+    }
+    // A change on the extents or on the transforms will change the size of the models
+    _bboxCache.Clear();
+    _needsEvaluation = true;
+}
+
+void DrawModeLod::CollectModels() {
+    _models.clear();
+    if (!_stage) {
+        return;
+    }
+    const TfToken &lodKind = LodKinds[_kindIndex];
+    UsdPrimRange range = _stage->Traverse();
+    for (auto it = range.begin(); it != range.end(); ++it) {
+        // Models can only live under other models, the rest of the hierarchy is skipped
+        if (!it->IsModel()) {
+            it.PruneChildren();
+            continue;
+        }
+        TfToken kind;
+        UsdModelAPI(*it).GetKind(&kind);
+        if (KindRegistry::IsA(kind, lodKind)) {
+            _models.push_back(it->GetPath());
+            it.PruneChildren();
+        }
+    }
+    _modelsAreDirty = false;
+    _needsEvaluation = true;
+}
+
+static void PrependModelAPI(const SdfLayerHandle &layer, const SdfPath &modelPath) {
+    if (!SdfCreatePrimInLayer(layer, modelPath)) {
+        return;
+    }
+    SdfTokenListOp apiSchemas = layer->GetFieldAs<SdfTokenListOp>(modelPath, UsdTokens->apiSchemas);
+    SdfTokenListOp::ItemVector prepended = apiSchemas.GetPrependedItems();
+    if (std::find(prepended.begin(), prepended.end(), GeomModelAPIName) == prepended.end()) {
+        prepended.push_back(GeomModelAPIName);
+        apiSchemas.SetPrependedItems(prepended);
+        layer->SetField(modelPath, UsdTokens->apiSchemas, apiSchemas);
+    }
+}
+
+static void RemoveModelAPI(const SdfLayerHandle &layer, const SdfPath &modelPath) {
+    if (!layer->HasField(modelPath, UsdTokens->apiSchemas)) {
+        return;
+    }
+    SdfTokenListOp apiSchemas = layer->GetFieldAs<SdfTokenListOp>(modelPath, UsdTokens->apiSchemas);
+    SdfTokenListOp::ItemVector prepended = apiSchemas.GetPrependedItems();
+    prepended.erase(std::remove(prepended.begin(), prepended.end(), GeomModelAPIName), prepended.end());
+    apiSchemas.SetPrependedItems(prepended);
+    if (apiSchemas.HasKeys()) {
+        layer->SetField(modelPath, UsdTokens->apiSchemas, apiSchemas);
+    } else {
+        layer->EraseField(modelPath, UsdTokens->apiSchemas);
+    }
+}
+
+/// Remove the overs created for the model and its parents if they are empty
+static void RemoveInertOvers(const SdfLayerHandle &layer, const SdfPath &modelPath) {
+    for (SdfPath path = modelPath; path != SdfPath::AbsoluteRootPath(); path = path.GetParentPath()) {
+        SdfPrimSpecHandle spec = layer->GetPrimAtPath(path);
+        if (!spec || !layer->RemovePrimIfInert(spec)) {
+            break;
+        }
+    }
+}
+
+void DrawModeLod::ApplyModelAPI() {
+    SdfLayerHandle sessionLayer = _stage->GetSessionLayer();
+    if (!sessionLayer) {
+        return;
+    }
+    SdfPathVector missing;
+    for (const auto &modelPath : _models) {
+        if (_modelAPIs.count(modelPath)) {
+            continue;
+        }
+        const UsdPrim prim = _stage->GetPrimAtPath(modelPath);
+        if (prim && !prim.HasAPI<UsdGeomModelAPI>()) {
+            missing.push_back(modelPath);
+        }
+    }
+    if (missing.empty()) {
+        return;
+    }
+    _authoring = true;
+    {
+        SdfChangeBlock block;
+        for (const auto &modelPath : missing) {
+            PrependModelAPI(sessionLayer, modelPath);
+            _modelAPIs.insert(modelPath);
+        }
+    }
+    _authoring = false;
+}
+
+/// Returns the height or width in pixels, whichever is bigger, of the bounding box projected on screen.
+/// Returns a negative value when the box crosses the camera plane, the model is then considered close.
+static double ComputeScreenSize(const GfBBox3d &bbox, const GfMatrix4d &viewProjection, const GfVec2i &viewportSize) {
+    const GfRange3d box = bbox.ComputeAlignedRange();
+    if (box.IsEmpty()) {
+        return -1.0;
+    }
+    GfRange2d screenRange;
+    for (int corner = 0; corner < 8; ++corner) {
+        const GfVec3d point = box.GetCorner(corner);
+        const GfVec4d clip = GfVec4d(point[0], point[1], point[2], 1.0) * viewProjection;
+        if (clip[3] <= 0.0) {
+            return -1.0;
+        }
+        screenRange.UnionWith(GfVec2d(clip[0] / clip[3], clip[1] / clip[3]));
+    }
+    const GfVec2d ndcSize = screenRange.GetSize();
+    return std::max(ndcSize[0] * 0.5 * viewportSize[0], ndcSize[1] * 0.5 * viewportSize[1]);
+}
+
+void DrawModeLod::Update(const UsdStageRefPtr &stage, const GfCamera &camera, UsdTimeCode tc, const GfVec2i &viewportSize) {
+    if (_stage != stage) {
+        Clear();
+        TfNotice::Revoke(_objectsChangedKey);
+        _stage = stage;
+        _modelsAreDirty = true;
+        _bboxCache.Clear();
+        if (_stage) {
+            TfWeakPtr<DrawModeLod> me(this);
+            _objectsChangedKey = TfNotice::Register(me, &DrawModeLod::OnObjectsChanged, _stage);
+        }
+    }
+    if (!_enabled || !_stage) {
+        Clear();
+        return;
+    }
+    if (_modelsAreDirty) {
+        CollectModels();
+        ApplyModelAPI();
+    }
+
+    const GfFrustum frustum = camera.GetFrustum();
+    const GfMatrix4d viewProjection = frustum.ComputeViewMatrix() * frustum.ComputeProjectionMatrix();
+    if (!_needsEvaluation && viewProjection == _lastViewProjection && tc == _lastTimeCode &&
+        viewportSize == _lastViewportSize) {
+        return;
+    }
+    _lastViewProjection = viewProjection;
+    _lastTimeCode = tc;
+    _lastViewportSize = viewportSize;
+    _needsEvaluation = false;
+
+    // The models are evaluated at the top level of the lod kind, the world bounds are kept in the cache until
+    // the time or the stage changes
+    _bboxCache.SetTime(tc);
+    const TfToken &drawMode = LodDrawModes[_drawModeIndex];
+    SdfPathVector toOverride;
+    SdfPathVector toRevert;
+    for (const auto &modelPath : _models) {
+        const UsdPrim prim = _stage->GetPrimAtPath(modelPath);
+        if (!prim) {
+            continue;
+        }
+        const double screenSize = ComputeScreenSize(_bboxCache.ComputeWorldBound(prim), viewProjection, viewportSize);
+        const auto overrideIt = _overrides.find(modelPath);
+        const bool isOverridden = overrideIt != _overrides.end();
+        if (screenSize >= 0.0 && screenSize < _pixelThreshold) {
+            if (!isOverridden || overrideIt->second != drawMode) {
+                toOverride.push_back(modelPath);
+            }
+        } else if (isOverridden && (screenSize < 0.0 || screenSize > _pixelThreshold * LodHysteresis)) {
+            toRevert.push_back(modelPath);
+        }
+    }
+    if (!toOverride.empty() || !toRevert.empty()) {
+        AuthorOverrides(toOverride, toRevert);
+    }
+}
+
+static void RemoveOverride(const SdfLayerHandle &layer, const SdfPath &modelPath) {
+    SdfPrimSpecHandle primSpec = layer->GetPrimAtPath(modelPath);
+    if (!primSpec) {
+        return;
+    }
+    for (const auto &attributeName : {UsdGeomTokens->modelDrawMode, UsdGeomTokens->modelApplyDrawMode}) {
+        if (SdfAttributeSpecHandle attribute = layer->GetAttributeAtPath(modelPath.AppendProperty(attributeName))) {
+            primSpec->RemoveProperty(attribute);
+        }
+    }
+    RemoveInertOvers(layer, modelPath);
+}
+
+static void AuthorOverride(const SdfLayerHandle &layer, const SdfPath &modelPath, const TfToken &drawMode) {
+    if (!SdfCreatePrimInLayer(layer, modelPath)) {
+        return;
+    }
+    const SdfPath drawModePath = modelPath.AppendProperty(UsdGeomTokens->modelDrawMode);
+    const SdfPath applyDrawModePath = modelPath.AppendProperty(UsdGeomTokens->modelApplyDrawMode);
+    SdfJustCreatePrimAttributeInLayer(layer, drawModePath, SdfValueTypeNames->Token, SdfVariabilityUniform);
+    SdfJustCreatePrimAttributeInLayer(layer, applyDrawModePath, SdfValueTypeNames->Bool, SdfVariabilityUniform);
+    layer->SetField(drawModePath, SdfFieldKeys->Default, VtValue(drawMode));
+    layer->SetField(applyDrawModePath, SdfFieldKeys->Default, VtValue(true));
+}
+
+void DrawModeLod::AuthorOverrides(const SdfPathVector &toOverride, const SdfPathVector &toRevert) {
+    SdfLayerHandle sessionLayer = _stage->GetSessionLayer();
+    if (!sessionLayer) {
+        return;
+    }
+    const TfToken &drawMode = LodDrawModes[_drawModeIndex];
+    _authoring = true;
+    {
+        SdfChangeBlock block;
+        for (const auto &path : toRevert) {
+            RemoveOverride(sessionLayer, path);
+            _overrides.erase(path);
+        }
+        for (const auto &path : toOverride) {
+            // Don't overwrite a draw mode set by the user in the session layer
+            if (_overrides.find(path) == _overrides.end() &&
+                sessionLayer->HasSpec(path.AppendProperty(UsdGeomTokens->modelDrawMode))) {
+                continue;
+            }
+            AuthorOverride(sessionLayer, path, drawMode);
+            _overrides[path] = drawMode;
+        }
+    }
+    _authoring = false;
+}
+
+void DrawModeLod::Clear() {
+    SdfLayerHandle sessionLayer = _stage ? _stage->GetSessionLayer() : SdfLayerHandle();
+    if ((_overrides.empty() && _modelAPIs.empty()) || !sessionLayer) {
+        _overrides.clear();
+        _modelAPIs.clear();
+        return;
+    }
+    _authoring = true;
+    {
+        SdfChangeBlock block;
+        for (const auto &overridden : _overrides) {
+            RemoveOverride(sessionLayer, overridden.first);
+        }
+        for (const auto &modelPath : _modelAPIs) {
+            RemoveModelAPI(sessionLayer, modelPath);
+            RemoveInertOvers(sessionLayer, modelPath);
+        }
+    }
+    _authoring = false;
+    _overrides.clear();
+    _modelAPIs.clear();
+    // The schemas are applied again on the next update
+    _modelsAreDirty = true;
+    _needsEvaluation = true;
+}
+
+void DrawModeLod::DrawSettings() {
+    ScopedStyleColor defaultStyle(DefaultColorStyle);
+    if (ImGui::BeginMenu("Draw mode LOD")) {
+        ImGui::Checkbox("Enable", &_enabled);
+        ImGui::BeginDisabled(!_enabled);
+        if (ImGui::SliderFloat("Pixel threshold", &_pixelThreshold, 1.f, 256.f, "%.0f")) {
+            _needsEvaluation = true;
+        }
+        if (ImGui::Combo("Draw mode", &_drawModeIndex, "bounds\0cards\0")) {
+            _needsEvaluation = true;
+        }
+        if (ImGui::Combo("Kind", &_kindIndex, "component\0group\0assembly\0")) {
+            Clear();
+            _modelsAreDirty = true;
+        }
+        ImGui::Text("%zu/%zu models simplified", _overrides.size(), _models.size());
+        ImGui::EndDisabled();
+        ImGui::EndMenu();
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <unordered_map>
+#include <unordered_set>
+#include <pxr/base/gf/camera.h>
+#include <pxr/base/gf/matrix4d.h>
+#include <pxr/base/tf/notice.h>
+#include <pxr/base/tf/weakBase.h>
+#include <pxr/usd/sdf/path.h>
+#include <pxr/usd/usd/notice.h>
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usd/usdGeom/bboxCache.h>
+
+PXR_NAMESPACE_USING_DIRECTIVE
+
+/// DrawModeLod switches the models covering only a few pixels on screen to a simplified draw mode
+/// (bounds or cards). The overrides are authored on the session layer of the stage, outside of the
+/// edit target and without going through the undo stack, and they are removed when the models
+/// get bigger on screen or when the feature is disabled.
+/// GeomModelAPI is applied once on the models which don't have it, so switching the draw mode only
+/// changes attributes and doesn't recompose the models.
+class DrawModeLod : public TfWeakBase {
+  public:
+    DrawModeLod();
+    ~DrawModeLod();
+
+    DrawModeLod(const DrawModeLod &) = delete;
+    DrawModeLod &operator=(const DrawModeLod &) = delete;
+
+    /// Called once per frame by the viewport, it computes the screen size of the models and
+    /// updates the session layer overrides
+    void Update(const UsdStageRefPtr &stage, const GfCamera &camera, UsdTimeCode tc, const GfVec2i &viewportSize);
+
+    /// Remove all the overrides and the applied schemas authored on the stage
+    void Clear();
+
+    /// UI
+    void DrawSettings();
+
+    bool IsEnabled() const { return _enabled; }
+
+  private:
+    /// Find the models of the chosen kind
+    void CollectModels();
+    /// Apply GeomModelAPI on the models missing it, in a single change
+    void ApplyModelAPI();
+    void OnObjectsChanged(const UsdNotice::ObjectsChanged &notice, const UsdStageWeakPtr &sender);
+
+    void AuthorOverrides(const SdfPathVector &toOverride, const SdfPathVector &toRevert);
+
+    // Settings
+    bool _enabled = false;
+    float _pixelThreshold = 24.f;
+    int _drawModeIndex = 0; // bounds, cards
+    int _kindIndex = 0;     // component, group, assembly
+
+    // Models candidates, computed once per stage and recomputed when the hierarchy changes
+    UsdStageWeakPtr _stage;
+    SdfPathVector _models;
+    bool _modelsAreDirty = true;
+    TfNotice::Key _objectsChangedKey;
+    bool _authoring = false; // true when the overrides are being written, to ignore our own notices
+
+    // The draw mode authored on the session layer, per model path
+    std::unordered_map<SdfPath, TfToken, SdfPath::Hash> _overrides;
+    // The models on which GeomModelAPI was applied in the session layer
+    std::unordered_set<SdfPath, SdfPath::Hash> _modelAPIs;
+
+    // World bounds of the models, cleared when the stage changes
+    UsdGeomBBoxCache _bboxCache;
+
+    // Last state used for the evaluation, we don't recompute if nothing has moved
+    GfMatrix4d _lastViewProjection;
+    UsdTimeCode _lastTimeCode;
+    GfVec2i _lastViewportSize;
+    bool _needsEvaluation = true;
+};
@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <cmath>
+#include <pxr/base/work/loops.h>
+#include <pxr/usd/usd/primRange.h>
+
+#include "Playback.h"
+#include "Gui.h"
+#include "ImGuiHelpers.h"
+#include "Constants.h"
+
+namespace clk = std::chrono;
+
+Playback::~Playback() {
+    WaitForPrefetch();
+    TfNotice::Revoke(_objectsChangedKey);
+}
+
+void Playback::OnObjectsChanged(const UsdNotice::ObjectsChanged &notice, const UsdStageWeakPtr &sender) {
+    // The attribute queries cache the value resolution and must be recreated when the composition changes.
+    // The prefetch is not running, the notices are sent by the edits
+    for (const auto &path : notice.GetResyncedPaths()) {
+        _resyncedPaths.push_back(path.GetPrimPath());
+    }
+}
+
+void Playback::Start(const UsdStageRefPtr &stage) {
+    _playing = true;
+    _lastFrameTime = clk::steady_clock::now();
+    _statsStartTime = _lastFrameTime;
+    _statsFrameCount = 0;
+    _achievedFramesPerSecond = 0.0;
+    _droppedFrames = 0;
+    _prefetchedUntil = stage ? stage->GetStartTimeCode() - 1.0 : 0.0;
+}
+
+void Playback::Stop() {
+    WaitForPrefetch();
+    _playing = false;
+}
+
+void Playback::WaitForPrefetch() {
+    if (_prefetchTask.valid()) {
+        _prefetchTask.wait();
+        _prefetchTask = std::future<void>();
+    }
+}
+
+void Playback::CollectAnimatedAttributes(const UsdStageRefPtr &stage) {
+    WaitForPrefetch();
+    if (_stage != stage) {
+        TfNotice::Revoke(_objectsChangedKey);
+        _stage = stage;
+        if (_stage) {
+            TfWeakPtr<Playback> me(this);
+            _objectsChangedKey = TfNotice::Register(me, &Playback::OnObjectsChanged, _stage);
+        }
+        _animatedAttributesAreDirty = true;
+    }
+    if (_animatedAttributesAreDirty) {
+        _animatedAttributes.clear();
+        _resyncedPaths.clear();
+        CollectAnimatedAttributes(stage, SdfPath::AbsoluteRootPath());
+        _animatedAttributesAreDirty = false;
+    } else {
+        // Only the resynced subtrees are traversed again, the paths under another resynced path are skipped
+        std::sort(_resyncedPaths.begin(), _resyncedPaths.end());
+        SdfPath previous;
+        for (const auto &path : _resyncedPaths) {
+            if (previous.IsEmpty() || !path.HasPrefix(previous)) {
+                CollectAnimatedAttributes(stage, path);
+                previous = path;
+            }
+        }
+        _resyncedPaths.clear();
+    }
+    _prefetchedAttributes.clear();
+    for (const auto &prim : _animatedAttributes) {
+        for (const auto &attribute : prim.second) {
+            _prefetchedAttributes.push_back(&attribute);
+        }
+    }
+}
+
+void Playback::CollectAnimatedAttributes(const UsdStageRefPtr &stage, const SdfPath &path) {
+    // The descendants of a path follow it in the map
+    auto it = _animatedAttributes.lower_bound(path);
+    while (it != _animatedAttributes.end() && it->first.HasPrefix(path)) {
+        it = _animatedAttributes.erase(it);
+    }
+    const UsdPrim root = stage ? stage->GetPrimAtPath(path) : UsdPrim();
+    if (!root) {
+        return;
+    }
+    for (const auto &prim : UsdPrimRange(root)) {
+        std::vector<UsdAttributeQuery> queries;
+        for (const auto &attribute : prim.GetAttributes()) {
+            if (attribute.ValueMightBeTimeVarying()) {
+                queries.emplace_back(attribute);
+            }
+        }
+        if (!queries.empty()) {
+            _animatedAttributes[prim.GetPath()] = std::move(queries);
+        }
+    }
+}
+
+UsdTimeCode Playback::Advance(const UsdStageRefPtr &stage, UsdTimeCode current) {
+    if (!_playing || !stage) {
+        return current;
+    }
+    if (_stage != stage || _animatedAttributesAreDirty || !_resyncedPaths.empty()) {
+        CollectAnimatedAttributes(stage);
+    }
+
+    const auto now = clk::steady_clock::now();
+    const double startFrame = stage->GetStartTimeCode();
+    const double endFrame = stage->GetEndTimeCode();
+    _targetFramesPerSecond = stage->GetTimeCodesPerSecond();
+
+    double newFrame = current.GetValue();
+    if (_mode == RealTime) {
+        const auto timeDifference = clk::duration<double>(now - _lastFrameTime);
+        newFrame += _targetFramesPerSecond * timeDifference.count();
+        const double skipped = std::floor(newFrame) - std::floor(current.GetValue()) - 1.0;
+        if (skipped > 0.0) {
+            _droppedFrames += static_cast<size_t>(skipped);
+        }
+    } else {
+        newFrame = std::floor(newFrame) + 1.0;
+    }
+    if (newFrame > endFrame || newFrame < startFrame) {
+        newFrame = startFrame;
+        _prefetchedUntil = startFrame - 1.0;
+    }
+    const double frameStep = std::max(1.0, std::round(newFrame - current.GetValue()));
+    _lastFrameTime = now;
+
+    // Statistics
+    _statsFrameCount++;
+    const double statsDuration = clk::duration<double>(now - _statsStartTime).count();
+    if (statsDuration >= 1.0) {
+        _achievedFramesPerSecond = _statsFrameCount / statsDuration;
+        _statsFrameCount = 0;
+        _statsStartTime = now;
+    }
+
+    _prefetchFrame = newFrame;
+    _prefetchStep = frameStep;
+    _prefetchPending = true;
+    return UsdTimeCode(newFrame);
+}
+
+void Playback::StartPrefetch(const UsdStageRefPtr &stage) {
+    if (_prefetchPending && _playing && stage && _stage == stage) {
+        LaunchPrefetch(stage, _prefetchFrame, _prefetchStep);
+    }
+    _prefetchPending = false;
+}
+
+void Playback::LaunchPrefetch(const UsdStageRefPtr &stage, double currentFrame, double frameStep) {
+    if (_prefetchedAttributes.empty() || _prefetchTask.valid()) {
+        return;
+    }
+    // List the frames not yet prefetched in the window following the current frame, wrapping at the end of the range
+    const double startFrame = stage->GetStartTimeCode();
+    const double endFrame = stage->GetEndTimeCode();
+    std::vector<UsdTimeCode> frames;
+    for (int i = 1; i <= _prefetchFrames; ++i) {
+        double frame = std::floor(currentFrame) + i * frameStep;
+        if (frame > endFrame) {
+            frame = startFrame + (frame - endFrame - 1.0);
+        }
+        if (frame > _prefetchedUntil || frame < currentFrame) {
+            frames.emplace_back(frame);
+        }
+    }
+    if (frames.empty()) {
+        return;
+    }
+    _prefetchedUntil = std::max(_prefetchedUntil, frames.back().GetValue());
+
+    const std::vector<const UsdAttributeQuery *> &attributes = _prefetchedAttributes;
+    _prefetchTask = std::async(std::launch::async, [&attributes, frames]() {
+        WorkParallelForN(attributes.size(), [&](size_t begin, size_t end) {
+            VtValue value;
+            for (size_t i = begin; i < end; ++i) {
+                for (const auto &frame : frames) {
+                    attributes[i]->Get(&value, frame);
+                }
+            }
+        });
+    });
+}
+
+void Playback::DrawSettings() {
+    ScopedStyleColor defaultStyle(DefaultColorStyle);
+    int mode = static_cast<int>(_mode);
+    if (ImGui::Combo("Playback mode", &mode, "Real time\0Every frame\0")) {
+        _mode = static_cast<Mode>(mode);
+    }
+    ImGui::SliderInt("Prefetched frames", &_prefetchFrames, 0, 24);
+    ImGui::Text("%.1f / %.1f fps", _achievedFramesPerSecond, _targetFramesPerSecond);
+    if (_mode == RealTime) {
+        ImGui::Text("%zu dropped frames", _droppedFrames);
+    }
+    ImGui::Text("%zu animated attributes", _prefetchedAttributes.size());
+}
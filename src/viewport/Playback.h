@@ -0,0 +1,89 @@
+#pragma once
+
+#include <chrono>
+#include <future>
+#include <map>
+#include <vector>
+#include <pxr/base/tf/notice.h>
+#include <pxr/base/tf/weakBase.h>
+#include <pxr/usd/usd/attributeQuery.h>
+#include <pxr/usd/usd/notice.h>
+#include <pxr/usd/usd/stage.h>
+
+PXR_NAMESPACE_USING_DIRECTIVE
+
+/// Playback advances the time of the viewport and prefetches the values of the animated attributes
+/// for the upcoming frames on worker threads, so the crate data is already read and the value
+/// resolution cached when hydra asks for it.
+/// The prefetch runs while hydra renders the current frame: the viewport starts it once all its own edits of the
+/// frame are done, right before the render, and waits for it at the end of the render, before the stage is edited.
+class Playback : public TfWeakBase {
+  public:
+    enum Mode { RealTime = 0, EveryFrame };
+
+    Playback() = default;
+    ~Playback();
+
+    Playback(const Playback &) = delete;
+    Playback &operator=(const Playback &) = delete;
+
+    void Start(const UsdStageRefPtr &stage);
+    void Stop();
+    bool IsPlaying() const { return _playing; }
+
+    /// Returns the next time code to display, the prefetch of the following frames is started by StartPrefetch.
+    /// In RealTime mode the time follows the wall clock and frames are dropped if the rendering is too slow,
+    /// in EveryFrame mode all the frames are displayed.
+    UsdTimeCode Advance(const UsdStageRefPtr &stage, UsdTimeCode current);
+
+    /// Launch the prefetch of the frames following the last advance, the stage must not be edited until
+    /// WaitForPrefetch returns
+    void StartPrefetch(const UsdStageRefPtr &stage);
+
+    /// Block until the prefetch threads have finished reading the stage
+    void WaitForPrefetch();
+
+    Mode GetMode() const { return _mode; }
+    void SetMode(Mode mode) { _mode = mode; }
+
+    /// Playback statistics
+    double GetTargetFramesPerSecond() const { return _targetFramesPerSecond; }
+    double GetAchievedFramesPerSecond() const { return _achievedFramesPerSecond; }
+    size_t GetDroppedFrames() const { return _droppedFrames; }
+
+    /// UI
+    void DrawSettings();
+
+  private:
+    void CollectAnimatedAttributes(const UsdStageRefPtr &stage);
+    /// Collect the animated attributes of the prims under path, replacing the previous ones
+    void CollectAnimatedAttributes(const UsdStageRefPtr &stage, const SdfPath &path);
+    void LaunchPrefetch(const UsdStageRefPtr &stage, double currentFrame, double frameStep);
+    void OnObjectsChanged(const UsdNotice::ObjectsChanged &notice, const UsdStageWeakPtr &sender);
+
+    Mode _mode = RealTime;
+    bool _playing = false;
+    std::chrono::time_point<std::chrono::steady_clock> _lastFrameTime;
+
+    // Statistics, the achieved frame rate is averaged over one second
+    std::chrono::time_point<std::chrono::steady_clock> _statsStartTime;
+    int _statsFrameCount = 0;
+    double _achievedFramesPerSecond = 0.0;
+    double _targetFramesPerSecond = 0.0;
+    size_t _droppedFrames = 0;
+
+    // Prefetch
+    int _prefetchFrames = 4;
+    double _prefetchedUntil = 0.0;
+    double _prefetchFrame = 0.0;
+    double _prefetchStep = 1.0;
+    bool _prefetchPending = false;
+    UsdStageWeakPtr _stage;
+    // Queries per prim, so only the resynced subtrees are collected again
+    std::map<SdfPath, std::vector<UsdAttributeQuery>> _animatedAttributes;
+    std::vector<const UsdAttributeQuery *> _prefetchedAttributes;
+    SdfPathVector _resyncedPaths;
+    bool _animatedAttributesAreDirty = true;
+    TfNotice::Key _objectsChangedKey;
+    std::future<void> _prefetchTask;
+};
@@ -1,6 +1,13 @@
 #include "FileBrowser.h"
 #include "Gui.h"
+#include "ImagingSettings.h"
 #include "Playblast.h"
+#include "SchemaTypeIndex.h"
+#include <algorithm>
+#include <thread>
+#include <pxr/imaging/garch/glApi.h>
+#include <pxr/imaging/hd/aov.h>
+#include <pxr/imaging/hio/image.h>
 #include <pxr/usd/usd/primRange.h>
 #include <pxr/usd/usd/stage.h>
 #include <pxr/usd/usdGeom/camera.h>
@@ -16,8 +23,159 @@ namespace fs = ghc::filesystem;
 
 PXR_NAMESPACE_USING_DIRECTIVE
 
+static constexpr const char *PlayblastFileFormats[] = {"jpg", "png", "exr"};
+
+PlayblastJob::PlayblastJob(UsdStageRefPtr stage, const SdfPath &cameraPath, const std::vector<UsdTimeCode> &frames,
+                           const std::vector<std::string> &outputFiles, int width)
+    : BackgroundJob("Playblast " + cameraPath.GetString()), _stage(stage), _cameraPath(cameraPath), _frames(frames),
+      _outputFiles(outputFiles), _width(std::max(1, width)) {
+    // Keep one thread for the UI
+    _maxEncodingTasks = std::max(2u, std::thread::hardware_concurrency()) - 1;
+}
+
+PlayblastJob::~PlayblastJob() {
+    Cancel();
+    for (auto &task : _encodingTasks) {
+        task.wait();
+    }
+    // The GL resources are released in Step when the job ends, this is just in case the job was deleted before
+    ReleaseRenderer();
+}
+
+bool PlayblastJob::InitializeRenderer() {
+    UsdGeomCamera camera(_stage->GetPrimAtPath(_cameraPath));
+    if (!camera) {
+        return false;
+    }
+    const GfCamera gfCamera = camera.GetCamera(_frames.empty() ? UsdTimeCode::Default() : _frames.front());
+    const float aspectRatio = gfCamera.GetAspectRatio();
+    _height = std::max(1, static_cast<int>(aspectRatio > 0.f ? _width / aspectRatio : _width));
+
+    _drawTarget = GlfDrawTarget::New(GfVec2i(_width, _height), false);
+    _drawTarget->Bind();
+    _drawTarget->AddAttachment("color", GL_RGBA, GL_FLOAT, GL_RGBA);
+    _drawTarget->AddAttachment("depth", GL_DEPTH_COMPONENT, GL_FLOAT, GL_DEPTH_COMPONENT32F);
+    _drawTarget->Unbind();
+
+    SdfPathVector excludedPaths;
+    _renderer = new UsdImagingGLEngine(_stage->GetPseudoRoot().GetPath(), excludedPaths);
+    _renderer->SetRendererPlugin(TfToken("HdStormRendererPlugin"));
+    _renderer->SetRendererAov(HdAovTokens->color);
+    return true;
+}
+
+void PlayblastJob::ReleaseRenderer() {
+    if (_renderer) {
+        _drawTarget->Bind();
+        delete _renderer;
+        _renderer = nullptr;
+        _drawTarget->Unbind();
+    }
+    _drawTarget = TfNullPtr;
+}
+
+void PlayblastJob::RenderFrame(size_t frameIndex) {
+    const UsdTimeCode frame = _frames[frameIndex];
+    const std::string &outputFile = _outputFiles[frameIndex];
+    const bool isFloat = TfStringEndsWith(outputFile, ".exr");
+
+    ImagingSettings renderParams;
+    renderParams.frame = frame;
+    renderParams.clearColor = GfVec4f(0.0, 0.0, 0.0, 1.0);
+    renderParams.enableSceneMaterials = true;
+    renderParams.showGuides = false;
+    renderParams.highlight = false;
+    // Exr are kept linear
+    renderParams.colorCorrectionMode = isFloat ? TfToken("disabled") : TfToken("sRGB");
+
+    const GfCamera camera = UsdGeomCamera(_stage->GetPrimAtPath(_cameraPath)).GetCamera(frame);
+    renderParams.SetLightPositionFromCamera(camera);
+
+    _drawTarget->Bind();
+    glEnable(GL_DEPTH_TEST);
+    glClearColor(0.0, 0.0, 0.0, 1.0);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glViewport(0, 0, _width, _height);
+
+    _renderer->SetRenderBufferSize(GfVec2i(_width, _height));
+    _renderer->SetFraming(CameraUtilFraming(GfRect2i(GfVec2i(0, 0), _width, _height)));
+    _renderer->SetCameraPath(_cameraPath);
+    _renderer->SetLightingState(renderParams.GetLights(), renderParams._material, renderParams._ambient);
+    do {
+        _renderer->Render(_stage->GetPseudoRoot(), renderParams);
+    } while (!_renderer->IsConverged() && !IsCancelled());
+
+    // Read back the pixels, they are shared with the encoding task
+    const size_t pixelSize = isFloat ? 4 * sizeof(float) : 4 * sizeof(uint8_t);
+    auto pixels = std::make_shared<std::vector<uint8_t>>(static_cast<size_t>(_width) * _height * pixelSize);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, _width, _height, GL_RGBA, isFloat ? GL_FLOAT : GL_UNSIGNED_BYTE, pixels->data());
+    _drawTarget->Unbind();
+
+    const int width = _width;
+    const int height = _height;
+    _encodingTasks.emplace_back(std::async(std::launch::async, [this, pixels, width, height, isFloat, outputFile]() {
+        if (IsCancelled()) {
+            return;
+        }
+        HioImage::StorageSpec storage;
+        storage.width = width;
+        storage.height = height;
+        storage.depth = 1;
+        storage.format = isFloat ? HioFormatFloat32Vec4 : HioFormatUNorm8Vec4;
+        storage.flipped = true; // OpenGL images are bottom up
+        storage.data = pixels->data();
+        HioImageSharedPtr image = HioImage::OpenForWriting(outputFile);
+        if (image && image->Write(storage)) {
+            _writtenFrames++;
+        } else {
+            _failedFrames++;
+        }
+    }));
+}
+
+size_t PlayblastJob::CollectFinishedTasks() {
+    _encodingTasks.erase(std::remove_if(_encodingTasks.begin(), _encodingTasks.end(),
+                                        [](const std::future<void> &task) {
+                                            return task.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+                                        }),
+                         _encodingTasks.end());
+    return _encodingTasks.size();
+}
+
+bool PlayblastJob::Step() {
+    const bool hasFramesToRender = !IsCancelled() && _nextFrame < _frames.size();
+    if (hasFramesToRender && !_renderer && !InitializeRenderer()) {
+        SetStatus("Unable to find camera " + _cameraPath.GetString());
+        return false;
+    }
+    // The rendering waits for the encoders when they are all busy, this limits the memory used by the pending images
+    if (hasFramesToRender && CollectFinishedTasks() < _maxEncodingTasks) {
+        RenderFrame(_nextFrame++);
+    }
+    if (IsCancelled() || _nextFrame >= _frames.size()) {
+        ReleaseRenderer();
+    }
+    const size_t runningTasks = CollectFinishedTasks();
+    const size_t written = _writtenFrames;
+    const size_t failed = _failedFrames;
+    SetProgress(_frames.empty() ? 1.f : static_cast<float>(written + failed) / static_cast<float>(_frames.size()));
+
+    const bool running = runningTasks > 0 || (!IsCancelled() && _nextFrame < _frames.size());
+    std::string status = TfStringPrintf("Rendered %zu/%zu, written %zu", _nextFrame, _frames.size(), written);
+    if (failed) {
+        status += TfStringPrintf(", %zu failed", failed);
+    }
+    if (!running && IsCancelled()) {
+        status += ", cancelled";
+    }
+    SetStatus(status);
+    return running;
+}
+
 std::string PlayblastModalDialog::directory = "";
 std::string PlayblastModalDialog::filenamePrefix = "";
+int PlayblastModalDialog::fileFormat = 0;
 int PlayblastModalDialog::start = -1;
 int PlayblastModalDialog::end = -1;
 int PlayblastModalDialog::width = 960;
@@ -33,13 +191,9 @@ PlayblastModalDialog::PlayblastModalDialog(UsdStagePtr stage) : _stage(stage) {
         start = static_cast<int>(_stage->GetStartTimeCode());
         end = static_cast<int>(_stage->GetEndTimeCode());
     }
-    // find all camera in the stqge
+    // find all camera in the stage
     if (stage) {
-        for (const auto &prim : stage->Traverse()) {
-            if (prim.IsA<UsdGeomCamera>()) {
-                _stageCameras.push_back(prim.GetPath());
-            }
-        }
+        _stageCameras = GetSchemaTypeIndex(stage).GetPrimPaths<UsdGeomCamera>();
     }
     // Select the first camera
     if (!_stageCameras.empty()) {
@@ -62,6 +216,7 @@ void PlayblastModalDialog::Draw() {
     ImGui::Text("Purposes: default+proxy");
     ImGui::InputText("Output directory", &directory);
     ImGui::InputText("Output image prefix", &filenamePrefix);
+    ImGui::Combo("File format", &fileFormat, "jpg\0png\0exr\0");
     ImGui::Checkbox("Render sequence", &isSequence);
     if (isSequence) {
         ImGui::InputInt("Start", &start);
@@ -69,33 +224,27 @@ void PlayblastModalDialog::Draw() {
     }
     ImGui::InputInt("Image width", &width);
 
-    ImGui::BeginDisabled(directory.empty() || filenamePrefix.empty() || start > end || _cameraPath == SdfPath());
-    ImGui::Text("Rendering to : %s\\%s.#.jpg", directory.c_str(), filenamePrefix.c_str());
+    const bool directoryExists = fs::is_directory(fs::path(directory));
+    const char *extension = PlayblastFileFormats[fileFormat];
+    ImGui::BeginDisabled(!directoryExists || filenamePrefix.empty() || start > end || _cameraPath == SdfPath());
+    if (directoryExists) {
+        ImGui::Text("Rendering to : %s\\%s.#.%s", directory.c_str(), filenamePrefix.c_str(), extension);
+    } else {
+        ImGui::Text("Output directory does not exist");
+    }
     if (ImGui::Button("Blast")) {
-        if (width > 0) {
-            _recorder.SetImageWidth(width);
-        }
-        _recorder.SetRendererPlugin(TfToken("HdStormRendererPlugin"));
-        _recorder.SetColorCorrectionMode(TfToken("sRGB"));
-        _recorder.SetComplexity(1.0);
-        UsdGeomCamera camera(_stage->GetPrimAtPath(_cameraPath));
+        std::vector<UsdTimeCode> frames;
+        std::vector<std::string> outputFiles;
         if (isSequence) {
             for (int i = start; i <= end; ++i) {
-                std::string frameName = filenamePrefix + "." + std::to_string(i) + ".jpg";
-                fs::path outputFrame(directory);
-                if (fs::is_directory(outputFrame)) {
-                    outputFrame /= frameName;
-                    _recorder.Record(_stage, camera, UsdTimeCode(i), outputFrame.string());
-                }
+                frames.emplace_back(i);
+                outputFiles.push_back((fs::path(directory) / (filenamePrefix + "." + std::to_string(i) + "." + extension)).string());
             }
         } else {
-            std::string frameName = filenamePrefix + "." + ".jpg";
-            fs::path outputFrame(directory);
-            if (fs::is_directory(outputFrame)) {
-                outputFrame /= frameName;
-                _recorder.Record(_stage, camera, UsdTimeCode::Default(), outputFrame.string());
-            }
+            frames.emplace_back(UsdTimeCode::Default());
+            outputFiles.push_back((fs::path(directory) / (filenamePrefix + "." + extension)).string());
         }
+        LaunchBackgroundJob(std::make_unique<PlayblastJob>(_stage, _cameraPath, frames, outputFiles, width));
         CloseModal();
     }
     ImGui::SameLine();
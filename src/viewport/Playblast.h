@@ -1,20 +1,59 @@
 #pragma once
 
+#include <atomic>
+#include <future>
 #include <string>
+#include <vector>
 
-#include <pxr/usdImaging/usdAppUtils/frameRecorder.h>
+#include <pxr/imaging/glf/drawTarget.h>
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usdImaging/usdImagingGL/engine.h>
 
+#include "BackgroundJobs.h"
 #include "ModalDialogs.h"
 
 PXR_NAMESPACE_USING_DIRECTIVE
 
+/// Playblast job
+/// The frames are rendered with storm in sequence on the main thread, one frame per editor frame, so the UI stays
+/// responsive. The pixels are read back and handed to worker threads which encode and write the images.
+/// It only needs a GL context, so it also runs with a software GL driver.
+class PlayblastJob : public BackgroundJob {
+  public:
+    PlayblastJob(UsdStageRefPtr stage, const SdfPath &cameraPath, const std::vector<UsdTimeCode> &frames,
+                 const std::vector<std::string> &outputFiles, int width);
+    ~PlayblastJob() override;
+
+    bool Step() override;
+
+  private:
+    bool InitializeRenderer();
+    void RenderFrame(size_t frameIndex);
+    void ReleaseRenderer();
+
+    /// Remove the encoding tasks which have finished, returns the number of tasks still running
+    size_t CollectFinishedTasks();
+
+    UsdStageRefPtr _stage;
+    SdfPath _cameraPath;
+    std::vector<UsdTimeCode> _frames;
+    std::vector<std::string> _outputFiles;
+    int _width;
+    int _height = 0;
+
+    UsdImagingGLEngine *_renderer = nullptr;
+    GlfDrawTargetRefPtr _drawTarget;
+
+    size_t _nextFrame = 0;
+    std::atomic<size_t> _writtenFrames{0};
+    std::atomic<size_t> _failedFrames{0};
+    std::vector<std::future<void>> _encodingTasks;
+    size_t _maxEncodingTasks;
+};
+
 /// Playblast dialog
-/// This is a minimal implementation of a playblast dialog using UsdAppUtilsFrameRecorder.
-/// It needs some improvements as it's not possible to blast the viewport camera unless it's a stage camera,
-/// we can't select the renderer, we can't change options like loading materials or not, change the file format ...
-/// Also there is not ui for selecting the output directory, and no progress bar.
-///
-/// For all of those desirable features we need to extract the code from UsdAppUtilsFrameRecorder into another frame recorder.
+/// It is not possible to blast the viewport camera unless it's a stage camera, and we can't select the renderer or
+/// change options like loading materials or not.
 ///
 struct PlayblastModalDialog : public ModalDialog {
 
@@ -24,13 +63,13 @@ struct PlayblastModalDialog : public ModalDialog {
     void Draw() override;
     const char *DialogId() const override { return "Playblast"; }
 
-    UsdAppUtilsFrameRecorder _recorder;
     UsdStagePtr _stage;
     SdfPath _cameraPath;
     SdfPathVector _stageCameras;
 
     static std::string directory;
     static std::string filenamePrefix;
+    static int fileFormat;
     bool isSequence = true;
     static int start;
     static int end;
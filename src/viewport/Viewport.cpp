@@ -1,5 +1,7 @@
 #include <iostream>
+#include <cmath>
 
+#include <pxr/base/tf/mallocTag.h>
 #include <pxr/imaging/garch/glApi.h>
 #include <pxr/usd/usd/primRange.h>
 #include <pxr/usd/usdGeom/boundable.h>
@@ -14,11 +16,19 @@
 #include "Viewport.h"
 #include "Commands.h"
 #include "Constants.h"
+#include "MemoryPanel.h"
 #include "Shortcuts.h"
 #include "UsdPrimEditor.h" // DrawUsdPrimEditTarget
 
 namespace clk = std::chrono;
 
+// Steps of the adaptive resolution scale, the draw target and its AOVs are only reallocated when the step changes.
+// Under 1/4 of the resolution the image is not readable anymore
+static constexpr float ResolutionScales[] = {1.f, 0.75f, 0.5f, 0.35f, 0.25f};
+static constexpr int NbResolutionScales = sizeof(ResolutionScales) / sizeof(ResolutionScales[0]);
+// Number of frames rendered at a scale before it is measured again
+static constexpr int ResolutionScaleFrames = 3;
+
 // TODO: picking meshes: https://groups.google.com/g/usd-interest/c/P2CynIu7MYY/m/UNPIKzmMBwAJ
 
 Viewport::Viewport(UsdStageRefPtr stage, Selection &selection)
@@ -71,6 +81,7 @@ static void DrawOpenedStages() {
 
 /// Draw the viewport widget
 void Viewport::Draw() {
+    _drawnSinceLastUpdate = true;
     const ImVec2 wsize = ImGui::GetWindowSize();
     // Set the size of the texture here as we need the current window size
     const auto cursorPos = ImGui::GetCursorPos();
@@ -89,6 +100,11 @@ void Viewport::Draw() {
         //}
         HandleManipulationEvents();
         HandleKeyboardShortcut();
+        if (GetCurrentStage() && (!_renderer || _rendererIsNew)) {
+            ImGui::SetCursorPos(cursorPos + ImVec2(15, _textureSize[1] - ImGui::GetFrameHeight() - 15));
+            ImGui::Text("Populating hydra scene...");
+            _populationMessageDrawn = _renderer != nullptr;
+        }
         ImGui::BeginDisabled(!bool(GetCurrentStage()));
         DrawToolBar(cursorPos + ImVec2(120, 15));
         DrawManipulatorToolbox(cursorPos + ImVec2(15, 15));
@@ -126,6 +142,7 @@ void Viewport::DrawToolBar(const ImVec2 widgetPosition) {
     ImGui::Button(ICON_FA_TV);
     if (_renderer && ImGui::BeginPopupContextItem(nullptr, flags)) {
         DrawImagingSettings(*_renderer, _imagingSettings);
+        _drawModeLod.DrawSettings();
         ImGui::EndPopup();
     }
     if (ImGui::IsItemHovered() && GImGui->HoveredIdTimer > 1) {
@@ -172,9 +189,36 @@ void Viewport::DrawToolBar(const ImVec2 widgetPosition) {
     if (ImGui::IsItemHovered() && GImGui->HoveredIdTimer > 1) {
         ImGui::SetTooltip("Cameras");
     }
+    ImGui::SameLine();
+    DrawAdaptiveResolutionButton();
     ImGui::PopStyleColor(2);
 }
 
+void Viewport::DrawAdaptiveResolutionButton() {
+    const ImVec4 selectedColor(ColorButtonHighlight);
+    const bool downscaled = _resolutionScale < 1.f;
+    if (downscaled) {
+        ImGui::PushStyleColor(ImGuiCol_Button, selectedColor);
+    }
+    char scaleLabel[32];
+    snprintf(scaleLabel, sizeof(scaleLabel), ICON_FA_TACHOMETER_ALT " x%.2f###AdaptiveResolution", _resolutionScale);
+    ImGui::Button(scaleLabel);
+    if (downscaled) {
+        ImGui::PopStyleColor();
+    }
+    if (ImGui::BeginPopupContextItem(nullptr, ImGuiPopupFlags_MouseButtonLeft)) {
+        ScopedStyleColor defaultStyle(DefaultColorStyle);
+        ImGui::Checkbox("Adaptive resolution", &_adaptiveResolution);
+        ImGui::BeginDisabled(!_adaptiveResolution);
+        ImGui::SliderFloat("Target fps", &_targetFramesPerSecond, 5.f, 120.f, "%.0f");
+        ImGui::EndDisabled();
+        ImGui::EndPopup();
+    }
+    if (ImGui::IsItemHovered() && GImGui->HoveredIdTimer > 1) {
+        ImGui::SetTooltip("Render resolution scale");
+    }
+}
+
 
 // Poor man manipulator toolbox
 void Viewport::DrawManipulatorToolbox(const ImVec2 widgetPosition) {
@@ -245,7 +289,8 @@ void Viewport::FrameRootPrim(){
 }
 
 GfVec2d Viewport::GetPickingBoundarySize() const {
-    const GfVec2i renderSize = _drawTarget->GetSize();
+    // The draw target can be downscaled, the picking is done in window pixels
+    const GfVec2i &renderSize = _textureSize;
     const double width = static_cast<double>(renderSize[0]);
     const double height = static_cast<double>(renderSize[1]);
     return GfVec2d(20.0 / width, 20.0 / height);
@@ -310,7 +355,7 @@ void Viewport::HandleKeyboardShortcut() {
         } else {
             ScaleManipulatorPressedOnce = true;
         }
-        if (_playing) {
+        if (_playback.IsPlaying()) {
             AddShortcut<EditorStopPlayback, ImGuiKey_Space>();
         } else {
             AddShortcut<EditorStartPlayback, ImGuiKey_Space>();
@@ -326,13 +371,14 @@ void Viewport::HandleManipulationEvents() {
 
     // Check the mouse is over this widget
     if (ImGui::IsItemHovered()) {
-        const GfVec2i drawTargetSize = _drawTarget->GetSize();
-        if (drawTargetSize[0] == 0 || drawTargetSize[1] == 0) return;
+        // Use the displayed image size, the draw target might be downscaled
+        const GfVec2i &imageSize = _textureSize;
+        if (imageSize[0] == 0 || imageSize[1] == 0) return;
         _mousePosition[0] = 2.0 * (static_cast<double>(io.MousePos.x - (g->LastItemData.Rect.Min.x)) /
-            static_cast<double>(drawTargetSize[0])) -
+            static_cast<double>(imageSize[0])) -
             1.0;
         _mousePosition[1] = -2.0 * (static_cast<double>(io.MousePos.y - (g->LastItemData.Rect.Min.y)) /
-            static_cast<double>(drawTargetSize[1])) +
+            static_cast<double>(imageSize[1])) +
             1.0;
 
         /// This works like a Finite state machine
@@ -388,12 +434,17 @@ void Viewport::BeginHydraUI(int width, int height) {
 void Viewport ::EndHydraUI() { ImGui::End(); }
 
 void Viewport::Render() {
+    if (!_isVisible) {
+        return;
+    }
     GfVec2i renderSize = _drawTarget->GetSize();
     int width = renderSize[0];
     int height = renderSize[1];
 
-    if (width == 0 || height == 0)
+    if (width == 0 || height == 0) {
+        _playback.WaitForPrefetch();
         return;
+    }
 
     // Draw active manipulator and HUD
     BeginHydraUI(width, height);
@@ -408,7 +459,9 @@ void Viewport::Render() {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glViewport(0, 0, width, height);
 
-    if (_renderer && GetCurrentStage()) {
+    if (_renderer && _rendererIsNew && !_populationMessageDrawn) {
+        // Skip the render until the UI has shown the message, the scene population can be long.
+    } else if (_renderer && GetCurrentStage()) {
         // Render hydra
         // Set camera and lighting state
         _imagingSettings.SetLightPositionFromCamera(GetCurrentCamera());
@@ -441,7 +494,17 @@ void Viewport::Render() {
             _renderer->SetCameraState(GetCurrentCamera().GetFrustum().ComputeViewMatrix(),
                                   GetCurrentCamera().GetFrustum().ComputeProjectionMatrix());
         }
+        TfAutoMallocTag2 tag(MallocTagEditor, MallocTagRenderer);
+        // All the edits of the frame are done, the prefetch of the next frames can read the stage during the render
+        _playback.StartPrefetch(GetCurrentStage());
+        const auto renderStart = clk::steady_clock::now();
         _renderer->Render(GetCurrentStage()->GetPseudoRoot(), _imagingSettings);
+        // While interacting the gpu is waited for here so its time is measured, the main loop waits for it anyway
+        if (_adaptiveResolution && IsInteracting()) {
+            glFinish();
+        }
+        _lastRenderTime = clk::duration<double>(clk::steady_clock::now() - renderStart).count();
+        _rendererIsNew = false;
     } else {
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     }
@@ -456,6 +519,9 @@ void Viewport::Render() {
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
     _drawTarget->Unbind();
+
+    // The prefetch threads are reading the stage, they must be finished before any edit happens
+    _playback.WaitForPrefetch();
 }
 
 void Viewport::SetCurrentTimeCode(const UsdTimeCode &tc) {
@@ -464,13 +530,23 @@ void Viewport::SetCurrentTimeCode(const UsdTimeCode &tc) {
 
 /// Update anything that could have change after a frame render
 void Viewport::Update() {
+    // Nothing is created or updated for a viewport which wasn't drawn in the last frame. The stage opening doesn't
+    // pay for hydra until the viewport is actually looked at.
+    _isVisible = _drawnSinceLastUpdate;
+    _drawnSinceLastUpdate = false;
+    if (!_isVisible) {
+        return;
+    }
     if (GetCurrentStage()) {
         auto whichRenderer = _renderers.find(GetCurrentStage()); /// We expect a very limited number of opened stages
         if (whichRenderer == _renderers.end()) {
+            // Only the engine is created in this frame, the framing and the population happen in the following ones
             SdfPathVector excludedPaths;
             _renderer = new UsdImagingGLEngine(GetCurrentStage()->GetPseudoRoot().GetPath(), excludedPaths);
+            _rendererIsNew = true;
+            _populationMessageDrawn = false;
             if (_renderers.empty()) {
-                FrameRootPrim();
+                _frameRootPrimPending = true;
             }
             _renderers[GetCurrentStage()] = _renderer;
             _cameraManipulator.SetZIsUp(UsdGeomGetStageUpAxis(GetCurrentStage()) == "Z");
@@ -484,23 +560,14 @@ void Viewport::Update() {
             // TODO: the selection is also different per stage
             //_selection =
         }
+        if (_frameRootPrimPending && _populationMessageDrawn) {
+            FrameRootPrim();
+            _frameRootPrimPending = false;
+        }
 
-        // This should be extracted in a Playback module,
-        // also the current code is not providing the exact frame rate, it doesn't take into account when the frame is
-        // displayed. This is a first implementation to get an idea of how it should interact with the rest of the application.
-        if (_playing) {
-            auto current = clk::steady_clock::now();
-            const auto timesCodePerSec = GetCurrentStage()->GetTimeCodesPerSecond();
-            const auto timeDifference = std::chrono::duration<double>(current - _lastFrameTime);
-            double newFrame =
-                _imagingSettings.frame.GetValue() + timesCodePerSec * timeDifference.count(); // for now just increment the frame
-            if (newFrame > GetCurrentStage()->GetEndTimeCode()) {
-                newFrame = GetCurrentStage()->GetStartTimeCode();
-            } else if (newFrame < GetCurrentStage()->GetStartTimeCode()) {
-                newFrame = GetCurrentStage()->GetStartTimeCode();
-            }
-            _imagingSettings.frame = UsdTimeCode(newFrame);
-            _lastFrameTime = current;
+        // Advance the time, the next frames are prefetched while hydra renders this one
+        if (_playback.IsPlaying()) {
+            _imagingSettings.frame = _playback.Advance(GetCurrentStage(), _imagingSettings.frame);
         }
 
         // Update cameras state, this will assign the user selected camera for the current stage at
@@ -508,10 +575,13 @@ void Viewport::Update() {
         _cameras.Update(GetCurrentStage(), GetCurrentTimeCode());
     }
 
+    UpdateResolutionScale();
+    const GfVec2i renderSize(std::max(1, static_cast<int>(_textureSize[0] * _resolutionScale)),
+                             std::max(1, static_cast<int>(_textureSize[1] * _resolutionScale)));
     const GfVec2i &currentSize = _drawTarget->GetSize();
-    if (currentSize != _textureSize) {
+    if (currentSize != renderSize) {
         _drawTarget->Bind();
-        _drawTarget->SetSize(_textureSize);
+        _drawTarget->SetSize(renderSize);
         _drawTarget->Unbind();
 
     }
@@ -520,6 +590,9 @@ void Viewport::Update() {
     // and the user can resize the viewport
     _cameras.SetCameraAspectRatio(_textureSize[0], _textureSize[1]);
 
+    // Switch the draw mode of the tiny models, this uses the camera with the updated aspect ratio
+    _drawModeLod.Update(GetCurrentStage(), GetCurrentCamera(), GetCurrentTimeCode(), _textureSize);
+
     if (_renderer && _selection.UpdateSelectionHash(GetCurrentStage(), _lastSelectionHash)) {
         _renderer->ClearSelected();
         _renderer->SetSelected(_selection.GetSelectedPaths(GetCurrentStage()));
@@ -532,9 +605,46 @@ void Viewport::Update() {
 }
 
 
+bool Viewport::IsInteracting() const {
+    return _playback.IsPlaying() || _currentEditingState == &_cameraManipulator;
+}
+
+void Viewport::UpdateResolutionScale() {
+    // The full resolution is restored on the first frame following the interaction
+    if (!_adaptiveResolution || !IsInteracting()) {
+        _resolutionStep = 0;
+        _resolutionScale = ResolutionScales[0];
+        _framesAtResolutionStep = 0;
+        return;
+    }
+    // The step changes only after a few frames rendered at the current one, so the measures are not from the
+    // previous draw target size
+    if (++_framesAtResolutionStep < ResolutionScaleFrames || _lastRenderTime <= 0.0) {
+        return;
+    }
+    const double targetRenderTime = 1.0 / std::max(1.f, _targetFramesPerSecond);
+    int step = _resolutionStep;
+    if (_lastRenderTime > targetRenderTime && step < NbResolutionScales - 1) {
+        step++;
+    } else if (step > 0) {
+        // The number of pixels grows with the square of the scale. The margin on the predicted render time at
+        // the larger step avoids oscillating between two steps.
+        const double ratio = ResolutionScales[step - 1] / ResolutionScales[step];
+        if (_lastRenderTime * ratio * ratio < 0.8 * targetRenderTime) {
+            step--;
+        }
+    }
+    if (step != _resolutionStep) {
+        _resolutionStep = step;
+        _resolutionScale = ResolutionScales[step];
+        _framesAtResolutionStep = 0;
+    }
+}
+
 bool Viewport::TestIntersection(GfVec2d clickedPoint, SdfPath &outHitPrimPath, SdfPath &outHitInstancerPath, int &outHitInstanceIndex) {
 
-    GfVec2i renderSize = _drawTarget->GetSize();
+    // The picking frustum is computed in window pixels as the draw target can be downscaled
+    const GfVec2i &renderSize = _textureSize;
     double width = static_cast<double>(renderSize[0]);
     double height = static_cast<double>(renderSize[1]);
 
@@ -549,12 +659,11 @@ bool Viewport::TestIntersection(GfVec2d clickedPoint, SdfPath &outHitPrimPath, S
 
 
 void Viewport::StartPlayback() {
-    _playing = true;
-    _lastFrameTime = clk::steady_clock::now();
+    _playback.Start(GetCurrentStage());
 }
 
 void Viewport::StopPlayback() {
-    _playing = false;
+    _playback.Stop();
     // cast to nearest frame
     _imagingSettings.frame = UsdTimeCode(int(_imagingSettings.frame.GetValue()));
 }
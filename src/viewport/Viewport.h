@@ -16,6 +16,8 @@
 #include "Selection.h"
 #include "Grid.h"
 #include "ViewportCameras.h"
+#include "DrawModeLod.h"
+#include "Playback.h"
 #include <pxr/imaging/glf/drawTarget.h>
 #include <pxr/usd/usd/stage.h>
 #include <pxr/usdImaging/usdImagingGL/engine.h>
@@ -105,8 +107,24 @@ class Viewport final {
     /// Playback controls
     void StartPlayback();
     void StopPlayback();
+    Playback &GetPlayback() { return _playback; }
+
+    /// Adaptive resolution: the scene is rendered in a smaller draw target while the camera is moving or
+    /// the animation is playing, the scale is chosen among a few steps to reach the target render time.
+    bool IsAdaptiveResolutionEnabled() const { return _adaptiveResolution; }
+    void SetAdaptiveResolution(bool enabled) { _adaptiveResolution = enabled; }
+    float GetResolutionScale() const { return _resolutionScale; }
 
   private:
+    /// Returns true when the user is navigating or playing back the animation
+    bool IsInteracting() const;
+
+    /// Compute the new resolution scale from the last hydra render duration
+    void UpdateResolutionScale();
+
+    /// Draw the adaptive resolution button and its popup in the toolbar
+    void DrawAdaptiveResolutionButton();
+
     // Viewport ID
     std::string _viewportName;
     
@@ -126,6 +144,15 @@ class Viewport final {
     Selection &_selection;
     SelectionHash _lastSelectionHash = 0;
 
+    // Visibility, the hydra engine is created and rendered only when the viewport is drawn
+    bool _drawnSinceLastUpdate = false;
+    bool _isVisible = false;
+    // The engine creation, the framing and the first render (scene population) are spread over multiple frames.
+    // The engine stays new until its first render, which waits for the UI to draw the population message.
+    bool _rendererIsNew = false;
+    bool _populationMessageDrawn = false;
+    bool _frameRootPrimPending = false;
+
     // Hydra canvas
     void BeginHydraUI(int width, int height);
     void EndHydraUI();
@@ -142,9 +169,19 @@ class Viewport final {
     ImagingSettings _imagingSettings;
     GlfDrawTargetRefPtr _drawTarget;
 
+    // Simplified draw mode for the models too small on screen
+    DrawModeLod _drawModeLod;
+
     // Playback controls
-    bool _playing = false;
-    std::chrono::time_point<std::chrono::steady_clock> _lastFrameTime;
+    Playback _playback;
+
+    // Adaptive resolution
+    bool _adaptiveResolution = true;
+    float _targetFramesPerSecond = 30.f;
+    float _resolutionScale = 1.f;
+    int _resolutionStep = 0;
+    int _framesAtResolutionStep = 0;
+    double _lastRenderTime = 0.0;
 };
 
 template <> inline Manipulator *Viewport::GetManipulator<PositionManipulator>() { return &_positionManipulator; }
@@ -3,6 +3,7 @@
 #include "Commands.h"
 #include "Gui.h"
 #include "ImGuiHelpers.h"
+#include "SchemaTypeIndex.h"
 #include <pxr/usd/usd/primRange.h>
 #include <pxr/usd/usdGeom/camera.h>
 
@@ -117,19 +118,16 @@ void ViewportCameras::DrawCameraList(const UsdStageRefPtr &stage) {
         }
         
         if (stage) {
-            UsdPrimRange range = stage->Traverse();
-            for (const auto &prim : range) {
-                if (prim.IsA<UsdGeomCamera>()) {
-                    ImGui::PushID(prim.GetPath().GetString().c_str());
-                    const bool isSelected = (prim.GetPath() == _selectedCameraPath);
-                    if (ImGui::Selectable(prim.GetName().data(), isSelected)) {
-                        SetStageAndCameraPath(stage, prim.GetPath());
-                    }
-                    if (ImGui::IsItemHovered() && GImGui->HoveredIdTimer > 2) {
-                        ImGui::SetTooltip("%s", prim.GetPath().GetString().c_str());
-                    }
-                    ImGui::PopID();
+            for (const auto &cameraPath : GetSchemaTypeIndex(stage).GetPrimPaths<UsdGeomCamera>()) {
+                ImGui::PushID(cameraPath.GetString().c_str());
+                const bool isSelected = (cameraPath == _selectedCameraPath);
+                if (ImGui::Selectable(cameraPath.GetName().c_str(), isSelected)) {
+                    SetStageAndCameraPath(stage, cameraPath);
                 }
+                if (ImGui::IsItemHovered() && GImGui->HoveredIdTimer > 2) {
+                    ImGui::SetTooltip("%s", cameraPath.GetString().c_str());
+                }
+                ImGui::PopID();
             }
         }
         ImGui::EndListBox();
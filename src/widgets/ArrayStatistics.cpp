@@ -0,0 +1,332 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <future>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include <pxr/base/gf/half.h>
+#include <pxr/base/gf/vec2d.h>
+#include <pxr/base/gf/vec2f.h>
+#include <pxr/base/gf/vec2h.h>
+#include <pxr/base/gf/vec2i.h>
+#include <pxr/base/gf/vec3d.h>
+#include <pxr/base/gf/vec3f.h>
+#include <pxr/base/gf/vec3h.h>
+#include <pxr/base/gf/vec3i.h>
+#include <pxr/base/gf/vec4d.h>
+#include <pxr/base/gf/vec4f.h>
+#include <pxr/base/gf/vec4h.h>
+#include <pxr/base/gf/vec4i.h>
+#include <pxr/base/vt/array.h>
+#include <pxr/base/work/loops.h>
+
+#include "ArrayStatistics.h"
+#include "Gui.h"
+
+static constexpr size_t HistogramBins = 64;
+static constexpr size_t MaxComponents = 4;
+
+struct ArrayStatistics {
+    size_t size = 0;
+    size_t dimension = 0;
+    std::array<double, MaxComponents> min;
+    std::array<double, MaxComponents> max;
+    std::array<double, MaxComponents> mean;
+    size_t nanCount = 0;
+    size_t infCount = 0;
+    // Histogram of the values for scalars, of the lengths for vectors
+    double histogramMin = 0.0;
+    double histogramMax = 0.0;
+    std::array<float, HistogramBins> histogram;
+};
+
+/// Partial results computed on a chunk of the array
+struct ChunkStatistics {
+    std::array<double, MaxComponents> min;
+    std::array<double, MaxComponents> max;
+    std::array<double, MaxComponents> sum;
+    std::array<size_t, MaxComponents> finiteCount;
+    double lengthMin = std::numeric_limits<double>::max();
+    double lengthMax = std::numeric_limits<double>::lowest();
+    size_t nanCount = 0;
+    size_t infCount = 0;
+    std::array<size_t, HistogramBins> histogram;
+
+    ChunkStatistics() {
+        min.fill(std::numeric_limits<double>::max());
+        max.fill(std::numeric_limits<double>::lowest());
+        sum.fill(0.0);
+        finiteCount.fill(0);
+        histogram.fill(0);
+    }
+};
+
+// Scalar type and number of components of the numeric types, the vectors are stored as contiguous scalars
+template <typename ValueT> struct NumericTraits {
+    using ScalarT = ValueT;
+    static constexpr size_t dimension = 1;
+};
+#define VEC_NUMERIC_TRAITS(VecT)                                                                                                 \
+    template <> struct NumericTraits<VecT> {                                                                                     \
+        using ScalarT = VecT::ScalarType;                                                                                        \
+        static constexpr size_t dimension = VecT::dimension;                                                                     \
+    };
+VEC_NUMERIC_TRAITS(GfVec2f)
+VEC_NUMERIC_TRAITS(GfVec3f)
+VEC_NUMERIC_TRAITS(GfVec4f)
+VEC_NUMERIC_TRAITS(GfVec2d)
+VEC_NUMERIC_TRAITS(GfVec3d)
+VEC_NUMERIC_TRAITS(GfVec4d)
+VEC_NUMERIC_TRAITS(GfVec2h)
+VEC_NUMERIC_TRAITS(GfVec3h)
+VEC_NUMERIC_TRAITS(GfVec4h)
+VEC_NUMERIC_TRAITS(GfVec2i)
+VEC_NUMERIC_TRAITS(GfVec3i)
+VEC_NUMERIC_TRAITS(GfVec4i)
+
+// The kernels work on the flat scalars of a chunk of elements with the dimension known at compile time,
+// so the inner loops are simple enough to be vectorized by the compiler
+template <typename ScalarT, size_t Dimension>
+static void ComputeChunkMoments(const ScalarT *data, size_t begin, size_t end, ChunkStatistics &chunk) {
+    for (size_t i = begin; i < end; ++i) {
+        double squaredLength = 0.0;
+        bool isFinite = true;
+        for (size_t c = 0; c < Dimension; ++c) {
+            const double value = static_cast<double>(data[i * Dimension + c]);
+            if (std::isnan(value)) {
+                chunk.nanCount++;
+                isFinite = false;
+            } else if (std::isinf(value)) {
+                chunk.infCount++;
+                isFinite = false;
+            } else {
+                chunk.min[c] = std::min(chunk.min[c], value);
+                chunk.max[c] = std::max(chunk.max[c], value);
+                chunk.sum[c] += value;
+                chunk.finiteCount[c]++;
+                squaredLength += value * value;
+            }
+        }
+        if (Dimension > 1 && isFinite) {
+            const double length = std::sqrt(squaredLength);
+            chunk.lengthMin = std::min(chunk.lengthMin, length);
+            chunk.lengthMax = std::max(chunk.lengthMax, length);
+        }
+    }
+}
+
+template <typename ScalarT, size_t Dimension>
+static void ComputeChunkHistogram(const ScalarT *data, size_t begin, size_t end, double histogramMin, double histogramMax,
+                                  ChunkStatistics &chunk) {
+    const double range = histogramMax - histogramMin;
+    const double scale = range > 0.0 ? HistogramBins / range : 0.0;
+    for (size_t i = begin; i < end; ++i) {
+        double value = 0.0;
+        if (Dimension == 1) {
+            value = static_cast<double>(data[i]);
+        } else {
+            for (size_t c = 0; c < Dimension; ++c) {
+                const double component = static_cast<double>(data[i * Dimension + c]);
+                value += component * component;
+            }
+            value = std::sqrt(value);
+        }
+        if (std::isfinite(value)) {
+            const size_t bin = static_cast<size_t>((value - histogramMin) * scale);
+            chunk.histogram[std::min(bin, HistogramBins - 1)]++;
+        }
+    }
+}
+
+template <typename ValueT>
+static ArrayStatistics ComputeArrayStatistics(const VtArray<ValueT> &array, const std::atomic<bool> &cancelled) {
+    using ScalarT = typename NumericTraits<ValueT>::ScalarT;
+    constexpr size_t Dimension = NumericTraits<ValueT>::dimension;
+    static_assert(sizeof(ValueT) == sizeof(ScalarT) * Dimension, "numeric types must be stored as contiguous scalars");
+
+    const ScalarT *data = reinterpret_cast<const ScalarT *>(array.cdata());
+    const size_t size = array.size();
+    // Fixed size chunks to be able to merge the partial results without locking
+    const size_t chunkSize = 1 << 16;
+    const size_t chunkCount = (size + chunkSize - 1) / chunkSize;
+    std::vector<ChunkStatistics> chunks(chunkCount);
+
+    WorkParallelForN(chunkCount, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end && !cancelled; ++i) {
+            ComputeChunkMoments<ScalarT, Dimension>(data, i * chunkSize, std::min(size, (i + 1) * chunkSize), chunks[i]);
+        }
+    });
+
+    ArrayStatistics statistics;
+    statistics.size = size;
+    statistics.dimension = Dimension;
+    ChunkStatistics total;
+    for (const auto &chunk : chunks) {
+        for (size_t c = 0; c < Dimension; ++c) {
+            total.min[c] = std::min(total.min[c], chunk.min[c]);
+            total.max[c] = std::max(total.max[c], chunk.max[c]);
+            total.sum[c] += chunk.sum[c];
+            total.finiteCount[c] += chunk.finiteCount[c];
+        }
+        total.lengthMin = std::min(total.lengthMin, chunk.lengthMin);
+        total.lengthMax = std::max(total.lengthMax, chunk.lengthMax);
+        total.nanCount += chunk.nanCount;
+        total.infCount += chunk.infCount;
+    }
+    for (size_t c = 0; c < Dimension; ++c) {
+        statistics.min[c] = total.finiteCount[c] ? total.min[c] : 0.0;
+        statistics.max[c] = total.finiteCount[c] ? total.max[c] : 0.0;
+        statistics.mean[c] = total.finiteCount[c] ? total.sum[c] / total.finiteCount[c] : 0.0;
+    }
+    statistics.nanCount = total.nanCount;
+    statistics.infCount = total.infCount;
+    if (Dimension == 1) {
+        statistics.histogramMin = statistics.min[0];
+        statistics.histogramMax = statistics.max[0];
+    } else if (total.lengthMin <= total.lengthMax) {
+        statistics.histogramMin = total.lengthMin;
+        statistics.histogramMax = total.lengthMax;
+    }
+
+    // Second pass for the histogram, it needs the range of the values
+    WorkParallelForN(chunkCount, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end && !cancelled; ++i) {
+            ComputeChunkHistogram<ScalarT, Dimension>(data, i * chunkSize, std::min(size, (i + 1) * chunkSize),
+                                                      statistics.histogramMin, statistics.histogramMax, chunks[i]);
+        }
+    });
+    statistics.histogram.fill(0.f);
+    for (const auto &chunk : chunks) {
+        for (size_t bin = 0; bin < HistogramBins; ++bin) {
+            statistics.histogram[bin] += static_cast<float>(chunk.histogram[bin]);
+        }
+    }
+    return statistics;
+}
+
+/// Statistics of the last array drawn, computed asynchronously
+struct ArrayStatisticsCache {
+    ~ArrayStatisticsCache() { Cancel(); }
+
+    void Cancel() {
+        if (task.valid()) {
+            *cancelled = true;
+            task.wait();
+        }
+    }
+
+    // The array is identified by its buffer which is shared with the layer, any edit creates a new buffer.
+    // A copy of the array is kept so the buffer can't be freed and its address reused by another array
+    VtValue array;
+    const void *arrayData = nullptr;
+    size_t arraySize = 0;
+    std::shared_ptr<std::atomic<bool>> cancelled;
+    std::future<ArrayStatistics> task;
+    ArrayStatistics statistics;
+    bool ready = false;
+};
+
+template <typename ValueT> static void UpdateStatisticsCache(const VtValue &value, ArrayStatisticsCache &cache) {
+    const VtArray<ValueT> &array = value.UncheckedGet<VtArray<ValueT>>();
+    if (array.cdata() == cache.arrayData && array.size() == cache.arraySize) {
+        return;
+    }
+    cache.Cancel();
+    cache.array = value;
+    cache.arrayData = array.cdata();
+    cache.arraySize = array.size();
+    cache.ready = false;
+    cache.cancelled = std::make_shared<std::atomic<bool>>(false);
+    // The task has its own copy of the array sharing the buffer, it stays valid if the layer is modified
+    std::shared_ptr<std::atomic<bool>> cancelled = cache.cancelled;
+    cache.task = std::async(std::launch::async,
+                            [array, cancelled]() { return ComputeArrayStatistics<ValueT>(array, *cancelled); });
+}
+
+#define UpdateStatisticsIfHolding(ValueT)                                                                                       \
+    if (value.IsHolding<VtArray<ValueT>>()) {                                                                                    \
+        UpdateStatisticsCache<ValueT>(value, cache);                                                                             \
+    } else
+
+static void DrawStatistics(const ArrayStatistics &statistics) {
+    static const char *componentNames[] = {"x", "y", "z", "w"};
+    ImGui::Text("%zu elements", statistics.size);
+    if (statistics.nanCount || statistics.infCount) {
+        ImGui::SameLine();
+        ImGui::TextColored(ImVec4(1.0, 0.2, 0.2, 1.0), "%zu NaN, %zu Inf", statistics.nanCount, statistics.infCount);
+    }
+    const ImGuiTableFlags tableFlags = ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_RowBg;
+    if (ImGui::BeginTable("##ArrayStatistics", static_cast<int>(statistics.dimension) + 1, tableFlags)) {
+        ImGui::TableSetupColumn("");
+        for (size_t c = 0; c < statistics.dimension; ++c) {
+            ImGui::TableSetupColumn(statistics.dimension > 1 ? componentNames[c] : "value");
+        }
+        ImGui::TableHeadersRow();
+        auto drawRow = [&](const char *label, const std::array<double, MaxComponents> &values) {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::Text("%s", label);
+            for (size_t c = 0; c < statistics.dimension; ++c) {
+                ImGui::TableSetColumnIndex(static_cast<int>(c) + 1);
+                ImGui::Text("%g", values[c]);
+            }
+        };
+        // For vectors the min and max rows are the bounding box
+        drawRow("min", statistics.min);
+        drawRow("max", statistics.max);
+        drawRow("mean", statistics.mean);
+        ImGui::EndTable();
+    }
+    char overlay[128];
+    snprintf(overlay, sizeof(overlay), "%s [%g, %g]", statistics.dimension > 1 ? "length" : "value",
+             statistics.histogramMin, statistics.histogramMax);
+    ImGui::PlotHistogram("##ArrayHistogram", statistics.histogram.data(), HistogramBins, 0, overlay, 0.f, FLT_MAX,
+                         ImVec2(-FLT_MIN, 60));
+}
+
+void DrawVtArrayStatistics(const VtValue &value) {
+    static ArrayStatisticsCache cache;
+    if (!value.IsArrayValued()) {
+        return;
+    }
+    // clang-format off
+    UpdateStatisticsIfHolding(float)
+    UpdateStatisticsIfHolding(double)
+    UpdateStatisticsIfHolding(GfHalf)
+    UpdateStatisticsIfHolding(int)
+    UpdateStatisticsIfHolding(unsigned int)
+    UpdateStatisticsIfHolding(int64_t)
+    UpdateStatisticsIfHolding(uint64_t)
+    UpdateStatisticsIfHolding(unsigned char)
+    UpdateStatisticsIfHolding(GfVec2f)
+    UpdateStatisticsIfHolding(GfVec3f)
+    UpdateStatisticsIfHolding(GfVec4f)
+    UpdateStatisticsIfHolding(GfVec2d)
+    UpdateStatisticsIfHolding(GfVec3d)
+    UpdateStatisticsIfHolding(GfVec4d)
+    UpdateStatisticsIfHolding(GfVec2h)
+    UpdateStatisticsIfHolding(GfVec3h)
+    UpdateStatisticsIfHolding(GfVec4h)
+    UpdateStatisticsIfHolding(GfVec2i)
+    UpdateStatisticsIfHolding(GfVec3i)
+    UpdateStatisticsIfHolding(GfVec4i)
+    { return; } // Not a numeric array
+    // clang-format on
+
+    if (!ImGui::CollapsingHeader("Statistics", ImGuiTreeNodeFlags_DefaultOpen)) {
+        return;
+    }
+    if (!cache.ready && cache.task.valid() &&
+        cache.task.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        cache.statistics = cache.task.get();
+        cache.ready = true;
+    }
+    if (cache.ready) {
+        DrawStatistics(cache.statistics);
+    } else {
+        ImGui::Text("Computing statistics of %zu elements...", cache.arraySize);
+    }
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <pxr/base/vt/value.h>
+
+PXR_NAMESPACE_USING_DIRECTIVE
+
+/// Draw a summary of a numeric array: min, max, mean per component, NaN and Inf counts and a histogram.
+/// The statistics are computed in the background on multiple threads, the result is cached until the array changes.
+/// Nothing is drawn if the array doesn't hold numeric values
+void DrawVtArrayStatistics(const VtValue &array);
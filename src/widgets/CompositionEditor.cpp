@@ -491,28 +491,53 @@ template <typename CompositionArcItemT> void DrawCompositionEditor(const SdfPrim
     }
 }
 
+// Prim spec and arc type to show the next time the compositions are drawn, set from the composition profiler
+static SdfPath focusedPrimPath;
+static PcpArcType focusedArcType = PcpArcTypeRoot;
+
+void FocusPrimCompositions(const SdfPath &primPath, PcpArcType arcType) {
+    focusedPrimPath = primPath;
+    focusedArcType = arcType;
+}
+
+static ImGuiTabItemFlags GetCompositionTabFlags(bool hasArcs, bool isFocused, PcpArcType arcType) {
+    ImGuiTabItemFlags flags = hasArcs ? ImGuiTabItemFlags_UnsavedDocument : ImGuiTabItemFlags_None;
+    if (isFocused && focusedArcType == arcType) {
+        flags |= ImGuiTabItemFlags_SetSelected;
+    }
+    return flags;
+}
+
 void DrawPrimCompositions(const SdfPrimSpecHandle &primSpec) {
     if (!primSpec || !HasComposition(primSpec))
         return;
+    const bool isFocused = primSpec->GetPath() == focusedPrimPath;
+    if (isFocused) {
+        ImGui::SetNextItemOpen(true);
+        focusedPrimPath = SdfPath();
+    }
     if (ImGui::CollapsingHeader("Composition", ImGuiTreeNodeFlags_DefaultOpen)) {
+        if (isFocused) {
+            ImGui::SetScrollHereY(0.f);
+        }
         if (ImGui::BeginTabBar("##CompositionType")) {
             if (ImGui::BeginTabItem("References", nullptr,
-                                    primSpec->HasReferences() ? ImGuiTabItemFlags_UnsavedDocument : ImGuiTabItemFlags_None)) {
+                                    GetCompositionTabFlags(primSpec->HasReferences(), isFocused, PcpArcTypeReference))) {
                 DrawCompositionEditor<SdfReference>(primSpec);
                 ImGui::EndTabItem();
             }
             if (ImGui::BeginTabItem("Payloads", nullptr,
-                                    primSpec->HasPayloads() ? ImGuiTabItemFlags_UnsavedDocument : ImGuiTabItemFlags_None)) {
+                                    GetCompositionTabFlags(primSpec->HasPayloads(), isFocused, PcpArcTypePayload))) {
                 DrawCompositionEditor<SdfPayload>(primSpec);
                 ImGui::EndTabItem();
             }
             if (ImGui::BeginTabItem("Inherits", nullptr,
-                                    primSpec->HasInheritPaths() ? ImGuiTabItemFlags_UnsavedDocument : ImGuiTabItemFlags_None)) {
+                                    GetCompositionTabFlags(primSpec->HasInheritPaths(), isFocused, PcpArcTypeInherit))) {
                 DrawCompositionEditor<SdfInherit>(primSpec);
                 ImGui::EndTabItem();
             }
             if (ImGui::BeginTabItem("Specializes", nullptr,
-                                    primSpec->HasSpecializes() ? ImGuiTabItemFlags_UnsavedDocument : ImGuiTabItemFlags_None)) {
+                                    GetCompositionTabFlags(primSpec->HasSpecializes(), isFocused, PcpArcTypeSpecialize))) {
                 DrawCompositionEditor<SdfSpecialize>(primSpec);
                 ImGui::EndTabItem();
             }
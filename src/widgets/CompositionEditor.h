@@ -1,4 +1,5 @@
 #pragma once
+#include <pxr/usd/pcp/types.h>
 #include <pxr/usd/sdf/primSpec.h>
 
 PXR_NAMESPACE_USING_DIRECTIVE
@@ -12,5 +13,8 @@ void DrawPrimCreateSpecialize(const SdfPrimSpecHandle &primSpec);
 /// Draw multiple tables with the compositions (Reference, Payload, Inherit, Specialize)
 void DrawPrimCompositions(const SdfPrimSpecHandle &primSpec);
 
+/// Open the compositions the next time the prim spec at primPath is drawn, with the tab of arcType selected
+void FocusPrimCompositions(const SdfPath &primPath, PcpArcType arcType);
+
 // Draw a text summary of the composition
 void DrawPrimCompositionSummary(const SdfPrimSpecHandle &primSpec);
@@ -6,7 +6,11 @@
 #include <pxr/usd/usdShade/nodeGraph.h>
 #include <pxr/usd/usdShade/material.h>
 #include <pxr/usd/usdUI/nodeGraphNodeAPI.h>
+#include <pxr/usd/usd/notice.h>
 #include <iostream>
+#include <unordered_map>
+
+PXR_NAMESPACE_USING_DIRECTIVE
 
 /* 
  * Code copied from the USD repository, it extracts the shaders from a network of connected prims
@@ -167,199 +171,223 @@ function UsdImagingBuildHdMaterialNetworkFromTerminal
 
 */
 
-using _PathSet = std::unordered_set<SdfPath, SdfPath::Hash>;
-
 /*
  * Code copied from imgui node graph examples
  */
 
-// Dummy
 struct Node
 {
-    int     ID;
-    //char    Name[32]; // TODO: don't store node name, rather store the node path
-    SdfPath Path;
-    ImVec2  Pos, Size;
-    float   Value;
-    ImVec4  Color;
-    int     InputsCount, OutputsCount;
-
-    Node(int id, const SdfPath &path, const ImVec2& pos, float value, const ImVec4& color, int inputs_count, int outputs_count) { ID = id; Path=path; Pos = pos; Value = value; Color = color; InputsCount = inputs_count; OutputsCount = outputs_count; }
+    SdfPath     Path;
+    std::string Name;
+    std::string Identifier; // info:id of the shader
+    ImVec2      Pos, Size;
+    int         InputsCount, OutputsCount;
 
     ImVec2 GetInputSlotPos(int slot_no) const { return ImVec2(Pos.x, Pos.y + Size.y * ((float)slot_no + 1) / ((float)InputsCount + 1)); }
     ImVec2 GetOutputSlotPos(int slot_no) const { return ImVec2(Pos.x + Size.x, Pos.y + Size.y * ((float)slot_no + 1) / ((float)OutputsCount + 1)); }
 };
 
-
-// Store the prim node graphic state: position, color, etc ...
-using PrimNodesT = std::unordered_map<SdfPath, Node*, SdfPath::Hash>;
-
-static PrimNodesT primNodes = PrimNodesT();
-
 struct NodeLink
 {
     int InputIdx, InputSlot, OutputIdx, OutputSlot;
     NodeLink(int input_idx, int input_slot, int output_idx, int output_slot) { InputIdx = input_idx; InputSlot = input_slot; OutputIdx = output_idx; OutputSlot = output_slot; }
 };
 
-// Stores the number of node per depth
-static std::vector<int> nodeLayout = {};
+/// Retained node graph of the material shown in the editor.
+/// The nodes and links are rebuilt only when the material changes or when a prim of the material subtree or
+/// of the graph is modified. The node positions are kept per prim path so the layout survives the rebuilds
+/// and the switches between materials.
+class ShadingGraph : public TfWeakBase {
+  public:
+    ~ShadingGraph() { TfNotice::Revoke(_objectsChangedKey); }
+
+    void Update(const UsdPrim &prim) {
+        const UsdStageWeakPtr stage = prim ? prim.GetStage() : UsdStageWeakPtr();
+        if (stage != _stage) {
+            TfNotice::Revoke(_objectsChangedKey);
+            _stage = stage;
+            _layout.clear();
+            if (_stage) {
+                TfWeakPtr<ShadingGraph> me(this);
+                _objectsChangedKey = TfNotice::Register(me, &ShadingGraph::OnObjectsChanged, _stage);
+            }
+            _isDirty = true;
+        }
+        const SdfPath materialPath = prim ? prim.GetPath() : SdfPath();
+        if (materialPath != _materialPath) {
+            _materialPath = materialPath;
+            _isDirty = true;
+        }
+        if (_isDirty) {
+            Build(prim);
+            _isDirty = false;
+        }
+    }
 
+    /// Store the position of a node moved by the user
+    void MoveNode(int nodeIdx, const ImVec2 &delta) {
+        Node &node = _nodes[nodeIdx];
+        node.Pos = node.Pos + delta;
+        _layout[node.Path] = node.Pos;
+    }
 
-int _WalkGraph(UsdShadeConnectableAPI const & shadeNode,
-                _PathSet &visitedNodes,
-                ImVector<Node*> &nodes, ImVector<NodeLink> &links, int depth) {
+    std::vector<Node> &GetNodes() { return _nodes; }
+    const std::vector<NodeLink> &GetLinks() const { return _links; }
+    const SdfPath &GetMaterialPath() const { return _materialPath; }
+    const UsdStageWeakPtr &GetStage() const { return _stage; }
 
-    if (!shadeNode) {
-        return 0;
-    }
-    //visitedNodes.clear();
-    if (!visitedNodes.insert(shadeNode.GetPath()).second) {
-        return 0;
-    }
-    //std::cout << shadeNode.GetPath().GetString() << std::endl;
-    if (nodeLayout.size()<=depth) {nodeLayout.push_back(1);}
-    else {nodeLayout[depth]++;}
-    int nodeId = nodes.size();
-    auto nodeIt = primNodes.find(shadeNode.GetPath());
-    if (nodeIt == primNodes.end()){
-        primNodes[shadeNode.GetPath()] = new Node(nodeId, shadeNode.GetPath(),
-                           ImVec2(-depth * 300, nodeLayout[depth]*50), 0.5f,
-                           ImColor(255, 100, 100), shadeNode.GetInputs().size(), shadeNode.GetOutputs().size());
-        nodes.push_back(primNodes[shadeNode.GetPath()]);
-    } else {
-        nodeIt->second->ID = nodeId;
-        nodes.push_back(nodeIt->second);
+  private:
+    void OnObjectsChanged(const UsdNotice::ObjectsChanged &notice, const UsdStageWeakPtr &sender) {
+        if (_isDirty || _materialPath.IsEmpty()) {
+            return;
+        }
+        auto isInGraph = [&](const SdfPath &path) {
+            const SdfPath primPath = path.GetPrimPath();
+            return primPath.HasPrefix(_materialPath) || _nodeIndices.find(primPath) != _nodeIndices.end();
+        };
+        // The resync of an ancestor also changes the material
+        for (const auto &path : notice.GetResyncedPaths()) {
+            if (isInGraph(path) || _materialPath.HasPrefix(path)) {
+                _isDirty = true;
+                return;
+            }
+        }
+        for (const auto &path : notice.GetChangedInfoOnlyPaths()) {
+            if (isInGraph(path)) {
+                _isDirty = true;
+                return;
+            }
+        }
     }
 
+    void Build(const UsdPrim &prim) {
+        _nodes.clear();
+        _links.clear();
+        _nodeIndices.clear();
+        UsdShadeMaterial material(prim);
+        if (!material)
+            return;
+
+        // TODO nodes for the material outputs
+        // TODO: should we be able to edit the material in context ? purpose etc
+
+        ///
+        /// Returns a list, in descending order of preference, that can be used to
+        /// select among multiple material network implementations. The default
+        /// list contains an empty token.
+        /// This is generally provided by the renderDelegate
+        const TfTokenVector contextVector{TfToken("render"), TfToken("mtlx"), TfToken("arnold")}; //= _GetMaterialRenderContexts();
+        if (UsdShadeShader surface = material.ComputeSurfaceSource(contextVector)) {
+            std::vector<int> nodesPerDepth;
+            WalkGraph(UsdShadeConnectableAPI(surface), 0, nodesPerDepth);
+        }
+    }
 
-    // Visit the inputs of this node to ensure they are emitted first.
-    const std::vector<UsdShadeInput> shadeNodeInputs = shadeNode.GetInputs();
-    int inputIdx = 0;
-    for (UsdShadeInput input: shadeNodeInputs) {
-        TfToken inputName = input.GetBaseName();
-        // Find the attribute this input is getting its value from, which might
-        // be an output or an input, including possibly itself if not connected
-        UsdShadeAttributeType attrType;
-        UsdAttribute attr = input.GetValueProducingAttribute(&attrType); // DEPRECATED
-        // THIS DOESN'T SHOW THE NODE GRAPHS !
-        if (attrType == UsdShadeAttributeType::Output) {
-            // If it is an output on a shading node we visit the node and also
-            // create a relationship in the network
-            int outputIdx = _WalkGraph(UsdShadeConnectableAPI(attr.GetPrim()), visitedNodes, nodes, links, depth+1);
-            // TODO : link this input to the output
-            if (outputIdx)
-                links.push_back(NodeLink(nodeId, inputIdx, outputIdx, 0));
-            
-        } else if (attrType == UsdShadeAttributeType::Input) {
-            // If it is an input attribute we get the authored value.
-            //
-            // If its type is asset and contains <UDIM>,
-            // we resolve the asset path with the udim pattern to a file
-            // path with a udim pattern, e.g.,
-            // /someDir/myImage.<UDIM>.exr to /filePath/myImage.<UDIM>.exr.
-            //const VtValue value = _ResolveMaterialParamValue(attr, time);
+    // Returns the index of the node, or -1 if it is not a valid node
+    int WalkGraph(UsdShadeConnectableAPI const &shadeNode, int depth, std::vector<int> &nodesPerDepth) {
+        if (!shadeNode) {
+            return -1;
+        }
+        // The node was already visited, from another input or from a cycle
+        const SdfPath &path = shadeNode.GetPath();
+        auto visited = _nodeIndices.find(path);
+        if (visited != _nodeIndices.end()) {
+            return visited->second;
+        }
+        if (nodesPerDepth.size() <= depth) {
+            nodesPerDepth.push_back(1);
         } else {
-           // std::cout << "unknown " << attr.GetPath().GetString() << std::endl;
+            nodesPerDepth[depth]++;
+        }
+        const int nodeIdx = static_cast<int>(_nodes.size());
+        _nodeIndices[path] = nodeIdx;
+
+        const std::vector<UsdShadeInput> shadeNodeInputs = shadeNode.GetInputs();
+        Node node;
+        node.Path = path;
+        node.Name = shadeNode.GetPrim().GetName().GetString();
+        const auto infoIdAttr = shadeNode.GetPrim().GetAttribute(TfToken("info:id"));
+        TfToken infoId;
+        if (infoIdAttr && infoIdAttr.Get(&infoId)) {
+            node.Identifier = infoId.GetString();
+        }
+        auto layout = _layout.find(path);
+        node.Pos = layout != _layout.end() ? layout->second : ImVec2(-depth * 300, nodesPerDepth[depth] * 50);
+        node.Size = ImVec2(0, 0); // Computed when the node is drawn
+        node.InputsCount = static_cast<int>(shadeNodeInputs.size());
+        node.OutputsCount = static_cast<int>(shadeNode.GetOutputs().size());
+        _nodes.push_back(node);
+
+        // Visit the inputs of this node to ensure they are emitted first.
+        int inputIdx = 0;
+        for (UsdShadeInput input : shadeNodeInputs) {
+            // Find the attribute this input is getting its value from, which might
+            // be an output or an input, including possibly itself if not connected
+            UsdShadeAttributeType attrType;
+            UsdAttribute attr = input.GetValueProducingAttribute(&attrType); // DEPRECATED
+            // THIS DOESN'T SHOW THE NODE GRAPHS !
+            if (attrType == UsdShadeAttributeType::Output) {
+                // If it is an output on a shading node we visit the node and also
+                // create a relationship in the network
+                const int outputIdx = WalkGraph(UsdShadeConnectableAPI(attr.GetPrim()), depth + 1, nodesPerDepth);
+                if (outputIdx >= 0)
+                    _links.push_back(NodeLink(nodeIdx, inputIdx, outputIdx, 0));
+            }
+            inputIdx++;
         }
-        inputIdx++;
+        return nodeIdx;
     }
-    return nodeId;
-}
 
+    UsdStageWeakPtr _stage;
+    SdfPath _materialPath;
+    bool _isDirty = true;
+    TfNotice::Key _objectsChangedKey;
 
-void BuildNodeGraph(const UsdPrim &prim, ImVector<Node*> &nodes, ImVector<NodeLink> &links) {
-    UsdShadeMaterial material(prim);
-    nodeLayout.clear();
-    nodes.clear(); // TODO: how do we keep the position of the nodes ???
-    links.clear();
-    if (!material) return;
-    
-    // TODO nodes for the material outputs
-    // TODO: should we be able to edit the material in context ? purpose etc
-    
-    ///
-    /// Returns a list, in descending order of preference, that can be used to
-    /// select among multiple material network implementations. The default
-    /// list contains an empty token.
-    /// This is generally provided by the renderDelegate
-    const TfTokenVector contextVector{TfToken("render"), TfToken("mtlx"), TfToken("arnold")}; //= _GetMaterialRenderContexts();
-    if (UsdShadeShader surface = material.ComputeSurfaceSource(contextVector)) {
-        static _PathSet visitedNodes;
-        visitedNodes.clear();
-        _WalkGraph(UsdShadeConnectableAPI(surface), visitedNodes, nodes, links, 0);
-    }
-    
-}
+    std::vector<Node> _nodes;
+    std::vector<NodeLink> _links;
+    std::unordered_map<SdfPath, int, SdfPath::Hash> _nodeIndices;
+
+    // Node positions of all the materials of the stage
+    std::unordered_map<SdfPath, ImVec2, SdfPath::Hash> _layout;
+};
 
 
 static void ShowExampleAppCustomNodeGraph(const UsdPrim &prim)
 {
     ImGui::SetNextWindowSize(ImVec2(700, 600), ImGuiCond_FirstUseEver);
     if (!prim) return;
-    
-    static UsdPrim lastMaterialPrim;
-    UsdShadeMaterial material(prim);
-    if((!lastMaterialPrim || lastMaterialPrim!=prim) && material) {
-        lastMaterialPrim = prim;
-    }
 
     // State
-    static ImVector<Node*> nodes;
-    static ImVector<NodeLink> links;
+    static ShadingGraph graph;
     static ImVec2 scrolling = ImVec2(0.0f, 0.0f);
-    static bool inited = false;
     static bool show_grid = true;
     static int node_selected = -1;
 
-    // Initialization
+    // Keep showing the last material when the selected prim is not a material
+    if (UsdShadeMaterial(prim) || !graph.GetStage() || graph.GetStage() != prim.GetStage()) {
+        graph.Update(prim);
+    } else {
+        graph.Update(prim.GetStage()->GetPrimAtPath(graph.GetMaterialPath()));
+    }
+    std::vector<Node> &nodes = graph.GetNodes();
+    const std::vector<NodeLink> &links = graph.GetLinks();
+    if (node_selected >= static_cast<int>(nodes.size()))
+        node_selected = -1;
+
     ImGuiIO& io = ImGui::GetIO();
-//    if (!inited)
-//    {
-//        nodes.push_back(Node(0, "MainTex", ImVec2(40, 50), 0.5f, ImColor(255, 100, 100), 1, 1));
-//        nodes.push_back(Node(1, "BumpMap", ImVec2(40, 150), 0.42f, ImColor(200, 100, 200), 1, 1));
-//        nodes.push_back(Node(2, "Combine", ImVec2(270, 80), 1.0f, ImColor(0, 200, 100), 2, 2));
-//        links.push_back(NodeLink(0, 0, 2, 0));
-//        links.push_back(NodeLink(1, 0, 2, 1));
-//        inited = true;
-//    }
-    int nodeId = 0;
-    //UsdShadeNodeGraph nodeGraph(prim);
-    //UsdUINodeGraphNodeAPI uiNodeGraph(prim);
-    // TO walk the graph one needs to use UsdShadeConnectableAPI
-    //UsdShadeConnectableAPI api(prim);
-//    if (nodeGraph) {
-//        UsdUINodeGraphNodeAPI::Apply(prim);
-//        auto nodeGraphOutputs = nodeGraph.GetOutputs();
-//        nodes.clear();
-//        links.clear();
-//        for (const auto &output : nodeGraphOutputs) {
-//            auto outputPrim = output.GetPrim();
-//            // outputPrim.GetName().GetString().c_str()
-//            nodes.push_back(Node(nodeId++, output.GetFullName().GetString().c_str(), ImVec2(-nodeId * 300, 50), 0.5f,
-//                                 ImColor(255, 100, 100), 1, 1));
-//            auto inputs = output.GetValueProducingAttributes();
-//            for (const auto &inPrim : inputs) {
-//                nodes.push_back(Node(nodeId++, inPrim.GetPrim().GetName().GetString().c_str(), ImVec2(-nodeId * 300, 50), 0.5f,
-//                                     ImColor(255, 100, 100), 1, 1));
-//            }
-//        }
-//    }
-
-    BuildNodeGraph(lastMaterialPrim, nodes, links);
+
     // Draw a list of nodes on the left side
     bool open_context_menu = false;
     int node_hovered_in_list = -1;
     int node_hovered_in_scene = -1;
 
     ImGui::BeginGroup();
-    
-    if(lastMaterialPrim) {
-        ImGui::Text("%s", lastMaterialPrim.GetPath().GetText());
+
+    if (!graph.GetMaterialPath().IsEmpty()) {
+        ImGui::Text("%s", graph.GetMaterialPath().GetText());
         ImGui::SameLine(ImGui::GetWindowWidth() - 100);
     }
 
-
     const float NODE_SLOT_RADIUS = 4.0f;
     const ImVec2 NODE_WINDOW_PADDING(8.0f, 8.0f);
 
@@ -377,6 +405,9 @@ static void ShowExampleAppCustomNodeGraph(const UsdPrim &prim)
     const ImVec2 offset = ImGui::GetCursorScreenPos() + scrolling;
     ImDrawList* draw_list = ImGui::GetWindowDrawList();
 
+    // Only the nodes and links overlapping the canvas are drawn
+    const ImRect canvas(ImGui::GetWindowPos(), ImGui::GetWindowPos() + ImGui::GetWindowSize());
+
     // Display grid
     if (show_grid) {
         ImU32 GRID_COLOR = IM_COL32(200, 200, 200, 40);
@@ -392,74 +423,68 @@ static void ShowExampleAppCustomNodeGraph(const UsdPrim &prim)
     // Display links
     draw_list->ChannelsSplit(2);
     draw_list->ChannelsSetCurrent(0); // Background
-    for (int link_idx = 0; link_idx < links.Size; link_idx++)
+    for (const NodeLink &link : links)
     {
-        NodeLink* link = &links[link_idx];
-        Node* node_inp = nodes[link->InputIdx];
-        Node* node_out = nodes[link->OutputIdx];
-        ImVec2 p1 = offset + node_inp->GetInputSlotPos(link->InputSlot);
-        ImVec2 p2 = offset + node_out->GetOutputSlotPos(link->OutputSlot);
+        const Node &node_inp = nodes[link.InputIdx];
+        const Node &node_out = nodes[link.OutputIdx];
+        ImVec2 p1 = offset + node_inp.GetInputSlotPos(link.InputSlot);
+        ImVec2 p2 = offset + node_out.GetOutputSlotPos(link.OutputSlot);
+        // The curve stays inside the box of its control points
+        ImRect link_rect(ImMin(p1, p2) - ImVec2(50, 0), ImMax(p1, p2) + ImVec2(50, 0));
+        if (!canvas.Overlaps(link_rect))
+            continue;
         draw_list->AddBezierCubic(p1, p1 + ImVec2(-50, 0), p2 + ImVec2(+50, 0), p2, IM_COL32(200, 200, 100, 255), 3.0f);
     }
 
     // Display nodes
-    for (int node_idx = 0; node_idx < nodes.Size; node_idx++)
+    for (int node_idx = 0; node_idx < static_cast<int>(nodes.size()); node_idx++)
     {
-        Node* node = nodes[node_idx];
-        ImGui::PushID(node->ID);
-        ImVec2 node_rect_min = offset + node->Pos;
+        Node &node = nodes[node_idx];
+        ImVec2 node_rect_min = offset + node.Pos;
+        // The size is known after the first draw, the nodes without a size are always drawn
+        if (node.Size.x > 0 && !canvas.Overlaps(ImRect(node_rect_min, node_rect_min + node.Size)))
+            continue;
+        ImGui::PushID(node_idx);
 
         // Display node contents first
         draw_list->ChannelsSetCurrent(1); // Foreground
         bool old_any_active = ImGui::IsAnyItemActive();
         ImGui::SetCursorScreenPos(node_rect_min + NODE_WINDOW_PADDING);
         ImGui::BeginGroup(); // Lock horizontal position
-        UsdPrim nodePrim = prim.GetStage()->GetPrimAtPath(node->Path);
-        ImGui::Text("%s", nodePrim.GetName().GetText());
-
-
-        //UsdShadeConnectableAPI shader(nodePrim);
-        const auto infoIdAttr = nodePrim.GetAttribute(TfToken("info:id"));
-        if (infoIdAttr) {
-            VtValue infoIdVal;
-            infoIdAttr.Get(&infoIdVal, SdfTimeCode());
-            ImGui::Text("%s", infoIdVal.Get<TfToken>().GetText());
+        ImGui::Text("%s", node.Name.c_str());
+        if (!node.Identifier.empty()) {
+            ImGui::Text("%s", node.Identifier.c_str());
         }
-        //ImGui::SliderFloat("##value", &node->Value, 0.0f, 1.0f, "Alpha %.2f");
-        //ImGui::ColorEdit3("##color", &node->Color.x);
-//        for(int i=0; i<std::max(node->InputsCount, node->OutputsCount); ++i) {
-//            ImGui::Text("");
-//        }
         ImGui::EndGroup();
 
         // Save the size of what we have emitted and whether any of the widgets are being used
         bool node_widgets_active = (!old_any_active && ImGui::IsAnyItemActive());
-        node->Size = ImGui::GetItemRectSize() + NODE_WINDOW_PADDING + NODE_WINDOW_PADDING;
-        ImVec2 node_rect_max = node_rect_min + node->Size;
+        node.Size = ImGui::GetItemRectSize() + NODE_WINDOW_PADDING + NODE_WINDOW_PADDING;
+        ImVec2 node_rect_max = node_rect_min + node.Size;
 
         // Display node box
         draw_list->ChannelsSetCurrent(0); // Background
         ImGui::SetCursorScreenPos(node_rect_min);
-        if(ImGui::InvisibleButton("node", node->Size)){
-            ExecuteAfterDraw<EditorSetSelection>(prim.GetStage(), node->Path);
+        if(ImGui::InvisibleButton("node", node.Size)){
+            ExecuteAfterDraw<EditorSetSelection>(prim.GetStage(), node.Path);
         }
         if (ImGui::IsItemHovered())
         {
-            node_hovered_in_scene = node->ID;
+            node_hovered_in_scene = node_idx;
             open_context_menu |= ImGui::IsMouseClicked(1);
         }
         bool node_moving_active = ImGui::IsItemActive();
         if (node_widgets_active || node_moving_active)
-            node_selected = node->ID;
+            node_selected = node_idx;
         if (node_moving_active && ImGui::IsMouseDragging(ImGuiMouseButton_Left))
-            node->Pos = node->Pos + io.MouseDelta;
-        ImU32 node_bg_color = (node_hovered_in_list == node->ID || node_hovered_in_scene == node->ID || (node_hovered_in_list == -1 && node_selected == node->ID)) ? IM_COL32(75, 75, 75, 255) : IM_COL32(60, 60, 60, 255);
+            graph.MoveNode(node_idx, io.MouseDelta);
+        ImU32 node_bg_color = (node_hovered_in_list == node_idx || node_hovered_in_scene == node_idx || (node_hovered_in_list == -1 && node_selected == node_idx)) ? IM_COL32(75, 75, 75, 255) : IM_COL32(60, 60, 60, 255);
         draw_list->AddRectFilled(node_rect_min, node_rect_max, node_bg_color, 4.0f);
         draw_list->AddRect(node_rect_min, node_rect_max, IM_COL32(100, 100, 100, 255), 4.0f);
-        for (int slot_idx = 0; slot_idx < node->InputsCount; slot_idx++)
-            draw_list->AddCircleFilled(offset + node->GetInputSlotPos(slot_idx), NODE_SLOT_RADIUS, IM_COL32(150, 150, 150, 150));
-        for (int slot_idx = 0; slot_idx < node->OutputsCount; slot_idx++)
-            draw_list->AddCircleFilled(offset + node->GetOutputSlotPos(slot_idx), NODE_SLOT_RADIUS, IM_COL32(150, 150, 150, 150));
+        for (int slot_idx = 0; slot_idx < node.InputsCount; slot_idx++)
+            draw_list->AddCircleFilled(offset + node.GetInputSlotPos(slot_idx), NODE_SLOT_RADIUS, IM_COL32(150, 150, 150, 150));
+        for (int slot_idx = 0; slot_idx < node.OutputsCount; slot_idx++)
+            draw_list->AddCircleFilled(offset + node.GetOutputSlotPos(slot_idx), NODE_SLOT_RADIUS, IM_COL32(150, 150, 150, 150));
 
         ImGui::PopID();
     }
@@ -485,11 +510,10 @@ static void ShowExampleAppCustomNodeGraph(const UsdPrim &prim)
     ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(8, 8));
     if (ImGui::BeginPopup("context_menu"))
     {
-        Node* node = node_selected != -1 ? nodes[node_selected] : NULL;
-        ImVec2 scene_pos = ImGui::GetMousePosOnOpeningCurrentPopup() - offset;
+        Node* node = node_selected != -1 ? &nodes[node_selected] : NULL;
         if (node)
         {
-            //ImGui::Text("Node '%s'", node->Name);
+            ImGui::Text("Node '%s'", node->Name.c_str());
             ImGui::Separator();
             if (ImGui::MenuItem("Rename..", NULL, false, false)) {}
             if (ImGui::MenuItem("Delete", NULL, false, false)) {}
@@ -497,7 +521,6 @@ static void ShowExampleAppCustomNodeGraph(const UsdPrim &prim)
         }
         else
         {
-            //if (ImGui::MenuItem("Add")) { nodes.push_back(Node(nodes.Size, "New node", scene_pos, 0.5f, ImColor(100, 100, 200), 2, 2)); }
             if (ImGui::MenuItem("Paste", NULL, false, false)) {}
         }
         ImGui::EndPopup();
@@ -521,8 +544,6 @@ static void ShowExampleAppCustomNodeGraph(const UsdPrim &prim)
 
 }
 
-PXR_NAMESPACE_USING_DIRECTIVE
-
 void DrawConnectionEditor(const UsdPrim &prim){
     ShowExampleAppCustomNodeGraph(prim);
 }
@@ -13,6 +13,7 @@
 #include "TextFilter.h"
 #include "ModalDialogs.h"
 #include "FileBrowser.h"
+#include "LayerSaveJob.h"
 
 PXR_NAMESPACE_USING_DIRECTIVE
 
@@ -134,11 +135,13 @@ static const std::string &LayerNameFromOptions(const SdfLayerHandle &layer, cons
 }
 
 static inline void DrawSaveButton(SdfLayerHandle layer) {
+    // The hourglass is shown while the layer is written in the background
+    const bool isSaving = IsLayerBeingSaved(layer);
     ScopedStyleColor style(ImGuiCol_Button, ImVec4(ColorTransparent), ImGuiCol_Text,
                            layer->IsAnonymous() ? ImVec4(ColorTransparent)
-                                                : (layer->IsDirty() ? ImVec4(1.0, 1.0, 1.0, 1.0) : ImVec4(ColorTransparent)));
-    if (ImGui::Button(ICON_FA_SAVE "###Save")) {
-        ExecuteAfterDraw(&SdfLayer::Save, layer, true);
+                                                : (layer->IsDirty() || isSaving ? ImVec4(1.0, 1.0, 1.0, 1.0) : ImVec4(ColorTransparent)));
+    if (ImGui::Button(isSaving ? ICON_FA_HOURGLASS_HALF "###Save" : ICON_FA_SAVE "###Save")) {
+        ExecuteAfterDraw<EditorSaveLayer>(layer);
     }
 }
 
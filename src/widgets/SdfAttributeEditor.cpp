@@ -44,13 +44,13 @@ struct CreateTimeSampleDialog : public ModalDialog {
         DrawOkCancelModal([=]() {
             VtValue value = typeName.GetDefaultValue();
             if (_copyClosestValue) { // we are normally sure that there is a least one element
-                // This is not really the closest element right now
-                auto sampleSet = _layer->ListTimeSamplesForPath(_attrPath);
-                auto it = std::lower_bound(sampleSet.begin(), sampleSet.end(), _timeCode);
-                if (it==sampleSet.end()) {
-                    it--;
+                // The bracketing samples are found without copying the set of samples
+                double lower = 0.0;
+                double upper = 0.0;
+                if (_layer->GetBracketingTimeSamplesForPath(_attrPath, _timeCode, &lower, &upper)) {
+                    const double closest = (_timeCode - lower <= upper - _timeCode) ? lower : upper;
+                    _layer->QueryTimeSample(_attrPath, closest, &value);
                 }
-                _layer->QueryTimeSample(_attrPath, *it, &value);
             } else if (_isArray && ! _hasDefault) {
                 
             }
@@ -274,24 +274,33 @@ static void DrawSamplesAtTimeCode(const SdfAttributeSpecHandle &attr, SdfTimeSam
     if (selectedKeyframe == UsdTimeCode::Default()) {
         if (attr->HasDefaultValue()) {
             VtValue value = attr->GetDefaultValue();
-            VtValue editedValue = value.IsArrayValued() ? DrawVtArrayValue(value) : DrawVtValue("##default", value);
-            if (editedValue != VtValue()) {
-                ExecuteAfterDraw(&SdfAttributeSpec::SetDefaultValue, attr, editedValue);
+            if (value.IsArrayValued()) {
+                VtArrayPatch patch = DrawVtArrayValue(value);
+                if (!patch.IsEmpty()) {
+                    ExecuteAfterDraw<AttributePatchArray>(attr->GetLayer(), attr->GetPath(), UsdTimeCode::Default(), patch);
+                }
+            } else {
+                VtValue editedValue = DrawVtValue("##default", value);
+                if (editedValue != VtValue()) {
+                    ExecuteAfterDraw(&SdfAttributeSpec::SetDefaultValue, attr, editedValue);
+                }
             }
         }
     } else {
         auto foundSample = timeSamples.find(selectedKeyframe.GetValue());
         if (foundSample != timeSamples.end()) {
-            VtValue editResult;
             if (foundSample->second.IsArrayValued()) {
-                editResult = DrawVtArrayValue(foundSample->second);
+                VtArrayPatch patch = DrawVtArrayValue(foundSample->second);
+                if (!patch.IsEmpty()) {
+                    ExecuteAfterDraw<AttributePatchArray>(attr->GetLayer(), attr->GetPath(), UsdTimeCode(foundSample->first),
+                                                          patch);
+                }
             } else {
-                editResult = DrawVtValue("##timeSampleValue", foundSample->second);
-            }
-
-            if (editResult != VtValue()) {
-                ExecuteAfterDraw(&SdfLayer::SetTimeSample<VtValue>, attr->GetLayer(), attr->GetPath(), foundSample->first,
-                                 editResult);
+                VtValue editResult = DrawVtValue("##timeSampleValue", foundSample->second);
+                if (editResult != VtValue()) {
+                    ExecuteAfterDraw(&SdfLayer::SetTimeSample<VtValue>, attr->GetLayer(), attr->GetPath(), foundSample->first,
+                                     editResult);
+                }
             }
         }
     }
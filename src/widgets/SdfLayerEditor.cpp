@@ -431,7 +431,7 @@ void DrawLayerNavigation(SdfLayerRefPtr layer) {
         }
         ImGui::SameLine();
         if (ImGui::Button(ICON_FA_SAVE)) {
-            ExecuteAfterDraw(&SdfLayer::Save, layer, false);
+            ExecuteAfterDraw<EditorSaveLayer>(layer);
         }
     }
     ImGui::SameLine();
@@ -467,7 +467,7 @@ void DrawLayerActionPopupMenu(SdfLayerHandle layer, bool isStage) {
         ExecuteAfterDraw<EditorOpenStage>(layer->GetRealPath());
     }
     if (layer->IsDirty() && !layer->IsAnonymous() && ImGui::MenuItem("Save layer")) {
-        ExecuteAfterDraw(&SdfLayer::Save, layer, true);
+        ExecuteAfterDraw<EditorSaveLayer>(layer);
     }
     if (ImGui::MenuItem("Save layer as")) {
         ExecuteAfterDraw<EditorSaveLayerAs>(layer);
@@ -457,6 +457,10 @@ void TraverseOpenedPaths(const SdfLayerRefPtr &layer, std::vector<SdfPath> &path
     }
 }
 
+static size_t layerPrimHierarchyRowCount = 0;
+
+size_t GetLayerPrimHierarchyRowCount() { return layerPrimHierarchyRowCount; }
+
 void DrawLayerPrimHierarchy(SdfLayerRefPtr layer, const Selection &selection) {
 
     if (!layer)
@@ -480,6 +484,7 @@ void DrawLayerPrimHierarchy(SdfLayerRefPtr layer, const Selection &selection) {
         // Find all the opened paths
         paths.reserve(1024);
         TraverseOpenedPaths(layer, paths);
+        layerPrimHierarchyRowCount = paths.size();
 
         int nodeId = 0;
         float selectedPosY = -1;
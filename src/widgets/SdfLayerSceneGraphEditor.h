@@ -10,3 +10,6 @@
 
 void DrawLayerPrimHierarchy(SdfLayerRefPtr layer, const Selection &selectedPrim);
 
+/// Number of rows found by the traversal of the opened prim specs in the last DrawLayerPrimHierarchy call
+size_t GetLayerPrimHierarchyRowCount();
+
@@ -2,14 +2,17 @@
 
 #include <vector>
 
+#include <pxr/base/tf/mallocTag.h>
 #include <pxr/usd/pcp/layerStack.h>
 #include <pxr/usd/usd/primRange.h>
 #include <pxr/usd/usdGeom/gprim.h>
 
 #include "Commands.h"
+#include "CompositionProfiler.h"
 #include "Constants.h"
 #include "Gui.h"
 #include "ImGuiHelpers.h"
+#include "MemoryPanel.h"
 #include "UsdPrimEditor.h" // for DrawUsdPrimEditTarget
 #include "StageOutliner.h"
 #include "VtValueEditor.h"
@@ -26,6 +29,8 @@ class StageOutlinerDisplayOptions {
 
     void ToggleShowPrototypes() { _showPrototypes = !_showPrototypes; }
 
+    void ToggleShowCompositionCost() { _showCompositionCost = !_showCompositionCost; }
+
     void ToggleShowInactive() {
         _showInactive = !_showInactive;
         ComputePrimFlagsPredicate();
@@ -48,6 +53,7 @@ class StageOutlinerDisplayOptions {
     bool GetShowUnloaded() const { return _showUnloaded; }
     bool GetShowAbstract() const { return _showAbstract; }
     bool GetShowUndefined() const { return _showUndefined; }
+    bool GetShowCompositionCost() const { return _showCompositionCost; }
 
   private:
     // Default is:
@@ -75,6 +81,7 @@ class StageOutlinerDisplayOptions {
     bool _showUnloaded = true;
     bool _showAbstract = false;
     bool _showPrototypes = true;
+    bool _showCompositionCost = true;
 };
 
 static void ExploreLayerTree(SdfLayerTreeHandle tree, PcpNodeRef node) {
@@ -212,7 +219,8 @@ static void DrawBackgroundSelection(const UsdPrim &prim, bool selected) {
 
 
 
-static void DrawPrimTreeRow(const UsdPrim &prim, Selection &selectedPaths, StageOutlinerDisplayOptions &displayOptions) {
+static void DrawPrimTreeRow(const UsdPrim &prim, Selection &selectedPaths, StageOutlinerDisplayOptions &displayOptions,
+                            bool showCompositionCost) {
     ImGuiTreeNodeFlags flags =
         ImGuiTreeNodeFlags_OpenOnArrow |
         ImGuiTreeNodeFlags_AllowItemOverlap; // for testing worse case scenario add | ImGuiTreeNodeFlags_DefaultOpen;
@@ -263,6 +271,12 @@ static void DrawPrimTreeRow(const UsdPrim &prim, Selection &selectedPaths, Stage
         // Type
         ImGui::TableSetColumnIndex(2);
         ImGui::Text("%s", prim.GetTypeName().GetText());
+
+        // Composition cost from the last profile
+        if (showCompositionCost) {
+            ImGui::TableSetColumnIndex(3);
+            DrawCompositionCostCell(prim.GetStage(), prim.GetPath());
+        }
     }
     if (unfolded) {
         ImGui::TreePop();
@@ -326,6 +340,7 @@ static void TraverseRange(UsdPrimRange &range, std::vector<SdfPath> &paths) {
         //
         // In the end we workaround this issue by keeping the instance proxy paths alive:
         if (iter->IsInstanceProxy()) {
+            TfAutoMallocTag2 tag(MallocTagEditor, MallocTagStageOutliner);
             retainedPath.insert(path);
         }
         paths.push_back(path);
@@ -391,6 +406,10 @@ void DrawStageOutlinerMenuBar(StageOutlinerDisplayOptions &displayOptions) {
             if (ImGui::MenuItem("Prototypes", nullptr, displayOptions.GetShowPrototypes())) {
                 displayOptions.ToggleShowPrototypes();
             }
+            ImGui::Separator();
+            if (ImGui::MenuItem("Composition cost", nullptr, displayOptions.GetShowCompositionCost())) {
+                displayOptions.ToggleShowCompositionCost();
+            }
             ImGui::EndMenu();
         }
         ImGui::EndMenuBar();
@@ -398,6 +417,10 @@ void DrawStageOutlinerMenuBar(StageOutlinerDisplayOptions &displayOptions) {
 }
 
 /// Draw the hierarchy of the stage
+static size_t stageOutlinerRowCount = 0;
+
+size_t GetStageOutlinerRowCount() { return stageOutlinerRowCount; }
+
 void DrawStageOutliner(UsdStageRefPtr stage, Selection &selectedPaths) {
     if (!stage)
         return;
@@ -417,11 +440,17 @@ void DrawStageOutliner(UsdStageRefPtr stage, Selection &selectedPaths) {
     ImGuiWindow *currentWindow = ImGui::GetCurrentWindow();
     ImVec2 tableOuterSize(0, currentWindow->Size[1] - 100); // TODO: set the correct size
     constexpr ImGuiTableFlags tableFlags = ImGuiTableFlags_SizingFixedFit | /*ImGuiTableFlags_RowBg |*/ ImGuiTableFlags_ScrollY;
-    if (ImGui::BeginTable("##DrawStageOutliner", 3, tableFlags, tableOuterSize)) {
-        ImGui::TableSetupScrollFreeze(3, 1); // Freeze the root node of the tree (the layer)
+    // The cost column is added only when the stage has been profiled in the composition profiler
+    const bool showCompositionCost = displayOptions.GetShowCompositionCost() && HasCompositionProfile(stage);
+    const int nbColumns = showCompositionCost ? 4 : 3;
+    if (ImGui::BeginTable("##DrawStageOutliner", nbColumns, tableFlags, tableOuterSize)) {
+        ImGui::TableSetupScrollFreeze(nbColumns, 1); // Freeze the root node of the tree (the layer)
         ImGui::TableSetupColumn("Hierarchy");
         ImGui::TableSetupColumn("V", ImGuiTableColumnFlags_WidthFixed, 40);
         ImGui::TableSetupColumn("Type");
+        if (showCompositionCost) {
+            ImGui::TableSetupColumn("Cost", ImGuiTableColumnFlags_WidthFixed, 50);
+        }
 
         // Unfold the selected path
         const bool selectionHasChanged = selectedPaths.UpdateSelectionHash(stage, lastSelectionHash);
@@ -434,6 +463,7 @@ void DrawStageOutliner(UsdStageRefPtr stage, Selection &selectedPaths) {
         std::vector<SdfPath> paths;
         paths.reserve(1024);
         TraverseOpenedPaths(stage, paths, displayOptions); // This must be inside the table scope to get the correct treenode hash table
+        stageOutlinerRowCount = paths.size();
 
         // Draw the tree root node, the layer
         DrawStageTreeRow(stage, selectedPaths);
@@ -446,7 +476,7 @@ void DrawStageOutliner(UsdStageRefPtr stage, Selection &selectedPaths) {
                 ImGui::PushID(row);
                 const SdfPath &path = paths[row];
                 const auto &prim = stage->GetPrimAtPath(path);
-                DrawPrimTreeRow(prim, selectedPaths, displayOptions);
+                DrawPrimTreeRow(prim, selectedPaths, displayOptions, showCompositionCost);
                 ImGui::PopID();
             }
         }
@@ -6,3 +6,6 @@ PXR_NAMESPACE_USING_DIRECTIVE
 
 // TODO: selected could be multiple Path, we should pass a HdSelection instead
 void DrawStageOutliner(UsdStageRefPtr stage, Selection &selectedPaths);
+
+/// Number of rows found by the traversal of the opened prims in the last DrawStageOutliner call
+size_t GetStageOutlinerRowCount();
@@ -1,15 +1,261 @@
 #include "Timeline.h"
 #include "Commands.h"
+#include "Constants.h"
 #include "Gui.h"
+#include "Playback.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <future>
 #include <iostream>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
-// The easiest version of a timeline: a slider
-void DrawTimeline(UsdStageRefPtr stage, UsdTimeCode &currentTimeCode) {
+#include <pxr/base/tf/notice.h>
+#include <pxr/base/tf/weakBase.h>
+#include <pxr/usd/usd/attribute.h>
+#include <pxr/usd/usd/notice.h>
+
+/// Time samples of the attributes of the selected prims, drawn as ticks on the timeline.
+/// The times are gathered per attribute by a worker thread and cached until the attribute is edited. The worker reads
+/// the stage while the frame is rendered, between StartTimelineTasks and StopTimelineTasks, when nothing edits it.
+class TimelineKeys : public TfWeakBase {
+  public:
+    TimelineKeys(const UsdStageRefPtr &stage) : _stage(stage) {
+        TfWeakPtr<TimelineKeys> me(this);
+        _objectsChangedKey = TfNotice::Register(me, &TimelineKeys::OnObjectsChanged, UsdStageWeakPtr(stage));
+    }
+
+    ~TimelineKeys() {
+        StopTask();
+        TfNotice::Revoke(_objectsChangedKey);
+    }
+
+    const UsdStageWeakPtr &GetStage() const { return _stage; }
+
+    /// Update the attributes of the selected prims and their keys
+    void Update(Selection &selection);
+
+    /// Start gathering the times of the attributes which are not cached
+    void StartTask();
+
+    /// Stop the worker and keep the times it has gathered
+    void StopTask();
+
+    bool IsGathering() const { return !_pending.empty(); }
+
+    /// Sorted times of the keys of all the selected attributes
+    const std::vector<double> &GetKeys() const { return _keys; }
+
+    /// Positions in pixels of the keys between the start and end times drawn on a given width. The keys falling in the
+    /// same pixel give only one tick, so the number of ticks is bounded by the width whatever the number of keys.
+    const std::vector<float> &GetTicks(double startTime, double endTime, float width);
+
+  private:
+    void OnObjectsChanged(const UsdNotice::ObjectsChanged &notice);
+    void UpdateKeys();
+
+    UsdStageWeakPtr _stage;
+    SelectionHash _selectionHash = 0;
+    bool _attributesChanged = true;
+    bool _keysChanged = true;
+    SdfPathVector _attributes;
+    SdfPathVector _pending;
+    std::unordered_map<SdfPath, std::vector<double>, SdfPath::Hash> _attributeTimes;
+    std::vector<double> _keys;
+
+    // Ticks of the last drawn range
+    std::vector<float> _ticks;
+    double _ticksStartTime = 0.0;
+    double _ticksEndTime = 0.0;
+    float _ticksWidth = 0.f;
+    bool _ticksChanged = true;
+
+    using GatheredTimes = std::vector<std::pair<SdfPath, std::vector<double>>>;
+    std::future<GatheredTimes> _task;
+    std::atomic<bool> _stopTask{false};
+    TfNotice::Key _objectsChangedKey;
+};
+
+void TimelineKeys::OnObjectsChanged(const UsdNotice::ObjectsChanged &notice) {
+    // The notices are sent by the edits, the worker is not running and the cache can be modified
+    auto invalidate = [&](const SdfPath &path) {
+        if (path.IsPropertyPath()) {
+            _keysChanged |= _attributeTimes.erase(path) != 0;
+            return;
+        }
+        for (auto it = _attributeTimes.begin(); it != _attributeTimes.end();) {
+            if (it->first.HasPrefix(path)) {
+                it = _attributeTimes.erase(it);
+                _keysChanged = true;
+            } else {
+                ++it;
+            }
+        }
+    };
+    for (const auto &path : notice.GetResyncedPaths()) {
+        invalidate(path);
+        _attributesChanged = true;
+    }
+    for (const auto &path : notice.GetChangedInfoOnlyPaths()) {
+        invalidate(path);
+    }
+}
+
+void TimelineKeys::Update(Selection &selection) {
+    UsdStageRefPtr stage = _stage;
+    if (!stage) {
+        return;
+    }
+    if (selection.UpdateSelectionHash(stage, _selectionHash)) {
+        _attributesChanged = true;
+    }
+    if (_attributesChanged) {
+        _attributes.clear();
+        for (const auto &path : selection.GetSelectedPaths(stage)) {
+            if (UsdPrim prim = stage->GetPrimAtPath(path)) {
+                for (const auto &attribute : prim.GetAuthoredAttributes()) {
+                    _attributes.push_back(attribute.GetPath());
+                }
+            }
+        }
+        _attributesChanged = false;
+        _keysChanged = true;
+    }
+    if (_keysChanged) {
+        UpdateKeys();
+    }
+    _pending.clear();
+    for (const auto &path : _attributes) {
+        if (_attributeTimes.find(path) == _attributeTimes.end()) {
+            _pending.push_back(path);
+        }
+    }
+}
+
+void TimelineKeys::StartTask() {
+    UsdStageRefPtr stage = _stage;
+    if (!stage || _pending.empty() || _task.valid()) {
+        return;
+    }
+    _stopTask = false;
+    // The attributes are pending again in the next update if the worker is stopped before reading them
+    _task = std::async(std::launch::async, [this, stage, pending = std::move(_pending)]() {
+        GatheredTimes gathered;
+        for (const auto &path : pending) {
+            if (_stopTask) {
+                break;
+            }
+            std::vector<double> times;
+            if (UsdAttribute attribute = stage->GetAttributeAtPath(path)) {
+                attribute.GetTimeSamples(&times);
+            }
+            gathered.emplace_back(path, std::move(times));
+        }
+        return gathered;
+    });
+}
+
+void TimelineKeys::StopTask() {
+    if (!_task.valid()) {
+        return;
+    }
+    _stopTask = true;
+    for (auto &times : _task.get()) {
+        _attributeTimes[times.first] = std::move(times.second);
+    }
+    _keysChanged = true;
+}
+
+void TimelineKeys::UpdateKeys() {
+    _keys.clear();
+    for (const auto &path : _attributes) {
+        const auto times = _attributeTimes.find(path);
+        if (times != _attributeTimes.end()) {
+            _keys.insert(_keys.end(), times->second.begin(), times->second.end());
+        }
+    }
+    std::sort(_keys.begin(), _keys.end());
+    _keys.erase(std::unique(_keys.begin(), _keys.end()), _keys.end());
+    _keysChanged = false;
+    _ticksChanged = true;
+}
+
+const std::vector<float> &TimelineKeys::GetTicks(double startTime, double endTime, float width) {
+    if (!_ticksChanged && startTime == _ticksStartTime && endTime == _ticksEndTime && width == _ticksWidth) {
+        return _ticks;
+    }
+    _ticks.clear();
+    _ticksStartTime = startTime;
+    _ticksEndTime = endTime;
+    _ticksWidth = width;
+    _ticksChanged = false;
+    if (endTime <= startTime || width <= 0.f) {
+        return _ticks;
+    }
+    const double timePerPixel = (endTime - startTime) / width;
+    auto key = std::lower_bound(_keys.begin(), _keys.end(), startTime);
+    while (key != _keys.end() && *key <= endTime) {
+        const double pixel = std::floor((*key - startTime) / timePerPixel);
+        _ticks.push_back(static_cast<float>(pixel));
+        // Skip the keys drawn on the same pixel
+        key = std::lower_bound(key + 1, _keys.end(), startTime + (pixel + 1.0) * timePerPixel);
+    }
+    return _ticks;
+}
+
+// Collected for the stage and selection shown by the timeline. Only accessed from the main thread
+static std::unique_ptr<TimelineKeys> timelineKeys;
+
+void StartTimelineTasks() {
+    if (timelineKeys) {
+        timelineKeys->StartTask();
+    }
+}
+
+void StopTimelineTasks() {
+    if (timelineKeys) {
+        timelineKeys->StopTask();
+    }
+}
+
+/// Draw the ticks of the keys on the frame of the slider which was just drawn
+static void DrawKeyTicks(TimelineKeys &keys, int startTime, int endTime) {
+    // Same geometry as the grab of ImGui::SliderInt, so the ticks are aligned with the frames
+    const ImVec2 frameMin = ImGui::GetItemRectMin();
+    const ImVec2 frameMax = ImGui::GetItemRectMax();
+    constexpr float grabPadding = 2.f;
+    const float sliderSize = frameMax.x - frameMin.x - grabPadding * 2.f;
+    const float grabSize =
+        std::min(std::max(sliderSize / static_cast<float>(endTime - startTime + 1), ImGui::GetStyle().GrabMinSize), sliderSize);
+    const float usableSize = sliderSize - grabSize;
+    const float usableMin = frameMin.x + grabPadding + grabSize * 0.5f;
+    const float tickTop = frameMax.y - (frameMax.y - frameMin.y) * 0.35f;
+    const ImU32 tickColor = ImGui::GetColorU32(ImVec4(ColorTimelineKey));
+    ImDrawList *drawList = ImGui::GetWindowDrawList();
+    for (const float tick : keys.GetTicks(startTime, endTime, usableSize)) {
+        drawList->AddLine(ImVec2(usableMin + tick, tickTop), ImVec2(usableMin + tick, frameMax.y - 1.f), tickColor);
+    }
+}
+
+// The easiest version of a timeline: a slider with the keys of the selected prims
+void DrawTimeline(UsdStageRefPtr stage, UsdTimeCode &currentTimeCode, Playback &playback, Selection &selection) {
     const bool hasStage = stage;
     constexpr int widgetWidth = 80;
     int startTime = hasStage ? static_cast<int>(stage->GetStartTimeCode()) : 0;
     int endTime = hasStage ? static_cast<int>(stage->GetEndTimeCode()) : 0;
 
+    if (hasStage && (!timelineKeys || timelineKeys->GetStage() != stage)) {
+        timelineKeys = std::make_unique<TimelineKeys>(stage);
+    } else if (!hasStage) {
+        timelineKeys.reset();
+    }
+    if (timelineKeys) {
+        timelineKeys->Update(selection);
+    }
+
     // Start time
     ImGui::PushItemWidth(widgetWidth);
     ImGui::InputInt("##Start", &startTime, 0);
@@ -19,14 +265,48 @@ void DrawTimeline(UsdStageRefPtr stage, UsdTimeCode &currentTimeCode) {
         }
     }
 
+    // Previous key
+    ImGui::SameLine();
+    static const std::vector<double> noKeys;
+    const std::vector<double> &keys = timelineKeys ? timelineKeys->GetKeys() : noKeys;
+    const double currentTime = currentTimeCode.GetValue();
+    const auto nextKey = std::upper_bound(keys.begin(), keys.end(), currentTime);
+    const auto previousKey = std::lower_bound(keys.begin(), keys.end(), currentTime);
+    ImGui::BeginDisabled(previousKey == keys.begin());
+    if (ImGui::ArrowButton("##PreviousKey", ImGuiDir_Left)) {
+        currentTimeCode = UsdTimeCode(*std::prev(previousKey));
+    }
+    ImGui::EndDisabled();
+    if (ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled)) {
+        ImGui::SetTooltip("Previous key of the selected prims");
+    }
+
     // Frame Slider
     ImGui::SameLine();
-    ImGui::PushItemWidth(ImGui::GetWindowWidth() -
-                         6 * widgetWidth); // 6 to account for the 5 input widgets and the space between them
+    const ImGuiStyle &style = ImGui::GetStyle();
+    // 7 to account for the 6 input widgets and the space between them, plus the key buttons
+    ImGui::PushItemWidth(ImGui::GetWindowWidth() - 7 * widgetWidth - 2 * (ImGui::GetFrameHeight() + style.ItemSpacing.x));
     int currentTimeSlider = static_cast<int>(currentTimeCode.GetValue());
     if (ImGui::SliderInt("##SliderFrame", &currentTimeSlider, startTime, endTime)) {
         currentTimeCode = static_cast<UsdTimeCode>(currentTimeSlider);
     }
+    if (timelineKeys) {
+        DrawKeyTicks(*timelineKeys, startTime, endTime);
+        if (timelineKeys->IsGathering() && ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Reading the keys of the selected prims");
+        }
+    }
+
+    // Next key
+    ImGui::SameLine();
+    ImGui::BeginDisabled(nextKey == keys.end());
+    if (ImGui::ArrowButton("##NextKey", ImGuiDir_Right)) {
+        currentTimeCode = UsdTimeCode(*nextKey);
+    }
+    ImGui::EndDisabled();
+    if (ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled)) {
+        ImGui::SetTooltip("Next key of the selected prims");
+    }
 
     // End time
     ImGui::SameLine();
@@ -41,11 +321,11 @@ void DrawTimeline(UsdStageRefPtr stage, UsdTimeCode &currentTimeCode) {
     // Frame input
     ImGui::SameLine();
     ImGui::PushItemWidth(widgetWidth);
-    double currentTime = currentTimeCode.GetValue();
-    ImGui::InputDouble("##Frame", &currentTime);
+    double frameTime = currentTimeCode.GetValue();
+    ImGui::InputDouble("##Frame", &frameTime);
     if (ImGui::IsItemDeactivatedAfterEdit()) {
-        if (currentTimeCode.GetValue() != static_cast<double>(currentTime)) {
-            currentTimeCode = static_cast<UsdTimeCode>(currentTime);
+        if (currentTimeCode.GetValue() != static_cast<double>(frameTime)) {
+            currentTimeCode = static_cast<UsdTimeCode>(frameTime);
         }
     }
 
@@ -62,4 +342,18 @@ void DrawTimeline(UsdStageRefPtr stage, UsdTimeCode &currentTimeCode) {
     if (ImGui::Button("Stop", ImVec2(widgetWidth, 0))) {
         ExecuteAfterDraw<EditorStopPlayback>();
     }
+
+    // Playback settings and frame rate
+    ImGui::SameLine();
+    char fpsLabel[32];
+    snprintf(fpsLabel, sizeof(fpsLabel), "%.0f fps###PlaybackSettings", playback.GetAchievedFramesPerSecond());
+    ImGui::Button(fpsLabel, ImVec2(widgetWidth, 0));
+    if (ImGui::BeginPopupContextItem(nullptr, ImGuiPopupFlags_MouseButtonLeft)) {
+        playback.DrawSettings();
+        ImGui::EndPopup();
+    }
+    if (ImGui::IsItemHovered() && GImGui->HoveredIdTimer > 1) {
+        ImGui::SetTooltip("Achieved %.1f fps, target %.1f fps", playback.GetAchievedFramesPerSecond(),
+                          playback.GetTargetFramesPerSecond());
+    }
 }
@@ -1,6 +1,15 @@
 #pragma once
 #include <pxr/usd/usd/stage.h>
+#include "Selection.h"
 
 PXR_NAMESPACE_USING_DIRECTIVE
 
-void DrawTimeline(UsdStageRefPtr stage, UsdTimeCode &currentTimeCode);
+class Playback;
+
+/// Draw the timeline with the keys of the attributes of the selected prims
+void DrawTimeline(UsdStageRefPtr stage, UsdTimeCode &currentTimeCode, Playback &playback, Selection &selection);
+
+/// The keys of the timeline are read by a worker thread which must only run while the stage is not edited: it is
+/// started once the editor is drawn and stopped before the commands are executed
+void StartTimelineTasks();
+void StopTimelineTasks();
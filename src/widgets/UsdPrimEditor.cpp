@@ -1,8 +1,12 @@
 #include <iostream>
+#include <unordered_map>
+#include <unordered_set>
 #include <pxr/usd/usd/prim.h>
 #include <pxr/usd/usd/primRange.h>
 #include <pxr/usd/usd/variantSets.h>
 #include <pxr/usd/usd/primCompositionQuery.h>
+#include <pxr/usd/usd/attributeQuery.h>
+#include <pxr/usd/usd/notice.h>
 #include <pxr/usd/usdGeom/gprim.h>
 #include <pxr/usd/usdGeom/xformCommonAPI.h>
 #include <pxr/usd/pcp/node.h>
@@ -16,11 +20,13 @@
 #include "ModalDialogs.h"
 #include "ImGuiHelpers.h"
 #include "TableLayouts.h"
+#include "SchemaTypeIndex.h"
 
 PXR_NAMESPACE_USING_DIRECTIVE
 
 
 /// A material browser which keeps a cache of the current material list until it is reset.
+/// The materials come from the stage schema type index, so resetting the cache doesn't traverse the stage
 ///
 struct MaterialList {
     // Returns true if a material was selected. SdfPath() is the empty material.
@@ -62,12 +68,7 @@ struct MaterialList {
         if (!stage)
             return;
 
-        UsdPrimRange range = stage->Traverse();
-        for (const auto &prim : range) {
-            if (prim.IsA<UsdShadeMaterial>()) {
-                _materialPaths.push_back(prim.GetPath());
-            }
-        }
+        _materialPaths = GetSchemaTypeIndex(stage).GetPrimPaths<UsdShadeMaterial>();
     }
 
     bool _cacheValid = false;
@@ -180,13 +181,8 @@ void DrawAttributeDisplayName(const UsdAttribute &attribute) {
     ImGui::Text("%s", displayName.c_str());
 }
 
-void DrawAttributeValueAtTime(UsdAttribute &attribute, UsdTimeCode currentTime) {
-    const std::string attributeLabel = GetDisplayName(attribute);
-    VtValue value;
-    // TODO: On the lower spec mac, this call appears to be really slow with some attributes
-    //       AttributeQuery could be a solution but doesn't update with external data updates
-    const bool HasValue = attribute.Get(&value, currentTime);
-
+static void DrawAttributeValueAtTime(UsdAttribute &attribute, const std::string &attributeLabel, const VtValue &value,
+                                     bool HasValue, UsdTimeCode currentTime) {
     if (HasValue) {
         VtValue modified = DrawAttributeValue(attributeLabel, attribute, value);
         if (!modified.IsEmpty()) {
@@ -215,6 +211,15 @@ void DrawAttributeValueAtTime(UsdAttribute &attribute, UsdTimeCode currentTime)
     }
 }
 
+void DrawAttributeValueAtTime(UsdAttribute &attribute, UsdTimeCode currentTime) {
+    const std::string attributeLabel = GetDisplayName(attribute);
+    VtValue value;
+    // TODO: On the lower spec mac, this call appears to be really slow with some attributes
+    //       The property editor uses the attribute queries cached in PropertyList instead
+    const bool HasValue = attribute.Get(&value, currentTime);
+    DrawAttributeValueAtTime(attribute, attributeLabel, value, HasValue, currentTime);
+}
+
 void DrawUsdRelationshipDisplayName(const UsdRelationship &relationship) {
     std::string relationshipName = GetDisplayName(relationship);
     ImVec4 attributeNameColor = relationship.IsAuthored() ? ImVec4(ColorAttributeAuthored) : ImVec4(ColorAttributeUnauthored);
@@ -671,6 +676,111 @@ void DrawUsdPrimHeader(UsdPrim &prim) {
     }
 }
 
+/// Cached list of the properties of the prim shown in the property editor, with an attribute query per attribute
+/// to speed up the value resolution. The list is rebuilt only when the prim or its properties are added or removed,
+/// the queries don't update with the scene description changes so the query of a modified attribute is recreated.
+/// The height of the rows is kept as the rows with connections or relationship targets are taller than the others.
+class PropertyList : public TfWeakBase {
+  public:
+    struct AttributeRow {
+        UsdAttribute attribute;
+        UsdAttributeQuery query;
+        std::string displayName;
+        float height;
+    };
+
+    struct RelationshipRow {
+        UsdRelationship relationship;
+        float height;
+    };
+
+    ~PropertyList() { TfNotice::Revoke(_objectsChangedKey); }
+
+    void Update(const UsdPrim &prim) {
+        const UsdStageWeakPtr stage = prim.GetStage();
+        if (stage != _stage) {
+            TfNotice::Revoke(_objectsChangedKey);
+            _stage = stage;
+            if (_stage) {
+                TfWeakPtr<PropertyList> me(this);
+                _objectsChangedKey = TfNotice::Register(me, &PropertyList::OnObjectsChanged, _stage);
+            }
+            _isDirty = true;
+        }
+        if (prim.GetPath() != _primPath) {
+            _primPath = prim.GetPath();
+            _isDirty = true;
+        }
+        if (_isDirty) {
+            _attributes.clear();
+            _relationships.clear();
+            _attributeIndices.clear();
+            for (const auto &attribute : prim.GetAttributes()) {
+                _attributeIndices[attribute.GetName()] = _attributes.size();
+                _attributes.push_back({attribute, UsdAttributeQuery(attribute), GetDisplayName(attribute), TableRowDefaultHeight});
+            }
+            for (const auto &relationship : prim.GetRelationships()) {
+                _relationships.push_back({relationship, TableRowDefaultHeight});
+            }
+            _isDirty = false;
+        } else {
+            for (const auto &name : _changedAttributes) {
+                const auto attributeIndex = _attributeIndices.find(name);
+                if (attributeIndex != _attributeIndices.end()) {
+                    AttributeRow &row = _attributes[attributeIndex->second];
+                    row.query = UsdAttributeQuery(row.attribute);
+                }
+            }
+        }
+        _changedAttributes.clear();
+    }
+
+    std::vector<AttributeRow> &GetAttributes() { return _attributes; }
+    std::vector<RelationshipRow> &GetRelationships() { return _relationships; }
+
+  private:
+    void OnObjectsChanged(const UsdNotice::ObjectsChanged &notice, const UsdStageWeakPtr &sender) {
+        if (_isDirty) {
+            return;
+        }
+        // A resync of an ancestor, the prim or one of its properties, the properties might have been added or removed
+        for (const auto &path : notice.GetResyncedPaths()) {
+            if (_primPath.HasPrefix(path) || path.GetPrimPath() == _primPath) {
+                _isDirty = true;
+                return;
+            }
+        }
+        // New opinions on a property only invalidate its attribute query
+        for (const auto &path : notice.GetChangedInfoOnlyPaths()) {
+            if (path.IsPropertyPath() && path.GetPrimPath() == _primPath) {
+                _changedAttributes.insert(path.GetNameToken());
+            }
+        }
+    }
+
+    UsdStageWeakPtr _stage;
+    SdfPath _primPath;
+    bool _isDirty = true;
+    TfNotice::Key _objectsChangedKey;
+    std::vector<AttributeRow> _attributes;
+    std::vector<RelationshipRow> _relationships;
+    std::unordered_map<TfToken, size_t, TfToken::HashFunctor> _attributeIndices;
+    std::unordered_set<TfToken, TfToken::HashFunctor> _changedAttributes;
+};
+
+/// Starts a row of the property table with the last known height of the row. Returns true if the row is visible and
+/// its content must be drawn, otherwise the row is left empty and keeps its height so the rows below don't move.
+static bool BeginPropertyRow(float rowHeight) {
+    ImGui::TableNextRow(ImGuiTableRowFlags_None, rowHeight);
+    ImGui::TableSetColumnIndex(0);
+    return ImGui::IsRectVisible(ImVec2(1.f, rowHeight));
+}
+
+/// Returns the height of the row which was just drawn, measured from the bottom of the items of its cells
+static float MeasurePropertyRow(float cellTop, float cellBottom) {
+    return std::max(TableRowDefaultHeight, cellBottom - cellTop + 2.f * ImGui::GetStyle().CellPadding.y);
+}
+
 void DrawUsdPrimProperties(UsdPrim &prim, UsdTimeCode currentTime) {
 
     DrawPropertyEditorMenuBar(prim, 0);
@@ -708,44 +818,61 @@ void DrawUsdPrimProperties(UsdPrim &prim, UsdTimeCode currentTime) {
             ImGui::TableSetupColumn("Value");
             ImGui::TableHeadersRow();
 
-            int miniButtonId = 0;
             const auto &editTarget = prim.GetStage()->GetEditTarget();
-
-            // Draw attributes
-            for (auto &attribute : prim.GetAttributes()) {
-                ImGui::TableNextRow(ImGuiTableRowFlags_None, TableRowDefaultHeight);
-                ImGui::TableSetColumnIndex(0);
-                ImGui::PushID(miniButtonId++);
+            static PropertyList propertyList; // We expect only one thread running this code
+            propertyList.Update(prim);
+            auto &attributes = propertyList.GetAttributes();
+            auto &relationships = propertyList.GetRelationships();
+
+            // Only the visible rows are drawn and resolve their values. The rows outside the view are kept empty with
+            // the height they had when last drawn, as the rows with connections or relationship targets are taller.
+            for (auto &attributeRow : attributes) {
+                if (!BeginPropertyRow(attributeRow.height)) {
+                    continue;
+                }
+                UsdAttribute &attribute = attributeRow.attribute;
+                ImGui::PushID(attribute.GetPath().GetHash());
+                const float cellTop = ImGui::GetCursorScreenPos().y;
                 DrawPropertyMiniButton(attribute, editTarget, currentTime);
-                ImGui::PopID();
+                float cellBottom = ImGui::GetItemRectMax().y;
 
                 ImGui::TableSetColumnIndex(1);
-                DrawAttributeDisplayName(attribute);
+                ImGui::Text("%s", attributeRow.displayName.c_str());
+                cellBottom = std::max(cellBottom, ImGui::GetItemRectMax().y);
 
                 ImGui::TableSetColumnIndex(2);
                 ImGui::PushItemWidth(-FLT_MIN); // Right align and get rid of widget label
-                ImGui::PushID(attribute.GetPath().GetHash());
-                DrawAttributeValueAtTime(attribute, currentTime);
-                ImGui::PopID();
+                VtValue value;
+                const bool hasValue = attributeRow.query.Get(&value, currentTime);
+                DrawAttributeValueAtTime(attribute, attributeRow.displayName, value, hasValue, currentTime);
+                cellBottom = std::max(cellBottom, ImGui::GetItemRectMax().y);
                 ImGui::PopItemWidth();
+                ImGui::PopID();
+                attributeRow.height = MeasurePropertyRow(cellTop, cellBottom);
                 // TODO: in the hint ???
                 // DrawAttributeTypeInfo(attribute);
             }
 
             // Draw relations
-            for (auto &relationship : prim.GetRelationships()) {
-                ImGui::TableNextRow();
-
-                ImGui::TableSetColumnIndex(0);
-                ImGui::PushID(miniButtonId++);
+            for (auto &relationshipRow : relationships) {
+                if (!BeginPropertyRow(relationshipRow.height)) {
+                    continue;
+                }
+                UsdRelationship &relationship = relationshipRow.relationship;
+                ImGui::PushID(relationship.GetPath().GetHash());
+                const float cellTop = ImGui::GetCursorScreenPos().y;
                 DrawPropertyMiniButton(relationship, editTarget, currentTime);
-                ImGui::PopID();
+                float cellBottom = ImGui::GetItemRectMax().y;
 
                 ImGui::TableSetColumnIndex(1);
                 DrawUsdRelationshipDisplayName(relationship);
+                cellBottom = std::max(cellBottom, ImGui::GetItemRectMax().y);
 
                 ImGui::TableSetColumnIndex(2);
                 DrawUsdRelationshipList(relationship);
+                cellBottom = std::max(cellBottom, ImGui::GetItemRectMax().y);
+                ImGui::PopID();
+                relationshipRow.height = MeasurePropertyRow(cellTop, cellBottom);
             }
 
             ImGui::EndTable();
@@ -1,4 +1,5 @@
 #include "VtArrayEditor.h"
+#include "ArrayStatistics.h"
 #include "Commands.h"
 #include "Gui.h"
 #include "VtValueEditor.h"
@@ -23,8 +24,9 @@ template <> int HeightOf<GfMatrix3f>() { return HeightOf<float>() * 3; }
 template <> int HeightOf<GfMatrix2d>() { return HeightOf<double>() * 2; }
 template <> int HeightOf<GfMatrix2f>() { return HeightOf<float>() * 2; }
 
-// Returns true if a modification happened
-template <typename ValueT> inline bool DrawVtArray(VtArray<ValueT> &values) {
+// Returns a patch with the modified elements, or an empty patch if nothing was modified.
+// The array is only read, a non const access would copy the whole array at every frame if it is shared with the layer
+template <typename ValueT> inline VtArrayPatch DrawVtArray(const VtArray<ValueT> &values) {
     auto arraySize = values.size();
     bool addRow = ImGui::Button(ICON_FA_PLUS "##Add");
 
@@ -77,46 +79,36 @@ template <typename ValueT> inline bool DrawVtArray(VtArray<ValueT> &values) {
         ImGui::EndTable();
         // the actions need to happen after the clipper.Step() because it calls the draw code multiple times
         // to determine the size of the rows
-        if (newResult != VtValue()) {
-            values[rowToModify] = newResult.Get<ValueT>();
-            return true;
+        if (newResult.IsHolding<ValueT>()) {
+            return VtArrayPatch(rowToModify, VtArray<ValueT>{values[rowToModify]}, VtArray<ValueT>{newResult.UncheckedGet<ValueT>()});
         } else if (deleteRow) {
-            values.erase(values.begin() + rowToModify);
-            return true;
+            return VtArrayPatch(rowToModify, VtArray<ValueT>{values[rowToModify]}, VtArray<ValueT>());
         } else if (moveUp) {
             if (rowToModify > 0) {
-                std::swap(values[rowToModify], values[rowToModify - 1]);
-                return true;
+                return VtArrayPatch(rowToModify - 1, VtArray<ValueT>{values[rowToModify - 1], values[rowToModify]},
+                                    VtArray<ValueT>{values[rowToModify], values[rowToModify - 1]});
             }
         } else if (moveDown) {
             if (rowToModify + 1 < values.size()) {
-                std::swap(values[rowToModify], values[rowToModify + 1]);
-                return true;
+                return VtArrayPatch(rowToModify, VtArray<ValueT>{values[rowToModify], values[rowToModify + 1]},
+                                    VtArray<ValueT>{values[rowToModify + 1], values[rowToModify]});
             }
         } else if (addRow) {
-            values.push_back(ValueT());
-            return true;
+            return VtArrayPatch(arraySize, VtArray<ValueT>(), VtArray<ValueT>{ValueT()});
         }
     }
-    return false;
-}
-
-template <typename ValueT> inline VtValue DrawVtValueArrayTyped(const VtValue &value) {
-    auto newArray = value.Get<VtArray<ValueT>>();
-    if (DrawVtArray<ValueT>(newArray))
-        return VtValue(newArray);
-    else
-        return VtValue();
+    return VtArrayPatch();
 }
 
 #define DrawArrayIfHolding(ValueT)                                                                                               \
     if (value.IsHolding<VtArray<ValueT>>()) {                                                                                    \
-        newValue = DrawVtValueArrayTyped<ValueT>(value);                                                                         \
+        patch = DrawVtArray<ValueT>(value.UncheckedGet<VtArray<ValueT>>());                                                      \
     } else
 
-VtValue DrawVtArrayValue(const VtValue &value) {
-    VtValue newValue;
+VtArrayPatch DrawVtArrayValue(const VtValue &value) {
+    VtArrayPatch patch;
     if (value.IsArrayValued()) {
+        DrawVtArrayStatistics(value);
         // Ideally we would like to order the conditions test by the probablility
         // of appearance of the type
         // clang-format off
@@ -156,5 +148,5 @@ VtValue DrawVtArrayValue(const VtValue &value) {
         DrawArrayIfHolding(GfQuatd)
         {}
     }
-    return newValue;
+    return patch;
 }
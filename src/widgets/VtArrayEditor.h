@@ -3,7 +3,10 @@
 #include <pxr/usd/sdf/path.h>
 #include <pxr/usd/sdf/layer.h>
 #include "Selection.h"
+#include "VtArrayPatch.h"
 
 PXR_NAMESPACE_USING_DIRECTIVE
 
-VtValue DrawVtArrayValue(const VtValue &value);
+/// Draw an array editor, returns the modified elements as a patch to apply on the array, the patch is empty if
+/// nothing was edited
+VtArrayPatch DrawVtArrayValue(const VtValue &value);